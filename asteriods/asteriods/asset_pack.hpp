@@ -0,0 +1,237 @@
+#ifndef __ASSET_PACK_HPP__
+#define __ASSET_PACK_HPP__
+
+#include "mapped_file.hpp"
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+
+// many files bundled into one, read through a single mapping.
+//
+// layout:
+//   asset_pack_header
+//   file contents, each one starting at a multiple of ASSET_PACK_ALIGNMENT
+//   table of contents: asset_pack_entry * entry_count_
+//   names: the chars of every entry's name back to back
+//
+// names are paths relative to the pack's root with '/' separators and lower case letters(see virtual_file_system::name_of()).
+// contents are stored as they are on disk: images stay encoded, mesh caches keep their own layout.
+static constexpr const std::uint32_t ASSET_PACK_VERSION{ 1 };
+static constexpr const char ASSET_PACK_MAGIC[8]{ 'A', 'S', 'S', 'E', 'T', 'P', 'A', 'K' };
+
+// enough for every array a mesh cache maps in place.
+static constexpr const std::size_t ASSET_PACK_ALIGNMENT{ 16 };
+
+struct asset_pack_header
+{
+	char magic_[8];
+	std::uint32_t version_;
+	std::uint32_t entry_count_;
+	std::uint64_t toc_offset_;
+	std::uint64_t names_offset_;
+	std::uint64_t names_size_;
+};
+
+struct asset_pack_entry
+{
+	std::uint64_t offset_;
+	std::uint64_t size_;
+	std::uint32_t name_offset_;
+	std::uint32_t name_length_;
+};
+
+static_assert(sizeof(asset_pack_entry) == 24, "asset_pack_entry is written as it is");
+
+
+// a mounted pack, lookups are read only and may run on any thread.
+class asset_pack final
+{
+private:
+	std::basic_string<char> pack_file_{};
+	std::shared_ptr<mapped_file> file_{};
+	std::unordered_map<std::basic_string<char>, asset_pack_entry> entries_{};
+
+public:
+	asset_pack() = default;
+	asset_pack(const asset_pack&) = delete;
+	asset_pack& operator=(const asset_pack&) = delete;
+
+	const std::basic_string<char>& get_pack_file()const noexcept
+	{
+		return this->pack_file_;
+	}
+
+	std::size_t get_entry_count()const noexcept
+	{
+		return this->entries_.size();
+	}
+
+	// the mapping, shared with every view handed out so it outlives the pack if needed.
+	const std::shared_ptr<mapped_file>& get_file()const noexcept
+	{
+		return this->file_;
+	}
+
+	bool open(const std::basic_string<char>& pack_file)
+	{
+		this->pack_file_ = pack_file;
+		this->file_ = std::make_shared<mapped_file>();
+		if (!this->file_->open(pack_file))
+		{
+			this->file_.reset();
+			return false;
+		}
+
+		if (!this->parse())
+		{
+			std::cout << "ASSET_PACK:: corrupted pack: " << pack_file << std::endl;
+			this->entries_.clear();
+			this->file_.reset();
+			return false;
+		}
+
+		return true;
+	}
+
+	// contents of the entry called name, false when the pack has none.
+	bool find(const std::basic_string<char>& name, const unsigned char*& data, std::size_t& size)const
+	{
+		auto entry_itr{ this->entries_.find(name) };
+		if (entry_itr == this->entries_.end())
+		{
+			return false;
+		}
+
+		data = this->file_->get_data() + entry_itr->second.offset_;
+		size = static_cast<std::size_t>(entry_itr->second.size_);
+		return true;
+	}
+
+	// files is a list of { name, path on disk }, written to a temporary file first so a crash never leaves a half pack.
+	static bool write(const std::basic_string<char>& pack_file, const std::vector<std::pair<std::basic_string<char>, std::basic_string<char>>>& files)
+	{
+		std::basic_string<char> temp_file{ pack_file + ".tmp" };
+		std::basic_ofstream<char> file_writer{ temp_file, std::ios::binary | std::ios::trunc };
+		if (!file_writer.is_open())
+		{
+			std::cout << "ASSET_PACK:: can not write pack: " << temp_file << std::endl;
+			return false;
+		}
+
+		// rewritten once the offsets are known.
+		asset_pack_header header{};
+		file_writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		std::uint64_t offset{ sizeof(header) };
+
+		std::vector<asset_pack_entry> entries{};
+		std::basic_string<char> names{};
+		for (const auto& file : files)
+		{
+			mapped_file source{};
+			if (!source.open(file.second))
+			{
+				std::cout << "ASSET_PACK:: skipping missing or empty file: " << file.second << std::endl;
+				continue;
+			}
+
+			static constexpr const char padding[ASSET_PACK_ALIGNMENT]{};
+			std::uint64_t aligned{ (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT };
+			file_writer.write(padding, static_cast<std::streamsize>(aligned - offset));
+
+			asset_pack_entry entry{};
+			entry.offset_ = aligned;
+			entry.size_ = source.get_size();
+			entry.name_offset_ = static_cast<std::uint32_t>(names.size());
+			entry.name_length_ = static_cast<std::uint32_t>(file.first.size());
+			entries.push_back(entry);
+			names += file.first;
+
+			file_writer.write(reinterpret_cast<const char*>(source.get_data()), static_cast<std::streamsize>(source.get_size()));
+			offset = aligned + source.get_size();
+		}
+
+		std::memcpy(header.magic_, ASSET_PACK_MAGIC, sizeof(header.magic_));
+		header.version_ = ASSET_PACK_VERSION;
+		header.entry_count_ = static_cast<std::uint32_t>(entries.size());
+		header.toc_offset_ = offset;
+		header.names_offset_ = offset + entries.size() * sizeof(asset_pack_entry);
+		header.names_size_ = names.size();
+
+		file_writer.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(asset_pack_entry)));
+		file_writer.write(names.data(), static_cast<std::streamsize>(names.size()));
+		file_writer.seekp(0);
+		file_writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		file_writer.close();
+		if (!file_writer)
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		std::remove(pack_file.c_str());
+		if (std::rename(temp_file.c_str(), pack_file.c_str()) != 0)
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	bool parse()
+	{
+		const unsigned char* data{ this->file_->get_data() };
+		std::size_t size{ this->file_->get_size() };
+		if (size < sizeof(asset_pack_header))
+		{
+			return false;
+		}
+
+		asset_pack_header header{};
+		std::memcpy(&header, data, sizeof(header));
+		if (std::memcmp(header.magic_, ASSET_PACK_MAGIC, sizeof(header.magic_)) != 0 || header.version_ != ASSET_PACK_VERSION)
+		{
+			return false;
+		}
+
+		std::uint64_t toc_bytes{ static_cast<std::uint64_t>(header.entry_count_) * sizeof(asset_pack_entry) };
+		if (header.toc_offset_ > size || toc_bytes > size - header.toc_offset_ ||
+			header.names_offset_ > size || header.names_size_ > size - header.names_offset_)
+		{
+			return false;
+		}
+
+		this->entries_.reserve(header.entry_count_);
+		for (std::uint32_t index = 0; index < header.entry_count_; ++index)
+		{
+			asset_pack_entry entry{};
+			std::memcpy(&entry, data + header.toc_offset_ + index * sizeof(asset_pack_entry), sizeof(entry));
+			if (entry.offset_ > size || entry.size_ > size - entry.offset_ ||
+				static_cast<std::uint64_t>(entry.name_offset_) + entry.name_length_ > header.names_size_)
+			{
+				return false;
+			}
+
+			const char* name{ reinterpret_cast<const char*>(data + header.names_offset_ + entry.name_offset_) };
+			this->entries_[std::basic_string<char>{ name, entry.name_length_ }] = entry;
+		}
+
+		return true;
+	}
+};
+
+
+#endif // !__ASSET_PACK_HPP__
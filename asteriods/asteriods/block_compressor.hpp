@@ -0,0 +1,491 @@
+#ifndef __BLOCK_COMPRESSOR_HPP__
+#define __BLOCK_COMPRESSOR_HPP__
+
+#include "thread_pool.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+// the block compressed formats the texture cooker writes, all of them 4x4 texel blocks.
+enum class block_format
+{
+	// rgb, 5:6:5 endpoints and 2 bit indices, 8 bytes a block.
+	bc1,
+	// bc1 colors plus a bc4 alpha block, 16 bytes.
+	bc3,
+	// two bc4 blocks for red and green, meant for tangent space normal maps, 16 bytes.
+	bc5,
+	// rgba, 16 bytes. only mode 6 is written: one subset, 7 bit endpoints with a shared bit, 4 bit indices.
+	bc7
+};
+
+
+// offline encoders for block_format, quality over speed is not a goal: principal axis endpoints and nearest indices,
+// with one least squares refit for bc1. meant for texture_cooker, never for the frame loop.
+class block_compressor final
+{
+public:
+	static std::size_t block_bytes(block_format format)noexcept
+	{
+		return format == block_format::bc1 ? 8 : 16;
+	}
+
+	// bytes of one level of width x height texels, partial blocks at the edges count as whole ones.
+	static std::size_t level_bytes(block_format format, int width, int height)noexcept
+	{
+		std::size_t blocks_x{ static_cast<std::size_t>(std::max(1, (width + 3) / 4)) };
+		std::size_t blocks_y{ static_cast<std::size_t>(std::max(1, (height + 3) / 4)) };
+		return blocks_x * blocks_y * block_compressor::block_bytes(format);
+	}
+
+	// rgba holds width x height texels of 4 bytes, rows of blocks are encoded on the worker pool.
+	// texels past the right and bottom edges repeat the last column and row.
+	static std::vector<std::uint8_t> compress(const std::uint8_t* rgba, int width, int height, block_format format)
+	{
+		std::size_t blocks_x{ static_cast<std::size_t>(std::max(1, (width + 3) / 4)) };
+		std::size_t blocks_y{ static_cast<std::size_t>(std::max(1, (height + 3) / 4)) };
+		std::size_t block_size{ block_compressor::block_bytes(format) };
+
+		std::vector<std::uint8_t> compressed(blocks_x * blocks_y * block_size);
+		thread_pool::shared().parallel_for(blocks_y, [&](std::size_t block_y)
+		{
+			std::uint8_t block[64]{};
+			for (std::size_t block_x = 0; block_x < blocks_x; ++block_x)
+			{
+				for (int texel = 0; texel < 16; ++texel)
+				{
+					int x{ std::min(static_cast<int>(block_x) * 4 + texel % 4, width - 1) };
+					int y{ std::min(static_cast<int>(block_y) * 4 + texel / 4, height - 1) };
+					std::memcpy(block + texel * 4, rgba + (static_cast<std::size_t>(y) * width + x) * 4, 4);
+				}
+
+				std::uint8_t* out{ compressed.data() + (block_y * blocks_x + block_x) * block_size };
+				switch (format)
+				{
+				case block_format::bc1: block_compressor::encode_bc1(block, out); break;
+				case block_format::bc3: block_compressor::encode_bc3(block, out); break;
+				case block_format::bc5: block_compressor::encode_bc5(block, out); break;
+				case block_format::bc7: block_compressor::encode_bc7(block, out); break;
+				}
+			}
+		});
+
+		return compressed;
+	}
+
+	// block is 16 rgba texels, row major.
+	static void encode_bc1(const std::uint8_t block[64], std::uint8_t out[8])
+	{
+		float texels[16][4]{};
+		block_compressor::to_float(block, texels);
+
+		float axis[4]{};
+		float mean[4]{};
+		block_compressor::principal_axis(texels, 3, mean, axis);
+
+		// endpoints at the extremes along the axis, pulled in by 1/16 of the range like most encoders do.
+		float low{ std::numeric_limits<float>::max() };
+		float high{ -std::numeric_limits<float>::max() };
+		for (const auto& texel : texels)
+		{
+			float projection{ block_compressor::project(texel, mean, axis, 3) };
+			low = std::min(low, projection);
+			high = std::max(high, projection);
+		}
+
+		float inset{ (high - low) / 16.0f };
+		float endpoints[2][3]{};
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			endpoints[0][channel] = mean[channel] + axis[channel] * (high - inset);
+			endpoints[1][channel] = mean[channel] + axis[channel] * (low + inset);
+		}
+
+		std::uint8_t indices[16]{};
+		block_compressor::fit_bc1(texels, endpoints, out, indices);
+
+		// one least squares refit of the endpoints to the chosen indices, kept only when it lowers the error.
+		static constexpr const float weights[4]{ 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa{}, ab{}, bb{};
+		float ax[3]{}, bx[3]{};
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			float alpha{ weights[indices[texel]] };
+			float beta{ 1.0f - alpha };
+			aa += alpha * alpha;
+			ab += alpha * beta;
+			bb += beta * beta;
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				ax[channel] += alpha * texels[texel][channel];
+				bx[channel] += beta * texels[texel][channel];
+			}
+		}
+
+		float determinant{ aa * bb - ab * ab };
+		if (std::fabs(determinant) > 1e-6f)
+		{
+			float refit[2][3]{};
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				refit[0][channel] = std::min(std::max((ax[channel] * bb - bx[channel] * ab) / determinant, 0.0f), 255.0f);
+				refit[1][channel] = std::min(std::max((bx[channel] * aa - ax[channel] * ab) / determinant, 0.0f), 255.0f);
+			}
+
+			std::uint8_t refit_out[8]{};
+			std::uint8_t refit_indices[16]{};
+			float refit_error{ block_compressor::fit_bc1(texels, refit, refit_out, refit_indices) };
+			if (refit_error < block_compressor::fit_bc1(texels, endpoints, out, indices))
+			{
+				std::memcpy(out, refit_out, 8);
+			}
+		}
+	}
+
+	static void encode_bc3(const std::uint8_t block[64], std::uint8_t out[16])
+	{
+		block_compressor::encode_bc4(block + 3, out);
+		block_compressor::encode_bc1(block, out + 8);
+	}
+
+	static void encode_bc5(const std::uint8_t block[64], std::uint8_t out[16])
+	{
+		block_compressor::encode_bc4(block + 0, out);
+		block_compressor::encode_bc4(block + 1, out + 8);
+	}
+
+	static void encode_bc7(const std::uint8_t block[64], std::uint8_t out[16])
+	{
+		static constexpr const int weights[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		float texels[16][4]{};
+		block_compressor::to_float(block, texels);
+
+		float axis[4]{};
+		float mean[4]{};
+		block_compressor::principal_axis(texels, 4, mean, axis);
+
+		float low{ std::numeric_limits<float>::max() };
+		float high{ -std::numeric_limits<float>::max() };
+		for (const auto& texel : texels)
+		{
+			float projection{ block_compressor::project(texel, mean, axis, 4) };
+			low = std::min(low, projection);
+			high = std::max(high, projection);
+		}
+
+		// each endpoint is 7 bits plus a shared bit, try the 4 shared bit pairs.
+		int best_endpoints[2][4]{};
+		int best_bits[2]{};
+		std::uint8_t best_indices[16]{};
+		float best_error{ std::numeric_limits<float>::max() };
+		for (int bits = 0; bits < 4; ++bits)
+		{
+			int shared_bits[2]{ bits & 1, bits >> 1 };
+			int endpoints[2][4]{};
+			int values[2][4]{};
+			for (int end = 0; end < 2; ++end)
+			{
+				float extreme{ end == 0 ? low : high };
+				for (int channel = 0; channel < 4; ++channel)
+				{
+					float value{ mean[channel] + axis[channel] * extreme };
+					int quantized{ static_cast<int>(std::lround((value - shared_bits[end]) / 2.0f)) };
+					endpoints[end][channel] = std::min(std::max(quantized, 0), 127);
+					values[end][channel] = endpoints[end][channel] << 1 | shared_bits[end];
+				}
+			}
+
+			float error{};
+			std::uint8_t indices[16]{};
+			for (int texel = 0; texel < 16; ++texel)
+			{
+				float texel_error{ std::numeric_limits<float>::max() };
+				for (int index = 0; index < 16; ++index)
+				{
+					float distance{};
+					for (int channel = 0; channel < 4; ++channel)
+					{
+						int value{ ((64 - weights[index]) * values[0][channel] + weights[index] * values[1][channel] + 32) >> 6 };
+						float difference{ value - texels[texel][channel] };
+						distance += difference * difference;
+					}
+
+					if (distance < texel_error)
+					{
+						texel_error = distance;
+						indices[texel] = static_cast<std::uint8_t>(index);
+					}
+				}
+				error += texel_error;
+			}
+
+			if (error < best_error)
+			{
+				best_error = error;
+				std::memcpy(best_endpoints, endpoints, sizeof(endpoints));
+				std::memcpy(best_bits, shared_bits, sizeof(shared_bits));
+				std::memcpy(best_indices, indices, sizeof(indices));
+			}
+		}
+
+		// the first index is stored with 3 bits, so its top bit has to be 0: swap the endpoints when it is not.
+		if (best_indices[0] & 8)
+		{
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				std::swap(best_endpoints[0][channel], best_endpoints[1][channel]);
+			}
+			std::swap(best_bits[0], best_bits[1]);
+			for (std::uint8_t& index : best_indices)
+			{
+				index = static_cast<std::uint8_t>(15 - index);
+			}
+		}
+
+		// mode 6: 7 mode bits(0000001), r0 r1 g0 g1 b0 b1 a0 a1 in 7 bits each, p0 p1, then the indices.
+		bit_writer writer{ out };
+		writer.write(1 << 6, 7);
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			writer.write(best_endpoints[0][channel], 7);
+			writer.write(best_endpoints[1][channel], 7);
+		}
+		writer.write(best_bits[0], 1);
+		writer.write(best_bits[1], 1);
+		writer.write(best_indices[0], 3);
+		for (int texel = 1; texel < 16; ++texel)
+		{
+			writer.write(best_indices[texel], 4);
+		}
+	}
+
+private:
+	// little endian bit stream into a 16 byte block.
+	struct bit_writer
+	{
+		std::uint8_t* out_;
+		int position_{ 0 };
+
+		explicit bit_writer(std::uint8_t* out)
+			: out_{ out }
+		{
+			std::memset(out, 0, 16);
+		}
+
+		void write(int value, int bit_count)
+		{
+			for (int bit = 0; bit < bit_count; ++bit, ++this->position_)
+			{
+				this->out_[this->position_ >> 3] |= static_cast<std::uint8_t>(((value >> bit) & 1) << (this->position_ & 7));
+			}
+		}
+	};
+
+	static void to_float(const std::uint8_t block[64], float texels[16][4])
+	{
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				texels[texel][channel] = block[texel * 4 + channel];
+			}
+		}
+	}
+
+	static float project(const float texel[4], const float mean[4], const float axis[4], int channels)
+	{
+		float projection{};
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			projection += (texel[channel] - mean[channel]) * axis[channel];
+		}
+
+		return projection;
+	}
+
+	// unit direction of largest spread over the first channels of the texels, by power iteration on the covariance.
+	static void principal_axis(const float texels[16][4], int channels, float mean[4], float axis[4])
+	{
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			mean[channel] = 0.0f;
+			axis[channel] = 0.0f;
+			for (int texel = 0; texel < 16; ++texel)
+			{
+				mean[channel] += texels[texel][channel] / 16.0f;
+			}
+		}
+
+		float covariance[4][4]{};
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			for (int row = 0; row < channels; ++row)
+			{
+				for (int column = 0; column < channels; ++column)
+				{
+					covariance[row][column] += (texels[texel][row] - mean[row]) * (texels[texel][column] - mean[column]);
+				}
+			}
+		}
+
+		// start from the diagonal, which always has a component along the largest eigenvector of a covariance.
+		float direction[4]{ 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4]{};
+			float length{};
+			for (int row = 0; row < channels; ++row)
+			{
+				for (int column = 0; column < channels; ++column)
+				{
+					next[row] += covariance[row][column] * direction[column];
+				}
+				length += next[row] * next[row];
+			}
+
+			// a flat block, every texel is the mean.
+			if (length <= 1e-12f)
+			{
+				return;
+			}
+
+			length = std::sqrt(length);
+			for (int row = 0; row < channels; ++row)
+			{
+				direction[row] = next[row] / length;
+			}
+		}
+
+		std::copy(direction, direction + channels, axis);
+	}
+
+	static std::uint16_t to_565(const float color[3])
+	{
+		int red{ std::min(std::max(static_cast<int>(std::lround(color[0] * 31.0f / 255.0f)), 0), 31) };
+		int green{ std::min(std::max(static_cast<int>(std::lround(color[1] * 63.0f / 255.0f)), 0), 63) };
+		int blue{ std::min(std::max(static_cast<int>(std::lround(color[2] * 31.0f / 255.0f)), 0), 31) };
+		return static_cast<std::uint16_t>(red << 11 | green << 5 | blue);
+	}
+
+	static void from_565(std::uint16_t packed, float color[3])
+	{
+		int red{ packed >> 11 & 31 };
+		int green{ packed >> 5 & 63 };
+		int blue{ packed & 31 };
+		color[0] = static_cast<float>(red << 3 | red >> 2);
+		color[1] = static_cast<float>(green << 2 | green >> 4);
+		color[2] = static_cast<float>(blue << 3 | blue >> 2);
+	}
+
+	// writes the block for two endpoints in 4 color mode and returns its squared error.
+	static float fit_bc1(const float texels[16][4], const float endpoints[2][3], std::uint8_t out[8], std::uint8_t indices[16])
+	{
+		std::uint16_t colors[2]{ block_compressor::to_565(endpoints[0]), block_compressor::to_565(endpoints[1]) };
+		if (colors[0] < colors[1])
+		{
+			std::swap(colors[0], colors[1]);
+		}
+
+		float palette[4][3]{};
+		block_compressor::from_565(colors[0], palette[0]);
+		block_compressor::from_565(colors[1], palette[1]);
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			palette[2][channel] = (2.0f * palette[0][channel] + palette[1][channel]) / 3.0f;
+			palette[3][channel] = (palette[0][channel] + 2.0f * palette[1][channel]) / 3.0f;
+		}
+
+		// equal endpoints would switch the decoder to 3 color mode, where index 3 is black.
+		int palette_size{ colors[0] == colors[1] ? 1 : 4 };
+
+		float error{};
+		std::uint32_t bits{};
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			float texel_error{ std::numeric_limits<float>::max() };
+			for (int index = 0; index < palette_size; ++index)
+			{
+				float distance{};
+				for (int channel = 0; channel < 3; ++channel)
+				{
+					float difference{ palette[index][channel] - texels[texel][channel] };
+					distance += difference * difference;
+				}
+
+				if (distance < texel_error)
+				{
+					texel_error = distance;
+					indices[texel] = static_cast<std::uint8_t>(index);
+				}
+			}
+
+			error += texel_error;
+			bits |= static_cast<std::uint32_t>(indices[texel]) << (texel * 2);
+		}
+
+		out[0] = static_cast<std::uint8_t>(colors[0] & 0xff);
+		out[1] = static_cast<std::uint8_t>(colors[0] >> 8);
+		out[2] = static_cast<std::uint8_t>(colors[1] & 0xff);
+		out[3] = static_cast<std::uint8_t>(colors[1] >> 8);
+		for (int byte = 0; byte < 4; ++byte)
+		{
+			out[4 + byte] = static_cast<std::uint8_t>(bits >> (byte * 8));
+		}
+
+		return error;
+	}
+
+	// one channel, read every 4th byte of block from values on: alpha for bc3, red or green for bc5.
+	static void encode_bc4(const std::uint8_t* values, std::uint8_t out[8])
+	{
+		int low{ 255 };
+		int high{ 0 };
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			low = std::min(low, static_cast<int>(values[texel * 4]));
+			high = std::max(high, static_cast<int>(values[texel * 4]));
+		}
+
+		// 8 value mode needs the first endpoint above the second, a flat block uses index 0 only.
+		int palette[8]{ high, low };
+		for (int index = 2; index < 8; ++index)
+		{
+			palette[index] = ((8 - index) * high + (index - 1) * low + 3) / 7;
+		}
+
+		std::uint64_t bits{};
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			int best_index{ 0 };
+			int best_distance{ std::numeric_limits<int>::max() };
+			for (int index = 0; index < (high == low ? 1 : 8); ++index)
+			{
+				int distance{ std::abs(palette[index] - values[texel * 4]) };
+				if (distance < best_distance)
+				{
+					best_distance = distance;
+					best_index = index;
+				}
+			}
+
+			bits |= static_cast<std::uint64_t>(best_index) << (texel * 3);
+		}
+
+		out[0] = static_cast<std::uint8_t>(high);
+		out[1] = static_cast<std::uint8_t>(low);
+		for (int byte = 0; byte < 6; ++byte)
+		{
+			out[2 + byte] = static_cast<std::uint8_t>(bits >> (byte * 8));
+		}
+	}
+};
+
+
+#endif // !__BLOCK_COMPRESSOR_HPP__
@@ -0,0 +1,427 @@
+#ifndef __BVH_HPP__
+#define __BVH_HPP__
+
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+#include <vector>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+
+static constexpr const std::uint32_t BVH_NO_ITEM{ 0xFFFFFFFFu };
+
+// items per leaf, a split stops below it.
+static constexpr const std::uint32_t BVH_LEAF_SIZE{ 4 };
+
+
+struct bvh_hit
+{
+	std::uint32_t item_{ BVH_NO_ITEM };
+	float distance_{ std::numeric_limits<float>::max() };
+
+	bool is_hit()const noexcept
+	{
+		return this->item_ != BVH_NO_ITEM;
+	}
+};
+
+
+// a binary tree of boxes over items the caller owns, addressed by their index.
+// built top down by splitting at the median centroid of the longest axis, so a query visits O(log n) nodes
+// for a small result. nodes are stored depth first: the left child follows its parent, the right one is linked.
+// when items move, refit() or update() grows and shrinks the boxes in place instead of building again.
+class bounding_volume_hierarchy final
+{
+private:
+	struct node
+	{
+		bounding_box box_{};
+		// an inner node: index of the right child. a leaf: first position in items_.
+		std::uint32_t right_or_first_{};
+		// 0 for inner nodes.
+		std::uint32_t count_{};
+		std::uint32_t parent_{ BVH_NO_ITEM };
+	};
+
+	std::vector<node> nodes_{};
+	// item indices, grouped by leaf.
+	std::vector<std::uint32_t> items_{};
+	std::vector<bounding_box> item_boxes_{};
+	// item index -> the leaf holding it, for update().
+	std::vector<std::uint32_t> item_leaves_{};
+
+public:
+	bool empty()const noexcept
+	{
+		return this->nodes_.empty();
+	}
+
+	std::size_t get_node_count()const noexcept
+	{
+		return this->nodes_.size();
+	}
+
+	std::size_t get_item_count()const noexcept
+	{
+		return this->item_boxes_.size();
+	}
+
+	// box of everything, empty when there are no items.
+	bounding_box get_bounds()const
+	{
+		return this->nodes_.empty() ? bounding_box{} : this->nodes_[0].box_;
+	}
+
+	void build(const std::vector<bounding_box>& item_boxes)
+	{
+		this->item_boxes_ = item_boxes;
+		this->nodes_.clear();
+		this->items_.resize(item_boxes.size());
+		this->item_leaves_.assign(item_boxes.size(), BVH_NO_ITEM);
+
+		if (item_boxes.empty())
+		{
+			return;
+		}
+
+		for (std::size_t index = 0; index < item_boxes.size(); ++index)
+		{
+			this->items_[index] = static_cast<std::uint32_t>(index);
+		}
+
+		this->nodes_.reserve(2 * item_boxes.size() / BVH_LEAF_SIZE + 1);
+		this->build_node(0, static_cast<std::uint32_t>(item_boxes.size()), BVH_NO_ITEM);
+	}
+
+	// every box changed, e.g. a whole scene moved: one pass from the leaves up, the tree shape stays.
+	void refit(const std::vector<bounding_box>& item_boxes)
+	{
+		this->item_boxes_ = item_boxes;
+
+		// children always come after their parent.
+		for (std::size_t index = this->nodes_.size(); index-- > 0;)
+		{
+			this->refit_node(static_cast<std::uint32_t>(index));
+		}
+	}
+
+	// one item moved: only its leaf and the leaf's ancestors are touched, O(log n).
+	void update(std::uint32_t item, const bounding_box& item_box)
+	{
+		this->item_boxes_[item] = item_box;
+
+		std::uint32_t node_index{ this->item_leaves_[item] };
+		while (node_index != BVH_NO_ITEM)
+		{
+			bounding_box old_box{ this->nodes_[node_index].box_ };
+			this->refit_node(node_index);
+
+			// an unchanged box leaves every ancestor unchanged as well.
+			const bounding_box& new_box{ this->nodes_[node_index].box_ };
+			if (old_box.min_ == new_box.min_ && old_box.max_ == new_box.max_)
+			{
+				break;
+			}
+
+			node_index = this->nodes_[node_index].parent_;
+		}
+	}
+
+	const bounding_box& get_item_box(std::uint32_t item)const
+	{
+		return this->item_boxes_[item];
+	}
+
+	// appends every item whose box touches the frustum. subtrees fully inside are taken without testing their items.
+	void query_frustum(const frustum& view_frustum, std::vector<std::uint32_t>& visible)const
+	{
+		if (this->nodes_.empty())
+		{
+			return;
+		}
+
+		std::uint32_t stack[64]{};
+		std::size_t stack_size{ 0 };
+		stack[stack_size++] = 0;
+
+		while (stack_size != 0)
+		{
+			std::uint32_t node_index{ stack[--stack_size] };
+			const node& the_node{ this->nodes_[node_index] };
+
+			frustum::containment containment{ view_frustum.classify(the_node.box_) };
+			if (containment == frustum::outside)
+			{
+				continue;
+			}
+
+			if (containment == frustum::inside)
+			{
+				this->append_subtree(node_index, visible);
+				continue;
+			}
+
+			if (the_node.count_ != 0)
+			{
+				for (std::uint32_t position = the_node.right_or_first_; position < the_node.right_or_first_ + the_node.count_; ++position)
+				{
+					if (view_frustum.classify(this->item_boxes_[this->items_[position]]) != frustum::outside)
+					{
+						visible.push_back(this->items_[position]);
+					}
+				}
+				continue;
+			}
+
+			stack[stack_size++] = the_node.right_or_first_;
+			stack[stack_size++] = node_index + 1;
+		}
+	}
+
+	// closest hit along the ray. hit_test(item, box_entry, max_distance) returns the item's own hit distance,
+	// or a negative value for a miss. closer children are visited first and farther subtrees are skipped.
+	template<typename HitTest>
+	bvh_hit raycast(const ray& the_ray, float max_distance, HitTest hit_test)const
+	{
+		bvh_hit closest{};
+		closest.distance_ = max_distance;
+		if (this->nodes_.empty())
+		{
+			return closest;
+		}
+
+		glm::vec3 inverse_direction{ the_ray.inverse_direction() };
+
+		std::pair<std::uint32_t, float> stack[64]{};
+		std::size_t stack_size{ 0 };
+
+		float entry{};
+		if (!this->nodes_[0].box_.intersects_ray(the_ray.origin_, inverse_direction, closest.distance_, entry))
+		{
+			return closest;
+		}
+		stack[stack_size++] = { 0, entry };
+
+		while (stack_size != 0)
+		{
+			std::pair<std::uint32_t, float> top{ stack[--stack_size] };
+			if (top.second > closest.distance_)
+			{
+				continue;
+			}
+
+			const node& the_node{ this->nodes_[top.first] };
+			if (the_node.count_ != 0)
+			{
+				for (std::uint32_t position = the_node.right_or_first_; position < the_node.right_or_first_ + the_node.count_; ++position)
+				{
+					std::uint32_t item{ this->items_[position] };
+					if (!this->item_boxes_[item].intersects_ray(the_ray.origin_, inverse_direction, closest.distance_, entry))
+					{
+						continue;
+					}
+
+					float distance{ hit_test(item, entry, closest.distance_) };
+					if (distance >= 0.0f && distance < closest.distance_)
+					{
+						closest.item_ = item;
+						closest.distance_ = distance;
+					}
+				}
+				continue;
+			}
+
+			std::uint32_t left{ top.first + 1 };
+			std::uint32_t right{ the_node.right_or_first_ };
+			float left_entry{}, right_entry{};
+			bool left_hit{ this->nodes_[left].box_.intersects_ray(the_ray.origin_, inverse_direction, closest.distance_, left_entry) };
+			bool right_hit{ this->nodes_[right].box_.intersects_ray(the_ray.origin_, inverse_direction, closest.distance_, right_entry) };
+
+			// the nearer child goes on top.
+			if (left_hit && right_hit && left_entry < right_entry)
+			{
+				stack[stack_size++] = { right, right_entry };
+				stack[stack_size++] = { left, left_entry };
+			}
+			else
+			{
+				if (left_hit)
+				{
+					stack[stack_size++] = { left, left_entry };
+				}
+				if (right_hit)
+				{
+					stack[stack_size++] = { right, right_entry };
+				}
+			}
+		}
+
+		return closest;
+	}
+
+	// closest hit against the items' boxes themselves.
+	bvh_hit raycast(const ray& the_ray, float max_distance = std::numeric_limits<float>::max())const
+	{
+		return this->raycast(the_ray, max_distance, [](std::uint32_t, float box_entry, float) { return box_entry; });
+	}
+
+	// the item whose box is nearest to point, within max_distance. distance_ of the result is the distance to the box.
+	bvh_hit nearest(const glm::vec3& point, float max_distance = std::numeric_limits<float>::max())const
+	{
+		bvh_hit closest{};
+		float closest_squared{ max_distance < std::sqrt(std::numeric_limits<float>::max()) ? max_distance * max_distance : std::numeric_limits<float>::max() };
+		if (this->nodes_.empty())
+		{
+			return closest;
+		}
+
+		std::pair<std::uint32_t, float> stack[64]{};
+		std::size_t stack_size{ 0 };
+		stack[stack_size++] = { 0, this->nodes_[0].box_.distance_squared(point) };
+
+		while (stack_size != 0)
+		{
+			std::pair<std::uint32_t, float> top{ stack[--stack_size] };
+			if (top.second > closest_squared)
+			{
+				continue;
+			}
+
+			const node& the_node{ this->nodes_[top.first] };
+			if (the_node.count_ != 0)
+			{
+				for (std::uint32_t position = the_node.right_or_first_; position < the_node.right_or_first_ + the_node.count_; ++position)
+				{
+					std::uint32_t item{ this->items_[position] };
+					float distance_squared{ this->item_boxes_[item].distance_squared(point) };
+					if (distance_squared <= closest_squared)
+					{
+						closest.item_ = item;
+						closest_squared = distance_squared;
+					}
+				}
+				continue;
+			}
+
+			std::uint32_t left{ top.first + 1 };
+			std::uint32_t right{ the_node.right_or_first_ };
+			float left_distance{ this->nodes_[left].box_.distance_squared(point) };
+			float right_distance{ this->nodes_[right].box_.distance_squared(point) };
+
+			// the nearer child goes on top.
+			if (left_distance < right_distance)
+			{
+				stack[stack_size++] = { right, right_distance };
+				stack[stack_size++] = { left, left_distance };
+			}
+			else
+			{
+				stack[stack_size++] = { left, left_distance };
+				stack[stack_size++] = { right, right_distance };
+			}
+		}
+
+		if (closest.is_hit())
+		{
+			closest.distance_ = std::sqrt(closest_squared);
+		}
+
+		return closest;
+	}
+
+private:
+	std::uint32_t build_node(std::uint32_t first, std::uint32_t count, std::uint32_t parent)
+	{
+		std::uint32_t node_index{ static_cast<std::uint32_t>(this->nodes_.size()) };
+		this->nodes_.push_back(node{});
+		this->nodes_[node_index].parent_ = parent;
+
+		bounding_box box{};
+		bounding_box centroids{};
+		for (std::uint32_t position = first; position < first + count; ++position)
+		{
+			const bounding_box& item_box{ this->item_boxes_[this->items_[position]] };
+			box.merge(item_box);
+			centroids.expand(item_box.center());
+		}
+		this->nodes_[node_index].box_ = box;
+
+		glm::vec3 spread{ centroids.max_ - centroids.min_ };
+		int axis{ spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2) };
+
+		// few items, or all centered on one point: no split separates them.
+		if (count <= BVH_LEAF_SIZE || spread[axis] <= 0.0f)
+		{
+			this->nodes_[node_index].right_or_first_ = first;
+			this->nodes_[node_index].count_ = count;
+			for (std::uint32_t position = first; position < first + count; ++position)
+			{
+				this->item_leaves_[this->items_[position]] = node_index;
+			}
+
+			return node_index;
+		}
+
+		std::uint32_t half{ count / 2 };
+		std::nth_element(this->items_.begin() + first, this->items_.begin() + first + half, this->items_.begin() + first + count,
+			[this, axis](std::uint32_t left, std::uint32_t right)
+		{
+			return this->item_boxes_[left].center()[axis] < this->item_boxes_[right].center()[axis];
+		});
+
+		this->build_node(first, half, node_index);
+		std::uint32_t right{ this->build_node(first + half, count - half, node_index) };
+		this->nodes_[node_index].right_or_first_ = right;
+		return node_index;
+	}
+
+	void refit_node(std::uint32_t node_index)
+	{
+		node& the_node{ this->nodes_[node_index] };
+
+		bounding_box box{};
+		if (the_node.count_ != 0)
+		{
+			for (std::uint32_t position = the_node.right_or_first_; position < the_node.right_or_first_ + the_node.count_; ++position)
+			{
+				box.merge(this->item_boxes_[this->items_[position]]);
+			}
+		}
+		else
+		{
+			box = this->nodes_[node_index + 1].box_;
+			box.merge(this->nodes_[the_node.right_or_first_].box_);
+		}
+
+		the_node.box_ = box;
+	}
+
+	// a subtree's items are contiguous in items_: from its leftmost leaf to the end of its rightmost one.
+	void append_subtree(std::uint32_t node_index, std::vector<std::uint32_t>& visible)const
+	{
+		std::uint32_t leftmost{ node_index };
+		while (this->nodes_[leftmost].count_ == 0)
+		{
+			leftmost = leftmost + 1;
+		}
+
+		std::uint32_t rightmost{ node_index };
+		while (this->nodes_[rightmost].count_ == 0)
+		{
+			rightmost = this->nodes_[rightmost].right_or_first_;
+		}
+
+		std::uint32_t begin{ this->nodes_[leftmost].right_or_first_ };
+		std::uint32_t end{ this->nodes_[rightmost].right_or_first_ + this->nodes_[rightmost].count_ };
+		visible.insert(visible.end(), this->items_.begin() + begin, this->items_.begin() + end);
+	}
+};
+
+
+#endif // !__BVH_HPP__
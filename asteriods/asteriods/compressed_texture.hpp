@@ -0,0 +1,472 @@
+#ifndef __COMPRESSED_TEXTURE_HPP__
+#define __COMPRESSED_TEXTURE_HPP__
+
+#include <glad/glad.h>
+
+#include "block_compressor.hpp"
+#include "virtual_file_system.hpp"
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+// EXT_texture_compression_s3tc is not part of core, so glad leaves its enums out.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+
+// one mipmap level of a compressed image, data_ points into the file's mapping.
+struct compressed_level
+{
+	const unsigned char* data_{ nullptr };
+	std::size_t size_{};
+	int width_{};
+	int height_{};
+};
+
+
+// a block compressed image read from a .dds or .ktx2 file, uploaded as it is: no decode on the CPU, no mipmap generation on the GPU.
+struct compressed_image
+{
+	block_format format_{ block_format::bc1 };
+	std::vector<compressed_level> levels_{};
+	// keeps the mapping the levels point into alive.
+	asset_view view_{};
+
+	int get_width()const noexcept
+	{
+		return this->levels_.empty() ? 0 : this->levels_.front().width_;
+	}
+
+	int get_height()const noexcept
+	{
+		return this->levels_.empty() ? 0 : this->levels_.front().height_;
+	}
+
+	std::size_t get_bytes()const noexcept
+	{
+		std::size_t bytes{};
+		for (const compressed_level& level : this->levels_)
+		{
+			bytes += level.size_;
+		}
+
+		return bytes;
+	}
+};
+
+
+// the block formats the current context can sample, one bit per block_format.
+using compressed_format_mask = std::uint32_t;
+
+
+// reads .dds(legacy FourCC and DX10 headers) and .ktx2(no supercompression), writes .dds.
+// only the 2D, single layer, BC1/BC3/BC5/BC7 subset texture_cooker produces is understood, anything else fails to parse
+// and the caller falls back to decoding the source image.
+class compressed_texture final
+{
+private:
+	static constexpr const std::uint32_t DDS_MAGIC{ 0x20534444u };
+	static constexpr const std::size_t DDS_HEADER_SIZE{ 124 };
+	static constexpr const std::size_t DDS_DX10_HEADER_SIZE{ 20 };
+	static constexpr const std::uint32_t DDS_PIXEL_FORMAT_FOURCC{ 0x4u };
+
+	// DXGI_FORMAT_BC1_UNORM, BC3_UNORM, BC5_UNORM, BC7_UNORM.
+	static constexpr const std::uint32_t DXGI_BC1{ 71 };
+	static constexpr const std::uint32_t DXGI_BC3{ 77 };
+	static constexpr const std::uint32_t DXGI_BC5{ 83 };
+	static constexpr const std::uint32_t DXGI_BC7{ 98 };
+
+	static constexpr const std::size_t KTX2_HEADER_SIZE{ 80 };
+	static constexpr const std::size_t KTX2_LEVEL_SIZE{ 24 };
+
+	// larger than any GL_MAX_TEXTURE_SIZE, and small enough that no level size computation overflows.
+	static constexpr const int MAX_EXTENT{ 1 << 16 };
+
+public:
+	static compressed_format_mask format_bit(block_format format)noexcept
+	{
+		return 1u << static_cast<std::uint32_t>(format);
+	}
+
+	// GL thread only.
+	static compressed_format_mask query_support()
+	{
+		GLint major{}, minor{};
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+		// rgtc is core since 3.0, bptc since 4.2.
+		compressed_format_mask mask{ compressed_texture::format_bit(block_format::bc5) };
+		if (major > 4 || (major == 4 && minor >= 2) || compressed_texture::has_extension("GL_ARB_texture_compression_bptc"))
+		{
+			mask |= compressed_texture::format_bit(block_format::bc7);
+		}
+
+		if (compressed_texture::has_extension("GL_EXT_texture_compression_s3tc"))
+		{
+			mask |= compressed_texture::format_bit(block_format::bc1) | compressed_texture::format_bit(block_format::bc3);
+		}
+
+		return mask;
+	}
+
+	static GLenum internal_format(block_format format)noexcept
+	{
+		switch (format)
+		{
+		case block_format::bc1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case block_format::bc3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case block_format::bc5: return GL_COMPRESSED_RG_RGTC2;
+		case block_format::bc7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		}
+
+		return GL_NONE;
+	}
+
+	static const char* format_name(block_format format)noexcept
+	{
+		switch (format)
+		{
+		case block_format::bc1: return "BC1";
+		case block_format::bc3: return "BC3";
+		case block_format::bc5: return "BC5";
+		case block_format::bc7: return "BC7";
+		}
+
+		return "?";
+	}
+
+	// the cooked files texture_cooker writes or a ktx2 tool may have made for a source image, in the order they are tried.
+	static std::vector<std::basic_string<char>> cooked_files(const std::basic_string<char>& source_file)
+	{
+		std::size_t separator{ source_file.find_last_of("/\\") };
+		std::size_t dot{ source_file.find_last_of('.') };
+		std::basic_string<char> stem{ dot != std::basic_string<char>::npos && (separator == std::basic_string<char>::npos || dot > separator) ?
+			source_file.substr(0, dot) : source_file };
+
+		return { stem + ".dds", stem + ".ktx2" };
+	}
+
+	// false for anything outside the supported subset, a truncated file included.
+	static bool parse(asset_view view, compressed_image& image)
+	{
+		image = compressed_image{};
+		if (!view.is_open())
+		{
+			return false;
+		}
+
+		bool parsed{ false };
+		if (view.size_ >= 4 && compressed_texture::read_u32(view.data_) == DDS_MAGIC)
+		{
+			parsed = compressed_texture::parse_dds(view.data_, view.size_, image);
+		}
+		else if (view.size_ >= KTX2_HEADER_SIZE && std::memcmp(view.data_, compressed_texture::ktx2_identifier(), 12) == 0)
+		{
+			parsed = compressed_texture::parse_ktx2(view.data_, view.size_, image);
+		}
+
+		if (!parsed)
+		{
+			image = compressed_image{};
+			return false;
+		}
+
+		image.view_ = std::move(view);
+		return true;
+	}
+
+	// levels holds the compressed blocks of each mipmap level, largest first. written to a temporary file first like asset packs.
+	static bool write_dds(const std::basic_string<char>& file, block_format format, int width, int height,
+		const std::vector<std::vector<std::uint8_t>>& levels)
+	{
+		std::uint32_t header[DDS_HEADER_SIZE / 4]{};
+		header[0] = DDS_HEADER_SIZE;
+		// caps, height, width, pixel format, mipmap count, linear size.
+		header[1] = 0xA1007u;
+		header[2] = static_cast<std::uint32_t>(height);
+		header[3] = static_cast<std::uint32_t>(width);
+		header[4] = static_cast<std::uint32_t>(levels.empty() ? 0 : levels.front().size());
+		header[6] = static_cast<std::uint32_t>(levels.size());
+		header[18] = 32;
+		header[19] = DDS_PIXEL_FORMAT_FOURCC;
+		// texture, mipmap, complex.
+		header[26] = 0x401008u;
+
+		// bc1 and bc3 keep the legacy FourCC every viewer reads, the others need the DX10 header.
+		bool dx10{ format == block_format::bc5 || format == block_format::bc7 };
+		header[20] = compressed_texture::four_cc(format == block_format::bc1 ? "DXT1" : (format == block_format::bc3 ? "DXT5" : "DX10"));
+
+		std::uint32_t dx10_header[DDS_DX10_HEADER_SIZE / 4]{};
+		dx10_header[0] = format == block_format::bc5 ? DXGI_BC5 : DXGI_BC7;
+		// texture 2d, no flags, one layer.
+		dx10_header[1] = 3;
+		dx10_header[3] = 1;
+
+		std::basic_string<char> temp_file{ file + ".tmp" };
+		std::basic_ofstream<char> file_writer{ temp_file, std::ios::binary | std::ios::trunc };
+		if (!file_writer.is_open())
+		{
+			std::cout << "COMPRESSED_TEXTURE:: can not write: " << temp_file << std::endl;
+			return false;
+		}
+
+		std::uint32_t magic{ DDS_MAGIC };
+		file_writer.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+		file_writer.write(reinterpret_cast<const char*>(header), sizeof(header));
+		if (dx10)
+		{
+			file_writer.write(reinterpret_cast<const char*>(dx10_header), sizeof(dx10_header));
+		}
+
+		for (const auto& level : levels)
+		{
+			file_writer.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+		}
+
+		file_writer.close();
+		if (!file_writer)
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		std::remove(file.c_str());
+		if (std::rename(temp_file.c_str(), file.c_str()) != 0)
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	// GL thread only, into the bound GL_TEXTURE_2D. returns the bytes resident in video memory.
+	static std::size_t upload(const compressed_image& image)
+	{
+		GLenum format{ compressed_texture::internal_format(image.format_) };
+		for (std::size_t level = 0; level < image.levels_.size(); ++level)
+		{
+			const compressed_level& source{ image.levels_[level] };
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, source.width_, source.height_, 0,
+				static_cast<GLsizei>(source.size_), source.data_);
+		}
+
+		// a file without the full chain down to 1x1 would otherwise leave the texture incomplete.
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels_.size()) - 1);
+		return image.get_bytes();
+	}
+
+private:
+	static const unsigned char* ktx2_identifier()noexcept
+	{
+		static constexpr const unsigned char identifier[12]{ 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		return identifier;
+	}
+
+	static std::uint32_t read_u32(const unsigned char* data)noexcept
+	{
+		std::uint32_t value{};
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	static std::uint64_t read_u64(const unsigned char* data)noexcept
+	{
+		std::uint64_t value{};
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	static std::uint32_t four_cc(const char* code)noexcept
+	{
+		return static_cast<std::uint32_t>(code[0]) | static_cast<std::uint32_t>(code[1]) << 8 |
+			static_cast<std::uint32_t>(code[2]) << 16 | static_cast<std::uint32_t>(code[3]) << 24;
+	}
+
+	// the header's size is usable and names no more levels than the chain down to 1x1 has, so every width >> level is defined.
+	static bool valid_chain(std::uint32_t width, std::uint32_t height, std::uint32_t level_count)noexcept
+	{
+		if (width == 0 || height == 0 || width > static_cast<std::uint32_t>(MAX_EXTENT) || height > static_cast<std::uint32_t>(MAX_EXTENT))
+		{
+			return false;
+		}
+
+		std::uint32_t full_chain{ 1 };
+		for (std::uint32_t extent = std::max(width, height); extent > 1; extent >>= 1)
+		{
+			++full_chain;
+		}
+
+		return level_count <= full_chain;
+	}
+
+	static bool parse_dds(const unsigned char* data, std::size_t size, compressed_image& image)
+	{
+		if (size < 4 + DDS_HEADER_SIZE || compressed_texture::read_u32(data + 4) != DDS_HEADER_SIZE)
+		{
+			return false;
+		}
+
+		const unsigned char* header{ data + 4 };
+		std::uint32_t height{ compressed_texture::read_u32(header + 8) };
+		std::uint32_t width{ compressed_texture::read_u32(header + 12) };
+		std::uint32_t level_count{ std::max<std::uint32_t>(compressed_texture::read_u32(header + 24), 1) };
+		if (!compressed_texture::valid_chain(width, height, level_count) || (compressed_texture::read_u32(header + 76) & DDS_PIXEL_FORMAT_FOURCC) == 0)
+		{
+			return false;
+		}
+
+		std::size_t offset{ 4 + DDS_HEADER_SIZE };
+		std::uint32_t code{ compressed_texture::read_u32(header + 80) };
+		if (code == compressed_texture::four_cc("DXT1"))
+		{
+			image.format_ = block_format::bc1;
+		}
+		else if (code == compressed_texture::four_cc("DXT5"))
+		{
+			image.format_ = block_format::bc3;
+		}
+		else if (code == compressed_texture::four_cc("ATI2") || code == compressed_texture::four_cc("BC5U"))
+		{
+			image.format_ = block_format::bc5;
+		}
+		else if (code == compressed_texture::four_cc("DX10"))
+		{
+			if (size < offset + DDS_DX10_HEADER_SIZE)
+			{
+				return false;
+			}
+
+			const unsigned char* dx10_header{ data + offset };
+			std::uint32_t dxgi_format{ compressed_texture::read_u32(dx10_header) };
+			if (compressed_texture::read_u32(dx10_header + 4) != 3 || compressed_texture::read_u32(dx10_header + 12) > 1)
+			{
+				return false;
+			}
+
+			if (dxgi_format == DXGI_BC1)
+				image.format_ = block_format::bc1;
+			else if (dxgi_format == DXGI_BC3)
+				image.format_ = block_format::bc3;
+			else if (dxgi_format == DXGI_BC5)
+				image.format_ = block_format::bc5;
+			else if (dxgi_format == DXGI_BC7)
+				image.format_ = block_format::bc7;
+			else
+				return false;
+
+			offset += DDS_DX10_HEADER_SIZE;
+		}
+		else
+		{
+			return false;
+		}
+
+		// dds stores the levels back to back, largest first.
+		for (std::uint32_t level = 0; level < level_count; ++level)
+		{
+			compressed_level target{};
+			target.width_ = std::max(static_cast<int>(width >> level), 1);
+			target.height_ = std::max(static_cast<int>(height >> level), 1);
+			target.size_ = block_compressor::level_bytes(image.format_, target.width_, target.height_);
+			if (offset > size || target.size_ > size - offset)
+			{
+				return false;
+			}
+
+			target.data_ = data + offset;
+			image.levels_.push_back(target);
+			offset += target.size_;
+		}
+
+		return true;
+	}
+
+	static bool parse_ktx2(const unsigned char* data, std::size_t size, compressed_image& image)
+	{
+		std::uint32_t vk_format{ compressed_texture::read_u32(data + 12) };
+		std::uint32_t width{ compressed_texture::read_u32(data + 20) };
+		std::uint32_t height{ compressed_texture::read_u32(data + 24) };
+		std::uint32_t depth{ compressed_texture::read_u32(data + 28) };
+		std::uint32_t layer_count{ compressed_texture::read_u32(data + 32) };
+		std::uint32_t face_count{ compressed_texture::read_u32(data + 36) };
+		std::uint32_t level_count{ std::max<std::uint32_t>(compressed_texture::read_u32(data + 40), 1) };
+		std::uint32_t supercompression{ compressed_texture::read_u32(data + 44) };
+		if (depth > 1 || layer_count > 1 || face_count != 1 || supercompression != 0 || !compressed_texture::valid_chain(width, height, level_count))
+		{
+			return false;
+		}
+
+		// VK_FORMAT_BC1_RGB(A)_UNORM_BLOCK, BC3_UNORM, BC5_UNORM, BC7_UNORM.
+		if (vk_format == 131 || vk_format == 133)
+			image.format_ = block_format::bc1;
+		else if (vk_format == 137)
+			image.format_ = block_format::bc3;
+		else if (vk_format == 141)
+			image.format_ = block_format::bc5;
+		else if (vk_format == 145)
+			image.format_ = block_format::bc7;
+		else
+			return false;
+
+		if (size < KTX2_HEADER_SIZE + static_cast<std::size_t>(level_count) * KTX2_LEVEL_SIZE)
+		{
+			return false;
+		}
+
+		// the level index lists every level with its own offset, the file itself stores the smallest first.
+		for (std::uint32_t level = 0; level < level_count; ++level)
+		{
+			const unsigned char* entry{ data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE };
+			std::uint64_t offset{ compressed_texture::read_u64(entry) };
+			std::uint64_t length{ compressed_texture::read_u64(entry + 8) };
+
+			compressed_level target{};
+			target.width_ = std::max(static_cast<int>(width >> level), 1);
+			target.height_ = std::max(static_cast<int>(height >> level), 1);
+			target.size_ = block_compressor::level_bytes(image.format_, target.width_, target.height_);
+			if (length != target.size_ || offset > size || length > size - offset)
+			{
+				return false;
+			}
+
+			target.data_ = data + offset;
+			image.levels_.push_back(target);
+		}
+
+		return true;
+	}
+
+	static bool has_extension(const char* name)
+	{
+		GLint extension_count{};
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+		for (GLint index = 0; index < extension_count; ++index)
+		{
+			const char* extension{ reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(index))) };
+			if (extension && std::strcmp(extension, name) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+
+#endif // !__COMPRESSED_TEXTURE_HPP__
@@ -0,0 +1,121 @@
+#ifndef __CULL_BENCHMARK_HPP__
+#define __CULL_BENCHMARK_HPP__
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "frustum.hpp"
+#include "frustum_culler.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+// times frustum_culler on every level the CPU runs against a plain loop over glm spheres(array of structures),
+// for 10k, 100k and 1M objects scattered around a camera, and checks that every level keeps the same objects.
+inline void run_cull_benchmark(std::ostream& out)
+{
+	static constexpr const std::size_t object_counts[]{ 10000, 100000, 1000000 };
+	// every measurement culls about this many objects, so small sets are repeated more often.
+	static constexpr const std::size_t objects_per_measurement{ 20000000 };
+
+	glm::mat4 projection{ glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f) };
+	glm::mat4 view{ glm::lookAt(glm::vec3{ 0.0f, 0.0f, 0.0f }, glm::vec3{ 0.0f, 0.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f }) };
+	frustum view_frustum{ frustum::from_view_projection(projection * view) };
+
+	std::vector<simd_level> levels{ simd_support::available_levels() };
+	out << "frustum culler benchmark, best level: " << simd_support::level_name(levels.back()) << std::endl;
+
+	for (std::size_t object_count : object_counts)
+	{
+		std::mt19937 generator{ 42 };
+		std::uniform_real_distribution<float> position{ -100.0f, 100.0f };
+		std::uniform_real_distribution<float> size{ 0.1f, 2.0f };
+
+		std::vector<bounding_sphere> sphere_array{};
+		sphere_soa spheres{};
+		aabb_soa boxes{};
+		sphere_array.reserve(object_count);
+		spheres.reserve(object_count);
+		boxes.reserve(object_count);
+
+		for (std::size_t index = 0; index < object_count; ++index)
+		{
+			bounding_sphere sphere{};
+			sphere.center_ = glm::vec3{ position(generator), position(generator), position(generator) };
+			sphere.radius_ = size(generator);
+			sphere_array.push_back(sphere);
+			spheres.push_back(sphere);
+
+			glm::vec3 extent{ sphere.radius_ * 0.8f, sphere.radius_ * 0.6f, sphere.radius_ * 0.4f };
+			boxes.push_back(sphere.center_ - extent, sphere.center_ + extent);
+		}
+
+		std::size_t repeats{ std::max<std::size_t>(1, objects_per_measurement / object_count) };
+		std::vector<std::uint32_t> visible{};
+		visible.reserve(object_count);
+
+		// the baseline: what culling per object with glm looks like.
+		auto baseline_begin{ std::chrono::steady_clock::now() };
+		for (std::size_t repeat = 0; repeat < repeats; ++repeat)
+		{
+			visible.clear();
+			for (std::size_t index = 0; index < sphere_array.size(); ++index)
+			{
+				if (view_frustum.intersects(sphere_array[index]))
+				{
+					visible.push_back(static_cast<std::uint32_t>(index));
+				}
+			}
+		}
+		double baseline_milliseconds{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - baseline_begin).count() / repeats };
+		std::vector<std::uint32_t> reference{ visible };
+
+		out << std::setw(8) << object_count << " objects, " << reference.size() << " visible" << std::endl;
+		out << "    glm baseline   spheres " << std::fixed << std::setprecision(3) << baseline_milliseconds << " ms" << std::endl;
+
+		std::vector<std::uint32_t> box_reference{};
+		for (simd_level level : levels)
+		{
+			frustum_culler culler{ level };
+
+			auto sphere_begin{ std::chrono::steady_clock::now() };
+			for (std::size_t repeat = 0; repeat < repeats; ++repeat)
+			{
+				culler.cull(view_frustum, spheres, visible);
+			}
+			double sphere_milliseconds{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sphere_begin).count() / repeats };
+			bool spheres_match{ visible == reference };
+
+			auto box_begin{ std::chrono::steady_clock::now() };
+			for (std::size_t repeat = 0; repeat < repeats; ++repeat)
+			{
+				culler.cull(view_frustum, boxes, visible);
+			}
+			double box_milliseconds{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - box_begin).count() / repeats };
+
+			// scalar runs first, its boxes are the reference of the wider levels.
+			if (level == simd_level::scalar)
+			{
+				box_reference = visible;
+			}
+			bool boxes_match{ visible == box_reference };
+
+			out << "    " << std::setw(6) << simd_support::level_name(level) << " soa    spheres " << sphere_milliseconds << " ms ("
+				<< baseline_milliseconds / sphere_milliseconds << "x)" << (spheres_match ? "" : " MISMATCH")
+				<< ", boxes " << box_milliseconds << " ms" << (boxes_match ? "" : " MISMATCH") << std::endl;
+		}
+
+		out.unsetf(std::ios::fixed);
+		out << std::setprecision(6);
+	}
+}
+
+
+#endif // !__CULL_BENCHMARK_HPP__
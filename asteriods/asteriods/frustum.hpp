@@ -0,0 +1,383 @@
+#ifndef __FRUSTUM_HPP__
+#define __FRUSTUM_HPP__
+
+#include <glm/glm.hpp>
+
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+
+struct bounding_sphere
+{
+	glm::vec3 center_{};
+	float radius_{ -1.0f };
+
+	bool is_empty()const noexcept
+	{
+		return this->radius_ < 0.0f;
+	}
+
+	// Ritter's sphere: not the smallest one, but within a few percent of it in two passes.
+	// positions are read every stride bytes, so a vertex array can be passed as it is.
+	static bounding_sphere from_points(const void* positions, std::size_t count, std::size_t stride)
+	{
+		bounding_sphere sphere{};
+		if (positions == nullptr || count == 0)
+		{
+			return sphere;
+		}
+
+		const unsigned char* bytes{ static_cast<const unsigned char*>(positions) };
+		auto position_at = [bytes, stride](std::size_t index) -> const glm::vec3&
+		{
+			return *reinterpret_cast<const glm::vec3*>(bytes + index * stride);
+		};
+
+		// the point farthest from the first point, then the point farthest from that one span the initial sphere.
+		std::size_t farthest{ bounding_sphere::farthest_from(position_at(0), count, position_at) };
+		std::size_t opposite{ bounding_sphere::farthest_from(position_at(farthest), count, position_at) };
+
+		sphere.center_ = (position_at(farthest) + position_at(opposite)) * 0.5f;
+		sphere.radius_ = glm::length(position_at(opposite) - position_at(farthest)) * 0.5f;
+
+		// grow just enough to take in every point left outside.
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			sphere.expand(position_at(index));
+		}
+
+		return sphere;
+	}
+
+	void expand(const glm::vec3& point)
+	{
+		if (this->is_empty())
+		{
+			this->center_ = point;
+			this->radius_ = 0.0f;
+			return;
+		}
+
+		float distance{ glm::length(point - this->center_) };
+		if (distance <= this->radius_)
+		{
+			return;
+		}
+
+		float new_radius{ (this->radius_ + distance) * 0.5f };
+		this->center_ += (point - this->center_) * ((new_radius - this->radius_) / distance);
+		this->radius_ = new_radius;
+	}
+
+	// the smallest sphere holding both.
+	void merge(const bounding_sphere& other)
+	{
+		if (other.is_empty())
+		{
+			return;
+		}
+
+		if (this->is_empty())
+		{
+			*this = other;
+			return;
+		}
+
+		glm::vec3 offset{ other.center_ - this->center_ };
+		float distance{ glm::length(offset) };
+		if (distance + other.radius_ <= this->radius_)
+		{
+			return;
+		}
+
+		if (distance + this->radius_ <= other.radius_)
+		{
+			*this = other;
+			return;
+		}
+
+		float new_radius{ (this->radius_ + distance + other.radius_) * 0.5f };
+		this->center_ += offset * ((new_radius - this->radius_) / distance);
+		this->radius_ = new_radius;
+	}
+
+	// the sphere under an affine transform, the radius grows by the largest axis scale.
+	bounding_sphere transformed(const glm::mat4& matrix)const
+	{
+		float scale_x{ glm::length(glm::vec3{ matrix[0] }) };
+		float scale_y{ glm::length(glm::vec3{ matrix[1] }) };
+		float scale_z{ glm::length(glm::vec3{ matrix[2] }) };
+
+		bounding_sphere sphere{};
+		sphere.center_ = glm::vec3{ matrix * glm::vec4{ this->center_, 1.0f } };
+		sphere.radius_ = this->radius_ * std::max(scale_x, std::max(scale_y, scale_z));
+		return sphere;
+	}
+
+private:
+	template<typename PositionAt>
+	static std::size_t farthest_from(const glm::vec3& point, std::size_t count, PositionAt position_at)
+	{
+		std::size_t farthest{ 0 };
+		float farthest_distance{ -1.0f };
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			glm::vec3 offset{ position_at(index) - point };
+			float distance{ glm::dot(offset, offset) };
+			if (distance > farthest_distance)
+			{
+				farthest = index;
+				farthest_distance = distance;
+			}
+		}
+
+		return farthest;
+	}
+};
+
+
+struct bounding_box
+{
+	glm::vec3 min_{ std::numeric_limits<float>::max() };
+	glm::vec3 max_{ -std::numeric_limits<float>::max() };
+
+	bool is_empty()const noexcept
+	{
+		return this->min_.x > this->max_.x;
+	}
+
+	glm::vec3 center()const
+	{
+		return (this->min_ + this->max_) * 0.5f;
+	}
+
+	glm::vec3 extent()const
+	{
+		return (this->max_ - this->min_) * 0.5f;
+	}
+
+	float surface_area()const
+	{
+		if (this->is_empty())
+		{
+			return 0.0f;
+		}
+
+		glm::vec3 size{ this->max_ - this->min_ };
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static bounding_box from_points(const void* positions, std::size_t count, std::size_t stride)
+	{
+		bounding_box box{};
+		const unsigned char* bytes{ static_cast<const unsigned char*>(positions) };
+		for (std::size_t index = 0; positions != nullptr && index < count; ++index)
+		{
+			box.expand(*reinterpret_cast<const glm::vec3*>(bytes + index * stride));
+		}
+
+		return box;
+	}
+
+	void expand(const glm::vec3& point)
+	{
+		this->min_ = glm::min(this->min_, point);
+		this->max_ = glm::max(this->max_, point);
+	}
+
+	void merge(const bounding_box& other)
+	{
+		if (!other.is_empty())
+		{
+			this->min_ = glm::min(this->min_, other.min_);
+			this->max_ = glm::max(this->max_, other.max_);
+		}
+	}
+
+	// the box around the transformed box, Arvo's method: each matrix element moves one bound of one axis.
+	bounding_box transformed(const glm::mat4& matrix)const
+	{
+		if (this->is_empty())
+		{
+			return *this;
+		}
+
+		bounding_box box{};
+		box.min_ = glm::vec3{ matrix[3] };
+		box.max_ = box.min_;
+		for (int column = 0; column < 3; ++column)
+		{
+			for (int row = 0; row < 3; ++row)
+			{
+				float low{ matrix[column][row] * this->min_[column] };
+				float high{ matrix[column][row] * this->max_[column] };
+				box.min_[row] += std::min(low, high);
+				box.max_[row] += std::max(low, high);
+			}
+		}
+
+		return box;
+	}
+
+	// squared distance from point to the box, 0 inside.
+	float distance_squared(const glm::vec3& point)const
+	{
+		glm::vec3 outside{ glm::max(this->min_ - point, glm::max(glm::vec3{ 0.0f }, point - this->max_)) };
+		return glm::dot(outside, outside);
+	}
+
+	// slab test, inverse_direction is 1 / direction per axis. entry is the distance along the ray, 0 when it starts inside.
+	bool intersects_ray(const glm::vec3& origin, const glm::vec3& inverse_direction, float max_distance, float& entry)const
+	{
+		float near_distance{ 0.0f };
+		float far_distance{ max_distance };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float first{ (this->min_[axis] - origin[axis]) * inverse_direction[axis] };
+			float second{ (this->max_[axis] - origin[axis]) * inverse_direction[axis] };
+			near_distance = std::max(near_distance, std::min(first, second));
+			far_distance = std::min(far_distance, std::max(first, second));
+		}
+
+		entry = near_distance;
+		return near_distance <= far_distance;
+	}
+};
+
+
+// origin + t * direction, t >= 0.
+struct ray
+{
+	glm::vec3 origin_{};
+	glm::vec3 direction_{ 0.0f, 0.0f, -1.0f };
+
+	glm::vec3 inverse_direction()const
+	{
+		// a zero component becomes a huge number instead of inf, so 0 * it stays finite in the slab test.
+		auto inverse = [](float value) { return std::fabs(value) > 1e-20f ? 1.0f / value : (value < 0.0f ? -1e20f : 1e20f); };
+		return glm::vec3{ inverse(this->direction_.x), inverse(this->direction_.y), inverse(this->direction_.z) };
+	}
+
+	ray transformed(const glm::mat4& matrix)const
+	{
+		// the direction is not normalized, so distances along the ray stay comparable between spaces.
+		ray result{};
+		result.origin_ = glm::vec3{ matrix * glm::vec4{ this->origin_, 1.0f } };
+		result.direction_ = glm::vec3{ matrix * glm::vec4{ this->direction_, 0.0f } };
+		return result;
+	}
+
+	// the ray from the camera through a cursor position in window pixels(origin top left, as glfw reports it).
+	static ray from_cursor(double cursor_x, double cursor_y, int width, int height, const glm::mat4& projection, const glm::mat4& view)
+	{
+		float ndc_x{ static_cast<float>(2.0 * cursor_x / width - 1.0) };
+		float ndc_y{ static_cast<float>(1.0 - 2.0 * cursor_y / height) };
+
+		glm::mat4 inverse_view_projection{ glm::inverse(projection * view) };
+		glm::vec4 near_point{ inverse_view_projection * glm::vec4{ ndc_x, ndc_y, -1.0f, 1.0f } };
+		glm::vec4 far_point{ inverse_view_projection * glm::vec4{ ndc_x, ndc_y, 1.0f, 1.0f } };
+
+		ray result{};
+		result.origin_ = glm::vec3{ near_point } / near_point.w;
+		result.direction_ = glm::normalize(glm::vec3{ far_point } / far_point.w - result.origin_);
+		return result;
+	}
+};
+
+
+// the six planes of a view frustum, xyz is the inward normal and w the distance: inside when dot(xyz, p) + w >= 0.
+struct frustum
+{
+	enum plane_index
+	{
+		left_plane,
+		right_plane,
+		bottom_plane,
+		top_plane,
+		near_plane,
+		far_plane,
+		plane_count
+	};
+
+	glm::vec4 planes_[plane_count]{};
+
+	// Gribb/Hartmann: the planes are sums and differences of the rows of projection * view.
+	static frustum from_view_projection(const glm::mat4& view_projection)
+	{
+		glm::vec4 row_x{ view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0] };
+		glm::vec4 row_y{ view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1] };
+		glm::vec4 row_z{ view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2] };
+		glm::vec4 row_w{ view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3] };
+
+		frustum result{};
+		result.planes_[left_plane] = row_w + row_x;
+		result.planes_[right_plane] = row_w - row_x;
+		result.planes_[bottom_plane] = row_w + row_y;
+		result.planes_[top_plane] = row_w - row_y;
+		result.planes_[near_plane] = row_w + row_z;
+		result.planes_[far_plane] = row_w - row_z;
+
+		// unit normals, so the plane distance of a point is in world units and comparable with a radius.
+		for (glm::vec4& plane : result.planes_)
+		{
+			plane /= glm::length(glm::vec3{ plane });
+		}
+
+		return result;
+	}
+
+	bool intersects(const glm::vec3& center, float radius)const noexcept
+	{
+		for (const glm::vec4& plane : this->planes_)
+		{
+			if (glm::dot(glm::vec3{ plane }, center) + plane.w < -radius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool intersects(const bounding_sphere& sphere)const noexcept
+	{
+		return this->intersects(sphere.center_, sphere.radius_);
+	}
+
+	enum containment
+	{
+		outside,
+		intersecting,
+		inside
+	};
+
+	// inside lets a hierarchy accept a whole subtree without testing it.
+	containment classify(const bounding_box& box)const
+	{
+		glm::vec3 center{ box.center() };
+		glm::vec3 extent{ box.extent() };
+
+		containment result{ inside };
+		for (const glm::vec4& plane : this->planes_)
+		{
+			float distance{ glm::dot(glm::vec3{ plane }, center) + plane.w };
+			float reach{ std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z };
+			if (distance + reach < 0.0f)
+			{
+				return outside;
+			}
+
+			if (distance - reach < 0.0f)
+			{
+				result = intersecting;
+			}
+		}
+
+		return result;
+	}
+};
+
+
+#endif // !__FRUSTUM_HPP__
@@ -0,0 +1,363 @@
+#ifndef __FRUSTUM_CULLER_HPP__
+#define __FRUSTUM_CULLER_HPP__
+
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+#include "simd_level.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+
+// bounding spheres as structure of arrays, so one SIMD load fetches the same field of 4 or 8 objects.
+struct sphere_soa
+{
+	std::vector<float> x_{};
+	std::vector<float> y_{};
+	std::vector<float> z_{};
+	std::vector<float> radius_{};
+
+	std::size_t size()const noexcept
+	{
+		return this->x_.size();
+	}
+
+	void reserve(std::size_t count)
+	{
+		this->x_.reserve(count);
+		this->y_.reserve(count);
+		this->z_.reserve(count);
+		this->radius_.reserve(count);
+	}
+
+	void clear()noexcept
+	{
+		this->x_.clear();
+		this->y_.clear();
+		this->z_.clear();
+		this->radius_.clear();
+	}
+
+	void push_back(const bounding_sphere& sphere)
+	{
+		this->x_.push_back(sphere.center_.x);
+		this->y_.push_back(sphere.center_.y);
+		this->z_.push_back(sphere.center_.z);
+		this->radius_.push_back(sphere.radius_);
+	}
+};
+
+
+// axis aligned boxes as center and half extent, structure of arrays like sphere_soa.
+struct aabb_soa
+{
+	std::vector<float> center_x_{};
+	std::vector<float> center_y_{};
+	std::vector<float> center_z_{};
+	std::vector<float> extent_x_{};
+	std::vector<float> extent_y_{};
+	std::vector<float> extent_z_{};
+
+	std::size_t size()const noexcept
+	{
+		return this->center_x_.size();
+	}
+
+	void reserve(std::size_t count)
+	{
+		this->center_x_.reserve(count);
+		this->center_y_.reserve(count);
+		this->center_z_.reserve(count);
+		this->extent_x_.reserve(count);
+		this->extent_y_.reserve(count);
+		this->extent_z_.reserve(count);
+	}
+
+	void clear()noexcept
+	{
+		this->center_x_.clear();
+		this->center_y_.clear();
+		this->center_z_.clear();
+		this->extent_x_.clear();
+		this->extent_y_.clear();
+		this->extent_z_.clear();
+	}
+
+	void push_back(const glm::vec3& min, const glm::vec3& max)
+	{
+		glm::vec3 center{ (min + max) * 0.5f };
+		glm::vec3 extent{ (max - min) * 0.5f };
+		this->center_x_.push_back(center.x);
+		this->center_y_.push_back(center.y);
+		this->center_z_.push_back(center.z);
+		this->extent_x_.push_back(extent.x);
+		this->extent_y_.push_back(extent.y);
+		this->extent_z_.push_back(extent.z);
+	}
+};
+
+
+// tests SoA bounding volumes against a frustum(see frustum::from_view_projection()), 8 at a time with AVX2,
+// 4 with SSE, and writes the indices of the survivors, in ascending order, to a compacted list.
+// the instruction set is picked once at run time, results are the same on every level.
+class frustum_culler final
+{
+private:
+	simd_level level_{ simd_level::scalar };
+
+public:
+	explicit frustum_culler(simd_level level = simd_support::detect())
+		: level_{ level }
+	{
+	}
+
+	simd_level get_level()const noexcept
+	{
+		return this->level_;
+	}
+
+	// returns the number of survivors, visible is resized to it.
+	std::size_t cull(const frustum& view_frustum, const sphere_soa& spheres, std::vector<std::uint32_t>& visible)const
+	{
+		visible.resize(spheres.size());
+
+		std::size_t count{ 0 };
+		switch (this->level_)
+		{
+#if defined(SIMD_X86)
+		case simd_level::avx2: count = frustum_culler::cull_spheres_avx2(view_frustum, spheres, visible.data()); break;
+		case simd_level::sse: count = frustum_culler::cull_spheres_sse(view_frustum, spheres, visible.data()); break;
+#endif
+		default: count = frustum_culler::cull_spheres_scalar(view_frustum, spheres, 0, visible.data()); break;
+		}
+
+		visible.resize(count);
+		return count;
+	}
+
+	std::size_t cull(const frustum& view_frustum, const aabb_soa& boxes, std::vector<std::uint32_t>& visible)const
+	{
+		visible.resize(boxes.size());
+
+		std::size_t count{ 0 };
+		switch (this->level_)
+		{
+#if defined(SIMD_X86)
+		case simd_level::avx2: count = frustum_culler::cull_boxes_avx2(view_frustum, boxes, visible.data()); break;
+		case simd_level::sse: count = frustum_culler::cull_boxes_sse(view_frustum, boxes, visible.data()); break;
+#endif
+		default: count = frustum_culler::cull_boxes_scalar(view_frustum, boxes, 0, visible.data()); break;
+		}
+
+		visible.resize(count);
+		return count;
+	}
+
+	// scalar, from begin on. also finishes the tail the SIMD loops leave behind.
+	static std::size_t cull_spheres_scalar(const frustum& view_frustum, const sphere_soa& spheres, std::size_t begin, std::uint32_t* visible)
+	{
+		std::size_t count{ 0 };
+		for (std::size_t index = begin; index < spheres.size(); ++index)
+		{
+			glm::vec3 center{ spheres.x_[index], spheres.y_[index], spheres.z_[index] };
+			if (view_frustum.intersects(center, spheres.radius_[index]))
+			{
+				visible[count++] = static_cast<std::uint32_t>(index);
+			}
+		}
+
+		return count;
+	}
+
+	static std::size_t cull_boxes_scalar(const frustum& view_frustum, const aabb_soa& boxes, std::size_t begin, std::uint32_t* visible)
+	{
+		std::size_t count{ 0 };
+		for (std::size_t index = begin; index < boxes.size(); ++index)
+		{
+			bool inside{ true };
+			for (const glm::vec4& plane : view_frustum.planes_)
+			{
+				// the box corner farthest along the normal decides.
+				float distance{ plane.x * boxes.center_x_[index] + plane.y * boxes.center_y_[index] + plane.z * boxes.center_z_[index] + plane.w };
+				float reach{ std::fabs(plane.x) * boxes.extent_x_[index] + std::fabs(plane.y) * boxes.extent_y_[index] + std::fabs(plane.z) * boxes.extent_z_[index] };
+				if (distance + reach < 0.0f)
+				{
+					inside = false;
+					break;
+				}
+			}
+
+			if (inside)
+			{
+				visible[count++] = static_cast<std::uint32_t>(index);
+			}
+		}
+
+		return count;
+	}
+
+#if defined(SIMD_X86)
+	static std::size_t cull_spheres_sse(const frustum& view_frustum, const sphere_soa& spheres, std::uint32_t* visible)
+	{
+		std::size_t count{ 0 };
+		std::size_t simd_end{ spheres.size() & ~static_cast<std::size_t>(3) };
+
+		for (std::size_t index = 0; index < simd_end; index += 4)
+		{
+			__m128 x{ _mm_loadu_ps(spheres.x_.data() + index) };
+			__m128 y{ _mm_loadu_ps(spheres.y_.data() + index) };
+			__m128 z{ _mm_loadu_ps(spheres.z_.data() + index) };
+			__m128 negative_radius{ _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius_.data() + index)) };
+
+			__m128 inside{ _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+			for (const glm::vec4& plane : view_frustum.planes_)
+			{
+				__m128 distance{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), z), _mm_set1_ps(plane.w))) };
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+			}
+
+			count += frustum_culler::compact(_mm_movemask_ps(inside), index, visible + count);
+		}
+
+		return count + frustum_culler::cull_spheres_scalar(view_frustum, spheres, simd_end, visible + count);
+	}
+
+	static std::size_t cull_boxes_sse(const frustum& view_frustum, const aabb_soa& boxes, std::uint32_t* visible)
+	{
+		std::size_t count{ 0 };
+		std::size_t simd_end{ boxes.size() & ~static_cast<std::size_t>(3) };
+
+		for (std::size_t index = 0; index < simd_end; index += 4)
+		{
+			__m128 center_x{ _mm_loadu_ps(boxes.center_x_.data() + index) };
+			__m128 center_y{ _mm_loadu_ps(boxes.center_y_.data() + index) };
+			__m128 center_z{ _mm_loadu_ps(boxes.center_z_.data() + index) };
+			__m128 extent_x{ _mm_loadu_ps(boxes.extent_x_.data() + index) };
+			__m128 extent_y{ _mm_loadu_ps(boxes.extent_y_.data() + index) };
+			__m128 extent_z{ _mm_loadu_ps(boxes.extent_z_.data() + index) };
+
+			__m128 inside{ _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+			for (const glm::vec4& plane : view_frustum.planes_)
+			{
+				__m128 distance{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), center_x), _mm_mul_ps(_mm_set1_ps(plane.y), center_y)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), center_z), _mm_set1_ps(plane.w))) };
+				__m128 reach{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), extent_x), _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), extent_y)),
+					_mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), extent_z)) };
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+			}
+
+			count += frustum_culler::compact(_mm_movemask_ps(inside), index, visible + count);
+		}
+
+		return count + frustum_culler::cull_boxes_scalar(view_frustum, boxes, simd_end, visible + count);
+	}
+
+	SIMD_TARGET_AVX2
+	static std::size_t cull_spheres_avx2(const frustum& view_frustum, const sphere_soa& spheres, std::uint32_t* visible)
+	{
+		std::size_t count{ 0 };
+		std::size_t simd_end{ spheres.size() & ~static_cast<std::size_t>(7) };
+
+		__m256 plane_x[frustum::plane_count], plane_y[frustum::plane_count], plane_z[frustum::plane_count], plane_w[frustum::plane_count];
+		for (std::size_t plane = 0; plane < frustum::plane_count; ++plane)
+		{
+			plane_x[plane] = _mm256_set1_ps(view_frustum.planes_[plane].x);
+			plane_y[plane] = _mm256_set1_ps(view_frustum.planes_[plane].y);
+			plane_z[plane] = _mm256_set1_ps(view_frustum.planes_[plane].z);
+			plane_w[plane] = _mm256_set1_ps(view_frustum.planes_[plane].w);
+		}
+
+		for (std::size_t index = 0; index < simd_end; index += 8)
+		{
+			__m256 x{ _mm256_loadu_ps(spheres.x_.data() + index) };
+			__m256 y{ _mm256_loadu_ps(spheres.y_.data() + index) };
+			__m256 z{ _mm256_loadu_ps(spheres.z_.data() + index) };
+			__m256 negative_radius{ _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius_.data() + index)) };
+
+			__m256 inside{ _mm256_castsi256_ps(_mm256_set1_epi32(-1)) };
+			for (std::size_t plane = 0; plane < frustum::plane_count; ++plane)
+			{
+				__m256 distance{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x[plane], x), _mm256_mul_ps(plane_y[plane], y)),
+					_mm256_add_ps(_mm256_mul_ps(plane_z[plane], z), plane_w[plane])) };
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+			}
+
+			count += frustum_culler::compact(_mm256_movemask_ps(inside), index, visible + count);
+		}
+
+		return count + frustum_culler::cull_spheres_scalar(view_frustum, spheres, simd_end, visible + count);
+	}
+
+	SIMD_TARGET_AVX2
+	static std::size_t cull_boxes_avx2(const frustum& view_frustum, const aabb_soa& boxes, std::uint32_t* visible)
+	{
+		std::size_t count{ 0 };
+		std::size_t simd_end{ boxes.size() & ~static_cast<std::size_t>(7) };
+
+		for (std::size_t index = 0; index < simd_end; index += 8)
+		{
+			__m256 center_x{ _mm256_loadu_ps(boxes.center_x_.data() + index) };
+			__m256 center_y{ _mm256_loadu_ps(boxes.center_y_.data() + index) };
+			__m256 center_z{ _mm256_loadu_ps(boxes.center_z_.data() + index) };
+			__m256 extent_x{ _mm256_loadu_ps(boxes.extent_x_.data() + index) };
+			__m256 extent_y{ _mm256_loadu_ps(boxes.extent_y_.data() + index) };
+			__m256 extent_z{ _mm256_loadu_ps(boxes.extent_z_.data() + index) };
+
+			__m256 inside{ _mm256_castsi256_ps(_mm256_set1_epi32(-1)) };
+			for (const glm::vec4& plane : view_frustum.planes_)
+			{
+				__m256 distance{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), center_x), _mm256_mul_ps(_mm256_set1_ps(plane.y), center_y)),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), center_z), _mm256_set1_ps(plane.w))) };
+				__m256 reach{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.x)), extent_x), _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.y)), extent_y)),
+					_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.z)), extent_z)) };
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+
+			count += frustum_culler::compact(_mm256_movemask_ps(inside), index, visible + count);
+		}
+
+		return count + frustum_culler::cull_boxes_scalar(view_frustum, boxes, simd_end, visible + count);
+	}
+#endif
+
+private:
+	// appends base + the position of every set bit of mask, lowest first.
+	static std::size_t compact(int mask, std::size_t base, std::uint32_t* visible)noexcept
+	{
+		std::size_t count{ 0 };
+		unsigned int bits{ static_cast<unsigned int>(mask) };
+		while (bits != 0)
+		{
+			visible[count++] = static_cast<std::uint32_t>(base + frustum_culler::lowest_bit(bits));
+			bits &= bits - 1;
+		}
+
+		return count;
+	}
+
+	static unsigned int lowest_bit(unsigned int bits)noexcept
+	{
+#if defined(_MSC_VER)
+		unsigned long index{};
+		_BitScanForward(&index, bits);
+		return static_cast<unsigned int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+		return static_cast<unsigned int>(__builtin_ctz(bits));
+#else
+		unsigned int index{ 0 };
+		while ((bits & 1u) == 0)
+		{
+			bits >>= 1;
+			++index;
+		}
+		return index;
+#endif
+	}
+};
+
+
+#endif // !__FRUSTUM_CULLER_HPP__
@@ -0,0 +1,244 @@
+#ifndef __GEOMETRY_ARENA_HPP__
+#define __GEOMETRY_ARENA_HPP__
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+// where a mesh lives inside a geometry_arena.
+struct geometry_range
+{
+	GLint base_vertex_{};
+	GLsizei vertex_count_{};
+	// in indices of index_type_, which is what draws and indirect commands expect.
+	GLuint first_index_{};
+	GLsizei index_count_{};
+	GLenum index_type_{ GL_UNSIGNED_INT };
+
+	std::size_t get_index_size()const noexcept
+	{
+		return this->index_type_ == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	}
+
+	const void* get_index_offset()const noexcept
+	{
+		return reinterpret_cast<const void*>(static_cast<std::size_t>(this->first_index_) * this->get_index_size());
+	}
+};
+
+// indices relative to a mesh of vertex_count vertices fit 16 bits up to 65536 vertices.
+static constexpr const std::size_t SHORT_INDEX_VERTEX_LIMIT{ 65536 };
+
+inline GLenum index_type_for(std::size_t vertex_count)noexcept
+{
+	return vertex_count <= SHORT_INDEX_VERTEX_LIMIT ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+
+// one VBO and one EBO shared by every mesh of a vertex format, each mesh gets a sub range of both.
+// indices stay relative to their mesh, draws add base_vertex_ with glDrawElementsBaseVertex.
+// the EBO mixes 16 and 32 bit ranges, each one aligned to its own index size, draws pass the range's index type.
+// the buffers grow by copying on the GPU, ranges handed out earlier stay valid.
+class geometry_arena final
+{
+private:
+	GLsizei vertex_stride_{};
+	void(*setup_vertex_attributes_)(){ nullptr };
+
+	GLuint VBO_{};
+	GLuint EBO_{};
+	// VAO_ and every VAO made by create_vertex_array(), re pointed at the new buffers when the arena grows.
+	GLuint VAO_{};
+	std::vector<GLuint> vertex_arrays_{};
+
+	std::size_t vertex_capacity_{};
+	std::size_t index_byte_capacity_{};
+	std::size_t vertex_count_{};
+	std::size_t index_bytes_{};
+
+	// narrowed copy of the indices of a 16 bit range.
+	std::vector<GLushort> short_indices_{};
+
+public:
+	// setup_vertex_attributes is called with a VAO and the arena VBO bound, and enables the format's attributes.
+	geometry_arena(GLsizei vertex_stride, void(*setup_vertex_attributes)(), std::size_t vertex_capacity, std::size_t index_byte_capacity)
+		: vertex_stride_{ vertex_stride },
+		setup_vertex_attributes_{ setup_vertex_attributes },
+		vertex_capacity_{ vertex_capacity },
+		index_byte_capacity_{ index_byte_capacity }
+	{
+	}
+
+	geometry_arena(const geometry_arena&) = delete;
+	geometry_arena& operator=(const geometry_arena&) = delete;
+
+	GLuint get_VAO()
+	{
+		this->create_buffers();
+		return this->VAO_;
+	}
+
+	GLuint get_VBO()
+	{
+		this->create_buffers();
+		return this->VBO_;
+	}
+
+	GLuint get_EBO()
+	{
+		this->create_buffers();
+		return this->EBO_;
+	}
+
+	std::size_t get_vertex_count()const noexcept
+	{
+		return this->vertex_count_;
+	}
+
+	std::size_t get_index_bytes()const noexcept
+	{
+		return this->index_bytes_;
+	}
+
+	// copy vertices and indices to the end of the arena, GL thread only.
+	// index_type GL_UNSIGNED_SHORT stores the indices narrowed, they must all be below 65536(see index_type_for()).
+	geometry_range allocate(const void* vertices, std::size_t vertex_count, const GLuint* indices, std::size_t index_count,
+		GLenum index_type = GL_UNSIGNED_INT)
+	{
+		geometry_range range{};
+		range.index_type_ = index_type;
+
+		std::size_t index_size{ range.get_index_size() };
+		std::size_t first_byte{ (this->index_bytes_ + index_size - 1) / index_size * index_size };
+
+		this->create_buffers();
+		this->reserve(this->vertex_count_ + vertex_count, first_byte + index_count * index_size);
+
+		range.base_vertex_ = static_cast<GLint>(this->vertex_count_);
+		range.vertex_count_ = static_cast<GLsizei>(vertex_count);
+		range.first_index_ = static_cast<GLuint>(first_byte / index_size);
+		range.index_count_ = static_cast<GLsizei>(index_count);
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO_);
+		glBufferSubData(GL_ARRAY_BUFFER, this->vertex_count_ * this->vertex_stride_, vertex_count * this->vertex_stride_, vertices);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		const void* index_data{ indices };
+		if (index_type == GL_UNSIGNED_SHORT)
+		{
+			this->short_indices_.assign(indices, indices + index_count);
+			index_data = this->short_indices_.data();
+		}
+
+		// the element array binding belongs to the VAO, so go through GL_COPY_WRITE_BUFFER instead.
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->EBO_);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, first_byte, index_count * index_size, index_data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		this->vertex_count_ += vertex_count;
+		this->index_bytes_ = first_byte + index_count * index_size;
+
+		return range;
+	}
+
+	// a new VAO reading this arena, for draws which add their own attributes(e.g. per instance data).
+	GLuint create_vertex_array()
+	{
+		this->create_buffers();
+
+		GLuint vertex_array{};
+		glGenVertexArrays(1, &vertex_array);
+		this->setup_vertex_array(vertex_array);
+		this->vertex_arrays_.push_back(vertex_array);
+
+		return vertex_array;
+	}
+
+	void reserve(std::size_t vertex_capacity, std::size_t index_byte_capacity)
+	{
+		this->create_buffers();
+
+		if (vertex_capacity > this->vertex_capacity_)
+		{
+			this->VBO_ = this->grow_buffer(this->VBO_, this->vertex_count_ * this->vertex_stride_,
+				std::max(vertex_capacity, this->vertex_capacity_ * 2) * this->vertex_stride_);
+			this->vertex_capacity_ = std::max(vertex_capacity, this->vertex_capacity_ * 2);
+			this->setup_vertex_arrays();
+		}
+
+		if (index_byte_capacity > this->index_byte_capacity_)
+		{
+			this->EBO_ = this->grow_buffer(this->EBO_, this->index_bytes_, std::max(index_byte_capacity, this->index_byte_capacity_ * 2));
+			this->index_byte_capacity_ = std::max(index_byte_capacity, this->index_byte_capacity_ * 2);
+			this->setup_vertex_arrays();
+		}
+	}
+
+private:
+	void create_buffers()
+	{
+		if (this->VAO_)
+		{
+			return;
+		}
+
+		glGenBuffers(1, &this->VBO_);
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO_);
+		glBufferData(GL_ARRAY_BUFFER, this->vertex_capacity_ * this->vertex_stride_, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &this->EBO_);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->EBO_);
+		glBufferData(GL_COPY_WRITE_BUFFER, this->index_byte_capacity_, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		glGenVertexArrays(1, &this->VAO_);
+		this->setup_vertex_array(this->VAO_);
+		this->vertex_arrays_.push_back(this->VAO_);
+	}
+
+	static GLuint grow_buffer(GLuint old_buffer, std::size_t used_bytes, std::size_t new_bytes)
+	{
+		GLuint new_buffer{};
+		glGenBuffers(1, &new_buffer);
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, nullptr, GL_STATIC_DRAW);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, old_buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_bytes);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &old_buffer);
+
+		return new_buffer;
+	}
+
+	void setup_vertex_arrays()
+	{
+		for (GLuint vertex_array : this->vertex_arrays_)
+		{
+			this->setup_vertex_array(vertex_array);
+		}
+	}
+
+	void setup_vertex_array(GLuint vertex_array)
+	{
+		glBindVertexArray(vertex_array);
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO_);
+		this->setup_vertex_attributes_();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO_);
+
+		//notice here:
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
+
+
+#endif // !__GEOMETRY_ARENA_HPP__
@@ -3,9 +3,18 @@ out vec4 frag_color;
 
 in vec2 TexCoords;
 
+#ifdef MATERIAL_ARRAY
+flat in uint Material;
+#include "material_block.glsl"
+#else
 uniform sampler2D texture_diffuse_1;
+#endif
 
 void main()
 {
+#ifdef MATERIAL_ARRAY
+    frag_color = sample_material(Material, TexCoords);
+#else
     frag_color = texture(texture_diffuse_1, TexCoords);
+#endif
 }
\ No newline at end of file
@@ -1,14 +1,22 @@
 #version 330 core
-layout (location = 0) in vec3 ver_position;
+layout (location = 0) in vec4 ver_position;
 layout (location = 2) in vec2 ver_tex_coord;
 layout (location = 3) in mat4 instance_matrix;
 
 out vec2 TexCoords;
-uniform mat4 projection;
-uniform mat4 view;
+#ifdef MATERIAL_ARRAY
+// constant per mesh, see MATERIAL_LOCATION in material_library.hpp.
+layout (location = 7) in uint material_index;
+flat out uint Material;
+#endif
+#include "camera_block.glsl"
+#include "vertex_decode.glsl"
 
 void main()
 {
     TexCoords = ver_tex_coord;
-    gl_Position = projection * view * instance_matrix * vec4(ver_position, 1.0); 
+#ifdef MATERIAL_ARRAY
+    Material = material_index;
+#endif
+    gl_Position = projection * view * instance_matrix * vec4(decode_position(ver_position), 1.0); 
 }
\ No newline at end of file
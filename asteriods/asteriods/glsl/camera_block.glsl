@@ -0,0 +1,7 @@
+// shared by every program, see camera_block in uniform_blocks.hpp.
+layout (std140) uniform camera_block
+{
+    mat4 projection;
+    mat4 view;
+    vec4 camera_position;
+};
\ No newline at end of file
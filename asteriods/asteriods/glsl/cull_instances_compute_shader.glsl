@@ -0,0 +1,155 @@
+#version 430 core
+// frustum culling and level of detail selection of the asteroid instances, one invocation per rock, in two passes.
+// pass 0: survivors pick a level by their size on screen and take a slot in it, each level's count lands in the
+// instance count of its first indirect draw. pass 1: every survivor is copied to visible_matrices behind the levels
+// before its own, and the other meshes' draws of each level get the same count and first instance.
+// bindings are the CULL_*_BINDING constants of instance_culler.hpp.
+layout (local_size_x = 256) in;
+
+// MESH_LOD_COUNT of mesh.hpp, the level is kept in the top 2 bits of a placement.
+#define LOD_COUNT 4
+#define NOT_VISIBLE 0xffffffffu
+#define SLOT_MASK 0x3fffffffu
+
+// std430 packs it like draw_elements_indirect_command.
+struct draw_command
+{
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+layout (std430, binding = 0) readonly buffer instance_matrices
+{
+    mat4 matrices[];
+};
+
+// xyz center, w radius, in world space.
+layout (std430, binding = 1) readonly buffer instance_spheres
+{
+    vec4 spheres[];
+};
+
+layout (std430, binding = 2) writeonly buffer visible_instances
+{
+    mat4 visible_matrices[];
+};
+
+// level major, the draw of mesh m at level l is commands[l * mesh_count + m].
+layout (std430, binding = 3) buffer draw_commands
+{
+    draw_command commands[];
+};
+
+// level << 30 | slot inside the level, or NOT_VISIBLE.
+layout (std430, binding = 4) buffer instance_placements
+{
+    uint placements[];
+};
+
+uniform vec4 frustum_planes[6];
+uniform uint instance_count;
+uniform uint cull_pass;
+uniform uint mesh_count;
+uniform uint level_count;
+
+// see lod_selector.hpp.
+uniform vec4 depth_row;
+uniform float pixel_scale;
+uniform float max_screen_radius[LOD_COUNT];
+
+// survivors of the work group per level, so only one invocation per group and level touches the global counters.
+shared uint group_visible[LOD_COUNT];
+shared uint group_first[LOD_COUNT];
+
+uint select_level(vec4 sphere)
+{
+    float depth = dot(depth_row.xyz, sphere.xyz) + depth_row.w;
+    if (depth <= sphere.w)
+        return 0u;
+
+    float screen_radius = sphere.w * pixel_scale / depth;
+    uint level = level_count - 1u;
+    while (level > 0u && screen_radius > max_screen_radius[level])
+        --level;
+
+    return level;
+}
+
+void classify(uint index)
+{
+    if (gl_LocalInvocationIndex < uint(LOD_COUNT))
+        group_visible[gl_LocalInvocationIndex] = 0u;
+
+    memoryBarrierShared();
+    barrier();
+
+    bool visible = index < instance_count;
+    uint level = 0u;
+    if (visible)
+    {
+        vec4 sphere = spheres[index];
+        for (int plane = 0; plane < 6; ++plane)
+            visible = visible && dot(frustum_planes[plane].xyz, sphere.xyz) + frustum_planes[plane].w >= -sphere.w;
+
+        level = select_level(sphere);
+    }
+
+    uint group_slot = 0u;
+    if (visible)
+        group_slot = atomicAdd(group_visible[level], 1u);
+
+    memoryBarrierShared();
+    barrier();
+
+    if (gl_LocalInvocationIndex < level_count)
+        group_first[gl_LocalInvocationIndex] = atomicAdd(commands[gl_LocalInvocationIndex * mesh_count].instance_count, group_visible[gl_LocalInvocationIndex]);
+
+    memoryBarrierShared();
+    barrier();
+
+    if (index < instance_count)
+        placements[index] = visible ? (level << 30) | (group_first[level] + group_slot) : NOT_VISIBLE;
+}
+
+void place(uint index)
+{
+    uint placement = index < instance_count ? placements[index] : NOT_VISIBLE;
+    if (placement != NOT_VISIBLE)
+    {
+        uint level = placement >> 30;
+        uint first = 0u;
+        for (uint before = 0u; before < level; ++before)
+            first += commands[before * mesh_count].instance_count;
+
+        visible_matrices[first + (placement & SLOT_MASK)] = matrices[index];
+    }
+
+    // only the first mesh's counts are read above, so one invocation may write the rest.
+    if (index == 0u)
+    {
+        uint first = 0u;
+        for (uint level = 0u; level < level_count; ++level)
+        {
+            uint count = commands[level * mesh_count].instance_count;
+            commands[level * mesh_count].base_instance = first;
+            for (uint mesh = 1u; mesh < mesh_count; ++mesh)
+            {
+                commands[level * mesh_count + mesh].instance_count = count;
+                commands[level * mesh_count + mesh].base_instance = first;
+            }
+            first += count;
+        }
+    }
+}
+
+// cull_pass is uniform, so the barriers of classify() sit in uniform flow control.
+void main()
+{
+    if (cull_pass == 0u)
+        classify(gl_GlobalInvocationID.x);
+    else
+        place(gl_GlobalInvocationID.x);
+}
\ No newline at end of file
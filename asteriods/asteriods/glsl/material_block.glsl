@@ -0,0 +1,32 @@
+// every texture of the scene in one sampler2DArray, see material_block in uniform_blocks.hpp and material_library.hpp.
+// a material is a whole layer, or a rectangle of an atlas layer surrounded by its own wrapped edges.
+#define MAX_MATERIALS 256
+
+struct material
+{
+    vec4 uv_rect;
+    vec4 layer;
+};
+
+layout (std140) uniform material_block
+{
+    material materials[MAX_MATERIALS];
+};
+
+uniform sampler2DArray material_textures;
+
+// repeats the texture inside its rectangle. the gradients come from the coordinates before fract(), so the wrap leaves no seam,
+// and are shortened where the mip level would read past the rectangle's padding.
+vec4 sample_material(uint index, vec2 texcoord)
+{
+    material the_material = materials[index];
+    vec2 gradient_x = dFdx(texcoord) * the_material.uv_rect.zw;
+    vec2 gradient_y = dFdy(texcoord) * the_material.uv_rect.zw;
+
+    vec2 layer_size = vec2(textureSize(material_textures, 0).xy);
+    float footprint = max(length(gradient_x * layer_size), length(gradient_y * layer_size));
+    float shorten = min(1.0, the_material.layer.y / max(footprint, 1e-6));
+
+    vec2 uv = the_material.uv_rect.xy + fract(texcoord) * the_material.uv_rect.zw;
+    return textureGrad(material_textures, vec3(uv, the_material.layer.x), gradient_x * shorten, gradient_y * shorten);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 430 core
+out vec4 frag_color;
+
+in vec2 TexCoords;
+flat in uint Material;
+
+#include "material_block.glsl"
+
+void main()
+{
+    frag_color = sample_material(Material, TexCoords);
+}
\ No newline at end of file
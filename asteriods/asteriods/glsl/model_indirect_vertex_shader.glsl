@@ -0,0 +1,19 @@
+#version 430 core
+layout (location = 0) in vec4 ver_position;
+layout (location = 2) in vec2 ver_tex_coord;
+// one value per draw command, fetched through the command's base instance.
+layout (location = 7) in uint material_index;
+
+out vec2 TexCoords;
+flat out uint Material;
+
+#include "camera_block.glsl"
+#include "vertex_decode.glsl"
+uniform mat4 model;
+
+void main()
+{
+    TexCoords = ver_tex_coord;
+    Material = material_index;
+    gl_Position = projection * view * model * vec4(decode_position(ver_position), 1.0);
+}
\ No newline at end of file
@@ -1,17 +1,25 @@
 #version 330 core
 
-layout (location = 0) in vec3 the_position;
+layout (location = 0) in vec4 the_position;
 layout (location = 2) in vec2 tex_tex_coords;
 
-out vec3 TexCoords;
+out vec2 TexCoords;
+#ifdef MATERIAL_ARRAY
+// constant per mesh, see MATERIAL_LOCATION in material_library.hpp.
+layout (location = 7) in uint material_index;
+flat out uint Material;
+#endif
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "camera_block.glsl"
+#include "vertex_decode.glsl"
 uniform mat4 model;
 
 
 void main()
 {
-    TexCoords = the_tex_coords;
-    gl_Position = projection * view * model * vec4(the_position, 1,0f);
+    TexCoords = tex_tex_coords;
+#ifdef MATERIAL_ARRAY
+    Material = material_index;
+#endif
+    gl_Position = projection * view * model * vec4(decode_position(the_position), 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+// undoes packed_vertex, see vertex_format.hpp. a full vertex gets scale(1, 1, 1, 0) and offset 0, so the same code reads both.
+// constant per draw: glVertexAttrib4fv for direct draws, an instanced attribute for multi draws.
+layout (location = 8) in vec4 vertex_decode_scale;
+layout (location = 9) in vec4 vertex_decode_offset;
+
+vec3 decode_position(vec4 position)
+{
+    return position.xyz * vertex_decode_scale.xyz + vertex_decode_offset.xyz;
+}
+
+vec3 decode_octahedral(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (direction.z < 0.0)
+    {
+        direction.xy = (1.0 - abs(direction.yx)) * vec2(encoded.x >= 0.0 ? 1.0 : -1.0, encoded.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(direction);
+}
+
+// normal is attribute 1 as it is: octahedral normal in xy and tangent in zw when packed, a plain normal otherwise.
+vec3 decode_normal(vec4 normal)
+{
+    return vertex_decode_scale.w > 0.5 ? decode_octahedral(normal.xy) : normal.xyz;
+}
+
+// packed vertices only, the bitangent sign is in the position's w.
+vec3 decode_tangent(vec4 normal)
+{
+    return decode_octahedral(normal.zw);
+}
+
+vec3 decode_bitangent(vec3 normal, vec3 tangent, vec4 position)
+{
+    return cross(normal, tangent) * (position.w * 2.0 - 1.0);
+}
\ No newline at end of file
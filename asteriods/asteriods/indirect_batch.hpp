@@ -0,0 +1,168 @@
+#ifndef __INDIRECT_BATCH_HPP__
+#define __INDIRECT_BATCH_HPP__
+
+#include <glad/glad.h>
+
+#include "mesh.hpp"
+#include "render_stats.hpp"
+#include "render_queue.hpp"
+
+#include <list>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+
+// layout fixed by the GL spec for GL_DRAW_INDIRECT_BUFFER.
+struct draw_elements_indirect_command
+{
+	GLuint count_;
+	GLuint instance_count_;
+	GLuint first_index_;
+	GLint base_vertex_;
+	GLuint base_instance_;
+};
+
+static_assert(sizeof(draw_elements_indirect_command) == 5 * sizeof(GLuint), "indirect command must be tightly packed");
+
+// element i of the per draw buffer, fetched by command i.
+struct indirect_draw_data
+{
+	GLuint material_;
+	vertex_decode decode_;
+};
+
+
+// renders a list of meshes living in mesh::get_arena() with one glMultiDrawElementsIndirect per vertex layout and index type.
+// the material and the vertex decode of each draw reach the shader through instanced attributes:
+// command i has base_instance_ = i, so it fetches element i of the per draw buffer.
+class indirect_batch final
+{
+private:
+	// the commands of one vertex layout and index type, drawn through that layout's VAO.
+	struct layout_group
+	{
+		vertex_layout layout_;
+		GLenum index_type_;
+		GLuint VAO_;
+		GLsizei first_command_;
+		GLsizei command_count_;
+	};
+
+	std::vector<layout_group> groups_{};
+	GLuint indirect_buffer_{};
+	GLuint material_buffer_{};
+	GLsizei draw_count_{};
+	std::size_t triangle_count_{};
+
+public:
+	indirect_batch() = default;
+	indirect_batch(const indirect_batch&) = delete;
+	indirect_batch& operator=(const indirect_batch&) = delete;
+
+	~indirect_batch()
+	{
+		glDeleteBuffers(1, &this->indirect_buffer_);
+		glDeleteBuffers(1, &this->material_buffer_);
+	}
+
+	GLsizei get_draw_count()const noexcept
+	{
+		return this->draw_count_;
+	}
+
+	// the meshes must have been uploaded and given their materials(see model_loader::assign_materials()).
+	void build(const std::list<std::shared_ptr<mesh>>& meshes)
+	{
+		std::vector<draw_elements_indirect_command> commands{};
+		std::vector<indirect_draw_data> draws{};
+
+		commands.reserve(meshes.size());
+		draws.reserve(meshes.size());
+
+		// commands of a layout and index type are contiguous so each pair is one multi draw.
+		std::vector<std::shared_ptr<mesh>> ordered{ meshes.begin(), meshes.end() };
+		std::stable_sort(ordered.begin(), ordered.end(), [](const std::shared_ptr<mesh>& left, const std::shared_ptr<mesh>& right)
+		{
+			return std::make_pair(left->get_layout(), left->get_index_type()) < std::make_pair(right->get_layout(), right->get_index_type());
+		});
+
+		for (const auto& shared_mesh : ordered)
+		{
+			const geometry_range& range{ shared_mesh->get_range() };
+			if (this->groups_.empty() || this->groups_.back().layout_ != shared_mesh->get_layout() || this->groups_.back().index_type_ != range.index_type_)
+			{
+				this->groups_.push_back(layout_group{ shared_mesh->get_layout(), range.index_type_, 0, static_cast<GLsizei>(commands.size()), 0 });
+			}
+			++this->groups_.back().command_count_;
+
+			draw_elements_indirect_command command{};
+			command.count_ = static_cast<GLuint>(range.index_count_);
+			command.instance_count_ = 1;
+			command.first_index_ = range.first_index_;
+			command.base_vertex_ = range.base_vertex_;
+			command.base_instance_ = static_cast<GLuint>(commands.size());
+			commands.push_back(command);
+			this->triangle_count_ += command.count_ / 3;
+
+			draws.push_back(indirect_draw_data{ shared_mesh->get_material(), shared_mesh->get_decode() });
+		}
+
+		this->draw_count_ = static_cast<GLsizei>(commands.size());
+
+		glGenBuffers(1, &this->indirect_buffer_);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(draw_elements_indirect_command), commands.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		glGenBuffers(1, &this->material_buffer_);
+		glBindBuffer(GL_ARRAY_BUFFER, this->material_buffer_);
+		glBufferData(GL_ARRAY_BUFFER, draws.size() * sizeof(indirect_draw_data), draws.data(), GL_STATIC_DRAW);
+
+		for (layout_group& group : this->groups_)
+		{
+			group.VAO_ = mesh::get_arena(group.layout_).create_vertex_array();
+			glBindVertexArray(group.VAO_);
+			glEnableVertexAttribArray(MATERIAL_LOCATION);
+			glVertexAttribIPointer(MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, sizeof(indirect_draw_data),
+				reinterpret_cast<void*>(offsetof(indirect_draw_data, material_)));
+			glVertexAttribDivisor(MATERIAL_LOCATION, 1);
+
+			glEnableVertexAttribArray(VERTEX_DECODE_SCALE_LOCATION);
+			glVertexAttribPointer(VERTEX_DECODE_SCALE_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(indirect_draw_data),
+				reinterpret_cast<void*>(offsetof(indirect_draw_data, decode_) + offsetof(vertex_decode, scale_)));
+			glVertexAttribDivisor(VERTEX_DECODE_SCALE_LOCATION, 1);
+
+			glEnableVertexAttribArray(VERTEX_DECODE_OFFSET_LOCATION);
+			glVertexAttribPointer(VERTEX_DECODE_OFFSET_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(indirect_draw_data),
+				reinterpret_cast<void*>(offsetof(indirect_draw_data, decode_) + offsetof(vertex_decode, offset_)));
+			glVertexAttribDivisor(VERTEX_DECODE_OFFSET_LOCATION, 1);
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// the program must be in use and sample the material array through glsl/material_block.glsl, runs as a render_queue callback.
+	void draw(render_state& state)
+	{
+		state.bind_material_array();
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+		for (const layout_group& group : this->groups_)
+		{
+			state.bind_VAO(group.VAO_);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, group.index_type_,
+				reinterpret_cast<void*>(group.first_command_ * sizeof(draw_elements_indirect_command)), group.command_count_, 0);
+			++render_stats::current().draw_calls_;
+		}
+		render_stats::current().triangles_ += this->triangle_count_;
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+};
+
+
+#endif // !__INDIRECT_BATCH_HPP__
@@ -0,0 +1,659 @@
+#ifndef __INSTANCE_CULLER_HPP__
+#define __INSTANCE_CULLER_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+#include "frustum_culler.hpp"
+#include "lod_selector.hpp"
+#include "mesh.hpp"
+#include "indirect_batch.hpp"
+#include "render_stats.hpp"
+#include "render_queue.hpp"
+#include "shader_program.hpp"
+
+#include <list>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+
+// buffer bindings of glsl/cull_instances_compute_shader.glsl.
+static constexpr const GLuint CULL_MATRICES_BINDING{ 0 };
+static constexpr const GLuint CULL_SPHERES_BINDING{ 1 };
+static constexpr const GLuint CULL_VISIBLE_BINDING{ 2 };
+static constexpr const GLuint CULL_COMMANDS_BINDING{ 3 };
+static constexpr const GLuint CULL_PLACEMENTS_BINDING{ 4 };
+
+// invocations per work group, local_size_x of the compute shader.
+static constexpr const GLuint CULL_GROUP_SIZE{ 256 };
+
+// dispatches that may be in flight with their results unread, a frame further ahead goes untimed.
+static constexpr const std::size_t CULL_QUERY_RING{ 3 };
+
+// the compute shader packs the level into the top 2 bits of an instance's slot.
+static_assert(MESH_LOD_COUNT <= 4, "glsl/cull_instances_compute_shader.glsl handles up to 4 levels");
+
+
+enum class cull_mode
+{
+	// every instance is drawn, as before culling existed.
+	off,
+	// spheres tested on the CPU with frustum_culler(AVX2/SSE), survivors uploaded every frame. runs on OpenGL 3.3.
+	cpu,
+	// a compute shader compacts the survivors and writes the instance count of the indirect draws(needs OpenGL 4.3).
+	gpu
+};
+
+
+// frustum culling of many instances of one model, each one bounded by the model's sphere under its matrix.
+// the survivors' matrices end up packed at the front of get_instance_buffer(), meant to be read as an instanced attribute,
+// grouped by the level of detail their size on screen asks for. each level is drawn from its own indices of the meshes.
+class instance_culler final
+{
+private:
+	cull_mode mode_{ cull_mode::off };
+	std::size_t instance_count_{};
+
+	// released once the GPU has its own copy.
+	std::vector<glm::mat4> matrices_{};
+	// world space spheres, xyz center and w radius, kept on the CPU in every mode for reference counts.
+	std::vector<glm::vec4> spheres_{};
+	std::vector<glm::mat4> visible_matrices_{};
+	std::size_t visible_count_{};
+
+	// cull_mode::cpu tests the same spheres as structure of arrays.
+	sphere_soa sphere_soa_{};
+	frustum_culler frustum_culler_{};
+	std::vector<std::uint32_t> visible_indices_{};
+	std::vector<std::uint8_t> visible_levels_{};
+
+	lod_selector lod_selector_{};
+	std::size_t mesh_count_{};
+	// instances of each level in get_instance_buffer(), the last frame's in cull_mode::gpu.
+	std::size_t level_first_[MESH_LOD_COUNT]{};
+	std::size_t level_counts_[MESH_LOD_COUNT]{};
+	std::size_t level_totals_[MESH_LOD_COUNT]{};
+	std::size_t level_frames_{};
+
+	// level major: the range and command of mesh m at level l are at l * mesh_count_ + m.
+	std::vector<geometry_range> ranges_{};
+	std::vector<draw_elements_indirect_command> commands_{};
+	std::vector<vertex_layout> layouts_{};
+	std::vector<vertex_decode> decodes_{};
+	// of each mesh, taken when the culler is made, so after model_loader::assign_materials().
+	std::vector<GLuint> materials_{};
+
+	// first of the 4 attribute locations of the instance matrix, see setup_instance_attributes().
+	GLuint instance_location_{};
+	// one per vertex layout the meshes use, owned by that layout's arena.
+	GLuint VAOs_[2]{};
+
+	GLuint instance_buffer_{};
+	GLuint matrix_buffer_{};
+	GLuint sphere_buffer_{};
+	GLuint indirect_buffer_{};
+	GLuint placement_buffer_{};
+
+	std::unique_ptr<shader_program> cull_program_{};
+	uniform_handle<glm::vec4> frustum_planes_[frustum::plane_count]{};
+	uniform_handle<GLuint> instance_count_handle_{};
+	uniform_handle<GLuint> cull_pass_handle_{};
+	uniform_handle<GLuint> mesh_count_handle_{};
+	uniform_handle<GLuint> level_count_handle_{};
+	uniform_handle<glm::vec4> depth_row_handle_{};
+	uniform_handle<float> pixel_scale_handle_{};
+	uniform_handle<float> max_screen_radius_handles_[MESH_LOD_COUNT]{};
+
+	// GL_TIME_ELAPSED of the last dispatches and a copy of the commands they wrote, fenced, only read once available
+	// so neither timing nor the per level counts ever wait for the GPU. query_next_ is the oldest slot, the one the
+	// next dispatch reuses.
+	GLuint time_queries_[CULL_QUERY_RING]{};
+	GLuint readback_buffers_[CULL_QUERY_RING]{};
+	GLsync readback_fences_[CULL_QUERY_RING]{};
+	bool query_pending_[CULL_QUERY_RING]{};
+	std::size_t query_next_{};
+
+	double cull_milliseconds_{};
+	std::size_t cull_frames_{};
+	std::size_t visible_total_{};
+
+public:
+	// cull_program_id is only used by cull_mode::gpu, a program linked from glsl/cull_instances_compute_shader.glsl.
+	// cull_mode::off draws level 0 only, as before levels of detail existed.
+	instance_culler(cull_mode mode, const glm::mat4* matrices, std::size_t count, const bounding_sphere& local_bounds,
+		const std::list<std::shared_ptr<mesh>>& meshes, const lod_selector& lods, GLuint cull_program_id = 0)
+		: mode_{ mode },
+		instance_count_{ count },
+		matrices_(matrices, matrices + count),
+		visible_count_{ count },
+		lod_selector_{ mode == cull_mode::off ? lod_selector{} : lods },
+		mesh_count_{ meshes.size() }
+	{
+		this->level_counts_[0] = count;
+
+		this->spheres_.reserve(count);
+		for (const glm::mat4& matrix : this->matrices_)
+		{
+			bounding_sphere sphere{ local_bounds.transformed(matrix) };
+			this->spheres_.push_back(glm::vec4{ sphere.center_, sphere.radius_ });
+		}
+
+		for (const auto& shared_mesh : meshes)
+		{
+			this->layouts_.push_back(shared_mesh->get_layout());
+			this->decodes_.push_back(shared_mesh->get_decode());
+			this->materials_.push_back(shared_mesh->get_material());
+		}
+
+		for (std::size_t level = 0; level < this->lod_selector_.get_level_count(); ++level)
+		{
+			for (const auto& shared_mesh : meshes)
+			{
+				geometry_range range{ shared_mesh->get_lod_range(level) };
+				this->ranges_.push_back(range);
+
+				draw_elements_indirect_command command{};
+				command.count_ = static_cast<GLuint>(range.index_count_);
+				command.instance_count_ = 0;
+				command.first_index_ = range.first_index_;
+				command.base_vertex_ = range.base_vertex_;
+				command.base_instance_ = 0;
+				this->commands_.push_back(command);
+			}
+		}
+
+		// culled modes rewrite it every frame, off uploads it once.
+		glGenBuffers(1, &this->instance_buffer_);
+		glBindBuffer(GL_ARRAY_BUFFER, this->instance_buffer_);
+		glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), this->mode_ == cull_mode::off ? this->matrices_.data() : nullptr,
+			this->mode_ == cull_mode::cpu ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (this->mode_ == cull_mode::cpu)
+		{
+			this->visible_matrices_.reserve(count);
+			this->visible_indices_.reserve(count);
+			this->visible_levels_.reserve(count);
+			this->sphere_soa_.reserve(count);
+			for (const glm::vec4& sphere : this->spheres_)
+			{
+				this->sphere_soa_.push_back(bounding_sphere{ glm::vec3{ sphere }, sphere.w });
+			}
+		}
+
+		if (this->mode_ == cull_mode::gpu)
+		{
+			this->create_gpu_buffers(cull_program_id);
+		}
+	}
+
+	instance_culler(const instance_culler&) = delete;
+	instance_culler& operator=(const instance_culler&) = delete;
+
+	~instance_culler()
+	{
+		glDeleteBuffers(1, &this->instance_buffer_);
+		glDeleteBuffers(1, &this->matrix_buffer_);
+		glDeleteBuffers(1, &this->sphere_buffer_);
+		glDeleteBuffers(1, &this->indirect_buffer_);
+		glDeleteBuffers(1, &this->placement_buffer_);
+		glDeleteQueries(static_cast<GLsizei>(CULL_QUERY_RING), this->time_queries_);
+		glDeleteBuffers(static_cast<GLsizei>(CULL_QUERY_RING), this->readback_buffers_);
+		for (GLsync fence : this->readback_fences_)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	GLuint get_instance_buffer()const noexcept
+	{
+		return this->instance_buffer_;
+	}
+
+	cull_mode get_mode()const noexcept
+	{
+		return this->mode_;
+	}
+
+	std::size_t get_instance_count()const noexcept
+	{
+		return this->instance_count_;
+	}
+
+	// makes a VAO over the arena of each vertex layout the meshes use, and points 4 attributes from first_location on
+	// at get_instance_buffer(), one column of the matrix each.
+	void setup_instance_attributes(GLuint first_location)
+	{
+		this->instance_location_ = first_location;
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->instance_buffer_);
+		for (vertex_layout layout : this->layouts_)
+		{
+			GLuint& VAO{ this->VAOs_[static_cast<std::size_t>(layout)] };
+			if (VAO != 0)
+			{
+				continue;
+			}
+
+			VAO = mesh::get_arena(layout).create_vertex_array();
+			glBindVertexArray(VAO);
+			for (GLuint column = 0; column < 4; ++column)
+			{
+				glEnableVertexAttribArray(first_location + column);
+				glVertexAttribDivisor(first_location + column, 1);
+			}
+			this->point_instance_attributes(0);
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void cull(const glm::mat4& projection, const glm::mat4& view)
+	{
+		frustum view_frustum{ frustum::from_view_projection(projection * view) };
+		this->lod_selector_.set_camera(projection, view);
+
+		if (this->mode_ == cull_mode::cpu)
+		{
+			this->cull_cpu(view_frustum);
+		}
+		else if (this->mode_ == cull_mode::gpu)
+		{
+			this->cull_gpu(view_frustum);
+		}
+	}
+
+	// draws every mesh with the survivors through the VAOs of setup_instance_attributes(), the program must be in use.
+	// VAOs, materials and vertex decodes go through state, this runs as a render_queue callback.
+	// cull_mode::gpu counts the triangles of the latest dispatch the GPU has finished, its own counts are still on the GPU.
+	void draw(render_state& state)
+	{
+		std::size_t level_count{ this->lod_selector_.get_level_count() };
+		if (this->mode_ == cull_mode::gpu)
+		{
+			// the vertex decode and index type are per mesh, so each mesh draws its levels on its own: a stride of one level.
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+			for (std::size_t mesh_index = 0; mesh_index < this->mesh_count_; ++mesh_index)
+			{
+				state.bind_VAO(this->VAOs_[static_cast<std::size_t>(this->layouts_[mesh_index])]);
+				state.apply_decode(this->decodes_[mesh_index]);
+				state.set_material(this->materials_[mesh_index]);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, this->ranges_[mesh_index].index_type_,
+					reinterpret_cast<void*>(mesh_index * sizeof(draw_elements_indirect_command)),
+					static_cast<GLsizei>(level_count), static_cast<GLsizei>(this->mesh_count_ * sizeof(draw_elements_indirect_command)));
+				++render_stats::current().draw_calls_;
+			}
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			render_stats::current().triangles_ += this->count_triangles();
+			return;
+		}
+
+		// without base instance(OpenGL 3.3), each level moves the instanced attributes to its first matrix.
+		glBindBuffer(GL_ARRAY_BUFFER, this->instance_buffer_);
+		for (std::size_t mesh_index = 0; mesh_index < this->mesh_count_; ++mesh_index)
+		{
+			state.bind_VAO(this->VAOs_[static_cast<std::size_t>(this->layouts_[mesh_index])]);
+			state.apply_decode(this->decodes_[mesh_index]);
+			state.set_material(this->materials_[mesh_index]);
+			for (std::size_t level = 0; level < level_count; ++level)
+			{
+				if (this->level_counts_[level] == 0)
+				{
+					continue;
+				}
+
+				const geometry_range& range{ this->ranges_[level * this->mesh_count_ + mesh_index] };
+				this->point_instance_attributes(this->level_first_[level]);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.index_count_, range.index_type_, range.get_index_offset(),
+					static_cast<GLsizei>(this->level_counts_[level]), range.base_vertex_);
+				++render_stats::current().draw_calls_;
+			}
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		render_stats::current().triangles_ += this->count_triangles();
+	}
+
+	// the scalar reference: how many instances the frustum keeps, without touching any buffer.
+	std::size_t count_visible(const glm::mat4& view_projection)const
+	{
+		frustum view_frustum{ frustum::from_view_projection(view_projection) };
+
+		std::size_t visible{ 0 };
+		for (const glm::vec4& sphere : this->spheres_)
+		{
+			visible += view_frustum.intersects(glm::vec3{ sphere }, sphere.w);
+		}
+
+		return visible;
+	}
+
+	// survivors of the last cull(), read back from the GPU in cull_mode::gpu, so it stalls there: for summaries only.
+	std::size_t read_visible_count()const
+	{
+		if (this->mode_ != cull_mode::gpu)
+		{
+			return this->visible_count_;
+		}
+
+		std::vector<draw_elements_indirect_command> commands{ this->read_commands() };
+		std::size_t instance_count{ 0 };
+		for (std::size_t level = 0; level < this->lod_selector_.get_level_count(); ++level)
+		{
+			instance_count += commands[level * this->mesh_count_].instance_count_;
+		}
+
+		return instance_count;
+	}
+
+	// mean cull time, wall clock for the CPU and GPU time of the dispatch for the GPU.
+	double get_cull_milliseconds()const noexcept
+	{
+		return this->cull_frames_ == 0 ? 0.0 : this->cull_milliseconds_ / this->cull_frames_;
+	}
+
+	void print(std::ostream& out)const
+	{
+		static const char* const mode_names[]{ "off", "cpu", "gpu" };
+
+		out << "culling(" << mode_names[static_cast<std::size_t>(this->mode_)];
+		if (this->mode_ == cull_mode::cpu)
+		{
+			out << ", " << simd_support::level_name(this->frustum_culler_.get_level());
+		}
+		out << "): ";
+		if (this->mode_ == cull_mode::cpu && this->cull_frames_ != 0)
+		{
+			out << static_cast<double>(this->visible_total_) / this->cull_frames_;
+		}
+		else
+		{
+			out << this->read_visible_count();
+		}
+
+		out << " / " << this->instance_count_ << " visible, " << this->get_cull_milliseconds() << " ms/frame culling";
+
+		if (this->level_frames_ != 0)
+		{
+			out << ", instances per level";
+			for (std::size_t level = 0; level < this->lod_selector_.get_level_count(); ++level)
+			{
+				out << (level == 0 ? " " : " / ") << static_cast<double>(this->level_totals_[level]) / this->level_frames_;
+			}
+		}
+	}
+
+private:
+	void cull_cpu(const frustum& view_frustum)
+	{
+		auto cull_begin{ std::chrono::steady_clock::now() };
+
+		this->frustum_culler_.cull(view_frustum, this->sphere_soa_, this->visible_indices_);
+
+		// bucket the survivors by level, then place each bucket after the one before.
+		std::size_t level_count{ this->lod_selector_.get_level_count() };
+		std::fill(std::begin(this->level_counts_), std::end(this->level_counts_), 0);
+		this->visible_levels_.clear();
+		for (std::uint32_t index : this->visible_indices_)
+		{
+			const glm::vec4& sphere{ this->spheres_[index] };
+			std::size_t level{ this->lod_selector_.select(glm::vec3{ sphere }, sphere.w) };
+			this->visible_levels_.push_back(static_cast<std::uint8_t>(level));
+			++this->level_counts_[level];
+		}
+
+		std::size_t slots[MESH_LOD_COUNT]{};
+		for (std::size_t level = 1; level < level_count; ++level)
+		{
+			this->level_first_[level] = this->level_first_[level - 1] + this->level_counts_[level - 1];
+			slots[level] = this->level_first_[level];
+		}
+
+		this->visible_count_ = this->visible_indices_.size();
+		this->visible_matrices_.resize(this->visible_count_);
+		for (std::size_t visible = 0; visible < this->visible_count_; ++visible)
+		{
+			this->visible_matrices_[slots[this->visible_levels_[visible]]++] = this->matrices_[this->visible_indices_[visible]];
+		}
+
+		for (std::size_t level = 0; level < level_count; ++level)
+		{
+			this->level_totals_[level] += this->level_counts_[level];
+		}
+		++this->level_frames_;
+
+		// orphan the old storage, the previous frame may still be reading it.
+		glBindBuffer(GL_ARRAY_BUFFER, this->instance_buffer_);
+		glBufferData(GL_ARRAY_BUFFER, this->instance_count_ * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, this->visible_count_ * sizeof(glm::mat4), this->visible_matrices_.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		this->cull_milliseconds_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cull_begin).count();
+		this->visible_total_ += this->visible_count_;
+		++this->cull_frames_;
+	}
+
+	void cull_gpu(const frustum& view_frustum)
+	{
+		if (!this->cull_program_)
+		{
+			return;
+		}
+
+		this->collect_finished_dispatches();
+
+		// the oldest dispatch still running means the GPU is CULL_QUERY_RING frames behind, this one goes untimed.
+		std::size_t slot{ this->query_next_ };
+		bool timed{ !this->query_pending_[slot] };
+		if (timed)
+		{
+			glBeginQuery(GL_TIME_ELAPSED, this->time_queries_[slot]);
+		}
+
+		// the first pass only ever adds to the instance count of each level's first command.
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, this->commands_.size() * sizeof(draw_elements_indirect_command), this->commands_.data());
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		this->cull_program_->use();
+		for (std::size_t plane = 0; plane < frustum::plane_count; ++plane)
+		{
+			this->cull_program_->set(this->frustum_planes_[plane], view_frustum.planes_[plane]);
+		}
+		this->cull_program_->set(this->instance_count_handle_, static_cast<GLuint>(this->instance_count_));
+		this->cull_program_->set(this->mesh_count_handle_, static_cast<GLuint>(this->mesh_count_));
+		this->cull_program_->set(this->level_count_handle_, static_cast<GLuint>(this->lod_selector_.get_level_count()));
+		this->cull_program_->set(this->depth_row_handle_, this->lod_selector_.get_depth_row());
+		this->cull_program_->set(this->pixel_scale_handle_, this->lod_selector_.get_pixel_scale());
+		for (std::size_t level = 0; level < MESH_LOD_COUNT; ++level)
+		{
+			this->cull_program_->set(this->max_screen_radius_handles_[level], this->lod_selector_.get_max_screen_radius(level));
+		}
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_MATRICES_BINDING, this->matrix_buffer_);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_SPHERES_BINDING, this->sphere_buffer_);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_VISIBLE_BINDING, this->instance_buffer_);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COMMANDS_BINDING, this->indirect_buffer_);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_PLACEMENTS_BINDING, this->placement_buffer_);
+
+		// pass 0 counts the survivors of each level and gives each one a slot, pass 1 needs every count to place the levels
+		// one after the other, and fills in the other meshes' commands.
+		GLuint group_count{ static_cast<GLuint>((this->instance_count_ + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE) };
+		this->cull_program_->set(this->cull_pass_handle_, 0u);
+		glDispatchCompute(group_count, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		this->cull_program_->set(this->cull_pass_handle_, 1u);
+		glDispatchCompute(group_count, 1, 1);
+
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		if (timed)
+		{
+			glEndQuery(GL_TIME_ELAPSED);
+
+			// outside the timed region, the counts are read from this copy once its fence has passed.
+			glBindBuffer(GL_COPY_READ_BUFFER, this->indirect_buffer_);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, this->readback_buffers_[slot]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->commands_.size() * sizeof(draw_elements_indirect_command));
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			this->readback_fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+			this->query_pending_[slot] = true;
+			this->query_next_ = (slot + 1) % CULL_QUERY_RING;
+		}
+	}
+
+	// reads the timings and level counts of the dispatches the GPU has finished, oldest first, without waiting for the others.
+	void collect_finished_dispatches()
+	{
+		for (std::size_t age = 0; age < CULL_QUERY_RING; ++age)
+		{
+			std::size_t slot{ (this->query_next_ + age) % CULL_QUERY_RING };
+			if (!this->query_pending_[slot])
+			{
+				continue;
+			}
+
+			GLint available{};
+			glGetQueryObjectiv(this->time_queries_[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available == GL_FALSE)
+			{
+				continue;
+			}
+
+			GLenum copied{ glClientWaitSync(this->readback_fences_[slot], 0, 0) };
+			if (copied != GL_ALREADY_SIGNALED && copied != GL_CONDITION_SATISFIED)
+			{
+				continue;
+			}
+
+			glDeleteSync(this->readback_fences_[slot]);
+			this->readback_fences_[slot] = nullptr;
+
+			GLuint64 nanoseconds{};
+			glGetQueryObjectui64v(this->time_queries_[slot], GL_QUERY_RESULT, &nanoseconds);
+			this->cull_milliseconds_ += nanoseconds / 1000000.0;
+			++this->cull_frames_;
+			this->query_pending_[slot] = false;
+
+			std::vector<draw_elements_indirect_command> commands(this->commands_.size());
+			glBindBuffer(GL_COPY_READ_BUFFER, this->readback_buffers_[slot]);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, commands.size() * sizeof(draw_elements_indirect_command), commands.data());
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			for (std::size_t level = 0; level < this->lod_selector_.get_level_count(); ++level)
+			{
+				this->level_counts_[level] = commands[level * this->mesh_count_].instance_count_;
+				this->level_totals_[level] += this->level_counts_[level];
+			}
+			++this->level_frames_;
+		}
+	}
+
+	void create_gpu_buffers(GLuint cull_program_id)
+	{
+		if (cull_program_id == 0)
+		{
+			std::cout << "INSTANCE_CULLER:: no cull program, every instance is drawn." << std::endl;
+			this->mode_ = cull_mode::off;
+			glBindBuffer(GL_ARRAY_BUFFER, this->instance_buffer_);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, this->instance_count_ * sizeof(glm::mat4), this->matrices_.data());
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			return;
+		}
+
+		this->cull_program_ = std::make_unique<shader_program>(cull_program_id);
+		// nothing is known to be drawn until the first dispatch has been read back.
+		this->level_counts_[0] = 0;
+		for (std::size_t plane = 0; plane < frustum::plane_count; ++plane)
+		{
+			std::basic_string<char> name{ "frustum_planes[" + std::to_string(plane) + "]" };
+			this->frustum_planes_[plane] = this->cull_program_->get_uniform<glm::vec4>(name.c_str());
+		}
+		this->instance_count_handle_ = this->cull_program_->get_uniform<GLuint>("instance_count");
+		this->cull_pass_handle_ = this->cull_program_->get_uniform<GLuint>("cull_pass");
+		this->mesh_count_handle_ = this->cull_program_->get_uniform<GLuint>("mesh_count");
+		this->level_count_handle_ = this->cull_program_->get_uniform<GLuint>("level_count");
+		this->depth_row_handle_ = this->cull_program_->get_uniform<glm::vec4>("depth_row");
+		this->pixel_scale_handle_ = this->cull_program_->get_uniform<float>("pixel_scale");
+		for (std::size_t level = 0; level < MESH_LOD_COUNT; ++level)
+		{
+			std::basic_string<char> name{ "max_screen_radius[" + std::to_string(level) + "]" };
+			this->max_screen_radius_handles_[level] = this->cull_program_->get_uniform<float>(name.c_str());
+		}
+
+		glGenBuffers(1, &this->matrix_buffer_);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->matrix_buffer_);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, this->matrices_.size() * sizeof(glm::mat4), this->matrices_.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &this->sphere_buffer_);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->sphere_buffer_);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, this->spheres_.size() * sizeof(glm::vec4), this->spheres_.data(), GL_STATIC_DRAW);
+
+		// level and slot of every instance, written by pass 0 for pass 1.
+		glGenBuffers(1, &this->placement_buffer_);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->placement_buffer_);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, this->instance_count_ * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glGenBuffers(1, &this->indirect_buffer_);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, this->commands_.size() * sizeof(draw_elements_indirect_command), this->commands_.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		glGenQueries(static_cast<GLsizei>(CULL_QUERY_RING), this->time_queries_);
+		glGenBuffers(static_cast<GLsizei>(CULL_QUERY_RING), this->readback_buffers_);
+		for (GLuint readback_buffer : this->readback_buffers_)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, readback_buffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, this->commands_.size() * sizeof(draw_elements_indirect_command), nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		// the GPU has its own copy now.
+		std::vector<glm::mat4>{}.swap(this->matrices_);
+	}
+
+	void point_instance_attributes(std::size_t first_instance)
+	{
+		std::size_t offset{ first_instance * sizeof(glm::mat4) };
+		for (GLuint column = 0; column < 4; ++column)
+		{
+			glVertexAttribPointer(this->instance_location_ + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+				reinterpret_cast<void*>(offset + column * sizeof(glm::vec4)));
+		}
+	}
+
+	std::vector<draw_elements_indirect_command> read_commands()const
+	{
+		std::vector<draw_elements_indirect_command> commands(this->commands_.size());
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+		glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(draw_elements_indirect_command), commands.data());
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		return commands;
+	}
+
+	std::size_t count_triangles()const
+	{
+		std::size_t triangles{ 0 };
+		for (std::size_t level = 0; level < this->lod_selector_.get_level_count(); ++level)
+		{
+			for (std::size_t mesh_index = 0; mesh_index < this->mesh_count_; ++mesh_index)
+			{
+				triangles += this->level_counts_[level] * (this->ranges_[level * this->mesh_count_ + mesh_index].index_count_ / 3);
+			}
+		}
+
+		return triangles;
+	}
+};
+
+
+#endif // !__INSTANCE_CULLER_HPP__
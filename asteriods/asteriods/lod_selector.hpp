@@ -0,0 +1,109 @@
+#ifndef __LOD_SELECTOR_HPP__
+#define __LOD_SELECTOR_HPP__
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+
+
+// picks a level of detail from how large an object is on screen. a level is good enough while its error,
+// scaled like the object and projected, stays below max_pixel_error pixels: with the model's errors known up front
+// that is a largest projected radius per level, so picking is a few compares per object.
+class lod_selector final
+{
+private:
+	// in pixels, the largest projected radius each level may be drawn at. never grows with the level.
+	float max_screen_radius_[MESH_LOD_COUNT]{};
+	std::size_t level_count_{ 1 };
+	float viewport_height_{ 1.0f };
+
+	// row w of projection * view, its dot product with a point is the point's depth in front of the camera.
+	glm::vec4 depth_row_{ 0.0f, 0.0f, 0.0f, 1.0f };
+	// pixels per unit of radius at depth 1.
+	float pixel_scale_{ 1.0f };
+
+public:
+	// always level 0.
+	lod_selector()
+	{
+		std::fill(std::begin(this->max_screen_radius_), std::end(this->max_screen_radius_), std::numeric_limits<float>::max());
+	}
+
+	// errors of every level in model units(see model_loader::get_lod_errors()), model_radius is the model's bounding radius.
+	// a max_pixel_error of 0 keeps everything at level 0.
+	lod_selector(const std::vector<float>& errors, float model_radius, float viewport_height, float max_pixel_error = 1.0f)
+		: lod_selector()
+	{
+		this->viewport_height_ = viewport_height;
+		if (max_pixel_error <= 0.0f || model_radius <= 0.0f)
+		{
+			return;
+		}
+
+		this->level_count_ = std::min(errors.size(), MESH_LOD_COUNT);
+		for (std::size_t level = 1; level < this->level_count_; ++level)
+		{
+			float limit{ errors[level] > 0.0f ? max_pixel_error * model_radius / errors[level] : std::numeric_limits<float>::max() };
+			this->max_screen_radius_[level] = std::min(limit, this->max_screen_radius_[level - 1]);
+		}
+	}
+
+	std::size_t get_level_count()const noexcept
+	{
+		return this->level_count_;
+	}
+
+	float get_max_screen_radius(std::size_t level)const noexcept
+	{
+		return this->max_screen_radius_[level];
+	}
+
+	const glm::vec4& get_depth_row()const noexcept
+	{
+		return this->depth_row_;
+	}
+
+	float get_pixel_scale()const noexcept
+	{
+		return this->pixel_scale_;
+	}
+
+	// once per frame, before select().
+	void set_camera(const glm::mat4& projection, const glm::mat4& view)
+	{
+		glm::mat4 view_projection{ projection * view };
+		this->depth_row_ = glm::vec4{ view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3] };
+		this->pixel_scale_ = projection[1][1] * this->viewport_height_ * 0.5f;
+	}
+
+	// projected radius in pixels of a world space sphere, unbounded once the camera is inside it.
+	float screen_radius(const glm::vec3& center, float radius)const
+	{
+		float depth{ glm::dot(glm::vec3{ this->depth_row_ }, center) + this->depth_row_.w };
+		return depth > radius ? radius * this->pixel_scale_ / depth : std::numeric_limits<float>::max();
+	}
+
+	std::size_t select(float screen_radius)const
+	{
+		std::size_t level{ this->level_count_ - 1 };
+		while (level > 0 && screen_radius > this->max_screen_radius_[level])
+		{
+			--level;
+		}
+
+		return level;
+	}
+
+	std::size_t select(const glm::vec3& center, float radius)const
+	{
+		return this->select(this->screen_radius(center, radius));
+	}
+};
+
+
+#endif // !__LOD_SELECTOR_HPP__
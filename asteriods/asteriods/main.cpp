@@ -16,17 +16,34 @@
 
 #include <atomic>
 #include <random>
+#include <chrono>
 #include <iostream>
 
 
 #include "shader.hpp"
+#include "shader_program.hpp"
+#include "program_cache.hpp"
+#include "shader_variants.hpp"
+#include "uniform_blocks.hpp"
+#include "virtual_file_system.hpp"
+#include "texture_cooker.hpp"
 #include "model.hpp"
+#include "material_library.hpp"
+#include "render_queue.hpp"
+#include "instance_culler.hpp"
+#include "lod_selector.hpp"
+#include "cull_benchmark.hpp"
+#include "mip_benchmark.hpp"
+#include "scene_bvh.hpp"
 
 
 
 static constexpr const int WIDTH{ 800 };
 static constexpr const int HEIGHT{ 600 };
 
+// decoded texture bytes uploaded per frame, keeps frame time flat while models stream in.
+static constexpr const std::size_t TEXTURE_UPLOAD_BUDGET{ 4 * 1024 * 1024 };
+
 // lighting.
 static const glm::vec3 light_pos{ 1.2f, 1.0f, 2.0f };
 
@@ -49,6 +66,27 @@ static float yaw{ -90.f };
 static float speed{ 2.5f };
 static float sensitivity{ 0.05f };
 
+// left click picks what is under the crosshair, N finds the object nearest to the camera.
+static bool pick_requested{ false };
+static bool nearest_requested{ false };
+
+// load a model and report how long it took, so cold(Assimp) and warm(mesh cache) starts can be compared.
+static std::unique_ptr<model_loader> load_model_timed(const std::basic_string<char>& model_file, vertex_layout layout)
+{
+	std::unique_ptr<model_loader> loader{ std::make_unique<model_loader>() };
+
+	auto load_begin{ std::chrono::steady_clock::now() };
+	loader->load_model(model_file);
+	loader->load_vertices_data(layout);
+	auto load_end{ std::chrono::steady_clock::now() };
+
+	std::cout << model_file.substr(model_file.find_last_of('\\') + 1) << " loaded in "
+		<< std::chrono::duration<double, std::milli>(load_end - load_begin).count() << " ms"
+		<< (loader->is_loaded_from_cache() ? " (mesh cache)" : " (assimp)") << std::endl;
+
+	return loader;
+}
+
 static void update_camera_vectors()
 {
 	// Calculate the new Front vector
@@ -136,6 +174,28 @@ static void mouse_callback(GLFWwindow *window, double xpos, double ypos)
 }
 
 
+// glfw: whenever a mouse button is pressed, this callback is called
+// -----------------------------------------------------------------
+static void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
+{
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+	{
+		pick_requested = true;
+	}
+}
+
+
+// glfw: whenever a key is pressed, this callback is called
+// ---------------------------------------------------------
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_N && action == GLFW_PRESS)
+	{
+		nearest_requested = true;
+	}
+}
+
+
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 static void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
@@ -156,14 +216,153 @@ static void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 	}
 }
 
-int main()
+// times one frustum query, ray pick and nearest lookup through the scene hierarchy, against a loop over every instance box.
+static void print_scene_queries(const scene_bvh& scene, const frustum& view_frustum, const ray& pick_ray, const glm::vec3& point)
 {
+	const bounding_volume_hierarchy& bvh{ scene.get_bvh() };
+
+	auto frustum_begin{ std::chrono::steady_clock::now() };
+	std::vector<std::uint32_t> visible{};
+	scene.query_frustum(view_frustum, visible);
+	auto frustum_end{ std::chrono::steady_clock::now() };
+
+	std::size_t linear_visible{ 0 };
+	for (std::uint32_t index = 0; index < bvh.get_item_count(); ++index)
+	{
+		linear_visible += view_frustum.classify(bvh.get_item_box(index)) != frustum::outside;
+	}
+	auto linear_end{ std::chrono::steady_clock::now() };
+
+	scene_hit hit{ scene.pick(pick_ray) };
+	auto pick_end{ std::chrono::steady_clock::now() };
+
+	bvh_hit nearest{ scene.nearest(point) };
+	auto nearest_end{ std::chrono::steady_clock::now() };
+
+	auto microseconds = [](std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::micro>(end - begin).count();
+	};
+
+	std::cout << "scene bvh: " << bvh.get_item_count() << " instances, " << bvh.get_node_count() << " nodes" << std::endl
+		<< "    frustum " << visible.size() << " visible in " << microseconds(frustum_begin, frustum_end) << " us (linear "
+		<< linear_visible << " in " << microseconds(frustum_end, linear_end) << " us)" << std::endl
+		<< "    pick " << (hit.is_hit() ? "instance " + std::to_string(hit.instance_) : std::basic_string<char>{ "nothing" })
+		<< " in " << microseconds(linear_end, pick_end) << " us" << std::endl
+		<< "    nearest instance " << nearest.item_ << " in " << microseconds(pick_end, nearest_end) << " us" << std::endl;
+}
+
+// command line:
+//   --indirect   draw the planet with one glMultiDrawElementsIndirect(needs OpenGL 4.3).
+//   --frames N   render N frames in a hidden window, then print the average frame time and draw calls and exit.
+//   --rocks N    number of asteroids, 1000 by default.
+//   --cull M     off, cpu(default) or gpu: frustum cull the asteroids, gpu runs a compute shader(needs OpenGL 4.3).
+//   --cull-benchmark  time the SIMD frustum culler against scalar glm at 10k/100k/1M objects, no window is opened.
+//   --mip-benchmark  time the SIMD mipmap generator against its scalar path in MPixels/s, no window is opened.
+//   --lod-error P  largest error in pixels a coarser level of detail may show, 1 by default. 0 draws full detail only.
+//   --vertex-format F  packed(default, 20 byte quantized vertices) or full(56 byte float vertices).
+//   --pack FILE  mount an asset pack instead of asteriods.pak next to the sources, loose files still fill the gaps.
+//   --write-pack FILE  after loading, bundle every loose file the demo opened(shaders, textures, mesh caches) into FILE.
+//   --cook-textures FILE...  write a block compressed .dds with mipmaps next to every image, no window is opened.
+//                            the loader prefers them over the images. must come last.
+//   --bc7        cook color textures as BC7 instead of BC1/BC3.
+//   --materials M  array(default): every diffuse texture in one texture array bound once per frame, meshes pass an index.
+//                  bind: every mesh binds its own textures. --indirect always draws the planet out of the array.
+int main(int argc, char* argv[])
+{
+	bool indirect_mode{ false };
+	std::size_t benchmark_frames{ 0 };
+	std::size_t amount{ 1000 };
+	cull_mode rock_cull_mode{ cull_mode::cpu };
+	float lod_pixel_error{ 1.0f };
+	vertex_layout model_layout{ vertex_layout::packed };
+	std::basic_string<char> pack_file{ "C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\asteriods.pak" };
+	std::basic_string<char> write_pack_file{};
+	std::vector<std::basic_string<char>> cook_files{};
+	bool cook_bc7{ false };
+	bool material_array{ true };
+	for (int index = 1; index < argc; ++index)
+	{
+		std::basic_string<char> argument{ argv[index] };
+		if (argument == "--indirect")
+		{
+			indirect_mode = true;
+		}
+		else if (argument == "--frames" && index + 1 < argc)
+		{
+			benchmark_frames = std::stoul(argv[++index]);
+		}
+		else if (argument == "--cull-benchmark")
+		{
+			run_cull_benchmark(std::cout);
+			return 0;
+		}
+		else if (argument == "--mip-benchmark")
+		{
+			run_mip_benchmark(std::cout);
+			return 0;
+		}
+		else if (argument == "--rocks" && index + 1 < argc)
+		{
+			amount = std::stoul(argv[++index]);
+		}
+		else if (argument == "--cull" && index + 1 < argc)
+		{
+			std::basic_string<char> mode{ argv[++index] };
+			rock_cull_mode = mode == "off" ? cull_mode::off : (mode == "gpu" ? cull_mode::gpu : cull_mode::cpu);
+		}
+		else if (argument == "--lod-error" && index + 1 < argc)
+		{
+			lod_pixel_error = std::stof(argv[++index]);
+		}
+		else if (argument == "--vertex-format" && index + 1 < argc)
+		{
+			model_layout = std::basic_string<char>{ argv[++index] } == "full" ? vertex_layout::full : vertex_layout::packed;
+		}
+		else if (argument == "--pack" && index + 1 < argc)
+		{
+			pack_file = argv[++index];
+		}
+		else if (argument == "--write-pack" && index + 1 < argc)
+		{
+			write_pack_file = argv[++index];
+		}
+		else if (argument == "--bc7")
+		{
+			cook_bc7 = true;
+		}
+		else if (argument == "--materials" && index + 1 < argc)
+		{
+			material_array = std::basic_string<char>{ argv[++index] } != "bind";
+		}
+		else if (argument == "--cook-textures")
+		{
+			cook_files.assign(argv + index + 1, argv + argc);
+			break;
+		}
+	}
+
+	if (!cook_files.empty())
+	{
+		texture_cooker cooker{};
+		cooker.set_prefer_bc7(cook_bc7);
+
+		bool cooked{ true };
+		for (const auto& file : cook_files)
+		{
+			cooked = cooker.cook(file) && cooked;
+		}
+		return cooked ? 0 : 1;
+	}
+
 	// glfw: initialize and configure
 // ------------------------------
 	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	bool needs_gl43{ indirect_mode || rock_cull_mode == cull_mode::gpu };
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, needs_gl43 ? 4 : 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, benchmark_frames == 0 ? GLFW_TRUE : GLFW_FALSE);
 
 	// glfw window creation
 	// --------------------
@@ -181,9 +380,14 @@ int main()
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetMouseButtonCallback(window, mouse_button_callback);
+	glfwSetKeyCallback(window, key_callback);
 
 	// tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (benchmark_frames == 0)
+	{
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	// glad: load all OpenGL function pointers
 	// ---------------------------------------
@@ -196,37 +400,135 @@ int main()
 	// configure global opengl state
 	glEnable(GL_DEPTH_TEST);
 
-	GLuint asteriods_vertex_shader_id{ shader::create("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\vertex_shader.glsl", shader_type::vertex_shader) };
-	GLuint asteriods_fragment_shader_id{ shader::create("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\fragment_shader.glsl", shader_type::fragment_shader) };
+	// shaders, textures and mesh caches come from the pack when there is one, one mapping instead of a file each.
+	virtual_file_system::shared().set_root("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods");
+	virtual_file_system::shared().mount(pack_file);
+
+	// programs come from the binary cache when a previous run already linked them with this driver.
+	program_cache::shared().set_directory("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\");
+
+	// every program is compiled up front in one batch, so the driver can work on them in parallel.
+	std::unique_ptr<shader_variants> programs{ std::make_unique<shader_variants>() };
+	programs->enable_parallel_compile(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
+	// the texture array replaces the per mesh sampler2D.
+	shader_defines material_defines{};
+	if (material_array)
+	{
+		material_defines.define("MATERIAL_ARRAY");
+	}
+
+	std::size_t asteriods_variant{ programs->add("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\asteroid_vertex_shader.glsl", "C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\asteroid_fragment_shader.glsl", material_defines) };
+	std::size_t planet_variant{ programs->add("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\planet_vertex_shader.glsl", "C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\planet_fragment_shader.glsl", material_defines) };
+	std::size_t indirect_variant{ 0 };
+	if (indirect_mode)
+	{
+		indirect_variant = programs->add("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\model_indirect_vertex_shader.glsl", "C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\model_indirect_fragment_shader.glsl");
+	}
+
+	std::size_t cull_variant{ 0 };
+	if (rock_cull_mode == cull_mode::gpu)
+	{
+		cull_variant = programs->add_compute("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\cull_instances_compute_shader.glsl");
+	}
+
+	programs->compile_all();
+	programs->print(std::cout);
+	std::cout << std::endl;
+
+	GLuint asteriods_gl_program_id{ programs->get_program(asteriods_variant) };
+	GLuint planet_gl_program_id{ programs->get_program(planet_variant) };
+	GLuint indirect_gl_program_id{ indirect_mode ? programs->get_program(indirect_variant) : 0 };
+	GLuint cull_gl_program_id{ rock_cull_mode == cull_mode::gpu ? programs->get_program(cull_variant) : 0 };
+
+	program_cache::shared().print(std::cout);
+	std::cout << std::endl;
+
+	// projection and view are written once per frame into one buffer every program reads.
+	std::unique_ptr<uniform_buffer<camera_block>> camera_buffer{ std::make_unique<uniform_buffer<camera_block>>(CAMERA_BLOCK_BINDING) };
+	camera_buffer->bind_to(asteriods_gl_program_id, "camera_block");
+	camera_buffer->bind_to(planet_gl_program_id, "camera_block");
 
-	GLuint asteriods_gl_program_id{ glCreateProgram() };
-	glAttachShader(asteriods_gl_program_id, asteriods_vertex_shader_id);
-	glAttachShader(asteriods_gl_program_id, asteriods_fragment_shader_id);
-	glLinkProgram(asteriods_gl_program_id);
-	shader::checkout_shader_state(asteriods_gl_program_id, shader_type::program);
+	// uniforms are resolved once here, the frame loop only goes through handles.
+	shader_program asteriods_program{ asteriods_gl_program_id };
+	uniform_handle<int> asteriods_diffuse_texture{ asteriods_program.get_uniform<int>("texture_diffuse_1") };
 
+	shader_program planet_program{ planet_gl_program_id };
+	uniform_handle<glm::mat4> planet_model{ planet_program.get_uniform<glm::mat4>("model") };
 
-	GLuint planet_vertex_shader_id{ shader::create("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\vertex_shader.glsl", shader_type::vertex_shader) };
-	GLuint planet_fragment_shader_id{ shader::create("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\glsl\\fragment_shader.glsl", shader_type::fragment_shader) };
-	GLuint planet_gl_program_id{ glCreateProgram() };
-	glAttachShader(planet_fragment_shader_id, planet_vertex_shader_id);
-	glAttachShader(planet_fragment_shader_id, planet_fragment_shader_id);
+	std::unique_ptr<shader_program> indirect_program{};
+	uniform_handle<glm::mat4> indirect_model{};
+	if (indirect_mode)
+	{
+		camera_buffer->bind_to(indirect_gl_program_id, "camera_block");
+		indirect_program = std::make_unique<shader_program>(indirect_gl_program_id);
+		indirect_model = indirect_program->get_uniform<glm::mat4>("model");
+	}
 
 
 
-	std::unique_ptr<model_loader> loaded_planet{ std::make_unique<model_loader>() };
-	loaded_planet->load_model("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\model_file\\planet\\planet.obj");
-	loaded_planet->load_vertices_data();
+	std::unique_ptr<model_loader> loaded_planet{ load_model_timed("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\model_file\\planet\\planet.obj", model_layout) };
+	std::unique_ptr<model_loader> loaded_rock{ load_model_timed("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\model_file\\planet\\rock.obj", model_layout) };
 
-	std::unique_ptr<model_loader> loaded_rock{ std::make_unique<model_loader>() };
-	loaded_rock->load_model("C:\\Users\\y\\Documents\\Visual Studio 2017\\Projects\\opengl_demo\\asteriods\\asteriods\\model_file\\planet\\rock.obj");
-	loaded_rock->load_vertices_data();
+	// every diffuse texture of both models in one texture array. it copies them, so this waits for the streamed textures.
+	std::unique_ptr<material_library> materials{ std::make_unique<material_library>() };
+	loaded_planet->assign_materials(*materials);
+	loaded_rock->assign_materials(*materials);
+	bool material_library_used{ material_array || indirect_mode };
+	if (material_library_used)
+	{
+		texture_loader::shared().finish();
+		materials->build();
+		// with the array every draw samples the copies, the diffuse textures would only double the texture memory.
+		if (material_array)
+		{
+			for (GLuint material = 1; material < materials->get_material_count(); ++material)
+			{
+				texture_registry::shared().trim(materials->get_texture(material));
+			}
+		}
+		materials->print(std::cout);
+		std::cout << std::endl;
+	}
+
+	if (material_array)
+	{
+		materials->bind_to(asteriods_program);
+		materials->bind_to(planet_program);
+	}
+
+	if (indirect_mode)
+	{
+		materials->bind_to(*indirect_program);
+		loaded_planet->build_indirect_draw();
+	}
+
+	// without the array every material binds its own texture, on the unit the samplers read.
+	if (!material_array)
+	{
+		asteriods_program.use();
+		asteriods_program.set(asteriods_diffuse_texture, MATERIAL_TEXTURE_UNIT);
+	}
+
+	render_queue queue{};
+	render_state state{};
+	state.set_material_library(materials.get(), material_array);
+
+	if (!write_pack_file.empty())
+	{
+		// the textures are opened by the decoding workers, wait for them.
+		texture_loader::shared().finish();
+		virtual_file_system::shared().write_pack(write_pack_file);
+	}
+
+	std::cout << "VFS:: ";
+	virtual_file_system::shared().print(std::cout);
+	std::cout << std::endl;
 
 
 
 	// generate a large list of semi-random model transformation matrices
 	// ------------------------------------------------------------------
-	std::size_t amount{ 1000 };
 	std::unique_ptr<glm::mat4[]> model_matrices{ new glm::mat4[amount]{} };
 
 	std::random_device random_device{};
@@ -261,39 +563,38 @@ int main()
 	}
 
 
-	// configure instanced array
-	GLuint instanced_VBO{};
-	glGenBuffers(1, &instanced_VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, instanced_VBO);
-	glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), model_matrices.get(), GL_STATIC_DRAW);
+	glm::mat4 planet_transform{ 1.0f };
+	planet_transform = glm::translate(planet_transform, glm::vec3(0.0f, -3.0f, 0.0f));
+	planet_transform = glm::scale(planet_transform, glm::vec3(4.0f, 4.0f, 4.0f));
 
-	const auto& meshes_in_rock{ loaded_rock->get_meshes() };
-	auto rock_meshed_itr{ meshes_in_rock.cbegin() };
-	for (; rock_meshed_itr != meshes_in_rock.cend(); ++rock_meshed_itr)
+	// picking and nearest lookups go through a hierarchy over every rock and the planet.
+	scene_bvh scene{};
+	for (std::size_t index = 0; index < amount; ++index)
 	{
-		std::size_t mesh_VAO{ (*rock_meshed_itr)->get_VAO() };
-		glBindVertexArray(mesh_VAO);
-
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(0));
-
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(sizeof(glm::mat4)));
-
-		glEnableVertexAttribArray(5);
-		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(2 * sizeof(glm::mat4)));
-
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(3 * sizeof(glm::mat4)));
-
+		scene.add(*loaded_rock, model_matrices[index]);
+	}
+	std::uint32_t planet_instance{ scene.add(*loaded_planet, planet_transform) };
+	scene.refit();
 
+	// levels of detail by size on screen, the planet as a whole and each rock on its own.
+	lod_selector planet_lods{ loaded_planet->get_lod_errors(), loaded_planet->get_bounds().radius_, static_cast<float>(HEIGHT), lod_pixel_error };
+	lod_selector rock_lods{ loaded_rock->get_lod_errors(), loaded_rock->get_bounds().radius_, static_cast<float>(HEIGHT), lod_pixel_error };
+	bounding_sphere planet_sphere{ loaded_planet->get_bounds().transformed(planet_transform) };
 
-		glBindVertexArray(0);
-	}
+	// the culler owns the instanced array, only the rocks inside the frustum are packed at its front.
+	std::unique_ptr<instance_culler> rock_culler{ std::make_unique<instance_culler>(rock_cull_mode, model_matrices.get(), amount,
+		loaded_rock->get_bounds(), loaded_rock->get_meshes(), rock_lods, cull_gl_program_id) };
+	model_matrices.reset();
 
+	// the rocks read the shared arena through the culler's VAOs, which add the per instance model matrix.
+	rock_culler->setup_instance_attributes(3);
 
 
 
+	std::size_t rendered_frames{ 0 };
+	render_stats frame_totals{};
+	double title_time{ 0.0 };
+	double benchmark_begin{ glfwGetTime() };
 
 	while (!glfwWindowShouldClose(window))
 	{
@@ -301,49 +602,84 @@ int main()
 		delta_time = current_time - last_frame;
 		last_frame = current_time;
 
+		render_stats::current().reset();
+
 
 		// process keyboard events.
 		process_input(window);
 
+		// textures decoded on the worker pool since last frame.
+		texture_loader::shared().upload_pending(TEXTURE_UPLOAD_BUDGET);
+
 		glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
-		glm::mat4 projection{ glm::perspective(glm::radians(45.0f), (WIDTH / HEIGHT)*1.0f, 1.0f, 100.0f) };
-		glm::mat4 view{ 1.0f }; // make sure to initialize matrix to identity matrix first
-		view = glm::lookAt(camera_pos, camera_pos + camera_front, camera_up);
+		camera_block camera{};
+		camera.projection_ = glm::perspective(glm::radians(45.0f), (WIDTH / HEIGHT)*1.0f, 1.0f, 100.0f);
+		camera.view_ = glm::lookAt(camera_pos, camera_pos + camera_front, camera_up);
+		camera.camera_position_ = glm::vec4{ camera_pos, 1.0f };
+		camera_buffer->update(camera);
 
-		glUseProgram(asteriods_gl_program_id);
-		shader::set_mat4(asteriods_gl_program_id, "projection", projection);
-		shader::set_mat4(asteriods_gl_program_id, "view", view);
+		glm::mat4 view_projection{ camera.projection_ * camera.view_ };
+		rock_culler->cull(camera.projection_, camera.view_);
+		planet_lods.set_camera(camera.projection_, camera.view_);
 
-		glUseProgram(planet_gl_program_id);
-		shader::set_mat4(planet_gl_program_id, "projection", projection);
-		shader::set_mat4(planet_gl_program_id, "view", view);
+		// the cursor is captured, so it always sits at the center of the window.
+		ray center_ray{ ray::from_cursor(WIDTH / 2.0, HEIGHT / 2.0, WIDTH, HEIGHT, camera.projection_, camera.view_) };
+		if (pick_requested)
+		{
+			pick_requested = false;
+			scene_hit hit{ scene.pick(center_ray) };
+			if (!hit.is_hit())
+			{
+				std::cout << "picked nothing" << std::endl;
+			}
+			else if (hit.instance_ == planet_instance)
+			{
+				std::cout << "picked the planet, mesh " << hit.mesh_ << ", " << hit.distance_ << " away" << std::endl;
+			}
+			else
+			{
+				std::cout << "picked rock " << hit.instance_ << ", " << hit.distance_ << " away" << std::endl;
+			}
+		}
 
-		// draw planet
-		glm::mat4 model{ 1.0f };
-		model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
-		shader::set_mat4(planet_gl_program_id, "model", model);
-		loaded_planet->draw(planet_gl_program_id);
+		if (nearest_requested)
+		{
+			nearest_requested = false;
+			bvh_hit nearest{ scene.nearest(camera_pos) };
+			std::cout << "nearest: " << (nearest.item_ == planet_instance ? std::basic_string<char>{ "the planet" } : "rock " + std::to_string(nearest.item_))
+				<< ", " << nearest.distance_ << " away" << std::endl;
+		}
 
+		// every draw of the frame goes through the queue, sorted so programs, materials and VAOs switch as rarely as possible.
+		queue.clear();
+		state.reset();
+
+		// draw planet
+		const glm::mat4& model{ planet_transform };
+		if (indirect_mode)
+		{
+			state.use(*indirect_program);
+			indirect_program->set(indirect_model, model);
+			loaded_planet->submit_indirect(queue, *indirect_program, camera.view_ * model);
+		}
+		else
+		{
+			state.use(planet_program);
+			planet_program.set(planet_model, model);
+			loaded_planet->submit(queue, planet_program, camera.view_ * model, planet_lods.select(planet_sphere.center_, planet_sphere.radius_));
+		}
 
 		// draw asteriod
-		glUseProgram(asteriods_gl_program_id);
-		shader::set_int(asteriods_gl_program_id, "texture_diffuse_1", 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, loaded_planet->get_loaded_textures()[0].second.id_);
-
-		std::size_t no_meshed_in_asteroid{ loaded_planet->get_loaded_textures().size() };
-		for (auto meshed_in_rock_itr_beg = loaded_planet->get_meshes().cbegin(); 
-			meshed_in_rock_itr_beg != loaded_planet->get_meshes().cend(); ++meshed_in_rock_itr_beg)
+		instance_culler* rocks{ rock_culler.get() };
+		queue.submit(render_pass::opaque, asteriods_program, loaded_rock->get_meshes().front()->get_material(), [rocks](render_state& rock_state)
 		{
-			glBindVertexArray((*meshed_in_rock_itr_beg)->get_VAO());
-			glDrawElementsInstanced(GL_TRIANGLES, (*meshed_in_rock_itr_beg)->get_indices().size(), GL_UNSIGNED_INT, 0, amount);
+			rocks->draw(rock_state);
+		}, 0.0f);
 
-			glBindVertexArray(0);
-		}
+		queue.execute(state);
 
 
 
@@ -351,8 +687,72 @@ int main()
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		frame_totals += render_stats::current();
+
+		// the counters of the current frame, refreshed once a second.
+		if (benchmark_frames == 0 && current_time - title_time >= 1.0)
+		{
+			title_time = current_time;
+			std::basic_string<char> title{ "LearnOpenGL - " + std::to_string(render_stats::current().draw_calls_) + " draw calls, "
+				+ std::to_string(render_stats::current().triangles_) + " triangles, " + std::to_string(render_stats::current().program_binds_ + render_stats::current().VAO_binds_
+				+ render_stats::current().texture_binds_) + " state switches" };
+			glfwSetWindowTitle(window, title.c_str());
+		}
+		if (benchmark_frames != 0 && ++rendered_frames == benchmark_frames)
+		{
+			glFinish();
+			double elapsed{ glfwGetTime() - benchmark_begin };
+			std::cout << (indirect_mode ? "indirect" : "direct") << ": " << rendered_frames << " frames, "
+				<< elapsed * 1000.0 / rendered_frames << " ms/frame, "
+				<< static_cast<double>(frame_totals.draw_calls_) / rendered_frames << " draw calls/frame, "
+				<< static_cast<double>(frame_totals.triangles_) / rendered_frames << " triangles/frame" << std::endl;
+
+			std::cout << "state switches(" << (material_array ? "array" : "bind") << " materials): "
+				<< static_cast<double>(frame_totals.program_binds_) / rendered_frames << " program, "
+				<< static_cast<double>(frame_totals.VAO_binds_) / rendered_frames << " VAO, "
+				<< static_cast<double>(frame_totals.texture_binds_) / rendered_frames << " texture per frame, "
+				<< static_cast<double>(frame_totals.redundant_binds_) / rendered_frames << " redundant skipped/frame" << std::endl;
+
+			std::size_t uniform_uploads{ asteriods_program.get_upload_count() + planet_program.get_upload_count() };
+			std::size_t uniform_skips{ asteriods_program.get_skipped_count() + planet_program.get_skipped_count() };
+			if (indirect_program)
+			{
+				uniform_uploads += indirect_program->get_upload_count();
+				uniform_skips += indirect_program->get_skipped_count();
+			}
+
+			std::cout << "uniforms: " << static_cast<double>(uniform_uploads) / rendered_frames << " uploads/frame, "
+				<< static_cast<double>(uniform_skips) / rendered_frames << " redundant skipped/frame" << std::endl;
+
+			rock_culler->print(std::cout);
+			std::cout << std::endl;
+
+			// the last frame again on the CPU, the GPU result must agree with it.
+			if (rock_culler->get_mode() == cull_mode::gpu)
+			{
+				std::size_t gpu_visible{ rock_culler->read_visible_count() };
+				std::size_t cpu_visible{ rock_culler->count_visible(view_projection) };
+				std::cout << "cpu reference: " << cpu_visible << " visible" << (gpu_visible == cpu_visible ? ", matches" : ", MISMATCH") << std::endl;
+			}
+
+			print_scene_queries(scene, frustum::from_view_projection(view_projection), center_ray, glm::vec3{ camera_pos });
+			break;
+		}
 	}
 
+	const texture_registry_stats& texture_stats{ texture_registry::shared().get_stats() };
+	std::cout << "texture registry: " << texture_stats.hits_ << " hits, " << texture_stats.misses_ << " misses, "
+		<< texture_stats.textures_resident_ << " textures / " << texture_stats.bytes_resident_ / 1024 << " KiB resident" << std::endl;
+
+	// textures are released back to the registry, which needs the context.
+	rock_culler.reset();
+	loaded_rock.reset();
+	loaded_planet.reset();
+	materials.reset();
+	camera_buffer.reset();
+	programs.reset();
+
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
 	glfwTerminate();
@@ -0,0 +1,181 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+// a whole file mapped read only, the pages are read in by the OS on first touch.
+class mapped_file final
+{
+private:
+	const unsigned char* data_{ nullptr };
+	std::size_t size_{};
+
+#ifdef _WIN32
+	HANDLE file_handle_{ INVALID_HANDLE_VALUE };
+	HANDLE mapping_handle_{ nullptr };
+#endif
+
+public:
+	mapped_file() = default;
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	~mapped_file()
+	{
+		this->release();
+	}
+
+	const unsigned char* get_data()const noexcept
+	{
+		return this->data_;
+	}
+
+	std::size_t get_size()const noexcept
+	{
+		return this->size_;
+	}
+
+	bool is_open()const noexcept
+	{
+		return this->data_ != nullptr;
+	}
+
+	// false for missing and for empty files, an empty file can not be mapped.
+	bool open(const std::basic_string<char>& file_path)
+	{
+		this->release();
+
+#ifdef _WIN32
+		this->file_handle_ = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (this->file_handle_ == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER file_size{};
+		if (!GetFileSizeEx(this->file_handle_, &file_size) || file_size.QuadPart == 0)
+		{
+			this->release();
+			return false;
+		}
+
+		this->mapping_handle_ = CreateFileMappingA(this->file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!this->mapping_handle_)
+		{
+			this->release();
+			return false;
+		}
+
+		this->data_ = static_cast<const unsigned char*>(MapViewOfFile(this->mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+		if (!this->data_)
+		{
+			this->release();
+			return false;
+		}
+
+		this->size_ = static_cast<std::size_t>(file_size.QuadPart);
+#else
+		int file_descriptor{ ::open(file_path.c_str(), O_RDONLY) };
+		if (file_descriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat file_state {};
+		if (fstat(file_descriptor, &file_state) != 0 || file_state.st_size == 0)
+		{
+			close(file_descriptor);
+			return false;
+		}
+
+		void* data{ mmap(nullptr, static_cast<std::size_t>(file_state.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0) };
+		// the mapping keeps its own reference to the file.
+		close(file_descriptor);
+
+		if (data == MAP_FAILED)
+		{
+			return false;
+		}
+
+		this->data_ = static_cast<const unsigned char*>(data);
+		this->size_ = static_cast<std::size_t>(file_state.st_size);
+#endif
+
+		return true;
+	}
+
+	void release()noexcept
+	{
+#ifdef _WIN32
+		if (this->data_)
+		{
+			UnmapViewOfFile(this->data_);
+		}
+
+		if (this->mapping_handle_)
+		{
+			CloseHandle(this->mapping_handle_);
+			this->mapping_handle_ = nullptr;
+		}
+
+		if (this->file_handle_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(this->file_handle_);
+			this->file_handle_ = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (this->data_)
+		{
+			munmap(const_cast<unsigned char*>(this->data_), this->size_);
+		}
+#endif
+
+		this->data_ = nullptr;
+		this->size_ = 0;
+	}
+
+	// modification time and size, false when the file does not exist.
+	static bool stat_file(const std::basic_string<char>& file, std::int64_t& mtime, std::uint64_t& size)
+	{
+#ifdef _WIN32
+		struct _stat64 file_state {};
+		if (_stat64(file.c_str(), &file_state) != 0)
+		{
+			return false;
+		}
+#else
+		struct stat file_state {};
+		if (stat(file.c_str(), &file_state) != 0)
+		{
+			return false;
+		}
+#endif
+
+		mtime = static_cast<std::int64_t>(file_state.st_mtime);
+		size = static_cast<std::uint64_t>(file_state.st_size);
+		return true;
+	}
+};
+
+
+#endif // !__MAPPED_FILE_HPP__
@@ -0,0 +1,593 @@
+#ifndef __MATERIAL_LIBRARY_HPP__
+#define __MATERIAL_LIBRARY_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "uniform_blocks.hpp"
+#include "render_stats.hpp"
+#include "shader_program.hpp"
+#include "compressed_texture.hpp"
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+
+// attribute location of the per draw material index: glVertexAttribI4ui for direct draws, an instanced attribute for multi draws.
+static constexpr const GLuint MATERIAL_LOCATION{ 7 };
+
+// unit the texture array stays bound to, glsl/material_block.glsl samples it as "material_textures".
+static constexpr const GLint MATERIAL_TEXTURE_UNIT{ 0 };
+
+// texels around an atlas rectangle, filled with the texture's own wrapped edges.
+// rectangles start on multiples of twice as much, so the first log2(padding) mip levels keep them apart.
+static constexpr const GLint MATERIAL_ATLAS_PADDING{ 8 };
+
+// where one material's texture ended up.
+struct material_placement
+{
+	GLint layer_{};
+	// texels of the rectangle inside the layer, padding excluded.
+	GLint x_{};
+	GLint y_{};
+	GLint width_{};
+	GLint height_{};
+	// true when the texture covers a whole layer, scaled up if it is smaller.
+	bool whole_layer_{};
+};
+
+
+// every texture a scene draws with, copied into the layers of one GL_TEXTURE_2D_ARRAY, each mip level from the texture's own.
+// layers are as large as the largest texture: textures of that size take a layer each, smaller ones are shelf packed
+// into atlas layers and reached through a uv rectangle, the rare one too wide for an atlas is scaled up to a whole layer.
+// when every texture has the same block compressed format and size the array keeps that format, a layer each.
+// otherwise it is RGBA8 and compressed textures are decompressed into it, print() says which.
+// a material is an index into the library, meshes carry it instead of texture names, so once bind() has run
+// whole models and instanced fields draw with no texture binds in between.
+// material 0 is plain white, for meshes without a texture.
+class material_library final
+{
+private:
+	// the texture of each material, 0 for material 0.
+	std::vector<GLuint> textures_{ 0 };
+	std::unordered_map<GLuint, GLuint> material_by_texture_{};
+
+	std::vector<material_placement> placements_{};
+	std::unique_ptr<uniform_buffer<material_block>> material_buffer_{};
+	GLuint texture_array_{};
+	GLint layer_width_{};
+	GLint layer_height_{};
+	GLint layer_count_{};
+	GLint level_count_{};
+	// GL_RGBA8, or the block compressed format every texture shares.
+	GLint internal_format_{ GL_RGBA8 };
+	block_format block_format_{};
+	// textures stored block compressed, decompressed into an RGBA8 array when the formats or sizes differ.
+	std::size_t compressed_count_{};
+	std::size_t bytes_{};
+
+public:
+	material_library() = default;
+	material_library(const material_library&) = delete;
+	material_library& operator=(const material_library&) = delete;
+
+	~material_library()
+	{
+		glDeleteTextures(1, &this->texture_array_);
+	}
+
+	// the material showing texture_id, the same index for the same texture. 0 for no texture or when the library is full.
+	GLuint add(GLuint texture_id)
+	{
+		if (texture_id == 0)
+		{
+			return 0;
+		}
+
+		auto material_itr{ this->material_by_texture_.find(texture_id) };
+		if (material_itr != this->material_by_texture_.end())
+		{
+			return material_itr->second;
+		}
+
+		if (this->textures_.size() == MAX_MATERIALS)
+		{
+			std::cout << "MATERIAL_LIBRARY:: more than " << MAX_MATERIALS << " materials, texture " << texture_id << " is drawn white" << std::endl;
+			return 0;
+		}
+
+		GLuint material{ static_cast<GLuint>(this->textures_.size()) };
+		this->textures_.push_back(texture_id);
+		this->material_by_texture_.emplace(texture_id, material);
+		return material;
+	}
+
+	std::size_t get_material_count()const noexcept
+	{
+		return this->textures_.size();
+	}
+
+	const std::vector<material_placement>& get_placements()const noexcept
+	{
+		return this->placements_;
+	}
+
+	// the texture material was added for, 0 for material 0.
+	GLuint get_texture(GLuint material)const noexcept
+	{
+		return material < this->textures_.size() ? this->textures_[material] : 0;
+	}
+
+	GLuint get_texture_array()const noexcept
+	{
+		return this->texture_array_;
+	}
+
+	// attaches program's material_block and points its "material_textures" at MATERIAL_TEXTURE_UNIT.
+	void bind_to(shader_program& program)const
+	{
+		if (!bind_uniform_block(program.get_id(), "material_block", MATERIAL_BLOCK_BINDING))
+		{
+			std::cout << "MATERIAL_LIBRARY:: program " << program.get_id() << " has no block named: material_block" << std::endl;
+		}
+
+		program.use();
+		program.set(program.get_uniform<int>("material_textures"), MATERIAL_TEXTURE_UNIT);
+	}
+
+	// once per frame, every draw after it picks its material through MATERIAL_LOCATION alone.
+	void bind()const
+	{
+		glActiveTexture(GL_TEXTURE0 + MATERIAL_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture_array_);
+		++render_stats::current().texture_binds_;
+	}
+
+	// the textures must have been uploaded(see texture_loader::finish()), materials added later are not part of the array.
+	void build()
+	{
+		std::vector<glm::ivec2> sizes(this->textures_.size(), glm::ivec2{ 1, 1 });
+		std::vector<GLint> formats(this->textures_.size(), GL_RGBA8);
+		std::vector<GLint> level_counts(this->textures_.size(), 1);
+		bool same_block_format{ this->textures_.size() > 1 };
+		this->compressed_count_ = 0;
+		for (std::size_t material = 1; material < this->textures_.size(); ++material)
+		{
+			GLint compressed{};
+			glBindTexture(GL_TEXTURE_2D, this->textures_[material]);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &sizes[material].x);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &sizes[material].y);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &formats[material]);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+			level_counts[material] = material_library::bound_level_count(sizes[material]);
+
+			this->compressed_count_ += compressed != 0;
+			same_block_format = same_block_format && compressed != 0 && formats[material] == formats[1]
+				&& sizes[material].x == sizes[1].x && sizes[material].y == sizes[1].y;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		this->internal_format_ = GL_RGBA8;
+		if (same_block_format && material_library::find_block_format(formats[1], this->block_format_))
+		{
+			this->internal_format_ = formats[1];
+		}
+
+		if (this->internal_format_ != GL_RGBA8)
+		{
+			// blocks can not be scaled or placed at any texel, so every texture keeps a whole layer of its own size.
+			this->layer_width_ = sizes[1].x;
+			this->layer_height_ = sizes[1].y;
+			this->placements_.assign(this->textures_.size(), material_placement{});
+			for (std::size_t material = 0; material < this->placements_.size(); ++material)
+			{
+				this->placements_[material] = material_placement{ static_cast<GLint>(material), 0, 0, this->layer_width_, this->layer_height_, true };
+			}
+			this->layer_count_ = static_cast<GLint>(this->textures_.size());
+			// a cooked file may stop above 1x1, the array has the levels every texture has.
+			this->level_count_ = *std::min_element(level_counts.begin() + 1, level_counts.end());
+		}
+		else
+		{
+			this->layer_width_ = 1;
+			this->layer_height_ = 1;
+			for (const glm::ivec2& size : sizes)
+			{
+				this->layer_width_ = std::max(this->layer_width_, size.x);
+				this->layer_height_ = std::max(this->layer_height_, size.y);
+			}
+
+			// white alone still needs room for its padded rectangle.
+			this->layer_width_ = std::max(this->layer_width_, 4 * MATERIAL_ATLAS_PADDING);
+			this->layer_height_ = std::max(this->layer_height_, 4 * MATERIAL_ATLAS_PADDING);
+
+			this->placements_ = material_library::pack(sizes, this->layer_width_, this->layer_height_);
+			this->layer_count_ = 0;
+			for (const material_placement& placement : this->placements_)
+			{
+				this->layer_count_ = std::max(this->layer_count_, placement.layer_ + 1);
+			}
+			this->level_count_ = material_library::full_level_count(this->layer_width_, this->layer_height_);
+		}
+
+		glGenTextures(1, &this->texture_array_);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture_array_);
+		this->bytes_ = 0;
+		for (GLint level = 0; level < this->level_count_; ++level)
+		{
+			GLint width{ std::max(this->layer_width_ >> level, 1) };
+			GLint height{ std::max(this->layer_height_ >> level, 1) };
+			if (this->internal_format_ != GL_RGBA8)
+			{
+				std::size_t bytes{ block_compressor::level_bytes(this->block_format_, width, height) * this->layer_count_ };
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, this->internal_format_, width, height, this->layer_count_, 0,
+					static_cast<GLsizei>(bytes), nullptr);
+				this->bytes_ += bytes;
+			}
+			else
+			{
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, width, height, this->layer_count_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+				this->bytes_ += static_cast<std::size_t>(width) * height * 4 * this->layer_count_;
+			}
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, this->level_count_ - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		if (this->internal_format_ != GL_RGBA8)
+		{
+			this->copy_blocks();
+		}
+		else
+		{
+			this->copy_textures(sizes, level_counts);
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		material_block block{};
+		for (std::size_t material = 0; material < this->placements_.size(); ++material)
+		{
+			const material_placement& placement{ this->placements_[material] };
+			material_entry& entry{ block.materials_[material] };
+			entry.uv_rect_ = glm::vec4{ static_cast<float>(placement.x_) / this->layer_width_, static_cast<float>(placement.y_) / this->layer_height_,
+				static_cast<float>(placement.width_) / this->layer_width_, static_cast<float>(placement.height_) / this->layer_height_ };
+			// a whole layer wraps by itself, its samples may cover any number of texels.
+			entry.layer_ = glm::vec4{ static_cast<float>(placement.layer_), placement.whole_layer_ ? 65536.0f : static_cast<float>(MATERIAL_ATLAS_PADDING), 0.0f, 0.0f };
+		}
+
+		this->material_buffer_ = std::make_unique<uniform_buffer<material_block>>(MATERIAL_BLOCK_BINDING);
+		this->material_buffer_->update(block);
+	}
+
+	// shelf packing, tallest first. sizes[i] is the texture of material i, layers may be no larger than layer_width x layer_height.
+	// textures of exactly that size, and those whose padded rectangle does not fit, come first with a layer each.
+	static std::vector<material_placement> pack(const std::vector<glm::ivec2>& sizes, GLint layer_width, GLint layer_height)
+	{
+		static constexpr const GLint alignment{ 2 * MATERIAL_ATLAS_PADDING };
+		auto slot_size = [](GLint size)
+		{
+			return (size + 2 * MATERIAL_ATLAS_PADDING + alignment - 1) / alignment * alignment;
+		};
+
+		std::vector<material_placement> placements(sizes.size());
+		std::vector<std::size_t> atlased{};
+		GLint layer{ 0 };
+		for (std::size_t material = 0; material < sizes.size(); ++material)
+		{
+			const glm::ivec2& size{ sizes[material] };
+			bool whole_layer{ (size.x == layer_width && size.y == layer_height) || slot_size(size.x) > layer_width || slot_size(size.y) > layer_height };
+			if (!whole_layer)
+			{
+				atlased.push_back(material);
+				continue;
+			}
+
+			placements[material] = material_placement{ layer++, 0, 0, layer_width, layer_height, true };
+		}
+
+		std::stable_sort(atlased.begin(), atlased.end(), [&sizes](std::size_t left, std::size_t right)
+		{
+			return sizes[left].y > sizes[right].y;
+		});
+
+		GLint shelf_x{ 0 };
+		GLint shelf_y{ 0 };
+		GLint shelf_height{ 0 };
+		bool layer_open{ false };
+		for (std::size_t material : atlased)
+		{
+			GLint slot_width{ slot_size(sizes[material].x) };
+			GLint slot_height{ slot_size(sizes[material].y) };
+
+			if (layer_open && shelf_x + slot_width > layer_width)
+			{
+				shelf_x = 0;
+				shelf_y += shelf_height;
+				shelf_height = 0;
+			}
+
+			if (!layer_open || shelf_y + slot_height > layer_height)
+			{
+				if (layer_open)
+				{
+					++layer;
+				}
+				layer_open = true;
+				shelf_x = 0;
+				shelf_y = 0;
+				shelf_height = 0;
+			}
+
+			placements[material] = material_placement{ layer, shelf_x + MATERIAL_ATLAS_PADDING, shelf_y + MATERIAL_ATLAS_PADDING,
+				sizes[material].x, sizes[material].y, false };
+			shelf_x += slot_width;
+			shelf_height = std::max(shelf_height, slot_height);
+		}
+
+		return placements;
+	}
+
+	// the textures added stay resident next to the array unless their owner drops them(see texture_registry::trim()),
+	// "sources" reports what they still hold.
+	void print(std::ostream& out)const
+	{
+		std::size_t whole_layers{ 0 };
+		for (const material_placement& placement : this->placements_)
+		{
+			whole_layers += placement.whole_layer_;
+		}
+
+		std::size_t source_bytes{ 0 };
+		for (std::size_t material = 1; material < this->textures_.size(); ++material)
+		{
+			source_bytes += material_library::texture_bytes(this->textures_[material]);
+		}
+
+		out << "materials: " << this->placements_.size() << " in " << this->layer_count_ << " layers of " << this->layer_width_ << "x" << this->layer_height_
+			<< " (" << whole_layers << " whole, " << this->placements_.size() - whole_layers << " atlased), "
+			<< (this->internal_format_ != GL_RGBA8 ? compressed_texture::format_name(this->block_format_) : "RGBA8") << " " << this->bytes_ / 1024 << " KiB";
+		if (this->internal_format_ == GL_RGBA8 && this->compressed_count_ != 0)
+		{
+			out << ", " << this->compressed_count_ << " block compressed textures decompressed(their formats or sizes differ)";
+		}
+		out << ", sources " << source_bytes / 1024 << " KiB";
+	}
+
+private:
+	// levels of a full chain down to 1x1.
+	static GLint full_level_count(GLint width, GLint height)noexcept
+	{
+		GLint count{ 1 };
+		while ((std::max(width, height) >> count) != 0)
+		{
+			++count;
+		}
+
+		return count;
+	}
+
+	// levels the bound GL_TEXTURE_2D has, from 0 up to its GL_TEXTURE_MAX_LEVEL or the first missing one.
+	static GLint bound_level_count(const glm::ivec2& size)
+	{
+		GLint max_level{};
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &max_level);
+
+		GLint count{ 1 };
+		for (; count <= max_level && count < material_library::full_level_count(size.x, size.y); ++count)
+		{
+			GLint width{};
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, count, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+			{
+				break;
+			}
+		}
+
+		return count;
+	}
+
+	static bool find_block_format(GLint internal_format, block_format& format)noexcept
+	{
+		for (block_format candidate : { block_format::bc1, block_format::bc3, block_format::bc5, block_format::bc7 })
+		{
+			if (static_cast<GLint>(compressed_texture::internal_format(candidate)) == internal_format)
+			{
+				format = candidate;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// what a GL_TEXTURE_2D holds in video memory, every level.
+	static std::size_t texture_bytes(GLuint texture_id)
+	{
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+		GLint width{};
+		GLint height{};
+		GLint compressed{};
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+
+		std::size_t bytes{ 0 };
+		GLint level_count{ material_library::bound_level_count(glm::ivec2{ width, height }) };
+		for (GLint level = 0; level < level_count; ++level)
+		{
+			if (compressed)
+			{
+				GLint level_bytes{};
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &level_bytes);
+				bytes += static_cast<std::size_t>(level_bytes);
+			}
+			else
+			{
+				bytes += static_cast<std::size_t>(std::max(width >> level, 1)) * std::max(height >> level, 1) * 4;
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		return bytes;
+	}
+
+	// every texture into its own layer as it is, block for block and level for level, material 0 encoded white.
+	void copy_blocks()
+	{
+		const std::vector<std::uint8_t> white_texels(4 * 4 * 4, 255);
+		const std::vector<std::uint8_t> white_block{ block_compressor::compress(white_texels.data(), 4, 4, this->block_format_) };
+
+		std::vector<unsigned char> blocks{};
+		for (GLint level = 0; level < this->level_count_; ++level)
+		{
+			GLint width{ std::max(this->layer_width_ >> level, 1) };
+			GLint height{ std::max(this->layer_height_ >> level, 1) };
+
+			blocks.resize(block_compressor::level_bytes(this->block_format_, width, height));
+			for (std::size_t offset = 0; offset < blocks.size(); offset += white_block.size())
+			{
+				std::copy(white_block.begin(), white_block.end(), blocks.begin() + offset);
+			}
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, 1, this->internal_format_,
+				static_cast<GLsizei>(blocks.size()), blocks.data());
+
+			for (std::size_t material = 1; material < this->textures_.size(); ++material)
+			{
+				glBindTexture(GL_TEXTURE_2D, this->textures_[material]);
+				glGetCompressedTexImage(GL_TEXTURE_2D, level, blocks.data());
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, this->placements_[material].layer_, width, height, 1, this->internal_format_,
+					static_cast<GLsizei>(blocks.size()), blocks.data());
+			}
+		}
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// blits every level of every texture to its placement in the same level of the array. an atlas rectangle is surrounded
+	// by copies of the texture, so filtering across its edges reads the texels repeating would. block compressed textures
+	// can not be framebuffer attachments and a texture without its full chain would leave levels unfilled, those are staged
+	// in a plain RGBA8 texture first, the missing levels generated there.
+	void copy_textures(const std::vector<glm::ivec2>& sizes, const std::vector<GLint>& level_counts)
+	{
+		GLuint framebuffers[2]{};
+		glGenFramebuffers(2, framebuffers);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+
+		GLuint staging_texture{};
+		std::vector<unsigned char> staging_pixels{};
+		for (std::size_t material = 0; material < this->placements_.size(); ++material)
+		{
+			const material_placement& placement{ this->placements_[material] };
+			if (material == 0)
+			{
+				static constexpr const GLfloat white[4]{ 1.0f, 1.0f, 1.0f, 1.0f };
+				glEnable(GL_SCISSOR_TEST);
+				for (GLint level = 0; level < this->level_count_; ++level)
+				{
+					glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, this->texture_array_, level, placement.layer_);
+					GLint left{ (placement.x_ - MATERIAL_ATLAS_PADDING) >> level };
+					GLint bottom{ (placement.y_ - MATERIAL_ATLAS_PADDING) >> level };
+					GLint right{ (placement.x_ + placement.width_ + MATERIAL_ATLAS_PADDING + (1 << level) - 1) >> level };
+					GLint top{ (placement.y_ + placement.height_ + MATERIAL_ATLAS_PADDING + (1 << level) - 1) >> level };
+					glScissor(left, bottom, right - left, top - bottom);
+					glClearBufferfv(GL_COLOR, 0, white);
+				}
+				glDisable(GL_SCISSOR_TEST);
+				continue;
+			}
+
+			GLint width{ sizes[material].x };
+			GLint height{ sizes[material].y };
+			GLint full_levels{ material_library::full_level_count(width, height) };
+			GLint compressed{};
+			glBindTexture(GL_TEXTURE_2D, this->textures_[material]);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+
+			GLuint source_texture{ this->textures_[material] };
+			if (compressed || level_counts[material] < full_levels)
+			{
+				if (staging_texture == 0)
+				{
+					glGenTextures(1, &staging_texture);
+				}
+
+				GLint staged_levels{ level_counts[material] < full_levels ? 1 : full_levels };
+				glPixelStorei(GL_PACK_ALIGNMENT, 1);
+				for (GLint level = 0; level < staged_levels; ++level)
+				{
+					GLint level_width{ std::max(width >> level, 1) };
+					GLint level_height{ std::max(height >> level, 1) };
+					staging_pixels.resize(static_cast<std::size_t>(level_width) * level_height * 4);
+					glBindTexture(GL_TEXTURE_2D, this->textures_[material]);
+					glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, staging_pixels.data());
+
+					glBindTexture(GL_TEXTURE_2D, staging_texture);
+					glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, level_width, level_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, staging_pixels.data());
+				}
+				glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+				glBindTexture(GL_TEXTURE_2D, staging_texture);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, full_levels - 1);
+				if (staged_levels < full_levels)
+				{
+					glGenerateMipmap(GL_TEXTURE_2D);
+				}
+				source_texture = staging_texture;
+			}
+
+			for (GLint level = 0; level < this->level_count_; ++level)
+			{
+				// past the source's 1x1(or 1xn) level its last one stands in, a texel wide like the rectangle.
+				GLint source_level{ std::min(level, full_levels - 1) };
+				GLint source_width{ std::max(width >> source_level, 1) };
+				GLint source_height{ std::max(height >> source_level, 1) };
+				glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source_texture, source_level);
+				glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, this->texture_array_, level, placement.layer_);
+
+				if (placement.whole_layer_)
+				{
+					glBlitFramebuffer(0, 0, source_width, source_height, 0, 0, std::max(placement.width_ >> level, 1), std::max(placement.height_ >> level, 1),
+						GL_COLOR_BUFFER_BIT, GL_LINEAR);
+					continue;
+				}
+
+				// one blit per repeat of the level overlapping the padded rectangle, clipped to it. past log2(padding)
+				// the rectangle no longer starts on a texel of the level and neighbours begin to share texels.
+				GLint origin_x{ placement.x_ >> level };
+				GLint origin_y{ placement.y_ >> level };
+				GLint left{ (placement.x_ - MATERIAL_ATLAS_PADDING) >> level };
+				GLint bottom{ (placement.y_ - MATERIAL_ATLAS_PADDING) >> level };
+				GLint right{ (placement.x_ + width + MATERIAL_ATLAS_PADDING + (1 << level) - 1) >> level };
+				GLint top{ (placement.y_ + height + MATERIAL_ATLAS_PADDING + (1 << level) - 1) >> level };
+				for (GLint tile_y = origin_y - (origin_y - bottom + source_height - 1) / source_height * source_height; tile_y < top; tile_y += source_height)
+				{
+					for (GLint tile_x = origin_x - (origin_x - left + source_width - 1) / source_width * source_width; tile_x < right; tile_x += source_width)
+					{
+						GLint x0{ std::max(tile_x, left) };
+						GLint y0{ std::max(tile_y, bottom) };
+						GLint x1{ std::min(tile_x + source_width, right) };
+						GLint y1{ std::min(tile_y + source_height, top) };
+						glBlitFramebuffer(x0 - tile_x, y0 - tile_y, x1 - tile_x, y1 - tile_y, x0, y0, x1, y1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+					}
+				}
+			}
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(2, framebuffers);
+		glDeleteTextures(1, &staging_texture);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+};
+
+
+#endif // !__MATERIAL_LIBRARY_HPP__
@@ -3,6 +3,13 @@
 
 #include <glad/glad.h> // holds all OpenGL type declarations
 
+#include "geometry_arena.hpp"
+#include "render_stats.hpp"
+#include "shader_program.hpp"
+#include "frustum.hpp"
+#include "vertex_format.hpp"
+#include "material_library.hpp"
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/vec2.hpp>
@@ -12,6 +19,8 @@
 #include <list>
 #include <string>
 #include <vector>
+#include <utility>
+#include <algorithm>
 #include <cstddef>
 
 enum class texture_type
@@ -22,14 +31,21 @@ enum class texture_type
 	height_type
 };
 
-struct vertex
-{
-	glm::vec3 position_;
-	glm::vec3 normal_;
-	glm::vec2 texcoord_;
+// a mesh asked for vertex_layout::packed keeps the full layout when half float texture coordinates would be off by more.
+// half a texel of a 1024 texture, which half floats hold for coordinates up to 2.
+static constexpr const float VERTEX_TEXCOORD_TOLERANCE{ 1.0f / 2048.0f };
+
+// levels of detail per mesh, level 0 is the mesh as loaded.
+static constexpr const std::size_t MESH_LOD_COUNT{ 4 };
 
-	glm::vec3 tangent_;
-	glm::vec3 bitangent_;
+// one level of detail, a sub range of the mesh's own indices into the same vertices.
+struct mesh_lod
+{
+	// relative to the mesh's first index.
+	GLuint first_index_{};
+	GLsizei index_count_{};
+	// how far the level strays from level 0, in model units.
+	float error_{};
 };
 
 
@@ -37,6 +53,34 @@ struct texture
 {
 	std::size_t id_;
 	texture_type type_;
+	std::basic_string<char> path_;
+};
+
+
+// textures of one type a mesh may bind, "diffuse_texture_1" .. "diffuse_texture_8".
+static constexpr const std::size_t MAX_TEXTURES_PER_TYPE{ 8 };
+
+// the "<type>_texture_<n>" samplers of a program, resolved once instead of formatting and looking up names per mesh per frame.
+struct material_samplers
+{
+	uniform_handle<int> handles_[4][MAX_TEXTURES_PER_TYPE]{};
+
+	static material_samplers reflect(const shader_program& program)
+	{
+		static const char* const prefixes[4]{ "ambient_texture_", "diffuse_texture_", "specular_texture_", "height_texture_" };
+
+		material_samplers samplers{};
+		for (std::size_t type = 0; type < 4; ++type)
+		{
+			for (std::size_t number = 0; number < MAX_TEXTURES_PER_TYPE; ++number)
+			{
+				std::basic_string<char> name{ prefixes[type] + std::to_string(number + 1) };
+				samplers.handles_[type][number] = program.get_uniform<int>(name.c_str());
+			}
+		}
+
+		return samplers;
+	}
 };
 
 
@@ -47,10 +91,26 @@ private:
 	std::vector<vertex> vertices_;
 	std::vector<GLuint> indices_;
 	std::list<texture> textures_;
-
-	GLuint VAO_;
-	GLuint VBO_;
-	GLuint EBO_;
+	// level 0 first, every level indexes the same vertices.
+	std::vector<mesh_lod> lods_;
+
+	// point either to vertices_/indices_ or to memory owned by someone else(e.g. a mapped mesh cache).
+	const vertex* vertices_data_{ nullptr };
+	std::size_t vertices_count_{};
+	const GLuint* indices_data_{ nullptr };
+	std::size_t indices_count_{};
+
+	// where bind_VAO_VBO_EBO() put this mesh inside get_arena(layout_).
+	vertex_layout layout_{ vertex_layout::full };
+	geometry_range range_{};
+	vertex_decode decode_{};
+	vertex_precision precision_{};
+	// index into the material_library given to model_loader::assign_materials(), 0 draws white.
+	GLuint material_{};
+
+	// in model space, computed while the vertices are still around.
+	bounding_sphere bounds_{};
+	bounding_box box_{};
 
 public:
 	mesh() = default;
@@ -60,6 +120,33 @@ public:
 	inline void add_vertices(const std::vector<vertex>& vertices)noexcept
 	{
 		this->vertices_ = vertices;
+		this->vertices_data_ = this->vertices_.data();
+		this->vertices_count_ = this->vertices_.size();
+	}
+
+	inline void add_vertices(std::vector<vertex>&& vertices)noexcept
+	{
+		this->vertices_ = std::move(vertices);
+		this->vertices_data_ = this->vertices_.data();
+		this->vertices_count_ = this->vertices_.size();
+	}
+
+	// the caller keeps the vertices alive until bind_VAO_VBO_EBO() has uploaded them.
+	inline void add_vertices(const vertex* vertices, std::size_t count)noexcept
+	{
+		this->vertices_.clear();
+		this->vertices_data_ = vertices;
+		this->vertices_count_ = count;
+	}
+
+	inline const vertex* get_vertices_data()const noexcept
+	{
+		return this->vertices_data_;
+	}
+
+	inline std::size_t get_vertices_count()const noexcept
+	{
+		return this->vertices_count_;
 	}
 
 	inline const std::vector<vertex>& get_vertices(const std::vector<vertex>& vertices)const noexcept
@@ -70,103 +157,172 @@ public:
 	inline void add_indices(const std::vector<GLuint>& indices)noexcept
 	{
 		this->indices_ = indices;
+		this->indices_data_ = this->indices_.data();
+		this->indices_count_ = this->indices_.size();
 	}
 
-	inline const std::vector<GLuint>& get_indices()const noexcept
+	inline void add_indices(std::vector<GLuint>&& indices)noexcept
 	{
-		return this->indices_;
+		this->indices_ = std::move(indices);
+		this->indices_data_ = this->indices_.data();
+		this->indices_count_ = this->indices_.size();
 	}
 
-	inline void add_textures(const std::list<texture>& textures)noexcept
+	// the caller keeps the indices alive until bind_VAO_VBO_EBO() has uploaded them.
+	inline void add_indices(const GLuint* indices, std::size_t count)noexcept
 	{
-		this->textures_ = textures;
+		this->indices_.clear();
+		this->indices_data_ = indices;
+		this->indices_count_ = count;
 	}
 
-	const const std::list<texture> get_textures()const noexcept
+	inline const GLuint* get_indices_data()const noexcept
 	{
-		return this->textures_;
+		return this->indices_data_;
 	}
 
-	const std::size_t& get_VAO()const noexcept
+	inline std::size_t get_indices_count()const noexcept
 	{
-		return this->VAO_;
+		return this->indices_count_;
 	}
 
-	const std::size_t& get_VBO()const noexcept
+	inline const std::vector<GLuint>& get_indices()const noexcept
 	{
-		return this->VBO_;
+		return this->indices_;
 	}
 
-	const std::size_t& get_EBO()const noexcept
+	// indices must hold every level back to back, as mesh_simplifier::build_lod_chain() leaves them.
+	inline void add_lods(const std::vector<mesh_lod>& lods)
 	{
-		return this->EBO_;
+		this->lods_ = lods;
 	}
 
-	void bind_texture(std::size_t program_id)
+	// one level covering every index when the mesh was given none, valid after bind_VAO_VBO_EBO().
+	const std::vector<mesh_lod>& get_lods()const noexcept
 	{
-		std::size_t number_of_textures{ this->textures_.size() };
-		auto texture_itr_beg{ this->textures_.cbegin() };
+		return this->lods_;
+	}
 
-		std::size_t diffuse_no{ 1 };
-		std::size_t specular_no{ 1 };
-		std::size_t ambient_no{ 1 };
-		std::size_t height_no{ 1 };
+	// where a level lives inside get_arena(), levels past the last one clamp to it.
+	geometry_range get_lod_range(std::size_t level)const
+	{
+		const mesh_lod& lod{ this->lods_[std::min(level, this->lods_.size() - 1)] };
 
-		for (std::size_t index = 0; index < number_of_textures; ++index)
-		{
-			const texture& ref_texture = *texture_itr_beg;
+		geometry_range range{ this->range_ };
+		range.first_index_ += lod.first_index_;
+		range.index_count_ = lod.index_count_;
+		return range;
+	}
 
-			if (ref_texture.type_ == texture_type::ambient_type)
-			{
-				glUniform1i(glGetUniformLocation(program_id, ("ambient_texture_" + std::to_string(ambient_no++)).c_str()), index);
-			}
+	inline void add_textures(const std::list<texture>& textures)noexcept
+	{
+		this->textures_ = textures;
+	}
 
-			if (ref_texture.type_ == texture_type::diffuse_type)
-			{
-				glUniform1i(glGetUniformLocation(program_id, ("diffuse_texture_" + std::to_string(diffuse_no++)).c_str()), index);
-			}
+	const std::list<texture>& get_textures()const noexcept
+	{
+		return this->textures_;
+	}
 
-			if (ref_texture.type_ == texture_type::specular_type)
+	// the first diffuse texture, 0 when there is none.
+	GLuint get_diffuse_texture()const noexcept
+	{
+		for (const texture& the_texture : this->textures_)
+		{
+			if (the_texture.type_ == texture_type::diffuse_type)
 			{
-				glUniform1i(glGetUniformLocation(program_id, ("specular_texture_" + std::to_string(specular_no++)).c_str()), index);
+				return static_cast<GLuint>(the_texture.id_);
 			}
+		}
 
-			if (ref_texture.type_ == texture_type::height_type)
-			{
-				glUniform1i(glGetUniformLocation(program_id, ("height_texture_" + std::to_string(height_no++)).c_str()), index);
+		return 0;
+	}
 
-			}
+	void set_material(GLuint material)noexcept
+	{
+		this->material_ = material;
+	}
 
-			glActiveTexture(GL_TEXTURE0 + index);
-			glBindTexture(GL_TEXTURE_2D, ref_texture.id_);
+	GLuint get_material()const noexcept
+	{
+		return this->material_;
+	}
 
-			++texture_itr_beg;
-		}
+	// every mesh of a layout shares the arena's VAO/VBO/EBO.
+	GLuint get_VAO()const
+	{
+		return mesh::get_arena(this->layout_).get_VAO();
+	}
 
-		// draw mesh
-		glBindVertexArray(VAO_);
-		glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT, 0);
+	GLuint get_VBO()const
+	{
+		return mesh::get_arena(this->layout_).get_VBO();
+	}
 
-		// always good practice to set everything back to defaults once configured.
-		glBindVertexArray(0);
-		glActiveTexture(GL_TEXTURE0);
+	GLuint get_EBO()const
+	{
+		return mesh::get_arena(this->layout_).get_EBO();
+	}
 
+	vertex_layout get_layout()const noexcept
+	{
+		return this->layout_;
 	}
 
-	void bind_VAO_VBO_EBO()
+	const vertex_decode& get_decode()const noexcept
 	{
-		glGenVertexArrays(1, &(VAO_));
-		glGenBuffers(1, &VBO_);
-		glGenBuffers(1, &EBO_);
+		return this->decode_;
+	}
 
-		glBindVertexArray(VAO_);
+	// differences to the loaded vertices, all 0 in vertex_layout::full.
+	const vertex_precision& get_precision()const noexcept
+	{
+		return this->precision_;
+	}
+
+	// bytes of one vertex in the arena.
+	std::size_t get_vertex_size()const noexcept
+	{
+		return this->layout_ == vertex_layout::packed ? sizeof(packed_vertex) : sizeof(vertex);
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-		glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(vertex), &vertices_[0], GL_STATIC_DRAW);
+	// GL_UNSIGNED_SHORT up to 65536 vertices, GL_UNSIGNED_INT above, valid after bind_VAO_VBO_EBO().
+	GLenum get_index_type()const noexcept
+	{
+		return this->range_.index_type_;
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(GLuint), &indices_[0], GL_STATIC_DRAW);
+	// bytes of every level's indices in the arena.
+	std::size_t get_index_bytes()const noexcept
+	{
+		return this->indices_count_ * this->range_.get_index_size();
+	}
+
+	const geometry_range& get_range()const noexcept
+	{
+		return this->range_;
+	}
 
+	const bounding_sphere& get_bounds()const noexcept
+	{
+		return this->bounds_;
+	}
+
+	const bounding_box& get_box()const noexcept
+	{
+		return this->box_;
+	}
+
+	// one VBO/EBO pair for every mesh of a vertex layout.
+	static geometry_arena& get_arena(vertex_layout layout = vertex_layout::full)
+	{
+		static geometry_arena arena{ sizeof(vertex), &mesh::setup_vertex_attributes, 1 << 16, 1 << 20 };
+		static geometry_arena packed_arena{ sizeof(packed_vertex), &mesh::setup_packed_vertex_attributes, 1 << 16, 1 << 20 };
+		return layout == vertex_layout::packed ? packed_arena : arena;
+	}
+
+	static void setup_vertex_attributes()
+	{
 		std::size_t offset{ 0 };
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), reinterpret_cast<void*>(offset));
@@ -186,9 +342,119 @@ public:
 		//offset = offsetof(vertex, bitangent_);
 		//glEnableVertexAttribArray(4);
 		//glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), reinterpret_cast<void*>(offset));
+	}
+
+	// same locations as setup_vertex_attributes(), glsl/vertex_decode.glsl turns them back into model space.
+	static void setup_packed_vertex_attributes()
+	{
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(packed_vertex), reinterpret_cast<void*>(offsetof(packed_vertex, position_)));
+
+		// normal in xy, tangent in zw.
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_SHORT, GL_TRUE, sizeof(packed_vertex), reinterpret_cast<void*>(offsetof(packed_vertex, normal_)));
+
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(packed_vertex), reinterpret_cast<void*>(offsetof(packed_vertex, texcoord_)));
+	}
+
+	// expects get_VAO() to be bound already, so a whole model of one layout draws without switching VAOs.
+	// program must be in use, samplers must come from material_samplers::reflect(program).
+	void bind_texture(shader_program& program, const material_samplers& samplers, std::size_t level = 0)
+	{
+		std::size_t number_of_textures{ this->textures_.size() };
+		auto texture_itr_beg{ this->textures_.cbegin() };
+
+		// next free number of every texture_type.
+		std::size_t texture_no[4]{};
+
+		for (std::size_t index = 0; index < number_of_textures; ++index)
+		{
+			const texture& ref_texture = *texture_itr_beg;
 
-		//notice here:
-		glBindVertexArray(0);
+			std::size_t type{ static_cast<std::size_t>(ref_texture.type_) };
+			if (texture_no[type] < MAX_TEXTURES_PER_TYPE)
+			{
+				program.set(samplers.handles_[type][texture_no[type]++], static_cast<int>(index));
+			}
+
+			glActiveTexture(GL_TEXTURE0 + index);
+			glBindTexture(GL_TEXTURE_2D, ref_texture.id_);
+			++render_stats::current().texture_binds_;
+
+			++texture_itr_beg;
+		}
+
+		this->draw_level(level);
+
+		// always good practice to set everything back to defaults once configured.
+		glActiveTexture(GL_TEXTURE0);
+
+	}
+
+	// preferred is vertex_layout::full or packed, packed falls back to full when the texture coordinates do not fit.
+	void bind_VAO_VBO_EBO(vertex_layout preferred = vertex_layout::full)
+	{
+		this->layout_ = vertex_layout::full;
+		this->decode_ = vertex_decode{};
+		this->precision_ = vertex_precision{};
+
+		std::vector<packed_vertex> packed{};
+		if (preferred == vertex_layout::packed && vertices_data_)
+		{
+			vertex_decode decode{};
+			packed = vertex_packer::pack(vertices_data_, vertices_count_, decode);
+
+			vertex_precision precision{ vertex_packer::measure(vertices_data_, packed.data(), vertices_count_, decode) };
+			if (precision.texcoord_error_ <= VERTEX_TEXCOORD_TOLERANCE)
+			{
+				this->layout_ = vertex_layout::packed;
+				this->decode_ = decode;
+				this->precision_ = precision;
+			}
+		}
+
+		if (this->layout_ == vertex_layout::packed)
+		{
+			this->range_ = mesh::get_arena(vertex_layout::packed).allocate(packed.data(), packed.size(), indices_data_, indices_count_,
+				index_type_for(vertices_count_));
+		}
+		else
+		{
+			this->range_ = mesh::get_arena().allocate(vertices_data_, vertices_count_, indices_data_, indices_count_, index_type_for(vertices_count_));
+		}
+
+		this->bounds_ = bounding_sphere::from_points(vertices_data_ ? &vertices_data_->position_ : nullptr, vertices_count_, sizeof(vertex));
+		this->box_ = bounding_box::from_points(vertices_data_ ? &vertices_data_->position_ : nullptr, vertices_count_, sizeof(vertex));
+
+		if (this->lods_.empty())
+		{
+			this->lods_.push_back(mesh_lod{ 0, static_cast<GLsizei>(indices_count_), 0.0f });
+		}
+
+		// the arena holds every level, get_range() is level 0 alone.
+		this->range_.index_count_ = this->lods_.front().index_count_;
+
+		// external memory is not guaranteed to outlive the upload.
+		if (this->vertices_.empty())
+		{
+			this->vertices_data_ = nullptr;
+		}
+
+		if (this->indices_.empty())
+		{
+			this->indices_data_ = nullptr;
+		}
+	}
+
+private:
+	void draw_level(std::size_t level)
+	{
+		this->decode_.apply();
+		geometry_range range{ this->get_lod_range(level) };
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.index_count_, range.index_type_, range.get_index_offset(), range.base_vertex_);
+		++render_stats::current().draw_calls_;
+		render_stats::current().triangles_ += range.index_count_ / 3;
 	}
 };
 
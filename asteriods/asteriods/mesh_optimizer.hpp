@@ -0,0 +1,464 @@
+#ifndef __MESH_OPTIMIZER_HPP__
+#define __MESH_OPTIMIZER_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+// entries of the post transform cache the orderings aim at, and of the FIFO the statistics simulate.
+static constexpr const std::size_t VERTEX_CACHE_SIZE{ 16 };
+
+
+// how an index list uses a FIFO post transform cache of VERTEX_CACHE_SIZE entries.
+struct vertex_cache_stats
+{
+	std::size_t triangles_{};
+	std::size_t vertices_{};
+	std::size_t misses_{};
+
+	// average cache miss ratio: vertex shader runs per triangle, 0.5 at best, 3 without any reuse.
+	double acmr()const noexcept
+	{
+		return this->triangles_ == 0 ? 0.0 : static_cast<double>(this->misses_) / this->triangles_;
+	}
+
+	// average transformed vertex ratio: vertex shader runs per vertex, 1 at best.
+	double atvr()const noexcept
+	{
+		return this->vertices_ == 0 ? 0.0 : static_cast<double>(this->misses_) / this->vertices_;
+	}
+
+	void add(const vertex_cache_stats& other)noexcept
+	{
+		this->triangles_ += other.triangles_;
+		this->vertices_ += other.vertices_;
+		this->misses_ += other.misses_;
+	}
+};
+
+
+// one piece of a mesh cut by mesh_optimizer::split().
+struct mesh_part
+{
+	std::vector<vertex> vertices_;
+	std::vector<GLuint> indices_;
+};
+
+
+// reorders a mesh for the GPU, meant to run once at import:
+//  weld()                   merges vertices with equal position, normal and texture coordinate.
+//  split()                  cuts a mesh too large for 16 bit indices into parts which fit.
+//  optimize_vertex_cache()  Tipsify(Sander, Nehab, Barczak 2007): fans around the vertex most likely still cached.
+//  optimize_overdraw()      the clusters Tipsify leaves behind, outward facing ones first, so they hide the rest.
+//  optimize_vertex_fetch()  vertices in the order the indices first use them, unused ones dropped.
+class mesh_optimizer final
+{
+private:
+	static constexpr const GLuint NO_VERTEX{ 0xffffffffu };
+
+public:
+	// parts of at most max_vertices vertices, vertices on a cut are copied into every part using them.
+	// triangles are taken in Tipsify order, so each part is a compact patch rather than a scattered strip of triangles.
+	static std::vector<mesh_part> split(std::vector<vertex>&& vertices, std::vector<GLuint>&& indices,
+		std::size_t max_vertices = SHORT_INDEX_VERTEX_LIMIT)
+	{
+		std::vector<mesh_part> parts{};
+		if (vertices.size() <= max_vertices)
+		{
+			parts.push_back(mesh_part{ std::move(vertices), std::move(indices) });
+			return parts;
+		}
+
+		std::vector<std::size_t> cluster_starts{};
+		mesh_optimizer::optimize_vertex_cache(indices.data(), indices.size(), vertices.size(), cluster_starts);
+
+		// remap of the current part, reset through touched when the next one starts.
+		std::vector<GLuint> remap(vertices.size(), NO_VERTEX);
+		std::vector<GLuint> touched{};
+		parts.push_back(mesh_part{});
+		for (std::size_t corner = 0; corner + 2 < indices.size(); corner += 3)
+		{
+			const GLuint* triangle{ indices.data() + corner };
+			std::size_t new_vertices{ 0 };
+			for (std::size_t index = 0; index < 3; ++index)
+			{
+				bool repeated{ (index > 0 && triangle[index] == triangle[0]) || (index > 1 && triangle[index] == triangle[1]) };
+				new_vertices += remap[triangle[index]] == NO_VERTEX && !repeated ? 1 : 0;
+			}
+
+			if (parts.back().vertices_.size() + new_vertices > max_vertices)
+			{
+				for (GLuint vertex_index : touched)
+				{
+					remap[vertex_index] = NO_VERTEX;
+				}
+				touched.clear();
+				parts.push_back(mesh_part{});
+			}
+
+			mesh_part& part{ parts.back() };
+			for (std::size_t index = 0; index < 3; ++index)
+			{
+				GLuint vertex_index{ triangle[index] };
+				if (remap[vertex_index] == NO_VERTEX)
+				{
+					remap[vertex_index] = static_cast<GLuint>(part.vertices_.size());
+					part.vertices_.push_back(vertices[vertex_index]);
+					touched.push_back(vertex_index);
+				}
+
+				part.indices_.push_back(remap[vertex_index]);
+			}
+		}
+
+		return parts;
+	}
+
+	static vertex_cache_stats analyze(const GLuint* indices, std::size_t index_count, std::size_t vertex_count)
+	{
+		vertex_cache_stats stats{};
+		stats.triangles_ = index_count / 3;
+		stats.vertices_ = vertex_count;
+
+		// position in the FIFO is the number of misses since the vertex went in.
+		std::vector<std::size_t> inserted_at(vertex_count, 0);
+		for (std::size_t index = 0; index < index_count; ++index)
+		{
+			std::size_t& time{ inserted_at[indices[index]] };
+			if (time == 0 || stats.misses_ + 1 - time > VERTEX_CACHE_SIZE)
+			{
+				++stats.misses_;
+				time = stats.misses_;
+			}
+		}
+
+		return stats;
+	}
+
+	// Assimp imports OBJ faces with their own copies of every corner, so nothing is shared until this runs.
+	// tangent and bitangent are per face then, the merged vertex gets their normalized sum.
+	static void weld(std::vector<vertex>& vertices, std::vector<GLuint>& indices)
+	{
+		auto key_less = [&vertices](GLuint left, GLuint right)
+		{
+			return std::memcmp(&vertices[left], &vertices[right], offsetof(vertex, tangent_)) < 0;
+		};
+
+		std::vector<GLuint> order(vertices.size());
+		for (std::size_t index = 0; index < order.size(); ++index)
+		{
+			order[index] = static_cast<GLuint>(index);
+		}
+		std::sort(order.begin(), order.end(), key_less);
+
+		std::vector<GLuint> remap(vertices.size());
+		std::vector<vertex> welded{};
+		welded.reserve(vertices.size());
+		for (std::size_t index = 0; index < order.size(); ++index)
+		{
+			if (index == 0 || key_less(order[index - 1], order[index]))
+			{
+				welded.push_back(vertices[order[index]]);
+			}
+			else
+			{
+				welded.back().tangent_ += vertices[order[index]].tangent_;
+				welded.back().bitangent_ += vertices[order[index]].bitangent_;
+			}
+
+			remap[order[index]] = static_cast<GLuint>(welded.size() - 1);
+		}
+
+		for (vertex& welded_vertex : welded)
+		{
+			welded_vertex.tangent_ = mesh_optimizer::normalized(welded_vertex.tangent_);
+			welded_vertex.bitangent_ = mesh_optimizer::normalized(welded_vertex.bitangent_);
+		}
+
+		// a triangle whose corners merged has no area left.
+		std::size_t write{ 0 };
+		for (std::size_t index = 0; index + 2 < indices.size(); index += 3)
+		{
+			GLuint corner_0{ remap[indices[index]] };
+			GLuint corner_1{ remap[indices[index + 1]] };
+			GLuint corner_2{ remap[indices[index + 2]] };
+			if (corner_0 == corner_1 || corner_1 == corner_2 || corner_2 == corner_0)
+			{
+				continue;
+			}
+
+			indices[write++] = corner_0;
+			indices[write++] = corner_1;
+			indices[write++] = corner_2;
+		}
+
+		indices.resize(write);
+		vertices.swap(welded);
+	}
+
+	// every level of detail gets its own cache and overdraw order, then the vertices follow level 0.
+	static void optimize(std::vector<vertex>& vertices, std::vector<GLuint>& indices, const std::vector<mesh_lod>& lods)
+	{
+		for (std::size_t level = 0; level < lods.size(); ++level)
+		{
+			// repeated levels share their indices with the one before.
+			if (level > 0 && lods[level].first_index_ == lods[level - 1].first_index_)
+			{
+				continue;
+			}
+
+			GLuint* level_indices{ indices.data() + lods[level].first_index_ };
+			std::size_t index_count{ static_cast<std::size_t>(lods[level].index_count_) };
+
+			std::vector<std::size_t> cluster_starts{};
+			mesh_optimizer::optimize_vertex_cache(level_indices, index_count, vertices.size(), cluster_starts);
+			mesh_optimizer::optimize_overdraw(vertices.data(), level_indices, index_count, cluster_starts);
+		}
+
+		mesh_optimizer::optimize_vertex_fetch(vertices, indices);
+	}
+
+	// reorders the triangles in place. cluster_starts gets the first index of every run that starts
+	// from a vertex Tipsify did not find in the cache, the boundaries optimize_overdraw() may reorder at.
+	static void optimize_vertex_cache(GLuint* indices, std::size_t index_count, std::size_t vertex_count, std::vector<std::size_t>& cluster_starts)
+	{
+		std::size_t triangle_count{ index_count / 3 };
+		cluster_starts.clear();
+		if (triangle_count == 0)
+		{
+			return;
+		}
+
+		// triangles around every vertex, live_triangles counts the ones not emitted yet.
+		std::vector<GLuint> first_triangle(vertex_count + 1, 0);
+		for (std::size_t index = 0; index < triangle_count * 3; ++index)
+		{
+			++first_triangle[indices[index] + 1];
+		}
+		for (std::size_t vertex_index = 1; vertex_index <= vertex_count; ++vertex_index)
+		{
+			first_triangle[vertex_index] += first_triangle[vertex_index - 1];
+		}
+
+		std::vector<GLuint> vertex_triangles(triangle_count * 3);
+		std::vector<GLuint> live_triangles(vertex_count, 0);
+		for (std::size_t triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			for (std::size_t corner = 0; corner < 3; ++corner)
+			{
+				GLuint vertex_index{ indices[triangle * 3 + corner] };
+				vertex_triangles[first_triangle[vertex_index] + live_triangles[vertex_index]++] = static_cast<GLuint>(triangle);
+			}
+		}
+
+		std::vector<std::size_t> cache_time(vertex_count, 0);
+		std::vector<bool> emitted(triangle_count, false);
+		std::vector<GLuint> dead_ends{};
+		std::vector<GLuint> candidates{};
+		std::vector<GLuint> output{};
+		output.reserve(triangle_count * 3);
+
+		std::size_t time{ VERTEX_CACHE_SIZE + 1 };
+		std::size_t cursor{ 0 };
+		GLuint fan{ indices[0] };
+		cluster_starts.push_back(0);
+
+		while (fan != NO_VERTEX)
+		{
+			candidates.clear();
+			for (GLuint index = first_triangle[fan]; index < first_triangle[fan + 1]; ++index)
+			{
+				GLuint triangle{ vertex_triangles[index] };
+				if (emitted[triangle])
+				{
+					continue;
+				}
+
+				for (std::size_t corner = 0; corner < 3; ++corner)
+				{
+					GLuint vertex_index{ indices[triangle * 3 + corner] };
+					output.push_back(vertex_index);
+					dead_ends.push_back(vertex_index);
+					candidates.push_back(vertex_index);
+					--live_triangles[vertex_index];
+					if (time - cache_time[vertex_index] > VERTEX_CACHE_SIZE)
+					{
+						cache_time[vertex_index] = time++;
+					}
+				}
+
+				emitted[triangle] = true;
+			}
+
+			// the candidate that stays cached through its remaining fan and entered the cache earliest.
+			GLuint next{ NO_VERTEX };
+			std::size_t best_priority{ 0 };
+			for (GLuint candidate : candidates)
+			{
+				if (live_triangles[candidate] == 0)
+				{
+					continue;
+				}
+
+				std::size_t age{ time - cache_time[candidate] };
+				std::size_t priority{ age + 2 * live_triangles[candidate] <= VERTEX_CACHE_SIZE ? age : 0 };
+				if (next == NO_VERTEX || priority > best_priority)
+				{
+					next = candidate;
+					best_priority = priority;
+				}
+			}
+
+			// nothing left around the fan, the next run starts from a vertex that is probably out of the cache.
+			if (next == NO_VERTEX)
+			{
+				next = mesh_optimizer::skip_dead_end(dead_ends, live_triangles, indices, triangle_count, cursor);
+				if (next != NO_VERTEX)
+				{
+					cluster_starts.push_back(output.size());
+				}
+			}
+
+			fan = next;
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	// sorts the clusters by how far they face away from the mesh's center: on a mostly convex mesh those are
+	// the ones in front, so the depth test rejects more of what comes after them.
+	static void optimize_overdraw(const vertex* vertices, GLuint* indices, std::size_t index_count, const std::vector<std::size_t>& cluster_starts)
+	{
+		if (cluster_starts.size() < 2)
+		{
+			return;
+		}
+
+		std::vector<std::size_t> bounds{ cluster_starts };
+		bounds.push_back(index_count - index_count % 3);
+
+		glm::vec3 mesh_center{ 0.0f };
+		float mesh_area{ 0.0f };
+		std::vector<glm::vec3> cluster_centers(cluster_starts.size(), glm::vec3{ 0.0f });
+		std::vector<glm::vec3> cluster_normals(cluster_starts.size(), glm::vec3{ 0.0f });
+		std::vector<float> cluster_areas(cluster_starts.size(), 0.0f);
+		for (std::size_t cluster = 0; cluster < cluster_starts.size(); ++cluster)
+		{
+			for (std::size_t index = bounds[cluster]; index < bounds[cluster + 1]; index += 3)
+			{
+				const glm::vec3& point_0{ vertices[indices[index]].position_ };
+				const glm::vec3& point_1{ vertices[indices[index + 1]].position_ };
+				const glm::vec3& point_2{ vertices[indices[index + 2]].position_ };
+
+				glm::vec3 normal{ glm::cross(point_1 - point_0, point_2 - point_0) };
+				float area{ glm::length(normal) };
+
+				cluster_centers[cluster] += (point_0 + point_1 + point_2) * (area / 3.0f);
+				cluster_normals[cluster] += normal;
+				cluster_areas[cluster] += area;
+			}
+
+			mesh_center += cluster_centers[cluster];
+			mesh_area += cluster_areas[cluster];
+		}
+
+		if (mesh_area <= 0.0f)
+		{
+			return;
+		}
+
+		mesh_center /= mesh_area;
+
+		std::vector<float> facing(cluster_starts.size(), 0.0f);
+		for (std::size_t cluster = 0; cluster < cluster_starts.size(); ++cluster)
+		{
+			if (cluster_areas[cluster] > 0.0f)
+			{
+				glm::vec3 center{ cluster_centers[cluster] / cluster_areas[cluster] };
+				facing[cluster] = glm::dot(center - mesh_center, mesh_optimizer::normalized(cluster_normals[cluster]));
+			}
+		}
+
+		std::vector<std::size_t> order(cluster_starts.size());
+		for (std::size_t cluster = 0; cluster < order.size(); ++cluster)
+		{
+			order[cluster] = cluster;
+		}
+		std::stable_sort(order.begin(), order.end(), [&facing](std::size_t left, std::size_t right)
+		{
+			return facing[left] > facing[right];
+		});
+
+		std::vector<GLuint> sorted{};
+		sorted.reserve(bounds.back());
+		for (std::size_t cluster : order)
+		{
+			sorted.insert(sorted.end(), indices + bounds[cluster], indices + bounds[cluster + 1]);
+		}
+
+		std::copy(sorted.begin(), sorted.end(), indices);
+	}
+
+	static void optimize_vertex_fetch(std::vector<vertex>& vertices, std::vector<GLuint>& indices)
+	{
+		std::vector<GLuint> remap(vertices.size(), NO_VERTEX);
+		std::vector<vertex> ordered{};
+		ordered.reserve(vertices.size());
+
+		for (GLuint& index : indices)
+		{
+			if (remap[index] == NO_VERTEX)
+			{
+				remap[index] = static_cast<GLuint>(ordered.size());
+				ordered.push_back(vertices[index]);
+			}
+
+			index = remap[index];
+		}
+
+		vertices.swap(ordered);
+	}
+
+private:
+	static glm::vec3 normalized(const glm::vec3& value)
+	{
+		float length{ glm::length(value) };
+		return length > 0.0f ? value / length : value;
+	}
+
+	// the most recently emitted vertex with triangles left, or else the next one in input order.
+	static GLuint skip_dead_end(std::vector<GLuint>& dead_ends, const std::vector<GLuint>& live_triangles,
+		const GLuint* indices, std::size_t triangle_count, std::size_t& cursor)
+	{
+		while (!dead_ends.empty())
+		{
+			GLuint vertex_index{ dead_ends.back() };
+			dead_ends.pop_back();
+			if (live_triangles[vertex_index] > 0)
+			{
+				return vertex_index;
+			}
+		}
+
+		for (; cursor < triangle_count * 3; ++cursor)
+		{
+			if (live_triangles[indices[cursor]] > 0)
+			{
+				return indices[cursor];
+			}
+		}
+
+		return NO_VERTEX;
+	}
+};
+
+
+#endif // !__MESH_OPTIMIZER_HPP__
@@ -0,0 +1,550 @@
+#ifndef __MESH_SIMPLIFIER_HPP__
+#define __MESH_SIMPLIFIER_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+
+// Garland-Heckbert edge collapse on an index list, the vertices are never touched: every collapse moves one
+// vertex onto a neighbour, so all levels of detail index the same vertex buffer.
+//  - vertices sharing a position(uv or normal seams) are locked, so seams never tear. build_lod_chain() first points
+//    the indices of identical vertices at one of them, so only real seams are.
+//  - open borders only collapse along themselves, and carry extra quadrics so the outline stays in place.
+//  - collapses that would turn a triangle over are rejected.
+// simplify_to() continues from where the last call stopped, so a chain of levels is one run.
+class mesh_simplifier final
+{
+private:
+	// sum of squared distances to a set of weighted planes.
+	struct quadric
+	{
+		double a2_{}, b2_{}, c2_{}, ab_{}, ac_{}, bc_{}, ad_{}, bd_{}, cd_{}, d2_{};
+		double weight_{};
+
+		static quadric from_plane(double a, double b, double c, double d, double weight)
+		{
+			quadric result{};
+			result.a2_ = a * a * weight;
+			result.b2_ = b * b * weight;
+			result.c2_ = c * c * weight;
+			result.ab_ = a * b * weight;
+			result.ac_ = a * c * weight;
+			result.bc_ = b * c * weight;
+			result.ad_ = a * d * weight;
+			result.bd_ = b * d * weight;
+			result.cd_ = c * d * weight;
+			result.d2_ = d * d * weight;
+			result.weight_ = weight;
+			return result;
+		}
+
+		void add(const quadric& other)
+		{
+			this->a2_ += other.a2_; this->b2_ += other.b2_; this->c2_ += other.c2_;
+			this->ab_ += other.ab_; this->ac_ += other.ac_; this->bc_ += other.bc_;
+			this->ad_ += other.ad_; this->bd_ += other.bd_; this->cd_ += other.cd_;
+			this->d2_ += other.d2_;
+			this->weight_ += other.weight_;
+		}
+
+		// squared distance averaged over the weights, so its square root is in model units.
+		double evaluate(const glm::vec3& point)const
+		{
+			double x{ point.x }, y{ point.y }, z{ point.z };
+			double error{ this->a2_ * x * x + this->b2_ * y * y + this->c2_ * z * z
+				+ 2.0 * (this->ab_ * x * y + this->ac_ * x * z + this->bc_ * y * z)
+				+ 2.0 * (this->ad_ * x + this->bd_ * y + this->cd_ * z) + this->d2_ };
+
+			return std::max(0.0, this->weight_ > 0.0 ? error / this->weight_ : error);
+		}
+	};
+
+	enum class vertex_kind : unsigned char
+	{
+		manifold,
+		border,
+		locked
+	};
+
+	struct collapse
+	{
+		double cost_;
+		GLuint from_;
+		GLuint to_;
+
+		bool operator<(const collapse& other)const noexcept
+		{
+			return this->cost_ < other.cost_;
+		}
+	};
+
+	// borders weigh more than faces, a moved outline shows more than a flattened bump.
+	static constexpr const double BORDER_WEIGHT{ 10.0 };
+	// a collapse may turn a triangle's normal by up to about 75 degrees.
+	static constexpr const float MAX_NORMAL_TURN{ 0.25f };
+
+	const vertex* vertices_{ nullptr };
+	std::size_t vertex_count_{};
+	std::vector<GLuint> indices_{};
+
+	// first vertex with the same position, quadrics and kinds live there.
+	std::vector<GLuint> position_of_{};
+	std::vector<vertex_kind> kinds_{};
+	std::vector<quadric> quadrics_{};
+	// canonical edges(from << 32 | to) with only one direction present, sorted.
+	std::vector<std::uint64_t> border_edges_{};
+
+	double max_error_{};
+
+public:
+	// indices is a triangle list into vertex_count vertices, the vertices must outlive the simplifier.
+	mesh_simplifier(const vertex* vertices, std::size_t vertex_count, const GLuint* indices, std::size_t index_count)
+		: vertices_{ vertices },
+		vertex_count_{ vertex_count },
+		indices_(indices, indices + index_count - index_count % 3)
+	{
+		this->merge_positions();
+		this->classify_vertices();
+		this->accumulate_quadrics();
+	}
+
+	mesh_simplifier(const mesh_simplifier&) = delete;
+	mesh_simplifier& operator=(const mesh_simplifier&) = delete;
+
+	const std::vector<GLuint>& get_indices()const noexcept
+	{
+		return this->indices_;
+	}
+
+	// largest collapse cost so far, in model units.
+	float get_error()const noexcept
+	{
+		return static_cast<float>(std::sqrt(this->max_error_));
+	}
+
+	// collapses the cheapest edges until at most target_index_count indices are left.
+	// false when it got stuck above the target, every edge left is locked or would fold the surface.
+	bool simplify_to(std::size_t target_index_count)
+	{
+		while (this->indices_.size() > target_index_count)
+		{
+			if (!this->collapse_pass((this->indices_.size() - target_index_count + 2) / 3))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// level 0 is indices as they are, every further level aims at half the triangles of the one before.
+	// the coarser index lists are appended to indices, lods gets MESH_LOD_COUNT entries. when the
+	// simplifier gets stuck, the remaining levels repeat the last one instead of storing it again.
+	static void build_lod_chain(const std::vector<vertex>& vertices, std::vector<GLuint>& indices, std::vector<mesh_lod>& lods)
+	{
+		mesh_simplifier::share_identical_vertices(vertices, indices);
+
+		lods.clear();
+		lods.push_back(mesh_lod{ 0, static_cast<GLsizei>(indices.size()), 0.0f });
+
+		mesh_simplifier simplifier{ vertices.data(), vertices.size(), indices.data(), indices.size() };
+		std::size_t target_index_count{ indices.size() };
+		// once stuck, further calls would only repeat the failed round.
+		bool stuck{ false };
+		for (std::size_t level = 1; level < MESH_LOD_COUNT; ++level)
+		{
+			target_index_count = target_index_count / 6 * 3;
+			stuck = stuck || !simplifier.simplify_to(target_index_count);
+
+			const std::vector<GLuint>& level_indices{ simplifier.get_indices() };
+			if (level_indices.empty() || static_cast<GLsizei>(level_indices.size()) == lods.back().index_count_)
+			{
+				lods.push_back(lods.back());
+				continue;
+			}
+
+			lods.push_back(mesh_lod{ static_cast<GLuint>(indices.size()), static_cast<GLsizei>(level_indices.size()), simplifier.get_error() });
+			indices.insert(indices.end(), level_indices.begin(), level_indices.end());
+		}
+	}
+
+	// vertices equal in position, normal and texture coordinate become one to the index list, the first of them.
+	// an importer that gives every face corner its own vertex(Assimp without aiProcess_JoinIdenticalVertices) would
+	// otherwise have every position shared, so locked, and nothing would ever collapse. the vertices are left as they are.
+	static void share_identical_vertices(const std::vector<vertex>& vertices, std::vector<GLuint>& indices)
+	{
+		std::vector<GLuint> order(vertices.size());
+		for (std::size_t index = 0; index < order.size(); ++index)
+		{
+			order[index] = static_cast<GLuint>(index);
+		}
+
+		auto attribute_tuple = [&vertices](GLuint vertex_index)
+		{
+			const vertex& the_vertex{ vertices[vertex_index] };
+			return std::make_tuple(the_vertex.position_.x, the_vertex.position_.y, the_vertex.position_.z,
+				the_vertex.normal_.x, the_vertex.normal_.y, the_vertex.normal_.z, the_vertex.texcoord_.x, the_vertex.texcoord_.y);
+		};
+
+		std::sort(order.begin(), order.end(), [&attribute_tuple](GLuint left, GLuint right)
+		{
+			return attribute_tuple(left) < attribute_tuple(right) || (attribute_tuple(left) == attribute_tuple(right) && left < right);
+		});
+
+		std::vector<GLuint> remap(vertices.size());
+		for (std::size_t index = 0; index < order.size(); ++index)
+		{
+			bool same{ index != 0 && attribute_tuple(order[index]) == attribute_tuple(order[index - 1]) };
+			remap[order[index]] = same ? remap[order[index - 1]] : order[index];
+		}
+
+		for (GLuint& vertex_index : indices)
+		{
+			vertex_index = remap[vertex_index];
+		}
+	}
+
+private:
+	const glm::vec3& position(GLuint vertex_index)const
+	{
+		return this->vertices_[vertex_index].position_;
+	}
+
+	static std::uint64_t edge_key(GLuint from, GLuint to)noexcept
+	{
+		return static_cast<std::uint64_t>(from) << 32 | to;
+	}
+
+	bool is_border_edge(GLuint from, GLuint to)const
+	{
+		GLuint from_position{ this->position_of_[from] };
+		GLuint to_position{ this->position_of_[to] };
+		return std::binary_search(this->border_edges_.begin(), this->border_edges_.end(), mesh_simplifier::edge_key(from_position, to_position)) ||
+			std::binary_search(this->border_edges_.begin(), this->border_edges_.end(), mesh_simplifier::edge_key(to_position, from_position));
+	}
+
+	// sorting by position puts every group of coincident vertices next to each other. only vertices the indices use
+	// count, one left unreferenced by share_identical_vertices() is no seam.
+	void merge_positions()
+	{
+		std::vector<bool> referenced(this->vertex_count_, false);
+		for (GLuint vertex_index : this->indices_)
+		{
+			referenced[vertex_index] = true;
+		}
+
+		std::vector<GLuint> order{};
+		order.reserve(this->vertex_count_);
+		for (std::size_t index = 0; index < this->vertex_count_; ++index)
+		{
+			if (referenced[index])
+			{
+				order.push_back(static_cast<GLuint>(index));
+			}
+		}
+
+		auto position_tuple = [this](GLuint vertex_index)
+		{
+			const glm::vec3& point{ this->position(vertex_index) };
+			return std::make_tuple(point.x, point.y, point.z);
+		};
+
+		std::sort(order.begin(), order.end(), [&position_tuple](GLuint left, GLuint right)
+		{
+			return position_tuple(left) < position_tuple(right);
+		});
+
+		this->position_of_.resize(this->vertex_count_);
+		this->kinds_.assign(this->vertex_count_, vertex_kind::manifold);
+		for (std::size_t begin = 0, end = 0; begin < order.size(); begin = end)
+		{
+			GLuint first{ order[begin] };
+			for (end = begin; end < order.size() && position_tuple(order[end]) == position_tuple(order[begin]); ++end)
+			{
+				first = std::min(first, order[end]);
+			}
+
+			for (std::size_t index = begin; index < end; ++index)
+			{
+				this->position_of_[order[index]] = first;
+			}
+
+			if (end - begin > 1)
+			{
+				this->kinds_[first] = vertex_kind::locked;
+			}
+		}
+	}
+
+	void classify_vertices()
+	{
+		std::vector<std::uint64_t> edges{};
+		edges.reserve(this->indices_.size());
+		for (std::size_t index = 0; index < this->indices_.size(); index += 3)
+		{
+			for (std::size_t corner = 0; corner < 3; ++corner)
+			{
+				edges.push_back(mesh_simplifier::edge_key(this->position_of_[this->indices_[index + corner]],
+					this->position_of_[this->indices_[index + (corner + 1) % 3]]));
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+		for (std::uint64_t edge : edges)
+		{
+			std::uint64_t opposite{ edge << 32 | edge >> 32 };
+			if (std::binary_search(edges.begin(), edges.end(), opposite))
+			{
+				continue;
+			}
+
+			this->border_edges_.push_back(edge);
+			for (GLuint end_point : { static_cast<GLuint>(edge >> 32), static_cast<GLuint>(edge & 0xffffffffu) })
+			{
+				if (this->kinds_[end_point] == vertex_kind::manifold)
+				{
+					this->kinds_[end_point] = vertex_kind::border;
+				}
+			}
+		}
+
+		// edges is sorted, so is every subsequence of it.
+		this->border_edges_.erase(std::unique(this->border_edges_.begin(), this->border_edges_.end()), this->border_edges_.end());
+	}
+
+	void accumulate_quadrics()
+	{
+		this->quadrics_.assign(this->vertex_count_, quadric{});
+		for (std::size_t index = 0; index < this->indices_.size(); index += 3)
+		{
+			const glm::vec3& point_0{ this->position(this->indices_[index]) };
+			const glm::vec3& point_1{ this->position(this->indices_[index + 1]) };
+			const glm::vec3& point_2{ this->position(this->indices_[index + 2]) };
+
+			glm::vec3 normal{ glm::cross(point_1 - point_0, point_2 - point_0) };
+			float double_area{ glm::length(normal) };
+			if (double_area <= 0.0f)
+			{
+				continue;
+			}
+
+			normal /= double_area;
+			quadric face{ quadric::from_plane(normal.x, normal.y, normal.z, -glm::dot(normal, point_0), double_area * 0.5) };
+			for (std::size_t corner = 0; corner < 3; ++corner)
+			{
+				this->quadrics_[this->position_of_[this->indices_[index + corner]]].add(face);
+			}
+
+			// a plane through each border edge, standing upright on the face.
+			for (std::size_t corner = 0; corner < 3; ++corner)
+			{
+				GLuint from{ this->indices_[index + corner] };
+				GLuint to{ this->indices_[index + (corner + 1) % 3] };
+				if (!this->is_border_edge(from, to))
+				{
+					continue;
+				}
+
+				glm::vec3 edge{ this->position(to) - this->position(from) };
+				glm::vec3 border_normal{ glm::cross(edge, normal) };
+				float border_length{ glm::length(border_normal) };
+				if (border_length <= 0.0f)
+				{
+					continue;
+				}
+
+				border_normal /= border_length;
+				quadric border{ quadric::from_plane(border_normal.x, border_normal.y, border_normal.z,
+					-glm::dot(border_normal, this->position(from)), glm::dot(edge, edge) * BORDER_WEIGHT) };
+				this->quadrics_[this->position_of_[from]].add(border);
+				this->quadrics_[this->position_of_[to]].add(border);
+			}
+		}
+	}
+
+	bool can_collapse(GLuint from, GLuint to)const
+	{
+		GLuint from_position{ this->position_of_[from] };
+		GLuint to_position{ this->position_of_[to] };
+		if (from == to || from_position == to_position)
+		{
+			return false;
+		}
+
+		switch (this->kinds_[from_position])
+		{
+		case vertex_kind::manifold:
+			return true;
+		case vertex_kind::border:
+			// sliding along the border keeps it, cutting across would open a hole.
+			return this->kinds_[to_position] != vertex_kind::manifold && this->is_border_edge(from, to);
+		default:
+			return false;
+		}
+	}
+
+	// one round over every edge by increasing cost. a collapse locks the positions around it for the rest of the
+	// round, so the fold test of the next one always sees current triangles. false when nothing collapsed.
+	bool collapse_pass(std::size_t triangles_to_remove)
+	{
+		std::size_t triangle_count{ this->indices_.size() / 3 };
+
+		// triangles around every vertex.
+		std::vector<GLuint> first_triangle(this->vertex_count_ + 1, 0);
+		for (GLuint vertex_index : this->indices_)
+		{
+			++first_triangle[vertex_index + 1];
+		}
+		for (std::size_t index = 1; index < first_triangle.size(); ++index)
+		{
+			first_triangle[index] += first_triangle[index - 1];
+		}
+
+		std::vector<GLuint> vertex_triangles(this->indices_.size());
+		std::vector<GLuint> fill{ first_triangle.begin(), first_triangle.end() - 1 };
+		for (std::size_t triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			for (std::size_t corner = 0; corner < 3; ++corner)
+			{
+				vertex_triangles[fill[this->indices_[triangle * 3 + corner]]++] = static_cast<GLuint>(triangle);
+			}
+		}
+
+		std::vector<collapse> collapses{};
+		collapses.reserve(this->indices_.size() * 2);
+		for (std::size_t triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			for (std::size_t corner = 0; corner < 3; ++corner)
+			{
+				GLuint first{ this->indices_[triangle * 3 + corner] };
+				GLuint second{ this->indices_[triangle * 3 + (corner + 1) % 3] };
+				for (const std::pair<GLuint, GLuint>& edge : { std::make_pair(first, second), std::make_pair(second, first) })
+				{
+					if (!this->can_collapse(edge.first, edge.second))
+					{
+						continue;
+					}
+
+					quadric combined{ this->quadrics_[this->position_of_[edge.first]] };
+					combined.add(this->quadrics_[this->position_of_[edge.second]]);
+					collapses.push_back(collapse{ combined.evaluate(this->position(edge.second)), edge.first, edge.second });
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end());
+
+		std::vector<GLuint> target(this->vertex_count_);
+		for (std::size_t index = 0; index < target.size(); ++index)
+		{
+			target[index] = static_cast<GLuint>(index);
+		}
+
+		std::vector<bool> position_locked(this->vertex_count_, false);
+		std::size_t removed{ 0 };
+		for (const collapse& candidate : collapses)
+		{
+			if (removed >= triangles_to_remove)
+			{
+				break;
+			}
+
+			GLuint from_position{ this->position_of_[candidate.from_] };
+			GLuint to_position{ this->position_of_[candidate.to_] };
+			if (position_locked[from_position] || position_locked[to_position])
+			{
+				continue;
+			}
+
+			std::size_t collapsed_triangles{ 0 };
+			if (this->folds(candidate, first_triangle, vertex_triangles, collapsed_triangles))
+			{
+				continue;
+			}
+
+			target[candidate.from_] = candidate.to_;
+			this->quadrics_[to_position].add(this->quadrics_[from_position]);
+			this->max_error_ = std::max(this->max_error_, candidate.cost_);
+			removed += collapsed_triangles;
+
+			for (GLuint index = first_triangle[candidate.from_]; index < first_triangle[candidate.from_ + 1]; ++index)
+			{
+				const GLuint* corners{ &this->indices_[vertex_triangles[index] * 3] };
+				for (std::size_t corner = 0; corner < 3; ++corner)
+				{
+					position_locked[this->position_of_[corners[corner]]] = true;
+				}
+			}
+		}
+
+		if (removed == 0)
+		{
+			return false;
+		}
+
+		// a locked vertex is never a target, so one lookup resolves every move of the round.
+		std::size_t write{ 0 };
+		for (std::size_t triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			GLuint corner_0{ target[this->indices_[triangle * 3]] };
+			GLuint corner_1{ target[this->indices_[triangle * 3 + 1]] };
+			GLuint corner_2{ target[this->indices_[triangle * 3 + 2]] };
+			if (corner_0 == corner_1 || corner_1 == corner_2 || corner_2 == corner_0)
+			{
+				continue;
+			}
+
+			this->indices_[write++] = corner_0;
+			this->indices_[write++] = corner_1;
+			this->indices_[write++] = corner_2;
+		}
+
+		this->indices_.resize(write);
+		return true;
+	}
+
+	// whether moving candidate.from_ onto candidate.to_ turns any surviving triangle over, and how many triangles it removes.
+	bool folds(const collapse& candidate, const std::vector<GLuint>& first_triangle, const std::vector<GLuint>& vertex_triangles,
+		std::size_t& collapsed_triangles)const
+	{
+		const glm::vec3& from_point{ this->position(candidate.from_) };
+		const glm::vec3& to_point{ this->position(candidate.to_) };
+
+		for (GLuint index = first_triangle[candidate.from_]; index < first_triangle[candidate.from_ + 1]; ++index)
+		{
+			const GLuint* corners{ &this->indices_[vertex_triangles[index] * 3] };
+			if (corners[0] == candidate.to_ || corners[1] == candidate.to_ || corners[2] == candidate.to_)
+			{
+				++collapsed_triangles;
+				continue;
+			}
+
+			std::size_t corner{ corners[0] == candidate.from_ ? 0u : (corners[1] == candidate.from_ ? 1u : 2u) };
+			const glm::vec3& next{ this->position(corners[(corner + 1) % 3]) };
+			const glm::vec3& previous{ this->position(corners[(corner + 2) % 3]) };
+
+			glm::vec3 old_normal{ glm::cross(next - from_point, previous - from_point) };
+			glm::vec3 new_normal{ glm::cross(next - to_point, previous - to_point) };
+			float old_length{ glm::length(old_normal) };
+			if (old_length > 0.0f && glm::dot(old_normal, new_normal) <= MAX_NORMAL_TURN * old_length * glm::length(new_normal))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+
+#endif // !__MESH_SIMPLIFIER_HPP__
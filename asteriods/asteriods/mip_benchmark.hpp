@@ -0,0 +1,116 @@
+#ifndef __MIP_BENCHMARK_HPP__
+#define __MIP_BENCHMARK_HPP__
+
+#include "mip_generator.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+
+// times mip_generator on every level the CPU runs, box and Kaiser with sRGB averaging, on a 2048x2048 rgba image,
+// in source MPixels/s. the wider levels are checked against the scalar chain, then alpha coverage is checked on a cutout.
+inline void run_mip_benchmark(std::ostream& out)
+{
+	static constexpr const int size{ 2048 };
+	static constexpr const std::size_t repeats{ 3 };
+
+	std::mt19937 generator{ 42 };
+	std::uniform_int_distribution<int> noise{ -24, 24 };
+	// one soft disc of alpha per 32x32 cell, placed and sized at random like leaves on a foliage card.
+	std::uniform_real_distribution<float> disc_center{ 8.0f, 24.0f };
+	std::uniform_real_distribution<float> disc_radius{ 6.0f, 14.0f };
+	std::vector<float> discs((size / 32) * (size / 32) * 3);
+	for (std::size_t disc = 0; disc < discs.size(); disc += 3)
+	{
+		discs[disc] = disc_center(generator);
+		discs[disc + 1] = disc_center(generator);
+		discs[disc + 2] = disc_radius(generator);
+	}
+
+	// smooth gradients under noise, so neither filter sees flat blocks.
+	std::vector<std::uint8_t> pixels(static_cast<std::size_t>(size) * size * 4);
+	for (int y = 0; y < size; ++y)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			std::uint8_t* texel{ &pixels[(static_cast<std::size_t>(y) * size + x) * 4] };
+			texel[0] = static_cast<std::uint8_t>(std::min(std::max(x / 8 + noise(generator), 0), 255));
+			texel[1] = static_cast<std::uint8_t>(std::min(std::max(y / 8 + noise(generator), 0), 255));
+			texel[2] = static_cast<std::uint8_t>(std::min(std::max((x ^ y) & 255, 0), 255));
+			const float* disc{ &discs[((y / 32) * (size / 32) + x / 32) * 3] };
+			float distance{ std::hypot(static_cast<float>(x % 32) - disc[0], static_cast<float>(y % 32) - disc[1]) };
+			texel[3] = static_cast<std::uint8_t>(std::min(std::max(1.0f - distance / disc[2], 0.0f), 1.0f) * 255.0f);
+		}
+	}
+
+	std::vector<simd_level> levels{ simd_support::available_levels() };
+	out << "mip generator benchmark, " << size << "x" << size << " rgba, best level: " << simd_support::level_name(levels.back()) << std::endl;
+
+	for (mip_filter filter : { mip_filter::box, mip_filter::kaiser })
+	{
+		mip_options options{};
+		options.filter_ = filter;
+		options.srgb_ = true;
+
+		double scalar_seconds{};
+		std::vector<mip_level> reference{};
+		for (simd_level level : levels)
+		{
+			mip_generator mips{ level };
+			std::vector<mip_level> chain{};
+
+			auto begin{ std::chrono::steady_clock::now() };
+			for (std::size_t repeat = 0; repeat < repeats; ++repeat)
+			{
+				chain = mips.generate(pixels.data(), size, size, 4, options);
+			}
+			double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / repeats };
+
+			// scalar runs first. float sums in another order may round a byte the other way, never more.
+			int largest_difference{ 0 };
+			if (level == simd_level::scalar)
+			{
+				scalar_seconds = seconds;
+				reference = chain;
+			}
+			else
+			{
+				for (std::size_t index = 0; index < chain.size(); ++index)
+				{
+					for (std::size_t byte = 0; byte < chain[index].pixels_.size(); ++byte)
+					{
+						largest_difference = std::max(largest_difference, std::abs(chain[index].pixels_[byte] - reference[index].pixels_[byte]));
+					}
+				}
+			}
+
+			out << "    " << std::setw(6) << (filter == mip_filter::box ? "box" : "kaiser") << " " << std::setw(6) << simd_support::level_name(level)
+				<< " " << std::fixed << std::setprecision(1) << static_cast<double>(size) * size / seconds / 1e6 << " MPixels/s ("
+				<< std::setprecision(2) << scalar_seconds / seconds << "x)" << (largest_difference > 1 ? " MISMATCH" : "") << std::endl;
+		}
+	}
+
+	// averaging flattens the discs' peaks, a plain chain loses most of the covered texels within a few levels.
+	mip_options cutout{};
+	cutout.alpha_cutoff_ = 0.5f;
+	std::vector<mip_level> plain{ mip_generator{}.generate(pixels.data(), size, size, 4, mip_options{}) };
+	std::vector<mip_level> kept{ mip_generator{}.generate(pixels.data(), size, size, 4, cutout) };
+	std::size_t level{ std::min<std::size_t>(5, plain.size()) - 1 };
+	out << "    alpha coverage at 0.5: base " << std::setprecision(3) << mip_generator::coverage(pixels.data(), size, size, 4, 0.5f)
+		<< ", level " << level + 1 << " plain " << mip_generator::coverage(plain[level].pixels_.data(), plain[level].width_, plain[level].height_, 4, 0.5f)
+		<< ", preserved " << mip_generator::coverage(kept[level].pixels_.data(), kept[level].width_, kept[level].height_, 4, 0.5f) << std::endl;
+
+	out.unsetf(std::ios::fixed);
+	out << std::setprecision(6);
+}
+
+
+#endif // !__MIP_BENCHMARK_HPP__
@@ -10,30 +10,110 @@
 #include <assimp/postprocess.h>
 
 #include "mesh.hpp"
-#include "stb_image/stb_image.h"
+#include "mesh_cache.hpp"
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+#include "indirect_batch.hpp"
+#include "render_queue.hpp"
+#include "bvh.hpp"
+#include "thread_pool.hpp"
+#include "texture_registry.hpp"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <list>
+#include <memory>
+#include <algorithm>
+#include <utility>
 #include <cassert>
 
 
+// vertex/index arrays of one aiMesh, or of one part of it when it is too large for 16 bit indices.
+// built off the GL thread and moved into a mesh afterwards.
+struct mesh_geometry
+{
+	std::vector<vertex> vertices_{};
+	// every level of detail, level 0 first.
+	std::vector<GLuint> indices_{};
+	std::vector<mesh_lod> lods_{};
+
+	// level 0 as Assimp delivered it and as it is drawn, the first part of a split aiMesh holds the whole imported one.
+	vertex_cache_stats imported_stats_{};
+	vertex_cache_stats optimized_stats_{};
+
+	mesh_geometry() = default;
+	mesh_geometry(const mesh_geometry&) = delete;
+	mesh_geometry& operator=(const mesh_geometry&) = delete;
+	mesh_geometry(mesh_geometry&&) = default;
+	mesh_geometry& operator=(mesh_geometry&&) = default;
+};
+
+// GPU memory of a model's geometry in the arenas, next to what 56 byte vertices and 32 bit indices would take.
+struct model_memory
+{
+	std::size_t mesh_count_{};
+	std::size_t packed_meshes_{};
+	std::size_t short_index_meshes_{};
+	std::size_t vertex_bytes_{};
+	std::size_t full_vertex_bytes_{};
+	std::size_t index_bytes_{};
+	std::size_t full_index_bytes_{};
+
+	void print(std::ostream& out)const
+	{
+		out << this->mesh_count_ << " meshes, vertices " << this->full_vertex_bytes_ << " -> " << this->vertex_bytes_
+			<< " bytes(" << this->packed_meshes_ << " packed), indices " << this->full_index_bytes_ << " -> " << this->index_bytes_
+			<< " bytes(" << this->short_index_meshes_ << " 16 bit), total " << this->full_vertex_bytes_ + this->full_index_bytes_
+			<< " -> " << this->vertex_bytes_ + this->index_bytes_ << " bytes";
+	}
+};
+
+static constexpr const unsigned int MODEL_IMPORT_FLAGS{ aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace };
+
 class model_loader final
 {
 private:
 	std::list<std::shared_ptr<mesh>> meshes_;
 	std::vector<std::pair<std::basic_string<char>, texture>> loaded_texture_{};
+	// file name + color space(see load_texture) -> index into loaded_texture_.
+	std::unordered_map<std::basic_string<char>, std::size_t> loaded_texture_index_{};
 
+	std::basic_string<char> model_file_{};
 	std::basic_string<char> texture_file_dir_{};
+
+	// keeps the mapped cache alive until load_vertices_data() has uploaded it.
+	std::unique_ptr<mesh_cache> mesh_cache_{};
+	bool loaded_from_cache_{ false };
+
+	std::unique_ptr<indirect_batch> indirect_batch_{};
+	model_memory memory_{};
+	bounding_sphere bounds_{};
+	bounding_box box_{};
+	// over the meshes' boxes, item i is the i-th mesh of get_meshes().
+	bounding_volume_hierarchy bvh_{};
+
+	// sampler handles of the program draw() was last called with.
+	GLuint samplers_program_{};
+	material_samplers samplers_{};
 public:
 	model_loader() = default;
 	model_loader(const model_loader&) = delete;
 	model_loader& operator=(const model_loader&) = delete;
 
+	// must run while the GL context is still current.
+	~model_loader()
+	{
+		for (const auto& loaded_texture : loaded_texture_)
+		{
+			texture_registry::shared().release(loaded_texture.second.id_);
+		}
+	}
+
 
 	const std::list<std::shared_ptr<mesh>>& get_meshes()const noexcept
 	{
@@ -45,6 +125,11 @@ public:
 		return (this->loaded_texture_);
 	}
 
+	bool is_loaded_from_cache()const noexcept
+	{
+		return (this->loaded_from_cache_);
+	}
+
 
 	void load_model(const std::basic_string<char>& model_file)
 	{
@@ -55,10 +140,23 @@ public:
 			assert(false);
 		}
 
+		model_file_ = model_file;
 		texture_file_dir_ = model_file.substr(0, model_file.find_last_of('\\'));
 
+		// warm start: the sidecar cache is still valid, hand the mapped arrays to the meshes.
+		mesh_cache_ = std::make_unique<mesh_cache>(model_file, MODEL_IMPORT_FLAGS);
+		if (mesh_cache_->load())
+		{
+			process_cache(*mesh_cache_);
+			loaded_from_cache_ = true;
+			return;
+		}
+
+		mesh_cache_.reset();
+		loaded_from_cache_ = false;
+
 		Assimp::Importer importer{};
-		const aiScene* scene = importer.ReadFile(model_file, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		const aiScene* scene = importer.ReadFile(model_file, MODEL_IMPORT_FLAGS);
 
 		if (!scene)
 		{
@@ -73,85 +171,274 @@ public:
 			return;
 		}
 
-		// process ASSIMP's root node recursively
-		process_node(scene->mRootNode, scene);
+		// flatten the node tree first, so every mesh can be converted independently.
+		std::vector<unsigned int> mesh_indices{};
+		collect_mesh_indices(scene->mRootNode, mesh_indices);
+
+		// vertex/index conversion touches no GL state, run it on the worker pool.
+		std::vector<std::vector<mesh_geometry>> geometries(mesh_indices.size());
+		thread_pool::shared().parallel_for(mesh_indices.size(), [&geometries, &mesh_indices, scene](std::size_t index)
+		{
+			geometries[index] = model_loader::process_geometry(scene->mMeshes[mesh_indices[index]]);
+		});
+
+		vertex_cache_stats imported_stats{};
+		vertex_cache_stats optimized_stats{};
+		std::size_t part_count{};
+		for (const std::vector<mesh_geometry>& parts : geometries)
+		{
+			for (const mesh_geometry& geometry : parts)
+			{
+				imported_stats.add(geometry.imported_stats_);
+				optimized_stats.add(geometry.optimized_stats_);
+			}
+			part_count += parts.size();
+		}
+
+		std::cout << "MESH_OPTIMIZER:: " << model_file << ": " << imported_stats.vertices_ << " -> " << optimized_stats.vertices_
+			<< " vertices, ACMR " << imported_stats.acmr() << " -> " << optimized_stats.acmr()
+			<< ", ATVR " << imported_stats.atvr() << " -> " << optimized_stats.atvr() << " (FIFO " << VERTEX_CACHE_SIZE << ")" << std::endl;
+		if (part_count != mesh_indices.size())
+		{
+			std::cout << "MESH_OPTIMIZER:: " << model_file << ": " << mesh_indices.size() << " meshes split into " << part_count
+				<< " to fit 16 bit indices" << std::endl;
+		}
+
+		// materials upload textures, so they stay on the GL thread and keep the serial node order. parts share their material.
+		for (std::size_t index = 0; index < mesh_indices.size(); ++index)
+		{
+			std::list<texture> textures{ load_mesh_textures(scene->mMeshes[mesh_indices[index]], scene) };
+			for (mesh_geometry& geometry : geometries[index])
+			{
+				meshes_.push_back(process_mesh(std::move(geometry), textures));
+			}
+		}
+
+		if (!mesh_cache{ model_file, MODEL_IMPORT_FLAGS }.store(meshes_))
+		{
+			std::cout << "MESH_CACHE:: failed to write cache for: " << model_file << std::endl;
+		}
 	}
 
-	void load_vertices_data()
+	// preferred is the vertex layout every mesh should use, see mesh::bind_VAO_VBO_EBO().
+	void load_vertices_data(vertex_layout preferred = vertex_layout::full)
 	{
+		bounds_ = bounding_sphere{};
+		box_ = bounding_box{};
+		std::vector<bounding_box> mesh_boxes{};
+
+		memory_ = model_memory{};
+		vertex_precision precision{};
 		for (const auto& shared_mesh : meshes_)
 		{
-			shared_mesh->bind_VAO_VBO_EBO();
+			shared_mesh->bind_VAO_VBO_EBO(preferred);
+			bounds_.merge(shared_mesh->get_bounds());
+			box_.merge(shared_mesh->get_box());
+			mesh_boxes.push_back(shared_mesh->get_box());
+
+			++memory_.mesh_count_;
+			memory_.packed_meshes_ += shared_mesh->get_layout() == vertex_layout::packed ? 1 : 0;
+			memory_.short_index_meshes_ += shared_mesh->get_index_type() == GL_UNSIGNED_SHORT ? 1 : 0;
+			memory_.vertex_bytes_ += shared_mesh->get_vertices_count() * shared_mesh->get_vertex_size();
+			memory_.full_vertex_bytes_ += shared_mesh->get_vertices_count() * sizeof(vertex);
+			memory_.index_bytes_ += shared_mesh->get_index_bytes();
+			memory_.full_index_bytes_ += shared_mesh->get_indices_count() * sizeof(GLuint);
+			precision.merge(shared_mesh->get_precision());
 		}
+
+		bvh_.build(mesh_boxes);
+
+		std::cout << "MODEL_MEMORY:: " << model_file_ << ": ";
+		memory_.print(std::cout);
+		std::cout << std::endl;
+
+		if (preferred == vertex_layout::packed)
+		{
+			std::cout << "VERTEX_FORMAT:: " << model_file_ << ": max error: position " << precision.position_error_
+				<< " (" << precision.relative_position_error_ * 100.0f << "% of the box), normal " << precision.normal_error_degrees_
+				<< " degrees, texcoord " << precision.texcoord_error_ << std::endl;
+		}
+
+		// the vertices are on the GPU now, drop the mapping.
+		mesh_cache_.reset();
 	}
 
 
-	// draw model.
-	inline void draw(GLuint program_id)
+	// valid after load_vertices_data().
+	const model_memory& get_memory()const noexcept
+	{
+		return memory_;
+	}
+
+	// every mesh in model space, valid after load_vertices_data().
+	const bounding_sphere& get_bounds()const noexcept
 	{
-		glUseProgram(program_id);
+		return bounds_;
+	}
+
+	const bounding_box& get_box()const noexcept
+	{
+		return box_;
+	}
 
+	const bounding_volume_hierarchy& get_bvh()const noexcept
+	{
+		return bvh_;
+	}
+
+	// largest error of each level of detail over every mesh, in model units. valid after load_vertices_data().
+	std::vector<float> get_lod_errors()const
+	{
+		std::vector<float> errors(MESH_LOD_COUNT, 0.0f);
 		for (const auto& shared_mesh : meshes_)
 		{
-			shared_mesh->bind_texture(program_id);
+			for (std::size_t level = 0; level < MESH_LOD_COUNT; ++level)
+			{
+				const std::vector<mesh_lod>& lods{ shared_mesh->get_lods() };
+				errors[level] = std::max(errors[level], lods[std::min(level, lods.size() - 1)].error_);
+			}
 		}
+
+		return errors;
+	}
+
+	// draw model, level picks the level of detail of every mesh.
+	inline void draw(shader_program& program, std::size_t level = 0)
+	{
+		if (samplers_program_ != program.get_id())
+		{
+			samplers_ = material_samplers::reflect(program);
+			samplers_program_ = program.get_id();
+		}
+
+		program.use();
+
+		// one VAO per vertex layout, most models use just one.
+		GLuint bound_VAO{};
+		for (const auto& shared_mesh : meshes_)
+		{
+			if (shared_mesh->get_VAO() != bound_VAO)
+			{
+				bound_VAO = shared_mesh->get_VAO();
+				glBindVertexArray(bound_VAO);
+			}
+
+			shared_mesh->bind_texture(program, samplers_, level);
+		}
+
+		glBindVertexArray(0);
+	}
+
+	// every mesh gets the material of its first diffuse texture, call after load_vertices_data() and before library.build().
+	void assign_materials(material_library& library)
+	{
+		for (const auto& shared_mesh : meshes_)
+		{
+			shared_mesh->set_material(library.add(shared_mesh->get_diffuse_texture()));
+		}
+	}
+
+	// queue every mesh as an opaque draw, view_model is view * model. the meshes sort by material and VAO
+	// and, inside the same state, front to back by the view depth of their bounding sphere's center.
+	void submit(render_queue& queue, shader_program& program, const glm::mat4& view_model, std::size_t level = 0)const
+	{
+		for (const auto& shared_mesh : meshes_)
+		{
+			queue.submit(render_pass::opaque, program, shared_mesh->get_VAO(), shared_mesh->get_material(), shared_mesh->get_lod_range(level),
+				shared_mesh->get_decode(), model_loader::view_depth(view_model, shared_mesh->get_bounds().center_));
+		}
+	}
+
+	// record the whole model into one indirect draw, call after assign_materials().
+	void build_indirect_draw()
+	{
+		indirect_batch_ = std::make_unique<indirect_batch>();
+		indirect_batch_->build(meshes_);
+	}
+
+	// queue the whole model as one glMultiDrawElementsIndirect per vertex layout, see submit().
+	void submit_indirect(render_queue& queue, shader_program& program, const glm::mat4& view_model)const
+	{
+		assert(indirect_batch_);
+		indirect_batch* batch{ indirect_batch_.get() };
+		queue.submit(render_pass::opaque, program, 0, [batch](render_state& state)
+		{
+			batch->draw(state);
+		}, model_loader::view_depth(view_model, bounds_.center_));
+	}
+
+	// distance in front of the camera along the view direction.
+	static float view_depth(const glm::mat4& view_model, const glm::vec3& point)noexcept
+	{
+		return -(view_model[0][2] * point.x + view_model[1][2] * point.y + view_model[2][2] * point.z + view_model[3][2]);
 	}
 
 private:
 
-	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void process_node(aiNode *ai_node, const aiScene *ai_scene)
+	// collects the meshes of a node in a recursive fashion, in the same order a serial depth first walk would process them.
+	static void collect_mesh_indices(const aiNode* const ai_node, std::vector<unsigned int>& mesh_indices)
 	{
-		// process each mesh located at the current node
+		// the node object only contains indices to index the actual objects in the scene. 
+		// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
 		for (std::size_t index = 0; index < ai_node->mNumMeshes; ++index)
 		{
-			// the node object only contains indices to index the actual objects in the scene. 
-			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-			aiMesh* mesh_ptr = ai_scene->mMeshes[ai_node->mMeshes[index]];
-			meshes_.push_back(process_mesh(mesh_ptr, ai_scene));
+			mesh_indices.push_back(ai_node->mMeshes[index]);
 		}
-		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+		// after we've collected all of the meshes (if any) we then recursively collect each of the children nodes
 		for (std::size_t index = 0; index < ai_node->mNumChildren; ++index)
 		{
-			process_node(ai_node->mChildren[index], ai_scene);
+			collect_mesh_indices(ai_node->mChildren[index], mesh_indices);
 		}
 	}
 
 
-	std::shared_ptr<mesh> process_mesh(const aiMesh* const ai_mesh, const aiScene* const ai_scene)
+	void process_cache(const mesh_cache& cache)
 	{
-		std::vector<vertex> vertices{};
-		std::vector<GLuint> indices{};
-		std::list<texture> textures{};
+		for (const mesh_cache_entry& entry : cache.get_entries())
+		{
+			std::list<texture> textures{};
+			for (const auto& texture_ref : entry.texture_refs_)
+			{
+				textures.push_back(load_texture(texture_ref.second, texture_ref.first));
+			}
+
+			std::shared_ptr<mesh> shared_mesh{ std::make_shared<mesh>() };
+			shared_mesh->add_vertices(entry.vertices_, entry.vertex_count_);
+			shared_mesh->add_indices(entry.indices_, entry.index_count_);
+			shared_mesh->add_lods(entry.lods_);
+			shared_mesh->add_textures(textures);
+
+			meshes_.push_back(shared_mesh);
+		}
+	}
+
+	// thread safe: only reads the aiMesh and writes into presized buffers.
+	// one geometry per part, a single one unless the mesh has more vertices than 16 bit indices reach.
+	static std::vector<mesh_geometry> process_geometry(const aiMesh* const ai_mesh)
+	{
+		mesh_geometry geometry{};
+		geometry.vertices_.resize(ai_mesh->mNumVertices);
 
 		for (std::size_t index = 0; index < ai_mesh->mNumVertices; ++index)
 		{
-			vertex temp_vertex{};
-			glm::vec3 position{};
-			glm::vec3 normal{};
+			vertex& temp_vertex = geometry.vertices_[index];
 
 			// positions
-			position.x = ai_mesh->mVertices[index].x;
-			position.y = ai_mesh->mVertices[index].y;
-			position.z = ai_mesh->mVertices[index].z;
+			temp_vertex.position_.x = ai_mesh->mVertices[index].x;
+			temp_vertex.position_.y = ai_mesh->mVertices[index].y;
+			temp_vertex.position_.z = ai_mesh->mVertices[index].z;
 
 			// normals
-			normal.x = ai_mesh->mNormals[index].x;
-			normal.y = ai_mesh->mNormals[index].y;
-			normal.z = ai_mesh->mNormals[index].z;
-
-			temp_vertex.position_ = position;
-			temp_vertex.normal_ = normal;
-
+			temp_vertex.normal_.x = ai_mesh->mNormals[index].x;
+			temp_vertex.normal_.y = ai_mesh->mNormals[index].y;
+			temp_vertex.normal_.z = ai_mesh->mNormals[index].z;
 
 			if (ai_mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
 			{
-				glm::vec2 texcoord{};
 				// a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
 				// use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-				texcoord.x = ai_mesh->mTextureCoords[0][index].x;
-				texcoord.y = ai_mesh->mTextureCoords[0][index].y;
-				temp_vertex.texcoord_ = texcoord;
+				temp_vertex.texcoord_.x = ai_mesh->mTextureCoords[0][index].x;
+				temp_vertex.texcoord_.y = ai_mesh->mTextureCoords[0][index].y;
 			}
 			else
 			{
@@ -159,33 +446,57 @@ private:
 			}
 
 			// tangent
-			glm::vec3 tangent{};
-			tangent.x = ai_mesh->mTangents[index].x;
-			tangent.y = ai_mesh->mTangents[index].y;
-			tangent.z = ai_mesh->mTangents[index].z;
-			temp_vertex.tangent_ = tangent;
+			temp_vertex.tangent_.x = ai_mesh->mTangents[index].x;
+			temp_vertex.tangent_.y = ai_mesh->mTangents[index].y;
+			temp_vertex.tangent_.z = ai_mesh->mTangents[index].z;
 
 			// bitangent
-			glm::vec3 bitangent{};
-			bitangent.x = ai_mesh->mBitangents[index].x;
-			bitangent.y = ai_mesh->mBitangents[index].y;
-			bitangent.z = ai_mesh->mBitangents[index].z;
-			temp_vertex.bitangent_ = bitangent;
-
-			vertices.push_back(temp_vertex);
+			temp_vertex.bitangent_.x = ai_mesh->mBitangents[index].x;
+			temp_vertex.bitangent_.y = ai_mesh->mBitangents[index].y;
+			temp_vertex.bitangent_.z = ai_mesh->mBitangents[index].z;
 		}
 
 		// now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+		std::size_t number_of_indices{ 0 };
 		for (std::size_t index = 0; index < ai_mesh->mNumFaces; ++index)
 		{
-			aiFace face{ ai_mesh->mFaces[index] };
+			number_of_indices += ai_mesh->mFaces[index].mNumIndices;
+		}
 
-			for (std::size_t EBO_index = 0; EBO_index < face.mNumIndices; ++EBO_index)
-			{
-				indices.push_back(face.mIndices[EBO_index]);
-			}
+		geometry.indices_.resize(number_of_indices);
+		GLuint* index_ptr{ geometry.indices_.data() };
+		for (std::size_t index = 0; index < ai_mesh->mNumFaces; ++index)
+		{
+			const aiFace& face{ ai_mesh->mFaces[index] };
+			index_ptr = std::copy(face.mIndices, face.mIndices + face.mNumIndices, index_ptr);
 		}
 
+		vertex_cache_stats imported_stats{ mesh_optimizer::analyze(geometry.indices_.data(), geometry.indices_.size(), geometry.vertices_.size()) };
+		mesh_optimizer::weld(geometry.vertices_, geometry.indices_);
+
+		std::vector<mesh_part> parts{ mesh_optimizer::split(std::move(geometry.vertices_), std::move(geometry.indices_)) };
+		std::vector<mesh_geometry> geometries(parts.size());
+		for (std::size_t index = 0; index < parts.size(); ++index)
+		{
+			mesh_geometry& part{ geometries[index] };
+			part.vertices_ = std::move(parts[index].vertices_);
+			part.indices_ = std::move(parts[index].indices_);
+
+			// the coarser levels go after level 0 in the same index list, so they share the mesh's arena range.
+			mesh_simplifier::build_lod_chain(part.vertices_, part.indices_, part.lods_);
+
+			mesh_optimizer::optimize(part.vertices_, part.indices_, part.lods_);
+			part.optimized_stats_ = mesh_optimizer::analyze(part.indices_.data(), part.lods_.front().index_count_, part.vertices_.size());
+		}
+
+		geometries.front().imported_stats_ = imported_stats;
+		return geometries;
+	}
+
+	std::list<texture> load_mesh_textures(const aiMesh* const ai_mesh, const aiScene* const ai_scene)
+	{
+		std::list<texture> textures{};
+
 		// process materials
 		aiMaterial* material = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
 
@@ -205,9 +516,15 @@ private:
 		std::vector<texture> height_texture{ load_material_texture(material, aiTextureType_AMBIENT, texture_type::ambient_type) };
 		textures.insert(textures.end(), height_texture.begin(), height_texture.end());
 
+		return textures;
+	}
+
+	std::shared_ptr<mesh> process_mesh(mesh_geometry&& geometry, const std::list<texture>& textures)
+	{
 		std::shared_ptr<mesh> shared_mesh{ std::make_shared<mesh>() };
-		shared_mesh->add_vertices(vertices);
-		shared_mesh->add_indices(indices);
+		shared_mesh->add_vertices(std::move(geometry.vertices_));
+		shared_mesh->add_indices(std::move(geometry.indices_));
+		shared_mesh->add_lods(geometry.lods_);
 		shared_mesh->add_textures(textures);
 
 		return shared_mesh;
@@ -222,69 +539,44 @@ private:
 			aiString texture_file_name{};
 			ai_material->GetTexture(type, index, &texture_file_name);
 
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip{ false };
-			for (std::size_t load_texture_index = 0; load_texture_index < loaded_texture_.size(); ++load_texture_index)
-			{
-				if (std::strcmp(loaded_texture_[load_texture_index].first.c_str(), texture_file_name.C_Str()) == 0)
-				{
-					textures.push_back(loaded_texture_[load_texture_index].second);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
-			}
-
-			if (!skip)
-			{   // if texture hasn't been loaded already, load it
-				texture temp_texture{};
-				temp_texture.id_ = model_loader::load_texture_from_file(texture_file_name.C_Str(), texture_file_dir_);
-				temp_texture.type_ = the_type;
-				textures.push_back(temp_texture);
-				loaded_texture_.emplace_back(std::basic_string<char>{texture_file_name.C_Str()}, temp_texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-			}
+			textures.push_back(load_texture(texture_file_name.C_Str(), the_type));
 		}
 		return textures;
 	}
 
-	// gamma unused temporarily.
-	static GLuint load_texture_from_file(const std::basic_string<char>& file_name, const std::basic_string<char>& file_path, bool gamma = false)
+	texture load_texture(const std::basic_string<char>& texture_file_name, texture_type the_type)
 	{
-		std::basic_string<char> file_path_name{ file_path + '\\' + file_name };
-
-		GLuint texture_id{};
-		glGenTextures(1, &texture_id);
+		// diffuse maps hold sRGB colors, the others data.
+		bool srgb{ the_type == texture_type::diffuse_type };
 
-		int width{}, height{}, nrComponents{};
-		unsigned char *data{ stbi_load(file_path_name.c_str(), &width, &height, &nrComponents, 0) };
-
-		if (data)
-		{
-			GLenum format{};
-			if (nrComponents == 1)
-				format = GL_RED;
-			else if (nrComponents == 3)
-				format = GL_RGB;
-			else if (nrComponents == 4)
-				format = GL_RGBA;
-
-			glBindTexture(GL_TEXTURE_2D, texture_id);
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			stbi_image_free(data);
-		}
-		else
+		// a texture with the same filepath and color space has already been loaded by this model. (optimization)
+		std::basic_string<char> index_key{ texture_file_name + (srgb ? std::basic_string<char>(1, '\0') + "srgb" : std::basic_string<char>{}) };
+		auto loaded_itr{ loaded_texture_index_.find(index_key) };
+		if (loaded_itr != loaded_texture_index_.end())
 		{
-			std::cout << "Texture failed to load at path: " << file_path << std::endl;
-			stbi_image_free(data);
+			return loaded_texture_[loaded_itr->second].second;
 		}
 
-		return texture_id;
+		// if texture hasn't been loaded already, load it, the registry shares it with every other model using the same file.
+		texture temp_texture{};
+		temp_texture.id_ = model_loader::load_texture_from_file(texture_file_name, texture_file_dir_, srgb);
+		temp_texture.type_ = the_type;
+		temp_texture.path_ = texture_file_name;
+		loaded_texture_index_.emplace(index_key, loaded_texture_.size());
+		loaded_texture_.emplace_back(texture_file_name, temp_texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+		return temp_texture;
+	}
+
+	// gamma: the file holds sRGB encoded colors, its mipmaps are averaged in linear light.
+	// the returned texture samples as a placeholder until texture_loader::upload_pending() has uploaded the decoded file.
+	// it holds a reference in texture_registry which the caller releases.
+	static GLuint load_texture_from_file(const std::basic_string<char>& file_name, const std::basic_string<char>& file_path, bool gamma = false)
+	{
+		std::basic_string<char> file_path_name{ file_path + '\\' + file_name };
+
+		mip_options options{};
+		options.srgb_ = gamma;
+		return texture_registry::shared().acquire(file_path_name, options);
 	}
 
 
@@ -0,0 +1,374 @@
+#ifndef __PROGRAM_CACHE_HPP__
+#define __PROGRAM_CACHE_HPP__
+
+#include <glad/glad.h>
+
+#include "shader.hpp"
+#include "shader_preprocessor.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+
+static constexpr const std::uint32_t PROGRAM_CACHE_VERSION{ 1 };
+
+
+struct program_stage
+{
+	shader_type type_;
+	std::basic_string<char> source_;
+};
+
+
+struct program_cache_stats
+{
+	std::size_t loaded_{};
+	std::size_t compiled_{};
+	// binaries the driver refused(driver update, different GPU...), they were compiled again.
+	std::size_t rejected_{};
+	double milliseconds_{};
+};
+
+
+// links programs through binaries saved by glGetProgramBinary, so a warm start skips compiling and linking glsl.
+// glsl files are expanded by shader_preprocessor first, so an edited #include changes the key as well.
+// a binary is keyed by a hash of the stage sources, the defines and the GL vendor/renderer/version strings,
+// any change of them misses the cache instead of loading a stale binary.
+// every function must be called on the GL thread.
+class program_cache final
+{
+private:
+	// on disk: header, then binary_length_ bytes of the driver's program binary.
+	struct file_header
+	{
+		char magic_[8];
+		std::uint32_t version_;
+		std::uint32_t binary_format_;
+		std::uint64_t key_;
+		std::uint64_t binary_length_;
+	};
+
+	std::basic_string<char> directory_{};
+	program_cache_stats stats_{};
+
+	program_cache() = default;
+
+public:
+	program_cache(const program_cache&) = delete;
+	program_cache& operator=(const program_cache&) = delete;
+
+	static program_cache& shared()
+	{
+		static program_cache cache{};
+		return cache;
+	}
+
+	// where the binaries are written, the working directory by default. must end with a separator.
+	void set_directory(const std::basic_string<char>& directory)
+	{
+		this->directory_ = directory;
+	}
+
+	const program_cache_stats& get_stats()const noexcept
+	{
+		return (this->stats_);
+	}
+
+	// a linked program, or 0 when compiling or linking failed.
+	// defines("#define NAME VALUE\n" lines) are inserted right after every stage's #version line.
+	GLuint link(const std::vector<program_stage>& stages, const std::basic_string<char>& defines = {})
+	{
+		auto link_begin{ std::chrono::steady_clock::now() };
+
+		GLuint program_id{ this->load(stages, defines) };
+		if (program_id == 0)
+		{
+			program_id = program_cache::compile_and_link(stages, defines);
+			if (program_id != 0)
+			{
+				this->store(stages, defines, program_id);
+			}
+		}
+
+		this->stats_.milliseconds_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - link_begin).count();
+		return program_id;
+	}
+
+	GLuint link_files(const std::basic_string<char>& vertex_file, const std::basic_string<char>& fragment_file,
+		const std::basic_string<char>& geometry_file = {}, const std::basic_string<char>& defines = {})
+	{
+		std::vector<program_stage> stages{};
+		stages.push_back(program_stage{ shader_type::vertex_shader, shader_preprocessor::expand(vertex_file) });
+		stages.push_back(program_stage{ shader_type::fragment_shader, shader_preprocessor::expand(fragment_file) });
+		if (!geometry_file.empty())
+		{
+			stages.push_back(program_stage{ shader_type::geometry_shader, shader_preprocessor::expand(geometry_file) });
+		}
+
+		return this->link(stages, defines);
+	}
+
+	void print(std::ostream& out)const
+	{
+		out << "program cache: " << this->stats_.loaded_ << " loaded, " << this->stats_.compiled_ << " compiled";
+		if (this->stats_.rejected_ != 0)
+		{
+			out << " (" << this->stats_.rejected_ << " rejected by the driver)";
+		}
+
+		out << ", " << this->stats_.milliseconds_ << " ms" << (this->stats_.compiled_ == 0 ? " (warm)" : " (cold)");
+	}
+
+	// looks up a binary linked from exactly these stages and defines, 0 on a miss.
+	GLuint load(const std::vector<program_stage>& stages, const std::basic_string<char>& defines = {})
+	{
+		std::uint64_t key{ program_cache::hash_key(stages, defines) };
+		GLuint program_id{ this->load_file(this->get_cache_file(key), key) };
+		this->stats_.loaded_ += (program_id != 0);
+		return program_id;
+	}
+
+	// saves the binary of a program linked from these stages and defines, counted as compiled.
+	// the program should have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set(see prepare_program()).
+	void store(const std::vector<program_stage>& stages, const std::basic_string<char>& defines, GLuint program_id)
+	{
+		std::uint64_t key{ program_cache::hash_key(stages, defines) };
+		++this->stats_.compiled_;
+		this->store_file(this->get_cache_file(key), key, program_id);
+	}
+
+	// time spent linking outside of link(), e.g. by a batch of variants.
+	void add_milliseconds(double milliseconds)noexcept
+	{
+		this->stats_.milliseconds_ += milliseconds;
+	}
+
+	// call between glCreateProgram and glLinkProgram.
+	static void prepare_program(GLuint program_id)
+	{
+		if (program_cache::binaries_supported())
+		{
+			glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	static bool binaries_supported()
+	{
+		// glad leaves these null below GL 4.1.
+		if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+		{
+			return false;
+		}
+
+		GLint format_count{};
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+		return format_count > 0;
+	}
+
+private:
+	std::basic_string<char> get_cache_file(std::uint64_t key)const
+	{
+		return this->directory_ + "program_" + program_cache::to_hex(key) + ".program_binary";
+	}
+
+	static void hash_bytes(std::uint64_t& hash, const void* data, std::size_t size)noexcept
+	{
+		// 64-bit FNV-1a.
+		const unsigned char* bytes{ static_cast<const unsigned char*>(data) };
+		for (std::size_t index = 0; index < size; ++index)
+		{
+			hash ^= bytes[index];
+			hash *= 1099511628211ull;
+		}
+	}
+
+	static void hash_string(std::uint64_t& hash, const char* text)noexcept
+	{
+		// a terminator keeps "ab" + "c" apart from "a" + "bc".
+		std::size_t length{ text ? std::strlen(text) : 0 };
+		program_cache::hash_bytes(hash, text ? text : "", length + (text ? 1 : 0));
+	}
+
+	static std::uint64_t hash_key(const std::vector<program_stage>& stages, const std::basic_string<char>& defines)
+	{
+		std::uint64_t hash{ 14695981039346656037ull };
+
+		program_cache::hash_string(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+		program_cache::hash_string(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		program_cache::hash_string(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+		program_cache::hash_string(hash, defines.c_str());
+
+		for (const program_stage& stage : stages)
+		{
+			std::uint32_t type{ static_cast<std::uint32_t>(stage.type_) };
+			program_cache::hash_bytes(hash, &type, sizeof(type));
+			program_cache::hash_string(hash, stage.source_.c_str());
+		}
+
+		return hash;
+	}
+
+	static std::basic_string<char> to_hex(std::uint64_t value)
+	{
+		static constexpr const char digits[]{ "0123456789abcdef" };
+
+		std::basic_string<char> hex(16, '0');
+		for (std::size_t index = 0; index < 16; ++index)
+		{
+			hex[15 - index] = digits[(value >> (index * 4)) & 0xf];
+		}
+
+		return hex;
+	}
+
+	static GLuint compile_and_link(const std::vector<program_stage>& stages, const std::basic_string<char>& defines)
+	{
+		std::vector<GLuint> shader_ids{};
+		bool compiled{ true };
+
+		for (const program_stage& stage : stages)
+		{
+			GLuint shader_id{ shader::compile(shader_preprocessor::insert_defines(stage.source_, defines), stage.type_) };
+			compiled = compiled && shader_id != 0;
+			shader_ids.push_back(shader_id);
+		}
+
+		GLuint program_id{ 0 };
+		if (compiled)
+		{
+			program_id = glCreateProgram();
+			program_cache::prepare_program(program_id);
+
+			for (GLuint shader_id : shader_ids)
+			{
+				glAttachShader(program_id, shader_id);
+			}
+
+			glLinkProgram(program_id);
+
+			if (!shader::checkout_shader_state(program_id, shader_type::program))
+			{
+				glDeleteProgram(program_id);
+				program_id = 0;
+			}
+		}
+
+		// the program keeps what it needs.
+		for (GLuint shader_id : shader_ids)
+		{
+			glDeleteShader(shader_id);
+		}
+
+		return program_id;
+	}
+
+	GLuint load_file(const std::basic_string<char>& cache_file, std::uint64_t key)
+	{
+		if (!program_cache::binaries_supported())
+		{
+			return 0;
+		}
+
+		std::basic_ifstream<char> file_reader{ cache_file, std::ios::binary };
+		if (!file_reader.is_open())
+		{
+			return 0;
+		}
+
+		std::vector<char> bytes{ std::istreambuf_iterator<char>{ file_reader }, std::istreambuf_iterator<char>{} };
+		file_reader.close();
+
+		file_header header{};
+		if (bytes.size() < sizeof(file_header))
+		{
+			return 0;
+		}
+
+		std::memcpy(&header, bytes.data(), sizeof(file_header));
+		if (std::memcmp(header.magic_, "PRGMBIN", 8) != 0 || header.version_ != PROGRAM_CACHE_VERSION ||
+			header.key_ != key || header.binary_length_ != bytes.size() - sizeof(file_header))
+		{
+			return 0;
+		}
+
+		GLuint program_id{ glCreateProgram() };
+		glProgramBinary(program_id, header.binary_format_, bytes.data() + sizeof(file_header), static_cast<GLsizei>(header.binary_length_));
+
+		GLint success{};
+		glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			// not an error: the driver changed underneath us, link() compiles again and replaces the file.
+			++this->stats_.rejected_;
+			glDeleteProgram(program_id);
+			std::remove(cache_file.c_str());
+			return 0;
+		}
+
+		return program_id;
+	}
+
+	void store_file(const std::basic_string<char>& cache_file, std::uint64_t key, GLuint program_id)
+	{
+		if (!program_cache::binaries_supported())
+		{
+			return;
+		}
+
+		GLint binary_length{};
+		glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+		if (binary_length <= 0)
+		{
+			return;
+		}
+
+		std::vector<char> binary(static_cast<std::size_t>(binary_length));
+		GLenum binary_format{};
+		glGetProgramBinary(program_id, binary_length, nullptr, &binary_format, binary.data());
+
+		file_header header{};
+		std::memcpy(header.magic_, "PRGMBIN", 8);
+		header.version_ = PROGRAM_CACHE_VERSION;
+		header.binary_format_ = binary_format;
+		header.key_ = key;
+		header.binary_length_ = binary.size();
+
+		// a crash mid write must not leave a truncated binary under the final name.
+		std::basic_string<char> temp_file{ cache_file + ".tmp" };
+		{
+			std::basic_ofstream<char> file_writer{ temp_file, std::ios::binary | std::ios::trunc };
+			if (!file_writer.is_open())
+			{
+				std::cout << "PROGRAM_CACHE:: failed to write: " << cache_file << std::endl;
+				return;
+			}
+
+			file_writer.write(reinterpret_cast<const char*>(&header), sizeof(file_header));
+			file_writer.write(binary.data(), binary.size());
+			file_writer.close();
+			if (!file_writer)
+			{
+				std::cout << "PROGRAM_CACHE:: failed to write: " << cache_file << std::endl;
+				std::remove(temp_file.c_str());
+				return;
+			}
+		}
+
+		std::remove(cache_file.c_str());
+		if (std::rename(temp_file.c_str(), cache_file.c_str()) != 0)
+		{
+			std::remove(temp_file.c_str());
+		}
+	}
+};
+
+
+#endif // !__PROGRAM_CACHE_HPP__
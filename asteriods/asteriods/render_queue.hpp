@@ -0,0 +1,355 @@
+#ifndef __RENDER_QUEUE_HPP__
+#define __RENDER_QUEUE_HPP__
+
+#include <glad/glad.h>
+
+#include "geometry_arena.hpp"
+#include "vertex_format.hpp"
+#include "shader_program.hpp"
+#include "material_library.hpp"
+#include "render_stats.hpp"
+
+#include <array>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+// the GL state the queue's draws depend on. every change goes through here, so setting what is already set costs no GL call,
+// and render_stats counts the program, VAO and texture switches that remain.
+// GL calls made around it are invisible to it: reset() once per frame before the queue runs.
+class render_state final
+{
+private:
+	const material_library* materials_{ nullptr };
+	bool material_array_{ true };
+
+	GLuint program_{};
+	GLuint VAO_{};
+	GLuint texture_2D_{};
+	GLuint texture_array_{};
+	GLuint material_{};
+	vertex_decode decode_{};
+
+	// nothing is known after reset(), the first call of each kind always reaches GL.
+	bool program_known_{};
+	bool VAO_known_{};
+	bool unit_known_{};
+	bool texture_2D_known_{};
+	bool texture_array_known_{};
+	bool material_known_{};
+	bool decode_known_{};
+
+public:
+	render_state() = default;
+	render_state(const render_state&) = delete;
+	render_state& operator=(const render_state&) = delete;
+
+	// array: materials are layers of the library's texture array, picked by MATERIAL_LOCATION.
+	// otherwise every material change binds the material's own texture.
+	void set_material_library(const material_library* materials, bool array)noexcept
+	{
+		this->materials_ = materials;
+		this->material_array_ = array;
+	}
+
+	void reset()noexcept
+	{
+		this->program_known_ = false;
+		this->VAO_known_ = false;
+		this->unit_known_ = false;
+		this->texture_2D_known_ = false;
+		this->texture_array_known_ = false;
+		this->material_known_ = false;
+		this->decode_known_ = false;
+	}
+
+	void use(const shader_program& program)
+	{
+		if (this->program_known_ && this->program_ == program.get_id())
+		{
+			++render_stats::current().redundant_binds_;
+			return;
+		}
+
+		program.use();
+		this->program_ = program.get_id();
+		this->program_known_ = true;
+		++render_stats::current().program_binds_;
+	}
+
+	void bind_VAO(GLuint VAO)
+	{
+		if (this->VAO_known_ && this->VAO_ == VAO)
+		{
+			++render_stats::current().redundant_binds_;
+			return;
+		}
+
+		glBindVertexArray(VAO);
+		this->VAO_ = VAO;
+		this->VAO_known_ = true;
+		++render_stats::current().VAO_binds_;
+	}
+
+	// on MATERIAL_TEXTURE_UNIT, target is GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY.
+	void bind_texture(GLenum target, GLuint texture)
+	{
+		bool is_array{ target == GL_TEXTURE_2D_ARRAY };
+		GLuint& bound{ is_array ? this->texture_array_ : this->texture_2D_ };
+		bool& known{ is_array ? this->texture_array_known_ : this->texture_2D_known_ };
+		if (known && bound == texture)
+		{
+			++render_stats::current().redundant_binds_;
+			return;
+		}
+
+		if (!this->unit_known_)
+		{
+			glActiveTexture(GL_TEXTURE0 + MATERIAL_TEXTURE_UNIT);
+			this->unit_known_ = true;
+		}
+
+		glBindTexture(target, texture);
+		bound = texture;
+		known = true;
+		++render_stats::current().texture_binds_;
+	}
+
+	// the library's texture array, whatever the material mode: multi draws read their materials from it.
+	void bind_material_array()
+	{
+		this->bind_texture(GL_TEXTURE_2D_ARRAY, this->materials_->get_texture_array());
+	}
+
+	void set_material(GLuint material)
+	{
+		if (!this->material_array_)
+		{
+			this->bind_texture(GL_TEXTURE_2D, this->materials_->get_texture(material));
+			return;
+		}
+
+		this->bind_material_array();
+		if (this->material_known_ && this->material_ == material)
+		{
+			++render_stats::current().redundant_binds_;
+			return;
+		}
+
+		glVertexAttribI4ui(MATERIAL_LOCATION, material, 0, 0, 0);
+		this->material_ = material;
+		this->material_known_ = true;
+	}
+
+	void apply_decode(const vertex_decode& decode)
+	{
+		if (this->decode_known_ && std::memcmp(&this->decode_, &decode, sizeof(vertex_decode)) == 0)
+		{
+			++render_stats::current().redundant_binds_;
+			return;
+		}
+
+		decode.apply();
+		this->decode_ = decode;
+		this->decode_known_ = true;
+	}
+};
+
+
+// which draws go first, the most significant bits of a sort key.
+enum class render_pass : std::uint8_t
+{
+	opaque,
+	transparent
+};
+
+// one submitted draw: an indexed draw of range_ through VAO_, or callback_ when the draw is more than that(instanced, multi draw).
+// a callback runs with program_ in use and sets the rest of its state through the render_state it is given.
+struct render_item
+{
+	shader_program* program_{};
+	GLuint VAO_{};
+	GLuint material_{};
+	geometry_range range_{};
+	vertex_decode decode_{};
+	std::function<void(render_state&)> callback_{};
+};
+
+
+// draws submitted in any order during a frame, executed sorted by a 64 bit key so draws sharing state run back to back:
+//   opaque       pass:2 | program:10 | material:8 | VAO:12 | depth:32, front to back inside equal state.
+//   transparent  pass:2 | depth:32 back to front | program:10 | material:8 | VAO:12, blending order comes before state.
+// programs and VAOs enter the key as dense indices in the order the queue first saw them, materials as they are.
+class render_queue final
+{
+public:
+	struct sort_entry
+	{
+		std::uint64_t key_;
+		std::uint32_t item_;
+	};
+
+private:
+	std::vector<render_item> items_{};
+	std::vector<sort_entry> order_{};
+	std::vector<sort_entry> scratch_{};
+
+	std::vector<GLuint> programs_{};
+	std::vector<GLuint> VAOs_{};
+
+public:
+	render_queue() = default;
+	render_queue(const render_queue&) = delete;
+	render_queue& operator=(const render_queue&) = delete;
+
+	std::size_t get_item_count()const noexcept
+	{
+		return this->items_.size();
+	}
+
+	// once per frame before submitting, keeps the memory.
+	void clear()noexcept
+	{
+		this->items_.clear();
+		this->order_.clear();
+	}
+
+	// depth is the view space distance along the view direction, negative(behind the camera) counts as 0.
+	void submit(render_pass pass, shader_program& program, GLuint VAO, GLuint material, const geometry_range& range,
+		const vertex_decode& decode, float depth)
+	{
+		render_item item{};
+		item.program_ = &program;
+		item.VAO_ = VAO;
+		item.material_ = material;
+		item.range_ = range;
+		item.decode_ = decode;
+		this->push(pass, std::move(item), depth);
+	}
+
+	void submit(render_pass pass, shader_program& program, GLuint material, std::function<void(render_state&)> callback, float depth)
+	{
+		render_item item{};
+		item.program_ = &program;
+		item.material_ = material;
+		item.callback_ = std::move(callback);
+		this->push(pass, std::move(item), depth);
+	}
+
+	std::uint64_t make_key(render_pass pass, GLuint program_id, GLuint material, GLuint VAO, float depth)
+	{
+		std::uint64_t program{ std::min<std::uint64_t>(render_queue::dense_index(this->programs_, program_id), 1023) };
+		std::uint64_t VAO_index{ std::min<std::uint64_t>(render_queue::dense_index(this->VAOs_, VAO), 4095) };
+		std::uint64_t state{ program << 20 | std::min<std::uint64_t>(material, 255) << 12 | VAO_index };
+
+		// a non negative float orders like its bits.
+		float clamped_depth{ std::max(depth, 0.0f) };
+		std::uint32_t depth_bits{};
+		std::memcpy(&depth_bits, &clamped_depth, sizeof(depth_bits));
+
+		if (pass == render_pass::transparent)
+		{
+			return static_cast<std::uint64_t>(pass) << 62 | static_cast<std::uint64_t>(~depth_bits) << 30 | state;
+		}
+
+		return static_cast<std::uint64_t>(pass) << 62 | state << 32 | depth_bits;
+	}
+
+	// sorts the frame's draws and runs them through state.
+	void execute(render_state& state)
+	{
+		render_queue::radix_sort(this->order_, this->scratch_);
+
+		for (const sort_entry& entry : this->order_)
+		{
+			const render_item& item{ this->items_[entry.item_] };
+			state.use(*item.program_);
+
+			if (item.callback_)
+			{
+				item.callback_(state);
+				continue;
+			}
+
+			state.bind_VAO(item.VAO_);
+			state.set_material(item.material_);
+			state.apply_decode(item.decode_);
+			glDrawElementsBaseVertex(GL_TRIANGLES, item.range_.index_count_, item.range_.index_type_, item.range_.get_index_offset(), item.range_.base_vertex_);
+			++render_stats::current().draw_calls_;
+			render_stats::current().triangles_ += item.range_.index_count_ / 3;
+		}
+	}
+
+	// stable, least significant byte first. all 8 histograms come from one read of the keys, and a byte that is the same
+	// in every key moves nothing, so its pass is skipped: most frames sort on a few state bytes and the depth.
+	static void radix_sort(std::vector<sort_entry>& entries, std::vector<sort_entry>& scratch)
+	{
+		std::size_t count{ entries.size() };
+		if (count < 2)
+		{
+			return;
+		}
+
+		std::array<std::array<std::uint32_t, 256>, 8> histograms{};
+		for (const sort_entry& entry : entries)
+		{
+			for (std::size_t digit = 0; digit < 8; ++digit)
+			{
+				++histograms[digit][(entry.key_ >> (digit * 8)) & 0xff];
+			}
+		}
+
+		scratch.resize(count);
+		for (std::size_t digit = 0; digit < 8; ++digit)
+		{
+			std::array<std::uint32_t, 256>& histogram{ histograms[digit] };
+			if (histogram[(entries.front().key_ >> (digit * 8)) & 0xff] == count)
+			{
+				continue;
+			}
+
+			std::uint32_t offset{ 0 };
+			for (std::uint32_t& bucket : histogram)
+			{
+				std::uint32_t bucket_count{ bucket };
+				bucket = offset;
+				offset += bucket_count;
+			}
+
+			for (const sort_entry& entry : entries)
+			{
+				scratch[histogram[(entry.key_ >> (digit * 8)) & 0xff]++] = entry;
+			}
+			entries.swap(scratch);
+		}
+	}
+
+private:
+	void push(render_pass pass, render_item&& item, float depth)
+	{
+		GLuint program_id{ item.program_->get_id() };
+		std::uint64_t key{ this->make_key(pass, program_id, item.material_, item.VAO_, depth) };
+		this->order_.push_back(sort_entry{ key, static_cast<std::uint32_t>(this->items_.size()) });
+		this->items_.push_back(std::move(item));
+	}
+
+	static std::size_t dense_index(std::vector<GLuint>& names, GLuint name)
+	{
+		auto name_itr{ std::find(names.begin(), names.end(), name) };
+		if (name_itr != names.end())
+		{
+			return static_cast<std::size_t>(name_itr - names.begin());
+		}
+
+		names.push_back(name);
+		return names.size() - 1;
+	}
+};
+
+
+#endif // !__RENDER_QUEUE_HPP__
@@ -0,0 +1,52 @@
+#ifndef __RENDER_STATS_HPP__
+#define __RENDER_STATS_HPP__
+
+#include <iostream>
+#include <cstddef>
+
+
+// per frame counters of the GL work submitted by the demo, reset at the start of every frame.
+struct render_stats
+{
+	std::size_t draw_calls_{};
+	// submitted for rasterization, instances included.
+	std::size_t triangles_{};
+	// state switches made for drawing, uploads not included.
+	std::size_t program_binds_{};
+	std::size_t VAO_binds_{};
+	std::size_t texture_binds_{};
+	// switches render_state skipped because the state was already set.
+	std::size_t redundant_binds_{};
+
+	static render_stats& current()noexcept
+	{
+		static render_stats stats{};
+		return stats;
+	}
+
+	void reset()noexcept
+	{
+		*this = render_stats{};
+	}
+
+	// sums frames, for averages over a benchmark run.
+	render_stats& operator+=(const render_stats& frame)noexcept
+	{
+		this->draw_calls_ += frame.draw_calls_;
+		this->triangles_ += frame.triangles_;
+		this->program_binds_ += frame.program_binds_;
+		this->VAO_binds_ += frame.VAO_binds_;
+		this->texture_binds_ += frame.texture_binds_;
+		this->redundant_binds_ += frame.redundant_binds_;
+		return *this;
+	}
+
+	void print(std::ostream& out)const
+	{
+		out << "draw calls: " << this->draw_calls_ << ", triangles: " << this->triangles_ << ", binds: " << this->program_binds_ << " program, "
+			<< this->VAO_binds_ << " VAO, " << this->texture_binds_ << " texture, " << this->redundant_binds_ << " redundant skipped";
+	}
+};
+
+
+#endif // !__RENDER_STATS_HPP__
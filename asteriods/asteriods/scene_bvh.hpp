@@ -0,0 +1,162 @@
+#ifndef __SCENE_BVH_HPP__
+#define __SCENE_BVH_HPP__
+
+#include <glm/glm.hpp>
+
+#include "bvh.hpp"
+#include "frustum.hpp"
+#include "model.hpp"
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+
+struct scene_hit
+{
+	std::uint32_t instance_{ BVH_NO_ITEM };
+	// index into the instance model's get_meshes().
+	std::uint32_t mesh_{ BVH_NO_ITEM };
+	float distance_{ std::numeric_limits<float>::max() };
+
+	bool is_hit()const noexcept
+	{
+		return this->instance_ != BVH_NO_ITEM;
+	}
+};
+
+
+// placed models, with a hierarchy over their world boxes on top of each model's own hierarchy over its meshes.
+// set_transform() only records the move, refit() applies every move since the last call: per instance up its
+// path for a few of them, one pass over the whole tree for many. the models must outlive the scene.
+class scene_bvh final
+{
+private:
+	struct instance
+	{
+		const model_loader* model_{ nullptr };
+		glm::mat4 transform_{ 1.0f };
+		glm::mat4 inverse_transform_{ 1.0f };
+	};
+
+	std::vector<instance> instances_{};
+	std::vector<bounding_box> boxes_{};
+	std::vector<std::uint32_t> moved_{};
+	bounding_volume_hierarchy bvh_{};
+	bool built_{ false };
+
+public:
+	scene_bvh() = default;
+	scene_bvh(const scene_bvh&) = delete;
+	scene_bvh& operator=(const scene_bvh&) = delete;
+
+	// the model's meshes must be loaded(see model_loader::load_vertices_data()). rebuilds on the next refit().
+	std::uint32_t add(const model_loader& model, const glm::mat4& transform)
+	{
+		instance new_instance{};
+		new_instance.model_ = &model;
+		new_instance.transform_ = transform;
+		new_instance.inverse_transform_ = glm::inverse(transform);
+
+		this->instances_.push_back(new_instance);
+		this->boxes_.push_back(model.get_box().transformed(transform));
+		this->built_ = false;
+		return static_cast<std::uint32_t>(this->instances_.size() - 1);
+	}
+
+	void set_transform(std::uint32_t instance_index, const glm::mat4& transform)
+	{
+		instance& the_instance{ this->instances_[instance_index] };
+		the_instance.transform_ = transform;
+		the_instance.inverse_transform_ = glm::inverse(transform);
+		this->boxes_[instance_index] = the_instance.model_->get_box().transformed(transform);
+		this->moved_.push_back(instance_index);
+	}
+
+	const glm::mat4& get_transform(std::uint32_t instance_index)const
+	{
+		return this->instances_[instance_index].transform_;
+	}
+
+	std::size_t get_instance_count()const noexcept
+	{
+		return this->instances_.size();
+	}
+
+	const bounding_volume_hierarchy& get_bvh()const noexcept
+	{
+		return this->bvh_;
+	}
+
+	void refit()
+	{
+		if (!this->built_)
+		{
+			this->bvh_.build(this->boxes_);
+			this->built_ = true;
+		}
+		else if (this->moved_.size() * 8 > this->instances_.size())
+		{
+			// a path per instance would touch most nodes several times.
+			this->bvh_.refit(this->boxes_);
+		}
+		else
+		{
+			for (std::uint32_t instance_index : this->moved_)
+			{
+				this->bvh_.update(instance_index, this->boxes_[instance_index]);
+			}
+		}
+
+		this->moved_.clear();
+	}
+
+	// indices of the instances whose world box touches the frustum.
+	void query_frustum(const frustum& view_frustum, std::vector<std::uint32_t>& visible)const
+	{
+		this->bvh_.query_frustum(view_frustum, visible);
+	}
+
+	// the nearest mesh box along the ray: the scene tree finds candidate instances, each instance's
+	// model tree is searched in model space, with distances kept in world units along the_ray.
+	scene_hit pick(const ray& the_ray, float max_distance = std::numeric_limits<float>::max())const
+	{
+		scene_hit hit{};
+		bvh_hit instance_hit{ this->bvh_.raycast(the_ray, max_distance,
+			[this, &the_ray, &hit](std::uint32_t instance_index, float, float closest_distance)
+		{
+			const instance& the_instance{ this->instances_[instance_index] };
+			bvh_hit mesh_hit{ the_instance.model_->get_bvh().raycast(the_ray.transformed(the_instance.inverse_transform_), closest_distance) };
+			if (!mesh_hit.is_hit())
+			{
+				return -1.0f;
+			}
+
+			// the tree takes it only when it is closer than closest_distance, which raycast already ensured.
+			hit.mesh_ = mesh_hit.item_;
+			return mesh_hit.distance_;
+		}) };
+
+		if (instance_hit.is_hit())
+		{
+			hit.instance_ = instance_hit.item_;
+			hit.distance_ = instance_hit.distance_;
+		}
+		else
+		{
+			hit.mesh_ = BVH_NO_ITEM;
+		}
+
+		return hit;
+	}
+
+	// the instance whose world box is nearest to point.
+	bvh_hit nearest(const glm::vec3& point, float max_distance = std::numeric_limits<float>::max())const
+	{
+		return this->bvh_.nearest(point, max_distance);
+	}
+};
+
+
+#endif // !__SCENE_BVH_HPP__
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "virtual_file_system.hpp"
+
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -14,6 +16,7 @@ enum class shader_type
 	vertex_shader,
 	geometry_shader,
 	fragment_shader,
+	compute_shader,
 	program
 };
 
@@ -26,17 +29,22 @@ public:
 
 	static GLuint create(const std::basic_string<char>& glsl_file, shader_type type)
 	{
-		assert(!glsl_file.empty()); 
-		std::basic_ifstream<char> file_reader{ glsl_file };
+		return shader::compile(shader::read_source(glsl_file), type);
+	}
 
-		assert(file_reader.is_open());
+	static std::basic_string<char> read_source(const std::basic_string<char>& glsl_file)
+	{
+		assert(!glsl_file.empty()); 
+		asset_view file_view{ virtual_file_system::shared().open(glsl_file) };
 
-		std::basic_ostringstream<char> file_buffer_reader{};
-		std::basic_filebuf<char>* file_buffer_ptr = file_reader.rdbuf();
+		assert(file_view.is_open());
 
-		// read data which is in file.
-		file_buffer_reader << file_buffer_ptr;
+		// read data which is in file, a pack or the loose file.
+		return file_view.to_string();
+	}
 
+	static GLuint compile(const std::basic_string<char>& shader_source, shader_type type)
+	{
 		GLuint shader_id{};
 
 		if (type == shader_type::vertex_shader)
@@ -54,7 +62,11 @@ public:
 			shader_id = glCreateShader(GL_GEOMETRY_SHADER);
 		}
 
-		std::basic_string<char> shader_source{ file_buffer_reader.str() };
+		if (type == shader_type::compute_shader)
+		{
+			shader_id = glCreateShader(GL_COMPUTE_SHADER);
+		}
+
 		const char* c_shader_source_str{ shader_source.c_str() };
 		glShaderSource(shader_id, 1, &c_shader_source_str, nullptr);
 		glCompileShader(shader_id);
@@ -130,7 +142,8 @@ public:
 		GLint success{};
 		GLchar error_log[1024]{};
 
-		if (type == shader_type::vertex_shader || type == shader_type::fragment_shader || type == shader_type::geometry_shader)
+		if (type == shader_type::vertex_shader || type == shader_type::fragment_shader || type == shader_type::geometry_shader ||
+			type == shader_type::compute_shader)
 		{
 			glGetShaderiv(id, GL_COMPILE_STATUS, &success);
 
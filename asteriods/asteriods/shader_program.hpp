@@ -0,0 +1,448 @@
+#ifndef __SHADER_PROGRAM_HPP__
+#define __SHADER_PROGRAM_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+
+// maps a C++ value type to the GLSL uniform types it may be written to, and how to upload/read it.
+template<typename T>
+struct uniform_traits;
+
+template<>
+struct uniform_traits<float>
+{
+	using storage_type = GLfloat;
+	static bool accepts(GLenum type)noexcept { return type == GL_FLOAT; }
+	static storage_type to_storage(float value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniform1f(location, value); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformfv(program_id, location, &value); }
+};
+
+template<>
+struct uniform_traits<int>
+{
+	using storage_type = GLint;
+
+	// samplers are set through their texture unit.
+	static bool accepts(GLenum type)noexcept
+	{
+		switch (type)
+		{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_BUFFER:
+		case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_INT_SAMPLER_2D:
+		case GL_INT_SAMPLER_BUFFER:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static storage_type to_storage(int value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniform1i(location, value); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformiv(program_id, location, &value); }
+};
+
+template<>
+struct uniform_traits<bool>
+{
+	using storage_type = GLint;
+	static bool accepts(GLenum type)noexcept { return type == GL_BOOL; }
+	static storage_type to_storage(bool value)noexcept { return value ? 1 : 0; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniform1i(location, value); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformiv(program_id, location, &value); }
+};
+
+template<>
+struct uniform_traits<GLuint>
+{
+	using storage_type = GLuint;
+	static bool accepts(GLenum type)noexcept { return type == GL_UNSIGNED_INT; }
+	static storage_type to_storage(GLuint value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniform1ui(location, value); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformuiv(program_id, location, &value); }
+};
+
+template<>
+struct uniform_traits<glm::vec2>
+{
+	using storage_type = glm::vec2;
+	static bool accepts(GLenum type)noexcept { return type == GL_FLOAT_VEC2; }
+	static storage_type to_storage(const glm::vec2& value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniform2fv(location, 1, &value[0]); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformfv(program_id, location, &value[0]); }
+};
+
+template<>
+struct uniform_traits<glm::vec3>
+{
+	using storage_type = glm::vec3;
+	static bool accepts(GLenum type)noexcept { return type == GL_FLOAT_VEC3; }
+	static storage_type to_storage(const glm::vec3& value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniform3fv(location, 1, &value[0]); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformfv(program_id, location, &value[0]); }
+};
+
+template<>
+struct uniform_traits<glm::vec4>
+{
+	using storage_type = glm::vec4;
+	static bool accepts(GLenum type)noexcept { return type == GL_FLOAT_VEC4; }
+	static storage_type to_storage(const glm::vec4& value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniform4fv(location, 1, &value[0]); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformfv(program_id, location, &value[0]); }
+};
+
+template<>
+struct uniform_traits<glm::mat3>
+{
+	using storage_type = glm::mat3;
+	static bool accepts(GLenum type)noexcept { return type == GL_FLOAT_MAT3; }
+	static storage_type to_storage(const glm::mat3& value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformfv(program_id, location, &value[0][0]); }
+};
+
+template<>
+struct uniform_traits<glm::mat4>
+{
+	using storage_type = glm::mat4;
+	static bool accepts(GLenum type)noexcept { return type == GL_FLOAT_MAT4; }
+	static storage_type to_storage(const glm::mat4& value)noexcept { return value; }
+	static void upload(GLint location, const storage_type& value)noexcept { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+	static void read(GLuint program_id, GLint location, storage_type& value)noexcept { glGetUniformfv(program_id, location, &value[0][0]); }
+};
+
+
+// resolved once by shader_program::get_uniform(), setting through it costs no lookup at all.
+// an invalid handle(unknown name or wrong type) is accepted by set() and ignored, like location -1 is by glUniform*.
+template<typename T>
+struct uniform_handle
+{
+	GLint location_{ -1 };
+	std::uint32_t shadow_offset_{};
+
+	bool is_valid()const noexcept
+	{
+		return this->location_ >= 0;
+	}
+};
+
+
+// wraps a linked program: reflects every active uniform once, hands out typed handles and skips uploads of unchanged values.
+class shader_program final
+{
+private:
+	struct uniform_info
+	{
+		std::uint64_t hash_{};
+		std::uint32_t name_offset_{};
+		std::uint32_t name_length_{};
+		GLint location_{ -1 };
+		GLenum type_{};
+		std::uint32_t shadow_offset_{};
+	};
+
+	GLuint id_{};
+
+	// open addressing, linear probing, capacity is a power of two and at most half full. empty slots have location_ -1.
+	std::vector<uniform_info> uniforms_{};
+	std::basic_string<char> names_{};
+
+	// last value uploaded to every uniform, seeded from the program at reflection.
+	std::vector<unsigned char> shadow_values_{};
+
+	std::size_t upload_count_{};
+	std::size_t skipped_count_{};
+
+public:
+	explicit shader_program(GLuint program_id)
+		: id_{ program_id }
+	{
+		this->reflect();
+	}
+
+	shader_program(const shader_program&) = delete;
+	shader_program& operator=(const shader_program&) = delete;
+
+	GLuint get_id()const noexcept
+	{
+		return this->id_;
+	}
+
+	void use()const noexcept
+	{
+		glUseProgram(this->id_);
+	}
+
+	std::size_t get_upload_count()const noexcept
+	{
+		return this->upload_count_;
+	}
+
+	std::size_t get_skipped_count()const noexcept
+	{
+		return this->skipped_count_;
+	}
+
+	void reset_counters()noexcept
+	{
+		this->upload_count_ = 0;
+		this->skipped_count_ = 0;
+	}
+
+	// look the uniform up once, keep the handle. array elements are addressed as "name[i]", struct members as "name.member".
+	template<typename T>
+	uniform_handle<T> get_uniform(const char* name)const
+	{
+		uniform_handle<T> handle{};
+
+		const uniform_info* info{ this->find(name, std::strlen(name)) };
+		if (!info)
+		{
+			return handle;
+		}
+
+		if (!uniform_traits<T>::accepts(info->type_))
+		{
+			assert(false && "uniform type does not match the handle type");
+			return handle;
+		}
+
+		handle.location_ = info->location_;
+		handle.shadow_offset_ = info->shadow_offset_;
+		return handle;
+	}
+
+	// the program must be in use.
+	template<typename T, typename Value>
+	void set(const uniform_handle<T>& handle, const Value& value)
+	{
+		using traits = uniform_traits<T>;
+		using storage_type = typename traits::storage_type;
+
+		if (!handle.is_valid())
+		{
+			return;
+		}
+
+		storage_type stored{ traits::to_storage(value) };
+		unsigned char* shadow{ &this->shadow_values_[handle.shadow_offset_] };
+		if (std::memcmp(shadow, &stored, sizeof(storage_type)) == 0)
+		{
+			++this->skipped_count_;
+			return;
+		}
+
+		std::memcpy(shadow, &stored, sizeof(storage_type));
+		traits::upload(handle.location_, stored);
+		++this->upload_count_;
+	}
+
+private:
+	static std::uint64_t hash_name(const char* name, std::size_t length)noexcept
+	{
+		// 64-bit FNV-1a.
+		std::uint64_t hash{ 14695981039346656037ull };
+		for (std::size_t index = 0; index < length; ++index)
+		{
+			hash ^= static_cast<unsigned char>(name[index]);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	const uniform_info* find(const char* name, std::size_t length)const noexcept
+	{
+		if (this->uniforms_.empty())
+		{
+			return nullptr;
+		}
+
+		std::uint64_t hash{ shader_program::hash_name(name, length) };
+		std::size_t mask{ this->uniforms_.size() - 1 };
+
+		for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+		{
+			const uniform_info& info{ this->uniforms_[slot] };
+			if (info.location_ < 0)
+			{
+				return nullptr;
+			}
+
+			if (info.hash_ == hash && info.name_length_ == length &&
+				std::memcmp(this->names_.data() + info.name_offset_, name, length) == 0)
+			{
+				return &info;
+			}
+		}
+	}
+
+	void insert(const std::basic_string<char>& name, GLint location, GLenum type, std::uint32_t shadow_offset)
+	{
+		uniform_info info{};
+		info.hash_ = shader_program::hash_name(name.data(), name.size());
+		info.name_offset_ = static_cast<std::uint32_t>(this->names_.size());
+		info.name_length_ = static_cast<std::uint32_t>(name.size());
+		info.location_ = location;
+		info.type_ = type;
+		info.shadow_offset_ = shadow_offset;
+		this->names_ += name;
+
+		std::size_t mask{ this->uniforms_.size() - 1 };
+		std::size_t slot{ info.hash_ & mask };
+		while (this->uniforms_[slot].location_ >= 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		this->uniforms_[slot] = info;
+	}
+
+	static std::size_t shadow_size(GLenum type)noexcept
+	{
+		switch (type)
+		{
+		case GL_FLOAT_VEC2: return sizeof(GLfloat) * 2;
+		case GL_FLOAT_VEC3: return sizeof(GLfloat) * 3;
+		case GL_FLOAT_VEC4: return sizeof(GLfloat) * 4;
+		case GL_FLOAT_MAT2: return sizeof(GLfloat) * 4;
+		case GL_FLOAT_MAT3: return sizeof(GLfloat) * 9;
+		case GL_FLOAT_MAT4: return sizeof(GLfloat) * 16;
+		default: return sizeof(GLfloat);
+		}
+	}
+
+	void seed_shadow(GLint location, GLenum type, std::uint32_t shadow_offset)
+	{
+		unsigned char* shadow{ &this->shadow_values_[shadow_offset] };
+
+		if (uniform_traits<int>::accepts(type))
+		{
+			glGetUniformiv(this->id_, location, reinterpret_cast<GLint*>(shadow));
+		}
+		else if (type == GL_UNSIGNED_INT)
+		{
+			glGetUniformuiv(this->id_, location, reinterpret_cast<GLuint*>(shadow));
+		}
+		else
+		{
+			glGetUniformfv(this->id_, location, reinterpret_cast<GLfloat*>(shadow));
+		}
+	}
+
+	void reflect()
+	{
+		GLint active_uniforms{};
+		GLint max_name_length{};
+		glGetProgramiv(this->id_, GL_ACTIVE_UNIFORMS, &active_uniforms);
+		glGetProgramiv(this->id_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+		struct reflected_uniform
+		{
+			std::basic_string<char> name_;
+			GLint location_;
+			GLenum type_;
+		};
+
+		std::vector<reflected_uniform> reflected{};
+		std::vector<GLchar> name_buffer(static_cast<std::size_t>(max_name_length) + 1);
+
+		for (GLint index = 0; index < active_uniforms; ++index)
+		{
+			GLsizei name_length{};
+			GLint array_size{};
+			GLenum type{};
+			glGetActiveUniform(this->id_, static_cast<GLuint>(index), static_cast<GLsizei>(name_buffer.size()), &name_length, &array_size, &type, name_buffer.data());
+
+			std::basic_string<char> name{ name_buffer.data(), static_cast<std::size_t>(name_length) };
+
+			// arrays are reported once as "name[0]", every element has its own location.
+			std::basic_string<char> base_name{ name };
+			if (base_name.size() > 3 && base_name.compare(base_name.size() - 3, 3, "[0]") == 0)
+			{
+				base_name.resize(base_name.size() - 3);
+			}
+
+			for (GLint element = 0; element < array_size; ++element)
+			{
+				std::basic_string<char> element_name{ array_size > 1 || base_name != name ? base_name + '[' + std::to_string(element) + ']' : name };
+				GLint location{ glGetUniformLocation(this->id_, element_name.c_str()) };
+
+				// members of uniform blocks have no location.
+				if (location < 0)
+				{
+					continue;
+				}
+
+				reflected.push_back(reflected_uniform{ element_name, location, type });
+
+				// "name" is an alias of "name[0]".
+				if (element == 0 && element_name != base_name)
+				{
+					reflected.push_back(reflected_uniform{ base_name, location, type });
+				}
+			}
+		}
+
+		std::size_t capacity{ 8 };
+		while (capacity < reflected.size() * 2)
+		{
+			capacity *= 2;
+		}
+
+		this->uniforms_.assign(capacity, uniform_info{});
+
+		for (const reflected_uniform& uniform : reflected)
+		{
+			// an alias shares the shadow of the element it names, so both see the same last value.
+			const uniform_info* existing{ nullptr };
+			for (const uniform_info& info : this->uniforms_)
+			{
+				if (info.location_ == uniform.location_)
+				{
+					existing = &info;
+					break;
+				}
+			}
+
+			std::uint32_t shadow_offset{};
+			if (existing)
+			{
+				shadow_offset = existing->shadow_offset_;
+			}
+			else
+			{
+				shadow_offset = static_cast<std::uint32_t>(this->shadow_values_.size());
+				this->shadow_values_.resize(this->shadow_values_.size() + shader_program::shadow_size(uniform.type_));
+				this->seed_shadow(uniform.location_, uniform.type_, shadow_offset);
+			}
+
+			this->insert(uniform.name_, uniform.location_, uniform.type_, shadow_offset);
+		}
+	}
+};
+
+
+#endif // !__SHADER_PROGRAM_HPP__
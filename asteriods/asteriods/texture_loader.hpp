@@ -0,0 +1,334 @@
+#ifndef __TEXTURE_LOADER_HPP__
+#define __TEXTURE_LOADER_HPP__
+
+#include <glad/glad.h>
+
+#include "thread_pool.hpp"
+#include "virtual_file_system.hpp"
+#include "compressed_texture.hpp"
+#include "mip_generator.hpp"
+#include "stb_image/stb_image.h"
+
+#include <string>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+#include <cstddef>
+
+
+// decodes image files on the worker pool and uploads them on the GL thread within a per frame byte budget.
+// a requested texture name is valid immediately: it holds a 1x1 placeholder until its image has been uploaded.
+// a cooked .dds/.ktx2 next to the image(see texture_cooker) is uploaded as it is when the context can sample its format,
+// a decoded image gets its mipmaps from mip_generator on the same worker, so the GL thread only copies levels.
+class texture_loader final
+{
+private:
+	struct decoded_texture
+	{
+		GLuint texture_id_{};
+		std::basic_string<char> file_path_{};
+		int width_{};
+		int height_{};
+		int components_{};
+		std::unique_ptr<unsigned char, void(*)(void*)> data_{ nullptr, stbi_image_free };
+		// every level below data_.
+		std::vector<mip_level> mips_{};
+		// used instead of data_ when it has levels.
+		compressed_image compressed_{};
+		// what the upload moves to the GPU, counted against the upload budget.
+		std::size_t bytes_{};
+	};
+
+	std::deque<decoded_texture> decoded_textures_{};
+	std::size_t decoding_count_{};
+
+	// GL thread only: textures not uploaded yet, and the ones among them which were discarded meanwhile.
+	std::unordered_set<GLuint> pending_ids_{};
+	std::unordered_set<GLuint> discarded_ids_{};
+
+	std::function<void(GLuint, std::size_t)> upload_listener_{};
+
+	// GL thread only, queried on the first load().
+	bool formats_queried_{ false };
+	compressed_format_mask supported_formats_{};
+
+	std::mutex mutex_{};
+	std::condition_variable idle_condition_{};
+
+	texture_loader() = default;
+
+public:
+	texture_loader(const texture_loader&) = delete;
+	texture_loader& operator=(const texture_loader&) = delete;
+
+	~texture_loader()
+	{
+		// decode tasks still running on the pool refer to this object.
+		std::unique_lock<std::mutex> lock{ this->mutex_ };
+		this->idle_condition_.wait(lock, [this]() { return this->decoding_count_ == 0; });
+	}
+
+	// must be first called on the GL thread.
+	static texture_loader& shared()
+	{
+		static texture_loader loader{};
+		return loader;
+	}
+
+	// GL thread only. returns a texture name which samples as the placeholder until the file is decoded and uploaded.
+	// mip_options says how the mipmaps of a decoded image are filtered, cooked files bring their own.
+	GLuint load(const std::basic_string<char>& file_path, const mip_options& options = mip_options{})
+	{
+		static constexpr const unsigned char placeholder_pixel[4]{ 128, 128, 128, 255 };
+
+		GLuint texture_id{};
+		glGenTextures(1, &texture_id);
+
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder_pixel);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex_ };
+			++this->decoding_count_;
+		}
+
+		this->pending_ids_.insert(texture_id);
+
+		if (!this->formats_queried_)
+		{
+			this->supported_formats_ = compressed_texture::query_support();
+			this->formats_queried_ = true;
+		}
+
+		compressed_format_mask supported_formats{ this->supported_formats_ };
+		thread_pool::shared().submit([this, texture_id, file_path, supported_formats, options]()
+		{
+			decoded_texture decoded{};
+			decoded.texture_id_ = texture_id;
+			decoded.file_path_ = file_path;
+
+			// nobody waits on this task's future, so a throwing decode must still count itself done and hand back
+			// an empty texture(which keeps its placeholder), or finish() and the destructor would wait forever.
+			try
+			{
+				decoded = texture_loader::decode(texture_id, file_path, supported_formats, options);
+			}
+			catch (const std::exception& error)
+			{
+				std::cout << "TEXTURE_LOADER:: decoding " << file_path << " failed: " << error.what() << std::endl;
+			}
+			catch (...)
+			{
+				std::cout << "TEXTURE_LOADER:: decoding " << file_path << " failed" << std::endl;
+			}
+
+			std::lock_guard<std::mutex> lock{ this->mutex_ };
+			try
+			{
+				this->decoded_textures_.push_back(std::move(decoded));
+			}
+			catch (...)
+			{
+				// out of memory even for the queue entry: the name stays pending and keeps its placeholder.
+			}
+			--this->decoding_count_;
+			this->idle_condition_.notify_all();
+		});
+
+		return texture_id;
+	}
+
+	// GL thread only. uploads decoded images until byte_budget is used up, at least one image is uploaded per call
+	// so a texture larger than the budget still makes progress. returns the number of textures uploaded.
+	std::size_t upload_pending(std::size_t byte_budget)
+	{
+		std::size_t uploaded_count{ 0 };
+		std::size_t uploaded_bytes{ 0 };
+
+		for (;;)
+		{
+			decoded_texture decoded{};
+
+			{
+				std::lock_guard<std::mutex> lock{ this->mutex_ };
+				if (this->decoded_textures_.empty())
+				{
+					break;
+				}
+
+				std::size_t bytes{ this->decoded_textures_.front().bytes_ };
+				if (uploaded_count > 0 && uploaded_bytes + bytes > byte_budget)
+				{
+					break;
+				}
+
+				decoded = std::move(this->decoded_textures_.front());
+				this->decoded_textures_.pop_front();
+				uploaded_bytes += bytes;
+			}
+
+			this->pending_ids_.erase(decoded.texture_id_);
+			if (this->discarded_ids_.erase(decoded.texture_id_) != 0)
+			{
+				glDeleteTextures(1, &decoded.texture_id_);
+				continue;
+			}
+
+			std::size_t resident_bytes{ texture_loader::upload(decoded) };
+			if (this->upload_listener_)
+			{
+				this->upload_listener_(decoded.texture_id_, resident_bytes);
+			}
+			++uploaded_count;
+		}
+
+		return uploaded_count;
+	}
+
+	// GL thread only. blocks until every requested texture has been decoded and uploaded.
+	void finish()
+	{
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ this->mutex_ };
+				this->idle_condition_.wait(lock, [this]() { return this->decoding_count_ == 0 || !this->decoded_textures_.empty(); });
+
+				if (this->decoding_count_ == 0 && this->decoded_textures_.empty())
+				{
+					return;
+				}
+			}
+
+			this->upload_pending(static_cast<std::size_t>(-1));
+		}
+	}
+
+	// GL thread only. deletes a texture returned by load(), if it is still being decoded the deletion happens once the decode is done.
+	void discard(GLuint texture_id)
+	{
+		if (this->pending_ids_.count(texture_id) != 0)
+		{
+			this->discarded_ids_.insert(texture_id);
+			return;
+		}
+
+		glDeleteTextures(1, &texture_id);
+	}
+
+	// called on the GL thread with the texture name and its size in video memory(mipmaps included) after each upload.
+	void set_upload_listener(std::function<void(GLuint, std::size_t)> listener)
+	{
+		this->upload_listener_ = std::move(listener);
+	}
+
+	bool is_idle()
+	{
+		std::lock_guard<std::mutex> lock{ this->mutex_ };
+		return this->decoding_count_ == 0 && this->decoded_textures_.empty();
+	}
+
+private:
+	// worker side of load(): a cooked file the context can sample, otherwise the image decoded and its mipmaps generated.
+	static decoded_texture decode(GLuint texture_id, const std::basic_string<char>& file_path, compressed_format_mask supported_formats, const mip_options& options)
+	{
+		decoded_texture decoded{};
+		decoded.texture_id_ = texture_id;
+		decoded.file_path_ = file_path;
+
+		for (const auto& cooked_file : compressed_texture::cooked_files(file_path))
+		{
+			compressed_image image{};
+			if (compressed_texture::parse(virtual_file_system::shared().open(cooked_file), image) &&
+				(supported_formats & compressed_texture::format_bit(image.format_)) != 0)
+			{
+				decoded.width_ = image.get_width();
+				decoded.height_ = image.get_height();
+				decoded.bytes_ = image.get_bytes();
+				decoded.compressed_ = std::move(image);
+				return decoded;
+			}
+		}
+
+		// stb reads the encoded file straight out of the mapping.
+		asset_view file_view{ virtual_file_system::shared().open(file_path) };
+		if (file_view.is_open())
+		{
+			decoded.data_.reset(stbi_load_from_memory(file_view.data_, static_cast<int>(file_view.size_),
+				&decoded.width_, &decoded.height_, &decoded.components_, 0));
+			decoded.bytes_ = static_cast<std::size_t>(decoded.width_) * decoded.height_ * decoded.components_;
+		}
+
+		if (decoded.data_)
+		{
+			static const mip_generator generator{};
+			decoded.mips_ = generator.generate(decoded.data_.get(), decoded.width_, decoded.height_, decoded.components_, options);
+			for (const mip_level& level : decoded.mips_)
+			{
+				decoded.bytes_ += level.pixels_.size();
+			}
+		}
+
+		return decoded;
+	}
+
+	// returns the bytes resident in video memory.
+	static std::size_t upload(const decoded_texture& decoded)
+	{
+		if (!decoded.compressed_.levels_.empty())
+		{
+			glBindTexture(GL_TEXTURE_2D, decoded.texture_id_);
+			std::size_t resident_bytes{ compressed_texture::upload(decoded.compressed_) };
+			glBindTexture(GL_TEXTURE_2D, 0);
+			return resident_bytes;
+		}
+
+		if (!decoded.data_)
+		{
+			// keep the placeholder, the material still renders.
+			std::cout << "Texture failed to load at path: " << decoded.file_path_ << std::endl;
+			return 4;
+		}
+
+		GLenum format{ GL_RGBA };
+		if (decoded.components_ == 1)
+			format = GL_RED;
+		else if (decoded.components_ == 2)
+			format = GL_RG;
+		else if (decoded.components_ == 3)
+			format = GL_RGB;
+		else if (decoded.components_ == 4)
+			format = GL_RGBA;
+
+		// rows of 1 and 3 component levels are tightly packed.
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindTexture(GL_TEXTURE_2D, decoded.texture_id_);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, decoded.width_, decoded.height_, 0, format, GL_UNSIGNED_BYTE, decoded.data_.get());
+		for (std::size_t level = 0; level < decoded.mips_.size(); ++level)
+		{
+			const mip_level& mip{ decoded.mips_[level] };
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level + 1), format, mip.width_, mip.height_, 0, format, GL_UNSIGNED_BYTE, mip.pixels_.data());
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(decoded.mips_.size()));
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		return decoded.bytes_;
+	}
+};
+
+
+#endif // !__TEXTURE_LOADER_HPP__
@@ -0,0 +1,345 @@
+#ifndef __TEXTURE_REGISTRY_HPP__
+#define __TEXTURE_REGISTRY_HPP__
+
+#include <glad/glad.h>
+
+#include "texture_loader.hpp"
+#include "virtual_file_system.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+struct texture_registry_stats
+{
+	std::size_t hits_{};
+	std::size_t misses_{};
+	std::size_t textures_resident_{};
+	std::size_t bytes_resident_{};
+};
+
+
+// process wide, reference counted texture cache shared by every model_loader.
+// textures are keyed by their normalized path and mip_options, so "a/./b.png" and "a\\b.png" share one GL texture
+// while the same file asked for as sRGB and as linear data gets one of each.
+// with content hashing enabled, different files holding identical bytes under the same options share one GL texture as well:
+// a hash match is confirmed against the owner's bytes, so a collision only costs an extra upload.
+// every function must be called on the GL thread.
+class texture_registry final
+{
+private:
+	struct path_hash
+	{
+		// 64-bit FNV-1a.
+		std::size_t operator()(const std::basic_string<char>& path)const noexcept
+		{
+			return static_cast<std::size_t>(texture_registry::hash_bytes(path.data(), path.size()));
+		}
+	};
+
+	struct entry
+	{
+		GLuint texture_id_{};
+		std::size_t reference_count_{};
+		std::size_t bytes_{};
+		std::uint64_t content_hash_{};
+		// the path the owner was loaded from and the options it was loaded with, to compare against on a content hash match.
+		std::basic_string<char> file_path_{};
+		std::basic_string<char> options_key_{};
+	};
+
+	// normalized path + options key -> texture.
+	std::unordered_map<std::basic_string<char>, entry, path_hash> entries_{};
+	// reverse lookups used by release() and the upload listener.
+	std::unordered_map<GLuint, std::basic_string<char>> paths_by_id_{};
+	// content hash(options included) -> key of the entry owning the GL texture.
+	std::unordered_map<std::uint64_t, std::basic_string<char>> paths_by_content_{};
+
+	bool content_hashing_{ false };
+	texture_registry_stats stats_{};
+
+	texture_registry()
+	{
+		texture_loader::shared().set_upload_listener([this](GLuint texture_id, std::size_t bytes)
+		{
+			auto path_itr{ this->paths_by_id_.find(texture_id) };
+			if (path_itr == this->paths_by_id_.end())
+			{
+				return;
+			}
+
+			entry& the_entry{ this->entries_[path_itr->second] };
+			this->stats_.bytes_resident_ -= the_entry.bytes_;
+			the_entry.bytes_ = bytes;
+			this->stats_.bytes_resident_ += the_entry.bytes_;
+		});
+	}
+
+public:
+	texture_registry(const texture_registry&) = delete;
+	texture_registry& operator=(const texture_registry&) = delete;
+
+	static texture_registry& shared()
+	{
+		static texture_registry registry{};
+		return registry;
+	}
+
+	// reads every new file once more to hash its bytes, worth it when assets are known to duplicate textures under several names.
+	void set_content_hashing(bool enabled)noexcept
+	{
+		this->content_hashing_ = enabled;
+	}
+
+	const texture_registry_stats& get_stats()const noexcept
+	{
+		return (this->stats_);
+	}
+
+	// returns the texture for file_path, loading it on first use with options. every acquire must be paired with a release.
+	GLuint acquire(const std::basic_string<char>& file_path, const mip_options& options = mip_options{})
+	{
+		std::basic_string<char> options_key{ texture_registry::options_key(options) };
+		std::basic_string<char> key{ texture_registry::normalize_path(file_path) + options_key };
+
+		auto entry_itr{ this->entries_.find(key) };
+		if (entry_itr != this->entries_.end())
+		{
+			++this->stats_.hits_;
+			return this->add_reference(entry_itr->second);
+		}
+
+		std::uint64_t content_hash{ 0 };
+		bool shares_hash{ false };
+		asset_view file_view{};
+		if (this->content_hashing_ && texture_registry::hash_file(file_path, options_key, file_view, content_hash))
+		{
+			auto content_itr{ this->paths_by_content_.find(content_hash) };
+			if (content_itr != this->paths_by_content_.end())
+			{
+				entry& alias{ this->entries_[content_itr->second] };
+				if (alias.options_key_ == options_key && texture_registry::same_bytes(file_view, alias.file_path_))
+				{
+					// another path already uploaded these bytes with these options: alias it.
+					++this->stats_.hits_;
+					this->entries_[key] = entry{ alias.texture_id_, 0, 0, content_hash };
+					return this->add_reference(alias);
+				}
+
+				// a collision, the first owner keeps the hash.
+				shares_hash = true;
+			}
+		}
+
+		++this->stats_.misses_;
+		++this->stats_.textures_resident_;
+
+		entry new_entry{};
+		new_entry.texture_id_ = texture_loader::shared().load(file_path, options);
+		new_entry.reference_count_ = 1;
+		new_entry.content_hash_ = shares_hash ? 0 : content_hash;
+		new_entry.file_path_ = file_path;
+		new_entry.options_key_ = options_key;
+
+		this->paths_by_id_[new_entry.texture_id_] = key;
+		if (new_entry.content_hash_ != 0)
+		{
+			this->paths_by_content_[content_hash] = key;
+		}
+
+		this->entries_[key] = new_entry;
+		return new_entry.texture_id_;
+	}
+
+	// drops one reference, the GL texture is deleted together with the last one.
+	void release(GLuint texture_id)
+	{
+		auto path_itr{ this->paths_by_id_.find(texture_id) };
+		if (path_itr == this->paths_by_id_.end())
+		{
+			return;
+		}
+
+		std::basic_string<char> owner_path{ path_itr->second };
+		entry& owner{ this->entries_[owner_path] };
+		if (owner.reference_count_ == 0 || --owner.reference_count_ != 0)
+		{
+			return;
+		}
+
+		--this->stats_.textures_resident_;
+		this->stats_.bytes_resident_ -= owner.bytes_;
+		texture_loader::shared().discard(texture_id);
+
+		if (owner.content_hash_ != 0)
+		{
+			this->paths_by_content_.erase(owner.content_hash_);
+		}
+
+		// the owner and every alias of it.
+		for (auto entry_itr = this->entries_.begin(); entry_itr != this->entries_.end();)
+		{
+			if (entry_itr->second.texture_id_ == texture_id)
+			{
+				entry_itr = this->entries_.erase(entry_itr);
+			}
+			else
+			{
+				++entry_itr;
+			}
+		}
+
+		this->paths_by_id_.erase(texture_id);
+	}
+
+	// frees the levels of an uploaded texture which is only sampled through a copy from now on(see material_library), its name
+	// and references stay valid and sample the 1x1 placeholder. later acquires of the same file get the placeholder too.
+	void trim(GLuint texture_id)
+	{
+		static constexpr const unsigned char placeholder_pixel[4]{ 128, 128, 128, 255 };
+
+		auto path_itr{ this->paths_by_id_.find(texture_id) };
+		if (path_itr == this->paths_by_id_.end())
+		{
+			return;
+		}
+
+		GLint max_level{};
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &max_level);
+		// a 0x0 image releases a level's storage, there is no call deleting one.
+		for (GLint level = 1; level <= max_level; ++level)
+		{
+			GLint width{};
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+			{
+				break;
+			}
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder_pixel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		entry& owner{ this->entries_[path_itr->second] };
+		this->stats_.bytes_resident_ -= owner.bytes_;
+		owner.bytes_ = sizeof(placeholder_pixel);
+		this->stats_.bytes_resident_ += owner.bytes_;
+	}
+
+	// lexically normalized path: one separator kind, no "." or "x\\.." segments, case folded where the file system ignores case.
+	static std::basic_string<char> normalize_path(const std::basic_string<char>& path)
+	{
+		std::vector<std::basic_string<char>> segments{};
+		std::basic_string<char> prefix{};
+		std::basic_string<char> segment{};
+
+		std::size_t index{ 0 };
+		if (!path.empty() && (path[0] == '/' || path[0] == '\\'))
+		{
+			prefix = "/";
+			index = 1;
+		}
+
+		for (; index <= path.size(); ++index)
+		{
+			if (index == path.size() || path[index] == '/' || path[index] == '\\')
+			{
+				if (segment == ".." && !segments.empty() && segments.back() != "..")
+				{
+					segments.pop_back();
+				}
+				else if (!segment.empty() && segment != ".")
+				{
+					segments.push_back(segment);
+				}
+
+				segment.clear();
+				continue;
+			}
+
+#ifdef _WIN32
+			segment.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(path[index]))));
+#else
+			segment.push_back(path[index]);
+#endif
+		}
+
+		std::basic_string<char> normalized{ prefix };
+		for (std::size_t segment_index = 0; segment_index < segments.size(); ++segment_index)
+		{
+			if (segment_index != 0)
+			{
+				normalized.push_back('/');
+			}
+
+			normalized += segments[segment_index];
+		}
+
+		return normalized;
+	}
+
+private:
+	GLuint add_reference(entry& the_entry)
+	{
+		auto owner_itr{ this->paths_by_id_.find(the_entry.texture_id_) };
+		++this->entries_[owner_itr->second].reference_count_;
+		return the_entry.texture_id_;
+	}
+
+	// appended to the normalized path: the NUL cannot occur in a path, every field that changes the uploaded levels follows it.
+	static std::basic_string<char> options_key(const mip_options& options)
+	{
+		std::uint32_t cutoff_bits{};
+		std::memcpy(&cutoff_bits, &options.alpha_cutoff_, sizeof(cutoff_bits));
+
+		std::basic_string<char> key(1, '\0');
+		key += std::to_string(static_cast<int>(options.filter_));
+		key += options.srgb_ ? ":srgb:" : ":linear:";
+		key += std::to_string(cutoff_bits);
+		return key;
+	}
+
+	static std::uint64_t hash_bytes(const char* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull)noexcept
+	{
+		for (std::size_t index = 0; index < size; ++index)
+		{
+			hash ^= static_cast<unsigned char>(data[index]);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	// the file's bytes followed by options_key, so only loads with the same options meet in paths_by_content_.
+	static bool hash_file(const std::basic_string<char>& file_path, const std::basic_string<char>& options_key, asset_view& file_view, std::uint64_t& content_hash)
+	{
+		file_view = virtual_file_system::shared().open(file_path);
+		if (!file_view.is_open())
+		{
+			return false;
+		}
+
+		content_hash = texture_registry::hash_bytes(reinterpret_cast<const char*>(file_view.data_), file_view.size_);
+		content_hash = texture_registry::hash_bytes(options_key.data(), options_key.size(), content_hash);
+		// 0 means "not hashed".
+		content_hash += (content_hash == 0);
+		return true;
+	}
+
+	static bool same_bytes(const asset_view& file_view, const std::basic_string<char>& other_path)
+	{
+		asset_view other_view{ virtual_file_system::shared().open(other_path) };
+		return other_view.is_open() && other_view.size_ == file_view.size_
+			&& std::memcmp(other_view.data_, file_view.data_, file_view.size_) == 0;
+	}
+};
+
+
+#endif // !__TEXTURE_REGISTRY_HPP__
@@ -0,0 +1,175 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+// fixed size worker pool, tasks run in submission order(but may finish in any order).
+class thread_pool final
+{
+private:
+	std::vector<std::thread> workers_{};
+	std::deque<std::function<void()>> tasks_{};
+
+	std::mutex mutex_{};
+	std::condition_variable condition_{};
+	bool stopping_{ false };
+
+public:
+	explicit thread_pool(std::size_t thread_count)
+	{
+		thread_count = std::max<std::size_t>(thread_count, 1);
+		this->workers_.reserve(thread_count);
+
+		for (std::size_t index = 0; index < thread_count; ++index)
+		{
+			this->workers_.emplace_back([this]() { this->run(); });
+		}
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex_ };
+			this->stopping_ = true;
+		}
+
+		this->condition_.notify_all();
+
+		for (std::thread& worker : this->workers_)
+		{
+			worker.join();
+		}
+	}
+
+	// process wide pool, one worker per hardware thread minus the GL thread.
+	static thread_pool& shared()
+	{
+		static thread_pool pool{ std::max<std::size_t>(std::thread::hardware_concurrency(), 2) - 1 };
+		return pool;
+	}
+
+	std::size_t get_thread_count()const noexcept
+	{
+		return this->workers_.size();
+	}
+
+	template<typename Function>
+	std::future<void> submit(Function&& function)
+	{
+		// std::function needs a copyable target, so the move-only task lives behind a shared_ptr.
+		auto task{ std::make_shared<std::packaged_task<void()>>(std::forward<Function>(function)) };
+		std::future<void> result{ task->get_future() };
+
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex_ };
+			this->tasks_.emplace_back([task]() { (*task)(); });
+		}
+
+		this->condition_.notify_one();
+		return result;
+	}
+
+	// run body(0) ... body(count - 1) across the pool, the calling thread helps and returns once all are done.
+	// the helpers reference this frame, so a throwing body stops the remaining indices being handed out but
+	// the first exception is only rethrown after every helper has returned.
+	template<typename Body>
+	void parallel_for(std::size_t count, const Body& body)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		std::atomic<std::size_t> next_index{ 0 };
+		auto worker_loop = [&next_index, count, &body]()
+		{
+			for (std::size_t index = next_index.fetch_add(1); index < count; index = next_index.fetch_add(1))
+			{
+				body(index);
+			}
+		};
+
+		std::size_t helper_count{ std::min(this->workers_.size(), count - 1) };
+		std::vector<std::future<void>> helpers{};
+		helpers.reserve(helper_count);
+
+		std::exception_ptr failure{};
+		try
+		{
+			for (std::size_t index = 0; index < helper_count; ++index)
+			{
+				helpers.push_back(this->submit(worker_loop));
+			}
+
+			worker_loop();
+		}
+		catch (...)
+		{
+			failure = std::current_exception();
+			next_index.store(count);
+		}
+
+		for (std::future<void>& helper : helpers)
+		{
+			try
+			{
+				helper.get();
+			}
+			catch (...)
+			{
+				if (!failure)
+				{
+					failure = std::current_exception();
+				}
+				next_index.store(count);
+			}
+		}
+
+		if (failure)
+		{
+			std::rethrow_exception(failure);
+		}
+	}
+
+private:
+	void run()
+	{
+		for (;;)
+		{
+			std::function<void()> task{};
+
+			{
+				std::unique_lock<std::mutex> lock{ this->mutex_ };
+				this->condition_.wait(lock, [this]() { return this->stopping_ || !this->tasks_.empty(); });
+
+				if (this->stopping_ && this->tasks_.empty())
+				{
+					return;
+				}
+
+				task = std::move(this->tasks_.front());
+				this->tasks_.pop_front();
+			}
+
+			task();
+		}
+	}
+};
+
+
+#endif // !__THREAD_POOL_HPP__
@@ -0,0 +1,265 @@
+#ifndef __VERTEX_FORMAT_HPP__
+#define __VERTEX_FORMAT_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+struct vertex
+{
+	glm::vec3 position_;
+	glm::vec3 normal_;
+	glm::vec2 texcoord_;
+
+	glm::vec3 tangent_;
+	glm::vec3 bitangent_;
+};
+
+
+enum class vertex_layout
+{
+	// vertex as it is, 56 bytes.
+	full,
+	// packed_vertex, 20 bytes.
+	packed
+};
+
+
+// position: unorm16 inside the mesh's box, w is the sign of the bitangent(0 negative, 65535 positive).
+// normal and tangent: octahedral, snorm16 each. texcoord: half floats.
+// the shader reads position and normal + tangent as vec4 attributes 0 and 1, texcoord as attribute 2.
+struct packed_vertex
+{
+	std::uint16_t position_[4];
+	std::int16_t normal_[2];
+	std::int16_t tangent_[2];
+	std::uint16_t texcoord_[2];
+};
+
+static_assert(sizeof(packed_vertex) == 20, "packed_vertex must stay tightly packed");
+
+
+// generic attribute locations of glsl/vertex_decode.glsl.
+static constexpr const GLuint VERTEX_DECODE_SCALE_LOCATION{ 8 };
+static constexpr const GLuint VERTEX_DECODE_OFFSET_LOCATION{ 9 };
+
+// how a mesh's attributes map back to model space: position * scale_ + offset_, scale_.w is 1 when normals are octahedral.
+// constant per draw: set with apply() before direct draws, multi draws fetch it per command as an instanced attribute.
+struct vertex_decode
+{
+	glm::vec4 scale_{ 1.0f, 1.0f, 1.0f, 0.0f };
+	glm::vec4 offset_{ 0.0f, 0.0f, 0.0f, 0.0f };
+
+	void apply()const
+	{
+		glVertexAttrib4fv(VERTEX_DECODE_SCALE_LOCATION, &this->scale_[0]);
+		glVertexAttrib4fv(VERTEX_DECODE_OFFSET_LOCATION, &this->offset_[0]);
+	}
+};
+
+
+// the largest difference between a mesh and its packed copy.
+struct vertex_precision
+{
+	// in model units, and relative to the diagonal of the mesh's box.
+	float position_error_{};
+	float relative_position_error_{};
+	float normal_error_degrees_{};
+	float texcoord_error_{};
+
+	void merge(const vertex_precision& other)
+	{
+		this->position_error_ = std::max(this->position_error_, other.position_error_);
+		this->relative_position_error_ = std::max(this->relative_position_error_, other.relative_position_error_);
+		this->normal_error_degrees_ = std::max(this->normal_error_degrees_, other.normal_error_degrees_);
+		this->texcoord_error_ = std::max(this->texcoord_error_, other.texcoord_error_);
+	}
+};
+
+
+class vertex_packer final
+{
+public:
+	// packs into the box spanned by the vertices, decode gets what undoes it.
+	static std::vector<packed_vertex> pack(const vertex* vertices, std::size_t count, vertex_decode& decode)
+	{
+		glm::vec3 box_min{ count == 0 ? glm::vec3{ 0.0f } : vertices[0].position_ };
+		glm::vec3 box_max{ box_min };
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			box_min = glm::min(box_min, vertices[index].position_);
+			box_max = glm::max(box_max, vertices[index].position_);
+		}
+
+		// a flat box keeps a size of 1 along its flat axis, every value there is 0 anyway.
+		glm::vec3 size{ box_max - box_min };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			size[axis] = size[axis] > 0.0f ? size[axis] : 1.0f;
+		}
+
+		decode.scale_ = glm::vec4{ size, 1.0f };
+		decode.offset_ = glm::vec4{ box_min, 0.0f };
+
+		std::vector<packed_vertex> packed(count);
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			const vertex& source{ vertices[index] };
+			packed_vertex& target{ packed[index] };
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float unit{ (source.position_[axis] - box_min[axis]) / size[axis] };
+				target.position_[axis] = static_cast<std::uint16_t>(std::lround(std::min(std::max(unit, 0.0f), 1.0f) * 65535.0f));
+			}
+
+			bool right_handed{ glm::dot(glm::cross(source.normal_, source.tangent_), source.bitangent_) >= 0.0f };
+			target.position_[3] = right_handed ? 65535 : 0;
+
+			vertex_packer::encode_octahedral(source.normal_, target.normal_);
+			vertex_packer::encode_octahedral(source.tangent_, target.tangent_);
+			target.texcoord_[0] = vertex_packer::to_half(source.texcoord_.x);
+			target.texcoord_[1] = vertex_packer::to_half(source.texcoord_.y);
+		}
+
+		return packed;
+	}
+
+	// decodes every vertex the way glsl/vertex_decode.glsl does and compares.
+	static vertex_precision measure(const vertex* vertices, const packed_vertex* packed, std::size_t count, const vertex_decode& decode)
+	{
+		vertex_precision precision{};
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			const vertex& source{ vertices[index] };
+			const packed_vertex& target{ packed[index] };
+
+			glm::vec3 position{};
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				position[axis] = target.position_[axis] / 65535.0f * decode.scale_[axis] + decode.offset_[axis];
+			}
+			precision.position_error_ = std::max(precision.position_error_, glm::length(position - source.position_));
+
+			float source_length{ glm::length(source.normal_) };
+			if (source_length > 0.0f)
+			{
+				float cosine{ glm::dot(vertex_packer::decode_octahedral(target.normal_), source.normal_ / source_length) };
+				float degrees{ std::acos(std::min(std::max(cosine, -1.0f), 1.0f)) * 57.2957795f };
+				precision.normal_error_degrees_ = std::max(precision.normal_error_degrees_, degrees);
+			}
+
+			glm::vec2 texcoord{ vertex_packer::from_half(target.texcoord_[0]), vertex_packer::from_half(target.texcoord_[1]) };
+			precision.texcoord_error_ = std::max(precision.texcoord_error_,
+				std::max(std::fabs(texcoord.x - source.texcoord_.x), std::fabs(texcoord.y - source.texcoord_.y)));
+		}
+
+		float diagonal{ glm::length(glm::vec3{ decode.scale_ }) };
+		precision.relative_position_error_ = diagonal > 0.0f ? precision.position_error_ / diagonal : 0.0f;
+		return precision;
+	}
+
+	// Cigolle et al. 2014: the unit sphere folded onto an octahedron, then onto the square [-1, 1]^2.
+	static void encode_octahedral(const glm::vec3& direction, std::int16_t encoded[2])
+	{
+		float sum{ std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z) };
+		glm::vec2 point{ sum > 0.0f ? glm::vec2{ direction.x / sum, direction.y / sum } : glm::vec2{ 0.0f, 0.0f } };
+		if (direction.z < 0.0f)
+		{
+			point = glm::vec2{ (1.0f - std::fabs(point.y)) * vertex_packer::sign_not_zero(point.x),
+				(1.0f - std::fabs(point.x)) * vertex_packer::sign_not_zero(point.y) };
+		}
+
+		encoded[0] = static_cast<std::int16_t>(std::lround(std::min(std::max(point.x, -1.0f), 1.0f) * 32767.0f));
+		encoded[1] = static_cast<std::int16_t>(std::lround(std::min(std::max(point.y, -1.0f), 1.0f) * 32767.0f));
+	}
+
+	static glm::vec3 decode_octahedral(const std::int16_t encoded[2])
+	{
+		glm::vec2 point{ std::max(encoded[0] / 32767.0f, -1.0f), std::max(encoded[1] / 32767.0f, -1.0f) };
+		glm::vec3 direction{ point.x, point.y, 1.0f - std::fabs(point.x) - std::fabs(point.y) };
+		if (direction.z < 0.0f)
+		{
+			direction.x = (1.0f - std::fabs(point.y)) * vertex_packer::sign_not_zero(point.x);
+			direction.y = (1.0f - std::fabs(point.x)) * vertex_packer::sign_not_zero(point.y);
+		}
+
+		return glm::normalize(direction);
+	}
+
+	// round to nearest, overflow becomes infinity, tiny values become denormals or 0.
+	static std::uint16_t to_half(float value)
+	{
+		std::uint32_t bits{};
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		std::uint32_t sign{ (bits >> 16) & 0x8000u };
+		std::uint32_t float_exponent{ (bits >> 23) & 0xffu };
+		std::uint32_t mantissa{ bits & 0x7fffffu };
+
+		if (float_exponent == 0xffu)
+		{
+			return static_cast<std::uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+		}
+
+		std::int32_t exponent{ static_cast<std::int32_t>(float_exponent) - 127 + 15 };
+		if (exponent >= 31)
+		{
+			return static_cast<std::uint16_t>(sign | 0x7c00u);
+		}
+
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+			{
+				return static_cast<std::uint16_t>(sign);
+			}
+
+			mantissa |= 0x800000u;
+			std::uint32_t shift{ static_cast<std::uint32_t>(14 - exponent) };
+			std::uint32_t half{ mantissa >> shift };
+			half += (mantissa >> (shift - 1)) & 1u;
+			return static_cast<std::uint16_t>(sign | half);
+		}
+
+		// a carry out of the mantissa correctly bumps the exponent.
+		std::uint32_t half{ sign | static_cast<std::uint32_t>(exponent) << 10 | mantissa >> 13 };
+		half += (mantissa >> 12) & 1u;
+		return static_cast<std::uint16_t>(half);
+	}
+
+	static float from_half(std::uint16_t half)
+	{
+		float sign{ (half & 0x8000u) != 0 ? -1.0f : 1.0f };
+		int exponent{ (half >> 10) & 0x1f };
+		int mantissa{ half & 0x3ff };
+
+		if (exponent == 0)
+		{
+			return sign * std::ldexp(static_cast<float>(mantissa), -24);
+		}
+
+		if (exponent == 31)
+		{
+			return mantissa == 0 ? sign * INFINITY : NAN;
+		}
+
+		return sign * std::ldexp(static_cast<float>(mantissa + 1024), exponent - 25);
+	}
+
+private:
+	static float sign_not_zero(float value)noexcept
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+};
+
+
+#endif // !__VERTEX_FORMAT_HPP__
@@ -0,0 +1,204 @@
+#ifndef __VIRTUAL_FILE_SYSTEM_HPP__
+#define __VIRTUAL_FILE_SYSTEM_HPP__
+
+#include "mapped_file.hpp"
+#include "asset_pack.hpp"
+
+#include <string>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <utility>
+#include <cctype>
+#include <cstddef>
+
+
+// the bytes of one file, straight out of a mapping. copies share the mapping, it stays alive while any of them does.
+struct asset_view
+{
+	const unsigned char* data_{ nullptr };
+	std::size_t size_{};
+	// served by a mounted pack rather than a loose file.
+	bool from_pack_{ false };
+	std::shared_ptr<const mapped_file> file_{};
+
+	bool is_open()const noexcept
+	{
+		return this->data_ != nullptr;
+	}
+
+	std::basic_string<char> to_string()const
+	{
+		return std::basic_string<char>{ reinterpret_cast<const char*>(this->data_), this->size_ };
+	}
+};
+
+
+// one place to open assets from: mounted packs first, the loose file on disk otherwise. a file a mounted pack holds
+// hides its loose copy, so edits to loose files only show once the pack is rebuilt(or not mounted), open_loose() is for
+// callers which can tell that a pack's copy is out of date. paths stay what the demos always used, files below set_root()
+// are found in the packs by their path relative to it.
+// mount() before loading anything, open() may then run on any thread.
+class virtual_file_system final
+{
+private:
+	std::basic_string<char> root_{};
+	std::vector<std::unique_ptr<asset_pack>> packs_{};
+
+	std::mutex mutex_{};
+	// loose files opened or tracked so far, in first use order, what write_pack() bundles.
+	std::vector<std::basic_string<char>> loose_files_{};
+	std::unordered_set<std::basic_string<char>> loose_names_{};
+	std::size_t pack_opens_{};
+	std::size_t loose_opens_{};
+
+	virtual_file_system() = default;
+
+public:
+	virtual_file_system(const virtual_file_system&) = delete;
+	virtual_file_system& operator=(const virtual_file_system&) = delete;
+
+	static virtual_file_system& shared()
+	{
+		static virtual_file_system file_system{};
+		return file_system;
+	}
+
+	void set_root(const std::basic_string<char>& root)
+	{
+		this->root_ = virtual_file_system::normalize(root);
+		if (!this->root_.empty() && this->root_.back() != '/')
+		{
+			this->root_.push_back('/');
+		}
+	}
+
+	// later mounts hide the files of earlier ones.
+	bool mount(const std::basic_string<char>& pack_file)
+	{
+		std::unique_ptr<asset_pack> pack{ std::make_unique<asset_pack>() };
+		if (!pack->open(pack_file))
+		{
+			return false;
+		}
+
+		std::cout << "VFS:: mounted " << pack_file << ", " << pack->get_entry_count() << " files" << std::endl;
+		this->packs_.insert(this->packs_.begin(), std::move(pack));
+		return true;
+	}
+
+	// the name a file has inside a pack: below the root, '/' separated, lower case like the file systems the demos run on.
+	std::basic_string<char> name_of(const std::basic_string<char>& path)const
+	{
+		std::basic_string<char> name{ virtual_file_system::normalize(path) };
+		if (!this->root_.empty() && name.compare(0, this->root_.size(), this->root_) == 0)
+		{
+			name.erase(0, this->root_.size());
+		}
+
+		return name;
+	}
+
+	// an empty view when neither a pack nor the disk has the file.
+	asset_view open(const std::basic_string<char>& path)
+	{
+		std::basic_string<char> name{ this->name_of(path) };
+
+		asset_view view{};
+		for (const auto& pack : this->packs_)
+		{
+			if (pack->find(name, view.data_, view.size_))
+			{
+				view.from_pack_ = true;
+				view.file_ = pack->get_file();
+
+				std::lock_guard<std::mutex> lock{ this->mutex_ };
+				++this->pack_opens_;
+				return view;
+			}
+		}
+
+		return this->open_loose(path);
+	}
+
+	// the file on disk whatever the packs hold, an empty view when there is none.
+	asset_view open_loose(const std::basic_string<char>& path)
+	{
+		asset_view view{};
+		std::shared_ptr<mapped_file> file{ std::make_shared<mapped_file>() };
+		if (!file->open(path))
+		{
+			return view;
+		}
+
+		view.data_ = file->get_data();
+		view.size_ = file->get_size();
+		view.file_ = std::move(file);
+
+		std::lock_guard<std::mutex> lock{ this->mutex_ };
+		++this->loose_opens_;
+		this->record(path, this->name_of(path));
+		return view;
+	}
+
+	// adds a loose file to the next write_pack() without opening it, e.g. a cache written during this run.
+	void track(const std::basic_string<char>& path)
+	{
+		std::lock_guard<std::mutex> lock{ this->mutex_ };
+		this->record(path, this->name_of(path));
+	}
+
+	// bundles every loose file opened or tracked so far, mount the result to serve them all from one mapping.
+	bool write_pack(const std::basic_string<char>& pack_file)
+	{
+		std::vector<std::pair<std::basic_string<char>, std::basic_string<char>>> files{};
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex_ };
+			for (const auto& path : this->loose_files_)
+			{
+				files.emplace_back(this->name_of(path), path);
+			}
+		}
+
+		if (!asset_pack::write(pack_file, files))
+		{
+			return false;
+		}
+
+		std::cout << "VFS:: wrote " << files.size() << " files to " << pack_file << std::endl;
+		return true;
+	}
+
+	void print(std::ostream& out)
+	{
+		std::lock_guard<std::mutex> lock{ this->mutex_ };
+		out << this->pack_opens_ << " files from " << this->packs_.size() << " packs, " << this->loose_opens_ << " loose files";
+	}
+
+private:
+	void record(const std::basic_string<char>& path, const std::basic_string<char>& name)
+	{
+		if (this->loose_names_.insert(name).second)
+		{
+			this->loose_files_.push_back(path);
+		}
+	}
+
+	static std::basic_string<char> normalize(const std::basic_string<char>& path)
+	{
+		std::basic_string<char> normalized{ path };
+		std::replace(normalized.begin(), normalized.end(), '\\', '/');
+		std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](char character)
+		{
+			return static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+		});
+
+		return normalized;
+	}
+};
+
+
+#endif // !__VIRTUAL_FILE_SYSTEM_HPP__
@@ -0,0 +1,22 @@
+#version 330 core
+// weighted blended order independent transparency, blended with
+// glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA):
+// accumulation.rgb sums the weighted premultiplied colors, accumulation.a multiplies up the revealage,
+// weight sums the weighted alphas.
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out float weight;
+
+in vec2 TexCoords;
+in float ViewDepth;
+
+uniform sampler2D texture_1;
+
+void main()
+{
+    vec4 color = texture(texture_1, TexCoords);
+
+    // nearer surfaces weigh more, so the front layer dominates where layers pile up.
+    float depth_weight = clamp(10.0 / (1e-5 + pow(ViewDepth / 5.0, 2.0) + pow(ViewDepth / 200.0, 6.0)), 1e-2, 3e3);
+    accumulation = vec4(color.rgb * color.a * depth_weight, color.a);
+    weight = color.a * depth_weight;
+}
\ No newline at end of file
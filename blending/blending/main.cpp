@@ -8,10 +8,17 @@
 #include <GLFW/glfw3.h>
 
 #include <vector>
+#include <random>
+#include <string>
 #include <atomic>
 #include <iostream>
+#include <functional>
 
 #include "shader.hpp"
+#include "mip_generator.hpp"
+#include "transparency_sorter.hpp"
+#include "oit_framebuffer.hpp"
+#include "oit_benchmark.hpp"
 #include "stb_image/stb_image.h"
 
 static  const int WIDTH{ 1280 };
@@ -146,7 +153,9 @@ static void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 }
 
 
-static GLuint load_texture(const char * path)
+// mipmaps are built on the CPU and averaged in linear light. alpha_cutoff is the alpha below which the shader discards,
+// above 0 it keeps cutouts like the grass as dense in the distance as up close.
+static GLuint load_texture(const char * path, float alpha_cutoff = 0.0f)
 {
 	GLuint texture_id{};
 	glGenTextures(1, &texture_id);
@@ -164,9 +173,19 @@ static GLuint load_texture(const char * path)
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
+		mip_options options{};
+		options.srgb_ = true;
+		options.alpha_cutoff_ = alpha_cutoff;
+		std::vector<mip_level> mips{ mip_generator{}.generate(data, width, height, nrComponents, options) };
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 		glBindTexture(GL_TEXTURE_2D, texture_id);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		for (std::size_t level = 0; level < mips.size(); ++level)
+		{
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level + 1), format, mips[level].width_, mips[level].height_, 0, format, GL_UNSIGNED_BYTE, mips[level].pixels_.data());
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -186,14 +205,50 @@ static GLuint load_texture(const char * path)
 }
 
 
-int main()
+// how the grass is drawn.
+enum class grass_mode
+{
+	cutout,
+	sorted,
+	oit
+};
+
+// command line:
+//   --transparency M  cutout(default): alpha tested, opaque otherwise. sorted: blended back to front.
+//                     oit: weighted blended order independent transparency, unsorted.
+//   --grass N    scatter N more grass quads over the floor, next to the 5 placed ones.
+//   --compare-transparency N  render N frames sorted and N with OIT in a hidden window, print their GPU time and how far
+//                             the images differ, then exit.
+int main(int argc, char* argv[])
 {
+	grass_mode vegetation_mode{ grass_mode::cutout };
+	std::size_t extra_grass{ 0 };
+	std::size_t compare_frames{ 0 };
+	for (int index = 1; index < argc; ++index)
+	{
+		std::basic_string<char> argument{ argv[index] };
+		if (argument == "--transparency" && index + 1 < argc)
+		{
+			std::basic_string<char> mode{ argv[++index] };
+			vegetation_mode = mode == "sorted" ? grass_mode::sorted : (mode == "oit" ? grass_mode::oit : grass_mode::cutout);
+		}
+		else if (argument == "--grass" && index + 1 < argc)
+		{
+			extra_grass = std::stoul(argv[++index]);
+		}
+		else if (argument == "--compare-transparency" && index + 1 < argc)
+		{
+			compare_frames = std::stoul(argv[++index]);
+		}
+	}
+
 	// glfw: initialize and configure
 // ------------------------------
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, compare_frames == 0 ? GLFW_TRUE : GLFW_FALSE);
 
 	// glfw window creation
 	// --------------------
@@ -212,7 +267,10 @@ int main()
 	glfwSetScrollCallback(window, scroll_callback);
 
 	// tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (compare_frames == 0)
+	{
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	// glad: load all OpenGL function pointers
 	// ---------------------------------------
@@ -240,6 +298,30 @@ int main()
 	shader::checkout_shader_state(program_id, shader_type::program);
 
 
+	// weighted blended OIT, the shaders are copies of window_blending's.
+	GLuint oit_vertex_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\blending\\blending\\glsl\\oit_vertex_shader.glsl", shader_type::vertex_shader) };
+	GLuint oit_fragment_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\blending\\blending\\glsl\\oit_accumulation_fragment_shader.glsl", shader_type::fragment_shader) };
+
+	GLuint oit_program_id{ glCreateProgram() };
+	glAttachShader(oit_program_id, oit_vertex_shader_id);
+	glAttachShader(oit_program_id, oit_fragment_shader_id);
+	glLinkProgram(oit_program_id);
+	glDeleteShader(oit_vertex_shader_id);
+	glDeleteShader(oit_fragment_shader_id);
+	shader::checkout_shader_state(oit_program_id, shader_type::program);
+
+	GLuint composite_vertex_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\blending\\blending\\glsl\\oit_composite_vertex_shader.glsl", shader_type::vertex_shader) };
+	GLuint composite_fragment_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\blending\\blending\\glsl\\oit_composite_fragment_shader.glsl", shader_type::fragment_shader) };
+
+	GLuint composite_program_id{ glCreateProgram() };
+	glAttachShader(composite_program_id, composite_vertex_shader_id);
+	glAttachShader(composite_program_id, composite_fragment_shader_id);
+	glLinkProgram(composite_program_id);
+	glDeleteShader(composite_vertex_shader_id);
+	glDeleteShader(composite_fragment_shader_id);
+	shader::checkout_shader_state(composite_program_id, shader_type::program);
+
+
 	const float floor_vertices[]{
 		// positions          // texture Coords (note we set these higher than 1 (together with GL_REPEAT as texture wrapping mode). this will cause the floor texture to repeat)
 		 5.0f, -0.5f,  5.0f,  2.0f, 0.0f,
@@ -378,7 +460,7 @@ int main()
 
 	GLuint wall_texture_id{ load_texture("C:\\Users\\shihua\\source\\repos\\opengl_demo\\depth_test\\depth_test\\image\\marble.jpg") };
 	GLuint floor_texture_id{ load_texture("C:\\Users\\shihua\\source\\repos\\opengl_demo\\depth_test\\depth_test\\image\\metal.png") };
-	GLuint grass_texture_id{ load_texture("C:\\Users\\shihua\\source\\repos\\opengl_demo\\blending\\blending\\image\\grass.png") };
+	GLuint grass_texture_id{ load_texture("C:\\Users\\shihua\\source\\repos\\opengl_demo\\blending\\blending\\image\\grass.png", 0.1f) };
 
 	glUseProgram(program_id);
 	shader::set_int(program_id, "texture_1", 0);
@@ -394,15 +476,31 @@ int main()
 		glm::vec3(0.5f, 0.0f, -0.6f)
 	};
 
+	std::mt19937 generator{ 42 };
+	std::uniform_real_distribution<float> floor_position{ -4.5f, 4.5f };
+	for (std::size_t index = 0; index < extra_grass; ++index)
+	{
+		vegetation_locations.push_back(glm::vec3{ floor_position(generator), 0.0f, floor_position(generator) });
+	}
 
-	while (!glfwWindowShouldClose(window))
+	transparency_sorter grass_sorter{};
+	grass_sorter.reserve(vegetation_locations.size());
+	for (const glm::vec3& location : vegetation_locations)
 	{
-		double current_time{ glfwGetTime() };
-		delta_time = current_time - last_frame;
-		last_frame = current_time;
+		grass_sorter.add(location);
+	}
+
+	glUseProgram(oit_program_id);
+	shader::set_int(oit_program_id, "texture_1", 0);
+
+	// every mode draws into the same offscreen scene, which is then copied to the window.
+	oit_framebuffer targets{};
+	targets.create(WIDTH, HEIGHT, composite_program_id);
 
-		process_input(window);
 
+	std::function<void(grass_mode)> render_frame{ [&](grass_mode mode)
+	{
+		targets.begin_scene();
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -442,6 +540,41 @@ int main()
 		glBindVertexArray(grass_VAO);
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, grass_texture_id);
+		if (mode == grass_mode::oit)
+		{
+			// any order, the soft edges blend without sorting.
+			targets.begin_accumulation();
+			glUseProgram(oit_program_id);
+			shader::set_mat4(oit_program_id, "projection", projection);
+			shader::set_mat4(oit_program_id, "view", view);
+			for (const glm::vec3& location : vegetation_locations)
+			{
+				model = glm::mat4{ 1.0f };
+				model = glm::translate(model, location);
+				shader::set_mat4(oit_program_id, "model", model);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+			targets.composite();
+			return;
+		}
+
+		if (mode == grass_mode::sorted)
+		{
+			// blended grass goes back to front.
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			for (std::uint32_t index : grass_sorter.sort(view))
+			{
+				model = glm::mat4{ 1.0f };
+				model = glm::translate(model, vegetation_locations[index]);
+				shader::set_mat4(program_id, "model", model);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+			glDisable(GL_BLEND);
+			return;
+		}
+
+		// cutouts need no order.
 		for (std::size_t index = 0; index < vegetation_locations.size(); ++index)
 		{
 			model = glm::mat4{ 1.0f };
@@ -449,7 +582,33 @@ int main()
 			shader::set_mat4(program_id, "model", model);
 			glDrawArrays(GL_TRIANGLES, 0, 6);
 		}
+	} };
+
+	if (compare_frames != 0)
+	{
+		run_transparency_comparison(std::cout, targets, compare_frames, [&render_frame](transparency_mode mode)
+		{
+			render_frame(mode == transparency_mode::oit ? grass_mode::oit : grass_mode::sorted);
+		});
+		targets.destroy();
+		glfwTerminate();
+		return 0;
+	}
+
+
+	while (!glfwWindowShouldClose(window))
+	{
+		double current_time{ glfwGetTime() };
+		delta_time = current_time - last_frame;
+		last_frame = current_time;
+
+		process_input(window);
+
+		render_frame(vegetation_mode);
 
+		int window_width{}, window_height{};
+		glfwGetFramebufferSize(window, &window_width, &window_height);
+		targets.present(window_width, window_height);
 
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -467,6 +626,7 @@ int main()
 	glDeleteBuffers(1, &cube_VBO);
 	glDeleteBuffers(1, &floor_VBO);
 	glDeleteBuffers(1, &floor_VBO);
+	targets.destroy();
 
 	glfwTerminate();
 	return 0;
@@ -0,0 +1,649 @@
+#ifndef __MIP_GENERATOR_HPP__
+#define __MIP_GENERATOR_HPP__
+
+#include "simd_level.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+enum class mip_filter
+{
+	// 2x2 average, the cheapest and what glGenerateMipmap does on most drivers.
+	box,
+	// 8x8 Kaiser windowed sinc, sharper levels with less aliasing.
+	kaiser
+};
+
+
+struct mip_options
+{
+	mip_filter filter_{ mip_filter::box };
+	// the color channels hold sRGB encoded values: they are averaged as linear light and encoded again, alpha stays linear.
+	bool srgb_{ false };
+	// above 0 for alpha tested textures: each level's alpha is scaled so the share of texels with alpha >= alpha_cutoff_
+	// stays that of the base level, otherwise cutouts like foliage thin out and vanish in the distance.
+	float alpha_cutoff_{ 0.0f };
+};
+
+
+// one level of a mip chain, texels have as many 8 bit components as the base level.
+struct mip_level
+{
+	int width_{};
+	int height_{};
+	std::vector<std::uint8_t> pixels_{};
+};
+
+
+// builds a mip chain on the CPU, so a loader thread can hand the GPU every level instead of calling glGenerateMipmap.
+// each level is filtered in float from the float level above it, never from rounded bytes, and the base level is
+// converted a row at a time. one texel per SSE register, two per AVX2 register. the instruction set is picked at run time
+// like frustum_culler's, the levels match the scalar ones up to float rounding. generate() may run on any thread.
+class mip_generator final
+{
+private:
+	simd_level level_{ simd_level::scalar };
+
+	// 4 floats per texel whatever the source had, missing channels are 0.
+	struct float_image
+	{
+		int width_{};
+		int height_{};
+		std::vector<float> texels_{};
+	};
+
+	static constexpr const int KAISER_TAPS{ 8 };
+	// linear_to_srgb entries, fine enough that the darkest codes round like std::pow would.
+	static constexpr const int SRGB_TABLE_SIZE{ 16384 };
+
+public:
+	explicit mip_generator(simd_level level = simd_support::detect())
+		: level_{ level }
+	{
+	}
+
+	simd_level get_level()const noexcept
+	{
+		return this->level_;
+	}
+
+	// levels of a full chain down to 1x1, the base level included.
+	static int level_count(int width, int height)noexcept
+	{
+		int count{ 1 };
+		while (width > 1 || height > 1)
+		{
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+			++count;
+		}
+
+		return count;
+	}
+
+	// pixels holds width x height texels of components(1 to 4) bytes each. returns every level below the base one, down to 1x1.
+	// an odd last row or column is folded into the texels next to it.
+	std::vector<mip_level> generate(const std::uint8_t* pixels, int width, int height, int components, const mip_options& options)const
+	{
+		std::vector<mip_level> levels{};
+		if (!pixels || width <= 0 || height <= 0 || components < 1 || components > 4)
+		{
+			return levels;
+		}
+
+		int alpha_channel{ mip_generator::alpha_channel(components) };
+		bool keep_coverage{ options.alpha_cutoff_ > 0.0f && alpha_channel >= 0 };
+		float target_coverage{ keep_coverage ? mip_generator::coverage(pixels, width, height, components, options.alpha_cutoff_) : 1.0f };
+
+		// the base level is converted to float a row at a time as the filter asks for it, the box filter holds two rows at once.
+		std::vector<float> base_rows[2]{ std::vector<float>(static_cast<std::size_t>(width) * 4), std::vector<float>(static_cast<std::size_t>(width) * 4) };
+		auto base_row = [&](int y)
+		{
+			float* row{ base_rows[y & 1].data() };
+			this->convert_row(pixels + static_cast<std::size_t>(y) * width * components, width, components, options.srgb_, row);
+			return static_cast<const float*>(row);
+		};
+
+		float_image current{};
+		float_image next{};
+		float_image scratch{};
+		levels.reserve(static_cast<std::size_t>(mip_generator::level_count(width, height) - 1));
+		for (int source_width = width, source_height = height; source_width > 1 || source_height > 1;)
+		{
+			next.width_ = std::max(source_width / 2, 1);
+			next.height_ = std::max(source_height / 2, 1);
+			next.texels_.resize(static_cast<std::size_t>(next.width_) * next.height_ * 4);
+
+			if (levels.empty())
+			{
+				this->downsample(source_width, source_height, base_row, options.filter_, scratch, next);
+			}
+			else
+			{
+				auto image_row = [&current](int y)
+				{
+					return static_cast<const float*>(&current.texels_[static_cast<std::size_t>(y) * current.width_ * 4]);
+				};
+				this->downsample(source_width, source_height, image_row, options.filter_, scratch, next);
+			}
+
+			float alpha_scale{ keep_coverage ? mip_generator::coverage_scale(next, alpha_channel, options.alpha_cutoff_, target_coverage) : 1.0f };
+			levels.push_back(this->to_bytes(next, components, options.srgb_, alpha_channel, alpha_scale));
+
+			std::swap(current, next);
+			source_width = current.width_;
+			source_height = current.height_;
+		}
+
+		return levels;
+	}
+
+	// the share of texels with alpha >= cutoff in an 8 bit level, what alpha_cutoff_ keeps.
+	static float coverage(const std::uint8_t* pixels, int width, int height, int components, float cutoff)
+	{
+		int alpha_channel{ mip_generator::alpha_channel(components) };
+		std::size_t texel_count{ static_cast<std::size_t>(width) * height };
+		if (alpha_channel < 0 || texel_count == 0)
+		{
+			return 1.0f;
+		}
+
+		std::size_t covered{};
+		for (std::size_t texel = 0; texel < texel_count; ++texel)
+		{
+			covered += pixels[texel * components + alpha_channel] / 255.0f >= cutoff ? 1 : 0;
+		}
+
+		return static_cast<float>(covered) / texel_count;
+	}
+
+private:
+	// grey + alpha or rgba, -1 when there is no alpha.
+	static int alpha_channel(int components)noexcept
+	{
+		return components == 4 ? 3 : (components == 2 ? 1 : -1);
+	}
+
+	static const float* srgb_to_linear_table()
+	{
+		static const std::vector<float> table{ []()
+		{
+			std::vector<float> values(256);
+			for (int code = 0; code < 256; ++code)
+			{
+				float encoded{ code / 255.0f };
+				values[code] = encoded <= 0.04045f ? encoded / 12.92f : std::pow((encoded + 0.055f) / 1.055f, 2.4f);
+			}
+			return values;
+		}() };
+
+		return table.data();
+	}
+
+	static const std::uint8_t* linear_to_srgb_table()
+	{
+		static const std::vector<std::uint8_t> table{ []()
+		{
+			std::vector<std::uint8_t> values(SRGB_TABLE_SIZE);
+			for (int index = 0; index < SRGB_TABLE_SIZE; ++index)
+			{
+				float linear{ static_cast<float>(index) / (SRGB_TABLE_SIZE - 1) };
+				float encoded{ linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f };
+				values[index] = static_cast<std::uint8_t>(std::lround(std::min(std::max(encoded, 0.0f), 1.0f) * 255.0f));
+			}
+			return values;
+		}() };
+
+		return table.data();
+	}
+
+	// one row of the base level into 4 floats per texel, linear light when srgb.
+	void convert_row(const std::uint8_t* pixels, int width, int components, bool srgb, float* row)const
+	{
+		int first{ 0 };
+#if defined(SIMD_X86)
+		if (components == 4 && this->level_ == simd_level::avx2)
+		{
+			first = mip_generator::convert_row_avx2(pixels, width, srgb, row);
+		}
+		else if (components == 4 && this->level_ == simd_level::sse)
+		{
+			first = mip_generator::convert_row_sse(pixels, width, srgb, row);
+		}
+#endif
+
+		const float* srgb_table{ mip_generator::srgb_to_linear_table() };
+		int alpha_channel{ mip_generator::alpha_channel(components) };
+		for (int x = first; x < width; ++x)
+		{
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				float value{};
+				if (channel < components)
+				{
+					std::uint8_t code{ pixels[x * components + channel] };
+					value = srgb && channel != alpha_channel ? srgb_table[code] : code / 255.0f;
+				}
+				row[x * 4 + channel] = value;
+			}
+		}
+	}
+
+	mip_level to_bytes(const float_image& image, int components, bool srgb, int alpha_channel, float alpha_scale)const
+	{
+		const std::uint8_t* srgb_table{ mip_generator::linear_to_srgb_table() };
+
+		mip_level level{};
+		level.width_ = image.width_;
+		level.height_ = image.height_;
+		level.pixels_.resize(static_cast<std::size_t>(image.width_) * image.height_ * components);
+
+		std::size_t texel_count{ static_cast<std::size_t>(image.width_) * image.height_ };
+		std::size_t first{ 0 };
+#if defined(SIMD_X86)
+		if (components == 4 && this->level_ != simd_level::scalar)
+		{
+			first = mip_generator::to_bytes_sse(image.texels_.data(), texel_count, srgb, alpha_scale, level.pixels_.data());
+		}
+#endif
+
+		for (std::size_t texel = first; texel < texel_count; ++texel)
+		{
+			for (int channel = 0; channel < components; ++channel)
+			{
+				float value{ image.texels_[texel * 4 + channel] };
+				if (channel == alpha_channel)
+				{
+					value *= alpha_scale;
+				}
+				value = std::min(std::max(value, 0.0f), 1.0f);
+
+				level.pixels_[texel * components + channel] = srgb && channel != alpha_channel ?
+					srgb_table[static_cast<int>(value * (SRGB_TABLE_SIZE - 1) + 0.5f)] :
+					static_cast<std::uint8_t>(value * 255.0f + 0.5f);
+			}
+		}
+
+		return level;
+	}
+
+	static float coverage(const float_image& image, int alpha_channel, float cutoff, float alpha_scale)
+	{
+		std::size_t texel_count{ static_cast<std::size_t>(image.width_) * image.height_ };
+		std::size_t covered{};
+		for (std::size_t texel = 0; texel < texel_count; ++texel)
+		{
+			covered += image.texels_[texel * 4 + alpha_channel] * alpha_scale >= cutoff ? 1 : 0;
+		}
+
+		return static_cast<float>(covered) / texel_count;
+	}
+
+	// Castano 2010: coverage grows with the scale, so bisect for the scale whose coverage is closest to the base level's.
+	static float coverage_scale(const float_image& image, int alpha_channel, float cutoff, float target_coverage)
+	{
+		float low{ 0.0f };
+		float high{ 4.0f };
+		float best_scale{ 1.0f };
+		float best_error{ std::fabs(mip_generator::coverage(image, alpha_channel, cutoff, 1.0f) - target_coverage) };
+		for (int step = 0; step < 12; ++step)
+		{
+			float scale{ (low + high) * 0.5f };
+			float scaled_coverage{ mip_generator::coverage(image, alpha_channel, cutoff, scale) };
+			if (std::fabs(scaled_coverage - target_coverage) < best_error)
+			{
+				best_error = std::fabs(scaled_coverage - target_coverage);
+				best_scale = scale;
+			}
+
+			if (scaled_coverage < target_coverage)
+				low = scale;
+			else
+				high = scale;
+		}
+
+		return best_scale;
+	}
+
+	// tap i of an output texel reads source texel 2x - 3 + i, offset i - 3.5 from the output's center.
+	static const float* kaiser_weights()
+	{
+		static const std::vector<float> weights{ []()
+		{
+			static constexpr const double pi{ 3.14159265358979323846 };
+			static constexpr const double beta{ 4.0 };
+			static constexpr const double radius{ KAISER_TAPS / 2 };
+
+			// zeroth order modified Bessel function of the first kind, by its power series.
+			auto bessel_i0 = [](double x)
+			{
+				double sum{ 1.0 };
+				double term{ 1.0 };
+				for (int k = 1; k < 32; ++k)
+				{
+					term *= (x / (2.0 * k)) * (x / (2.0 * k));
+					sum += term;
+				}
+				return sum;
+			};
+
+			std::vector<float> values(KAISER_TAPS);
+			double total{};
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				// a sinc with its cutoff at the half resolution's Nyquist frequency.
+				double offset{ tap - (KAISER_TAPS - 1) / 2.0 };
+				double sinc{ std::sin(pi * offset / 2.0) / (pi * offset / 2.0) };
+				double ratio{ offset / radius };
+				double window{ bessel_i0(beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / bessel_i0(beta) };
+				values[tap] = static_cast<float>(sinc * window);
+				total += sinc * window;
+			}
+
+			for (float& value : values)
+			{
+				value = static_cast<float>(value / total);
+			}
+			return values;
+		}() };
+
+		return weights.data();
+	}
+
+	// rows(y) returns row y of the source level, asked for in ascending order.
+	template<typename Rows>
+	void downsample(int source_width, int source_height, const Rows& rows, mip_filter filter, float_image& scratch, float_image& target)const
+	{
+		if (filter == mip_filter::kaiser)
+		{
+			this->downsample_kaiser(source_width, source_height, rows, scratch, target);
+			return;
+		}
+
+		for (int y = 0; y < target.height_; ++y)
+		{
+			const float* row0{ rows(std::min(y * 2, source_height - 1)) };
+			const float* row1{ rows(std::min(y * 2 + 1, source_height - 1)) };
+			float* target_row{ &target.texels_[static_cast<std::size_t>(y) * target.width_ * 4] };
+
+			switch (this->level_)
+			{
+#if defined(SIMD_X86)
+			case simd_level::avx2: mip_generator::box_row_avx2(row0, row1, source_width, target_row, target.width_); break;
+			case simd_level::sse: mip_generator::box_row_sse(row0, row1, source_width, target_row, 0, target.width_); break;
+#endif
+			default: mip_generator::box_row_scalar(row0, row1, source_width, target_row, 0, target.width_); break;
+			}
+		}
+	}
+
+	static void box_row_scalar(const float* row0, const float* row1, int source_width, float* target_row, int first, int last)
+	{
+		for (int x = first; x < last; ++x)
+		{
+			int x0{ std::min(x * 2, source_width - 1) * 4 };
+			int x1{ std::min(x * 2 + 1, source_width - 1) * 4 };
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				target_row[x * 4 + channel] = (row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel]) * 0.25f;
+			}
+		}
+	}
+
+	template<typename Rows>
+	void downsample_kaiser(int source_width, int source_height, const Rows& rows, float_image& scratch, float_image& target)const
+	{
+		// horizontal into scratch(target width x source height), then vertical into target.
+		scratch.width_ = target.width_;
+		scratch.height_ = source_height;
+		scratch.texels_.resize(static_cast<std::size_t>(scratch.width_) * scratch.height_ * 4);
+
+		const float* weights{ mip_generator::kaiser_weights() };
+		for (int y = 0; y < source_height; ++y)
+		{
+			const float* source_row{ rows(y) };
+			float* scratch_row{ &scratch.texels_[static_cast<std::size_t>(y) * scratch.width_ * 4] };
+
+			switch (this->level_)
+			{
+#if defined(SIMD_X86)
+			case simd_level::avx2: mip_generator::kaiser_row_avx2(source_row, source_width, weights, scratch_row, scratch.width_); break;
+			case simd_level::sse: mip_generator::kaiser_row_sse(source_row, source_width, weights, scratch_row, 0, scratch.width_); break;
+#endif
+			default: mip_generator::kaiser_row_scalar(source_row, source_width, weights, scratch_row, 0, scratch.width_); break;
+			}
+		}
+
+		std::size_t row_floats{ static_cast<std::size_t>(target.width_) * 4 };
+		for (int y = 0; y < target.height_; ++y)
+		{
+			const float* rows[KAISER_TAPS]{};
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				int source_y{ std::min(std::max(y * 2 - 3 + tap, 0), scratch.height_ - 1) };
+				rows[tap] = &scratch.texels_[static_cast<std::size_t>(source_y) * row_floats];
+			}
+			float* target_row{ &target.texels_[static_cast<std::size_t>(y) * row_floats] };
+
+			switch (this->level_)
+			{
+#if defined(SIMD_X86)
+			case simd_level::avx2: mip_generator::kaiser_column_avx2(rows, weights, target_row, row_floats); break;
+			case simd_level::sse: mip_generator::kaiser_column_sse(rows, weights, target_row, 0, row_floats); break;
+#endif
+			default: mip_generator::kaiser_column_scalar(rows, weights, target_row, 0, row_floats); break;
+			}
+		}
+	}
+
+	static void kaiser_row_scalar(const float* source_row, int source_width, const float* weights, float* target_row, int first, int last)
+	{
+		for (int x = first; x < last; ++x)
+		{
+			float sum[4]{};
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				int source_x{ std::min(std::max(x * 2 - 3 + tap, 0), source_width - 1) };
+				for (int channel = 0; channel < 4; ++channel)
+				{
+					sum[channel] += weights[tap] * source_row[source_x * 4 + channel];
+				}
+			}
+
+			std::copy(sum, sum + 4, target_row + x * 4);
+		}
+	}
+
+	// every output row is a weighted sum of 8 whole scratch rows, the same weights for each float.
+	static void kaiser_column_scalar(const float* const rows[KAISER_TAPS], const float* weights, float* target_row, std::size_t first, std::size_t last)
+	{
+		for (std::size_t index = first; index < last; ++index)
+		{
+			float sum{};
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				sum += weights[tap] * rows[tap][index];
+			}
+			target_row[index] = sum;
+		}
+	}
+
+#if defined(SIMD_X86)
+	// one rgba texel per step, returns the texels done.
+	static int convert_row_sse(const std::uint8_t* pixels, int width, bool srgb, float* row)
+	{
+		const float* srgb_table{ mip_generator::srgb_to_linear_table() };
+		const __m128 unorm{ _mm_set1_ps(1.0f / 255.0f) };
+		const __m128i zero{ _mm_setzero_si128() };
+		for (int x = 0; x < width; ++x)
+		{
+			const std::uint8_t* texel{ pixels + x * 4 };
+			if (srgb)
+			{
+				_mm_storeu_ps(row + x * 4, _mm_set_ps(texel[3] / 255.0f, srgb_table[texel[2]], srgb_table[texel[1]], srgb_table[texel[0]]));
+				continue;
+			}
+
+			int packed{};
+			std::memcpy(&packed, texel, sizeof(packed));
+			__m128i codes{ _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero) };
+			_mm_storeu_ps(row + x * 4, _mm_mul_ps(_mm_cvtepi32_ps(codes), unorm));
+		}
+
+		return width;
+	}
+
+	// two rgba texels per step, sRGB decoded by gathering from the table, alpha kept linear by a blend.
+	SIMD_TARGET_AVX2
+	static int convert_row_avx2(const std::uint8_t* pixels, int width, bool srgb, float* row)
+	{
+		const float* srgb_table{ mip_generator::srgb_to_linear_table() };
+		const __m256 unorm{ _mm256_set1_ps(1.0f / 255.0f) };
+		int x{ 0 };
+		for (; x + 1 < width; x += 2)
+		{
+			__m256i codes{ _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + x * 4))) };
+			__m256 values{ _mm256_mul_ps(_mm256_cvtepi32_ps(codes), unorm) };
+			if (srgb)
+			{
+				values = _mm256_blend_ps(_mm256_i32gather_ps(srgb_table, codes, 4), values, 0x88);
+			}
+			_mm256_storeu_ps(row + x * 4, values);
+		}
+
+		return x;
+	}
+
+	// rgba only. returns the texels done.
+	static std::size_t to_bytes_sse(const float* texels, std::size_t texel_count, bool srgb, float alpha_scale, std::uint8_t* pixels)
+	{
+		const std::uint8_t* srgb_table{ mip_generator::linear_to_srgb_table() };
+		const float color_scale{ srgb ? static_cast<float>(SRGB_TABLE_SIZE - 1) : 255.0f };
+		const __m128 scale{ _mm_set_ps(255.0f, color_scale, color_scale, color_scale) };
+		const __m128 alpha{ _mm_set_ps(alpha_scale, 1.0f, 1.0f, 1.0f) };
+		const __m128 zero{ _mm_setzero_ps() };
+		const __m128 one{ _mm_set1_ps(1.0f) };
+		const __m128 half{ _mm_set1_ps(0.5f) };
+
+		alignas(16) std::int32_t codes[4]{};
+		for (std::size_t texel = 0; texel < texel_count; ++texel)
+		{
+			__m128 value{ _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(texels + texel * 4), alpha), zero), one) };
+			_mm_store_si128(reinterpret_cast<__m128i*>(codes), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half)));
+
+			std::uint8_t* pixel{ pixels + texel * 4 };
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				pixel[channel] = srgb ? srgb_table[codes[channel]] : static_cast<std::uint8_t>(codes[channel]);
+			}
+			pixel[3] = static_cast<std::uint8_t>(codes[3]);
+		}
+
+		return texel_count;
+	}
+
+	static void box_row_sse(const float* row0, const float* row1, int source_width, float* target_row, int first, int last)
+	{
+		const __m128 quarter{ _mm_set1_ps(0.25f) };
+		for (int x = first; x < last; ++x)
+		{
+			int x0{ std::min(x * 2, source_width - 1) * 4 };
+			int x1{ std::min(x * 2 + 1, source_width - 1) * 4 };
+			__m128 sum{ _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+				_mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1))) };
+			_mm_storeu_ps(target_row + x * 4, _mm_mul_ps(sum, quarter));
+		}
+	}
+
+	// two output texels from 4 source texels of each row: the vertical sums of texels 0 1 and 2 3, then the halves swapped and added.
+	SIMD_TARGET_AVX2
+	static void box_row_avx2(const float* row0, const float* row1, int source_width, float* target_row, int target_width)
+	{
+		const __m256 quarter{ _mm256_set1_ps(0.25f) };
+		int x{ 0 };
+		for (; x + 1 < target_width && x * 2 + 3 < source_width; x += 2)
+		{
+			__m256 left{ _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8)) };
+			__m256 right{ _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8)) };
+			__m256 sum{ _mm256_add_ps(_mm256_permute2f128_ps(left, right, 0x20), _mm256_permute2f128_ps(left, right, 0x31)) };
+			_mm256_storeu_ps(target_row + x * 4, _mm256_mul_ps(sum, quarter));
+		}
+
+		mip_generator::box_row_sse(row0, row1, source_width, target_row, x, target_width);
+	}
+
+	static void kaiser_row_sse(const float* source_row, int source_width, const float* weights, float* target_row, int first, int last)
+	{
+		for (int x = first; x < last; ++x)
+		{
+			__m128 sum{ _mm_setzero_ps() };
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				int source_x{ std::min(std::max(x * 2 - 3 + tap, 0), source_width - 1) };
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(source_row + source_x * 4)));
+			}
+			_mm_storeu_ps(target_row + x * 4, sum);
+		}
+	}
+
+	// two output texels per register, their taps are 2 source texels apart.
+	SIMD_TARGET_AVX2
+	static void kaiser_row_avx2(const float* source_row, int source_width, const float* weights, float* target_row, int target_width)
+	{
+		int x{ 0 };
+		for (; x + 1 < target_width; x += 2)
+		{
+			__m256 sum{ _mm256_setzero_ps() };
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				int first_x{ std::min(std::max(x * 2 - 3 + tap, 0), source_width - 1) };
+				int second_x{ std::min(std::max(x * 2 - 1 + tap, 0), source_width - 1) };
+				__m256 texels{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(source_row + first_x * 4)), _mm_loadu_ps(source_row + second_x * 4), 1) };
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[tap]), texels));
+			}
+			_mm256_storeu_ps(target_row + x * 4, sum);
+		}
+
+		mip_generator::kaiser_row_sse(source_row, source_width, weights, target_row, x, target_width);
+	}
+
+	static void kaiser_column_sse(const float* const rows[KAISER_TAPS], const float* weights, float* target_row, std::size_t first, std::size_t last)
+	{
+		for (std::size_t index = first; index < last; index += 4)
+		{
+			__m128 sum{ _mm_setzero_ps() };
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(rows[tap] + index)));
+			}
+			_mm_storeu_ps(target_row + index, sum);
+		}
+	}
+
+	SIMD_TARGET_AVX2
+	static void kaiser_column_avx2(const float* const rows[KAISER_TAPS], const float* weights, float* target_row, std::size_t row_floats)
+	{
+		std::size_t index{ 0 };
+		for (; index + 8 <= row_floats; index += 8)
+		{
+			__m256 sum{ _mm256_setzero_ps() };
+			for (int tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[tap]), _mm256_loadu_ps(rows[tap] + index)));
+			}
+			_mm256_storeu_ps(target_row + index, sum);
+		}
+
+		// rows are whole texels, so what is left is one texel of 4 floats or nothing.
+		mip_generator::kaiser_column_sse(rows, weights, target_row, index, row_floats);
+	}
+#endif
+};
+
+
+#endif // !__MIP_GENERATOR_HPP__
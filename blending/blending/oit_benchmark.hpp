@@ -0,0 +1,88 @@
+#ifndef __OIT_BENCHMARK_HPP__
+#define __OIT_BENCHMARK_HPP__
+
+#include <glad/glad.h>
+
+#include "oit_framebuffer.hpp"
+
+#include <array>
+#include <chrono>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+
+// renders frames frames in each transparency mode from the same camera, render_frame draws one into targets' scene.
+// GPU time comes from GL_TIME_ELAPSED queries, the wall time per frame includes the CPU side(sorting in sorted mode).
+// then how far the OIT image strays from the sorted one: mean and largest channel difference, and the share of pixels
+// with a channel off by more than 8/255.
+inline void run_transparency_comparison(std::ostream& out, const oit_framebuffer& targets, std::size_t frames,
+	const std::function<void(transparency_mode)>& render_frame)
+{
+	GLuint query_id{};
+	glGenQueries(1, &query_id);
+
+	out << "transparency comparison, " << targets.get_width() << "x" << targets.get_height() << ", " << frames << " frames per mode" << std::endl;
+
+	std::array<std::vector<std::uint8_t>, 2> images{};
+	for (transparency_mode mode : { transparency_mode::sorted, transparency_mode::oit })
+	{
+		// the first frame pays for shader compilation and first touches of the targets.
+		render_frame(mode);
+		glFinish();
+
+		GLuint64 gpu_nanoseconds{};
+		auto begin{ std::chrono::steady_clock::now() };
+		for (std::size_t frame = 0; frame < frames; ++frame)
+		{
+			glBeginQuery(GL_TIME_ELAPSED, query_id);
+			render_frame(mode);
+			glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 elapsed{};
+			glGetQueryObjectui64v(query_id, GL_QUERY_RESULT, &elapsed);
+			gpu_nanoseconds += elapsed;
+		}
+		glFinish();
+		double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() };
+
+		images[static_cast<std::size_t>(mode)] = targets.read_scene();
+		out << "    " << std::setw(6) << oit_framebuffer::mode_name(mode) << " " << std::fixed << std::setprecision(3)
+			<< static_cast<double>(gpu_nanoseconds) / frames / 1e6 << " ms/frame GPU, " << seconds * 1000.0 / frames << " ms/frame wall" << std::endl;
+	}
+
+	const std::vector<std::uint8_t>& sorted{ images[static_cast<std::size_t>(transparency_mode::sorted)] };
+	const std::vector<std::uint8_t>& oit{ images[static_cast<std::size_t>(transparency_mode::oit)] };
+	std::uint64_t difference_sum{};
+	int largest_difference{};
+	std::size_t differing_pixels{};
+	for (std::size_t pixel = 0; pixel < sorted.size(); pixel += 4)
+	{
+		int pixel_difference{};
+		for (std::size_t channel = 0; channel < 3; ++channel)
+		{
+			int difference{ std::abs(sorted[pixel + channel] - oit[pixel + channel]) };
+			difference_sum += static_cast<std::uint64_t>(difference);
+			pixel_difference = std::max(pixel_difference, difference);
+		}
+
+		largest_difference = std::max(largest_difference, pixel_difference);
+		differing_pixels += pixel_difference > 8 ? 1 : 0;
+	}
+
+	std::size_t pixel_count{ sorted.size() / 4 };
+	out << "    oit against sorted: mean difference " << std::setprecision(3) << static_cast<double>(difference_sum) / (pixel_count * 3)
+		<< ", largest " << largest_difference << ", " << std::setprecision(2) << 100.0 * differing_pixels / pixel_count << "% of pixels off by more than 8" << std::endl;
+
+	out.unsetf(std::ios::fixed);
+	out << std::setprecision(6);
+	glDeleteQueries(1, &query_id);
+}
+
+
+#endif // !__OIT_BENCHMARK_HPP__
@@ -0,0 +1,277 @@
+#ifndef __TRANSPARENCY_SORTER_HPP__
+#define __TRANSPARENCY_SORTER_HPP__
+
+#include <glm/glm.hpp>
+
+#include "simd_level.hpp"
+
+#include <array>
+#include <vector>
+#include <numeric>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+// orders transparent instances back to front for blending. positions are kept as SoA, every sort() writes the view space
+// depth of each instance into a preallocated array, 8 at a time with AVX2 or 4 with SSE, along with a 32 bit key that orders
+// like the float, then radix sorts the keys. the sort is stable: instances at the same depth keep the order they were added in,
+// none of them is lost. nothing is allocated once the arrays have grown to the instance count.
+class transparency_sorter final
+{
+public:
+	// fewer keys than this are insertion sorted, clearing and summing the histograms would cost more.
+	static constexpr const std::size_t INSERTION_SORT_LIMIT{ 48 };
+
+private:
+	simd_level level_{ simd_level::scalar };
+
+	std::vector<float> x_{};
+	std::vector<float> y_{};
+	std::vector<float> z_{};
+
+	std::vector<float> depths_{};
+	std::vector<std::uint32_t> keys_{};
+	std::vector<std::uint32_t> order_{};
+	std::vector<std::uint32_t> key_scratch_{};
+	std::vector<std::uint32_t> order_scratch_{};
+
+public:
+	explicit transparency_sorter(simd_level level = simd_support::detect())
+		: level_{ level }
+	{
+	}
+
+	transparency_sorter(const transparency_sorter&) = delete;
+	transparency_sorter& operator=(const transparency_sorter&) = delete;
+
+	simd_level get_level()const noexcept
+	{
+		return this->level_;
+	}
+
+	std::size_t size()const noexcept
+	{
+		return this->x_.size();
+	}
+
+	void reserve(std::size_t count)
+	{
+		for (std::vector<float>* values : { &this->x_, &this->y_, &this->z_, &this->depths_ })
+		{
+			values->reserve(count);
+		}
+
+		for (std::vector<std::uint32_t>* values : { &this->keys_, &this->order_, &this->key_scratch_, &this->order_scratch_ })
+		{
+			values->reserve(count);
+		}
+	}
+
+	void clear()noexcept
+	{
+		this->x_.clear();
+		this->y_.clear();
+		this->z_.clear();
+	}
+
+	// the index sort() refers to the instance by.
+	std::uint32_t add(const glm::vec3& position)
+	{
+		this->x_.push_back(position.x);
+		this->y_.push_back(position.y);
+		this->z_.push_back(position.z);
+		return static_cast<std::uint32_t>(this->x_.size() - 1);
+	}
+
+	void set_position(std::uint32_t index, const glm::vec3& position)noexcept
+	{
+		this->x_[index] = position.x;
+		this->y_[index] = position.y;
+		this->z_[index] = position.z;
+	}
+
+	// distance in front of the camera along the view direction as of the last sort(), by instance index.
+	const std::vector<float>& get_depths()const noexcept
+	{
+		return this->depths_;
+	}
+
+	// instance indices, farthest first. valid until the next sort().
+	const std::vector<std::uint32_t>& sort(const glm::mat4& view)
+	{
+		std::size_t count{ this->x_.size() };
+		this->depths_.resize(count);
+		this->keys_.resize(count);
+
+		// depth is minus view space z: the third row of view against the position.
+		glm::vec4 depth_row{ -view[0][2], -view[1][2], -view[2][2], -view[3][2] };
+		switch (this->level_)
+		{
+#if defined(SIMD_X86)
+		case simd_level::avx2: this->compute_keys_avx2(depth_row); break;
+		case simd_level::sse: this->compute_keys_sse(depth_row); break;
+#endif
+		default: this->compute_keys_scalar(depth_row, 0); break;
+		}
+
+		this->radix_sort();
+		return this->order_;
+	}
+
+	// smaller for farther: the float's bits with the sign flipped, and every bit of negative values, order like the float itself,
+	// the complement turns that around.
+	static std::uint32_t back_to_front_key(float depth)noexcept
+	{
+		std::uint32_t bits{};
+		std::memcpy(&bits, &depth, sizeof(bits));
+		std::uint32_t flip{ (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u };
+		return ~(bits ^ flip);
+	}
+
+private:
+	// scalar, from begin on. also finishes the tail the SIMD loops leave behind.
+	void compute_keys_scalar(const glm::vec4& depth_row, std::size_t begin)
+	{
+		for (std::size_t index = begin; index < this->x_.size(); ++index)
+		{
+			float depth{ depth_row.x * this->x_[index] + depth_row.y * this->y_[index] + depth_row.z * this->z_[index] + depth_row.w };
+			this->depths_[index] = depth;
+			this->keys_[index] = transparency_sorter::back_to_front_key(depth);
+		}
+	}
+
+#if defined(SIMD_X86)
+	void compute_keys_sse(const glm::vec4& depth_row)
+	{
+		std::size_t simd_end{ this->x_.size() & ~static_cast<std::size_t>(3) };
+		__m128 row_x{ _mm_set1_ps(depth_row.x) };
+		__m128 row_y{ _mm_set1_ps(depth_row.y) };
+		__m128 row_z{ _mm_set1_ps(depth_row.z) };
+		__m128 row_w{ _mm_set1_ps(depth_row.w) };
+		__m128i sign{ _mm_set1_epi32(static_cast<int>(0x80000000u)) };
+		__m128i ones{ _mm_set1_epi32(-1) };
+
+		for (std::size_t index = 0; index < simd_end; index += 4)
+		{
+			__m128 depth{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(row_x, _mm_loadu_ps(this->x_.data() + index)), _mm_mul_ps(row_y, _mm_loadu_ps(this->y_.data() + index))),
+				_mm_add_ps(_mm_mul_ps(row_z, _mm_loadu_ps(this->z_.data() + index)), row_w)) };
+			_mm_storeu_ps(this->depths_.data() + index, depth);
+
+			// all ones for negative depths, the sign bit alone for the rest.
+			__m128i bits{ _mm_castps_si128(depth) };
+			__m128i flip{ _mm_or_si128(_mm_srai_epi32(bits, 31), sign) };
+			__m128i key{ _mm_xor_si128(_mm_xor_si128(bits, flip), ones) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(this->keys_.data() + index), key);
+		}
+
+		this->compute_keys_scalar(depth_row, simd_end);
+	}
+
+	SIMD_TARGET_AVX2
+	void compute_keys_avx2(const glm::vec4& depth_row)
+	{
+		std::size_t simd_end{ this->x_.size() & ~static_cast<std::size_t>(7) };
+		__m256 row_x{ _mm256_set1_ps(depth_row.x) };
+		__m256 row_y{ _mm256_set1_ps(depth_row.y) };
+		__m256 row_z{ _mm256_set1_ps(depth_row.z) };
+		__m256 row_w{ _mm256_set1_ps(depth_row.w) };
+		__m256i sign{ _mm256_set1_epi32(static_cast<int>(0x80000000u)) };
+		__m256i ones{ _mm256_set1_epi32(-1) };
+
+		for (std::size_t index = 0; index < simd_end; index += 8)
+		{
+			__m256 depth{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row_x, _mm256_loadu_ps(this->x_.data() + index)), _mm256_mul_ps(row_y, _mm256_loadu_ps(this->y_.data() + index))),
+				_mm256_add_ps(_mm256_mul_ps(row_z, _mm256_loadu_ps(this->z_.data() + index)), row_w)) };
+			_mm256_storeu_ps(this->depths_.data() + index, depth);
+
+			__m256i bits{ _mm256_castps_si256(depth) };
+			__m256i flip{ _mm256_or_si256(_mm256_srai_epi32(bits, 31), sign) };
+			__m256i key{ _mm256_xor_si256(_mm256_xor_si256(bits, flip), ones) };
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(this->keys_.data() + index), key);
+		}
+
+		this->compute_keys_scalar(depth_row, simd_end);
+	}
+#endif
+
+	// least significant byte first, each pass stable. all 4 histograms come from one read of the keys,
+	// a byte that is the same in every key would move nothing, so its pass is skipped.
+	void radix_sort()
+	{
+		std::size_t count{ this->keys_.size() };
+		this->order_.resize(count);
+		std::iota(this->order_.begin(), this->order_.end(), 0u);
+		if (count < 2)
+		{
+			return;
+		}
+
+		if (count < transparency_sorter::INSERTION_SORT_LIMIT)
+		{
+			this->insertion_sort();
+			return;
+		}
+
+		std::array<std::array<std::uint32_t, 256>, 4> histograms{};
+		for (std::uint32_t key : this->keys_)
+		{
+			++histograms[0][key & 0xff];
+			++histograms[1][(key >> 8) & 0xff];
+			++histograms[2][(key >> 16) & 0xff];
+			++histograms[3][key >> 24];
+		}
+
+		this->key_scratch_.resize(count);
+		this->order_scratch_.resize(count);
+		for (std::size_t digit = 0; digit < 4; ++digit)
+		{
+			std::uint32_t shift{ static_cast<std::uint32_t>(digit * 8) };
+			std::array<std::uint32_t, 256>& histogram{ histograms[digit] };
+			if (histogram[(this->keys_.front() >> shift) & 0xff] == count)
+			{
+				continue;
+			}
+
+			std::uint32_t offset{ 0 };
+			for (std::uint32_t& bucket : histogram)
+			{
+				std::uint32_t bucket_count{ bucket };
+				bucket = offset;
+				offset += bucket_count;
+			}
+
+			for (std::size_t index = 0; index < count; ++index)
+			{
+				std::uint32_t key{ this->keys_[index] };
+				std::uint32_t slot{ histogram[(key >> shift) & 0xff]++ };
+				this->key_scratch_[slot] = key;
+				this->order_scratch_[slot] = this->order_[index];
+			}
+
+			this->keys_.swap(this->key_scratch_);
+			this->order_.swap(this->order_scratch_);
+		}
+	}
+
+	// stable: a key only moves past strictly greater ones.
+	void insertion_sort()noexcept
+	{
+		for (std::size_t index = 1; index < this->keys_.size(); ++index)
+		{
+			std::uint32_t key{ this->keys_[index] };
+			std::uint32_t instance{ this->order_[index] };
+			std::size_t slot{ index };
+			for (; slot > 0 && this->keys_[slot - 1] > key; --slot)
+			{
+				this->keys_[slot] = this->keys_[slot - 1];
+				this->order_[slot] = this->order_[slot - 1];
+			}
+			this->keys_[slot] = key;
+			this->order_[slot] = instance;
+		}
+	}
+};
+
+
+#endif // !__TRANSPARENCY_SORTER_HPP__
@@ -0,0 +1,441 @@
+#ifndef __MESH_CACHE_HPP__
+#define __MESH_CACHE_HPP__
+
+#include <glad/glad.h>
+
+#include "mesh.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <list>
+#include <utility>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+
+// binary sidecar written next to a model file(<model>.mesh_cache), so that warm starts skip Assimp.
+//
+// layout:
+//   mesh_cache_header
+//   source path (source_path_length_ chars, padded to 4 bytes)
+//   for each mesh:
+//     mesh_cache_record
+//     texture references: { uint32 type, uint32 length, chars padded to 4 bytes } * texture_count_
+//     vertices: vertex * vertex_count_
+//     indices: GLuint * index_count_
+//
+// the cache is only used when magic, version, vertex stride, import flags, source path, mtime and size all match.
+static constexpr const std::uint32_t MESH_CACHE_VERSION{ 1 };
+static constexpr const char MESH_CACHE_MAGIC[8]{ 'M', 'E', 'S', 'H', 'C', 'C', 'H', 'E' };
+
+struct mesh_cache_header
+{
+	char magic_[8];
+	std::uint32_t version_;
+	std::uint32_t vertex_stride_;
+	std::uint32_t import_flags_;
+	std::uint32_t mesh_count_;
+	std::int64_t source_mtime_;
+	std::uint64_t source_size_;
+	std::uint32_t source_path_length_;
+	std::uint32_t reserved_;
+};
+
+struct mesh_cache_record
+{
+	std::uint32_t vertex_count_;
+	std::uint32_t index_count_;
+	std::uint32_t texture_count_;
+	std::uint32_t reserved_;
+};
+
+// one mesh served from the mapped cache, vertices and indices point straight into the mapping.
+struct mesh_cache_entry
+{
+	const vertex* vertices_{ nullptr };
+	std::size_t vertex_count_{};
+	const GLuint* indices_{ nullptr };
+	std::size_t index_count_{};
+	std::vector<std::pair<texture_type, std::basic_string<char>>> texture_refs_{};
+};
+
+
+class mesh_cache final
+{
+private:
+	std::basic_string<char> source_file_{};
+	std::basic_string<char> cache_file_{};
+	std::uint32_t import_flags_{};
+
+	const unsigned char* mapped_data_{ nullptr };
+	std::size_t mapped_size_{};
+
+#ifdef _WIN32
+	HANDLE file_handle_{ INVALID_HANDLE_VALUE };
+	HANDLE mapping_handle_{ nullptr };
+#endif
+
+	std::vector<mesh_cache_entry> entries_{};
+
+public:
+	mesh_cache(const std::basic_string<char>& source_file, std::uint32_t import_flags)
+		: source_file_{ source_file },
+		cache_file_{ source_file + ".mesh_cache" },
+		import_flags_{ import_flags }
+	{
+	}
+
+	mesh_cache(const mesh_cache&) = delete;
+	mesh_cache& operator=(const mesh_cache&) = delete;
+
+	~mesh_cache()
+	{
+		this->release();
+	}
+
+	const std::vector<mesh_cache_entry>& get_entries()const noexcept
+	{
+		return (this->entries_);
+	}
+
+	// map the sidecar file and validate it against the source model, false means the caller must import with Assimp.
+	bool load()
+	{
+		std::int64_t source_mtime{};
+		std::uint64_t source_size{};
+		if (!mesh_cache::stat_file(this->source_file_, source_mtime, source_size))
+		{
+			return false;
+		}
+
+		if (!this->map_file())
+		{
+			return false;
+		}
+
+		if (!this->parse(source_mtime, source_size))
+		{
+			std::cout << "MESH_CACHE:: stale or corrupted cache, reimporting: " << this->cache_file_ << std::endl;
+			this->release();
+			return false;
+		}
+
+		return true;
+	}
+
+	// unmap the sidecar file, every entry becomes invalid afterwards.
+	void release()noexcept
+	{
+		this->entries_.clear();
+
+#ifdef _WIN32
+		if (this->mapped_data_)
+		{
+			UnmapViewOfFile(this->mapped_data_);
+		}
+
+		if (this->mapping_handle_)
+		{
+			CloseHandle(this->mapping_handle_);
+			this->mapping_handle_ = nullptr;
+		}
+
+		if (this->file_handle_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(this->file_handle_);
+			this->file_handle_ = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (this->mapped_data_)
+		{
+			munmap(const_cast<unsigned char*>(this->mapped_data_), this->mapped_size_);
+		}
+#endif
+
+		this->mapped_data_ = nullptr;
+		this->mapped_size_ = 0;
+	}
+
+	// write the flattened meshes to the sidecar file, written to a temporary file first so a crash never leaves a half cache.
+	bool store(const std::list<std::shared_ptr<mesh>>& meshes)const
+	{
+		std::int64_t source_mtime{};
+		std::uint64_t source_size{};
+		if (!mesh_cache::stat_file(this->source_file_, source_mtime, source_size))
+		{
+			return false;
+		}
+
+		std::basic_string<char> temp_file{ this->cache_file_ + ".tmp" };
+		std::basic_ofstream<char> file_writer{ temp_file, std::ios::binary | std::ios::trunc };
+		if (!file_writer.is_open())
+		{
+			std::cout << "MESH_CACHE:: can not write cache: " << temp_file << std::endl;
+			return false;
+		}
+
+		mesh_cache_header header{};
+		std::memcpy(header.magic_, MESH_CACHE_MAGIC, sizeof(header.magic_));
+		header.version_ = MESH_CACHE_VERSION;
+		header.vertex_stride_ = sizeof(vertex);
+		header.import_flags_ = this->import_flags_;
+		header.mesh_count_ = static_cast<std::uint32_t>(meshes.size());
+		header.source_mtime_ = source_mtime;
+		header.source_size_ = source_size;
+		header.source_path_length_ = static_cast<std::uint32_t>(this->source_file_.size());
+
+		file_writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		mesh_cache::write_padded_string(file_writer, this->source_file_);
+
+		for (const auto& shared_mesh : meshes)
+		{
+			const std::list<texture>& textures{ shared_mesh->get_textures() };
+
+			mesh_cache_record record{};
+			record.vertex_count_ = static_cast<std::uint32_t>(shared_mesh->get_vertices_count());
+			record.index_count_ = static_cast<std::uint32_t>(shared_mesh->get_indices_count());
+			record.texture_count_ = static_cast<std::uint32_t>(textures.size());
+			file_writer.write(reinterpret_cast<const char*>(&record), sizeof(record));
+
+			for (const texture& the_texture : textures)
+			{
+				std::uint32_t type{ static_cast<std::uint32_t>(the_texture.type_) };
+				std::uint32_t length{ static_cast<std::uint32_t>(the_texture.path_.size()) };
+				file_writer.write(reinterpret_cast<const char*>(&type), sizeof(type));
+				file_writer.write(reinterpret_cast<const char*>(&length), sizeof(length));
+				mesh_cache::write_padded_string(file_writer, the_texture.path_);
+			}
+
+			file_writer.write(reinterpret_cast<const char*>(shared_mesh->get_vertices_data()), record.vertex_count_ * sizeof(vertex));
+			file_writer.write(reinterpret_cast<const char*>(shared_mesh->get_indices_data()), record.index_count_ * sizeof(GLuint));
+		}
+
+		file_writer.close();
+		if (!file_writer)
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		std::remove(this->cache_file_.c_str());
+		if (std::rename(temp_file.c_str(), this->cache_file_.c_str()) != 0)
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	static std::size_t padded_size(std::size_t size)noexcept
+	{
+		return (size + 3) & ~static_cast<std::size_t>(3);
+	}
+
+	static void write_padded_string(std::basic_ofstream<char>& file_writer, const std::basic_string<char>& str)
+	{
+		static constexpr const char padding[4]{};
+		file_writer.write(str.data(), str.size());
+		file_writer.write(padding, mesh_cache::padded_size(str.size()) - str.size());
+	}
+
+	static bool stat_file(const std::basic_string<char>& file, std::int64_t& mtime, std::uint64_t& size)
+	{
+#ifdef _WIN32
+		struct _stat64 file_state {};
+		if (_stat64(file.c_str(), &file_state) != 0)
+		{
+			return false;
+		}
+#else
+		struct stat file_state {};
+		if (stat(file.c_str(), &file_state) != 0)
+		{
+			return false;
+		}
+#endif
+
+		mtime = static_cast<std::int64_t>(file_state.st_mtime);
+		size = static_cast<std::uint64_t>(file_state.st_size);
+		return true;
+	}
+
+	bool map_file()
+	{
+#ifdef _WIN32
+		this->file_handle_ = CreateFileA(this->cache_file_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (this->file_handle_ == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER file_size{};
+		if (!GetFileSizeEx(this->file_handle_, &file_size) || file_size.QuadPart == 0)
+		{
+			this->release();
+			return false;
+		}
+
+		this->mapping_handle_ = CreateFileMappingA(this->file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!this->mapping_handle_)
+		{
+			this->release();
+			return false;
+		}
+
+		this->mapped_data_ = static_cast<const unsigned char*>(MapViewOfFile(this->mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+		if (!this->mapped_data_)
+		{
+			this->release();
+			return false;
+		}
+
+		this->mapped_size_ = static_cast<std::size_t>(file_size.QuadPart);
+#else
+		int file_descriptor{ open(this->cache_file_.c_str(), O_RDONLY) };
+		if (file_descriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat file_state {};
+		if (fstat(file_descriptor, &file_state) != 0 || file_state.st_size == 0)
+		{
+			close(file_descriptor);
+			return false;
+		}
+
+		void* data{ mmap(nullptr, static_cast<std::size_t>(file_state.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0) };
+		// the mapping keeps its own reference to the file.
+		close(file_descriptor);
+
+		if (data == MAP_FAILED)
+		{
+			return false;
+		}
+
+		this->mapped_data_ = static_cast<const unsigned char*>(data);
+		this->mapped_size_ = static_cast<std::size_t>(file_state.st_size);
+#endif
+
+		return true;
+	}
+
+	bool parse(std::int64_t source_mtime, std::uint64_t source_size)
+	{
+		std::size_t offset{ 0 };
+
+		if (this->mapped_size_ < sizeof(mesh_cache_header))
+		{
+			return false;
+		}
+
+		mesh_cache_header header{};
+		std::memcpy(&header, this->mapped_data_, sizeof(header));
+		offset += sizeof(header);
+
+		if (std::memcmp(header.magic_, MESH_CACHE_MAGIC, sizeof(header.magic_)) != 0 ||
+			header.version_ != MESH_CACHE_VERSION ||
+			header.vertex_stride_ != sizeof(vertex) ||
+			header.import_flags_ != this->import_flags_ ||
+			header.source_mtime_ != source_mtime ||
+			header.source_size_ != source_size ||
+			header.source_path_length_ != this->source_file_.size())
+		{
+			return false;
+		}
+
+		if (!this->has_bytes(offset, mesh_cache::padded_size(header.source_path_length_)) ||
+			std::memcmp(this->mapped_data_ + offset, this->source_file_.data(), header.source_path_length_) != 0)
+		{
+			return false;
+		}
+		offset += mesh_cache::padded_size(header.source_path_length_);
+
+		this->entries_.reserve(header.mesh_count_);
+		for (std::uint32_t mesh_index = 0; mesh_index < header.mesh_count_; ++mesh_index)
+		{
+			if (!this->has_bytes(offset, sizeof(mesh_cache_record)))
+			{
+				return false;
+			}
+
+			mesh_cache_record record{};
+			std::memcpy(&record, this->mapped_data_ + offset, sizeof(record));
+			offset += sizeof(record);
+
+			mesh_cache_entry entry{};
+			for (std::uint32_t texture_index = 0; texture_index < record.texture_count_; ++texture_index)
+			{
+				std::uint32_t type_and_length[2]{};
+				if (!this->has_bytes(offset, sizeof(type_and_length)))
+				{
+					return false;
+				}
+
+				std::memcpy(type_and_length, this->mapped_data_ + offset, sizeof(type_and_length));
+				offset += sizeof(type_and_length);
+
+				if (!this->has_bytes(offset, mesh_cache::padded_size(type_and_length[1])))
+				{
+					return false;
+				}
+
+				entry.texture_refs_.emplace_back(static_cast<texture_type>(type_and_length[0]),
+					std::basic_string<char>{ reinterpret_cast<const char*>(this->mapped_data_ + offset), type_and_length[1] });
+				offset += mesh_cache::padded_size(type_and_length[1]);
+			}
+
+			std::size_t vertices_bytes{ record.vertex_count_ * sizeof(vertex) };
+			std::size_t indices_bytes{ record.index_count_ * sizeof(GLuint) };
+			if (!this->has_bytes(offset, vertices_bytes + indices_bytes))
+			{
+				return false;
+			}
+
+			// every section is padded to 4 bytes, so the float and GLuint arrays are correctly aligned inside the mapping.
+			entry.vertices_ = reinterpret_cast<const vertex*>(this->mapped_data_ + offset);
+			entry.vertex_count_ = record.vertex_count_;
+			offset += vertices_bytes;
+
+			entry.indices_ = reinterpret_cast<const GLuint*>(this->mapped_data_ + offset);
+			entry.index_count_ = record.index_count_;
+			offset += indices_bytes;
+
+			this->entries_.push_back(std::move(entry));
+		}
+
+		return true;
+	}
+
+	bool has_bytes(std::size_t offset, std::size_t count)const noexcept
+	{
+		return offset <= this->mapped_size_ && count <= this->mapped_size_ - offset;
+	}
+};
+
+
+#endif // !__MESH_CACHE_HPP__
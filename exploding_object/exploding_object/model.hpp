@@ -10,6 +10,7 @@
 #include <assimp/postprocess.h>
 
 #include "mesh.hpp"
+#include "mesh_cache.hpp"
 #include "stb_image/stb_image.h"
 
 #include <string>
@@ -19,9 +20,13 @@
 #include <map>
 #include <vector>
 #include <list>
+#include <memory>
 #include <cassert>
+#include <cstring>
 
 
+static constexpr const unsigned int MODEL_IMPORT_FLAGS{ aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace };
+
 class model_loader final
 {
 private:
@@ -29,12 +34,22 @@ private:
 	std::vector<std::pair<std::basic_string<char>, texture>> loaded_texture_{};
 
 	std::basic_string<char> texture_file_dir_{};
+
+	// keeps the mapped cache alive until load_vertices_data() has uploaded it.
+	std::unique_ptr<mesh_cache> mesh_cache_{};
+	bool loaded_from_cache_{ false };
 public:
 	model_loader() = default;
 	model_loader(const model_loader&) = delete;
 	model_loader& operator=(const model_loader&) = delete;
 
 
+	bool is_loaded_from_cache()const noexcept
+	{
+		return (this->loaded_from_cache_);
+	}
+
+
 	void load_model(const std::basic_string<char>& model_file)
 	{
 		assert(!model_file.empty());
@@ -46,8 +61,20 @@ public:
 
 		texture_file_dir_ = model_file.substr(0, model_file.find_last_of('\\'));
 
+		// warm start: the sidecar cache is still valid, hand the mapped arrays to the meshes.
+		mesh_cache_ = std::make_unique<mesh_cache>(model_file, MODEL_IMPORT_FLAGS);
+		if (mesh_cache_->load())
+		{
+			process_cache(*mesh_cache_);
+			loaded_from_cache_ = true;
+			return;
+		}
+
+		mesh_cache_.reset();
+		loaded_from_cache_ = false;
+
 		Assimp::Importer importer{};
-		const aiScene* scene = importer.ReadFile(model_file, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		const aiScene* scene = importer.ReadFile(model_file, MODEL_IMPORT_FLAGS);
 
 		if (!scene)
 		{
@@ -64,6 +91,11 @@ public:
 
 		// process ASSIMP's root node recursively
 		process_node(scene->mRootNode, scene);
+
+		if (!mesh_cache{ model_file, MODEL_IMPORT_FLAGS }.store(meshes_))
+		{
+			std::cout << "MESH_CACHE:: failed to write cache for: " << model_file << std::endl;
+		}
 	}
 
 	void load_vertices_data()
@@ -72,6 +104,9 @@ public:
 		{
 			shared_mesh->bind_VAO_VBO_EBO();
 		}
+
+		// the vertices are on the GPU now, drop the mapping.
+		mesh_cache_.reset();
 	}
 
 
@@ -107,6 +142,25 @@ private:
 	}
 
 
+	void process_cache(const mesh_cache& cache)
+	{
+		for (const mesh_cache_entry& entry : cache.get_entries())
+		{
+			std::list<texture> textures{};
+			for (const auto& texture_ref : entry.texture_refs_)
+			{
+				textures.push_back(load_texture(texture_ref.second, texture_ref.first));
+			}
+
+			std::shared_ptr<mesh> shared_mesh{ std::make_shared<mesh>() };
+			shared_mesh->add_vertices(entry.vertices_, entry.vertex_count_);
+			shared_mesh->add_indices(entry.indices_, entry.index_count_);
+			shared_mesh->add_textures(textures);
+
+			meshes_.push_back(shared_mesh);
+		}
+	}
+
 	std::shared_ptr<mesh> process_mesh(const aiMesh* const ai_mesh, const aiScene* const ai_scene)
 	{
 		std::vector<vertex> vertices{};
@@ -211,28 +265,29 @@ private:
 			aiString texture_file_name{};
 			ai_material->GetTexture(type, index, &texture_file_name);
 
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip{ false };
-			for (std::size_t load_texture_index = 0; load_texture_index < loaded_texture_.size(); ++load_texture_index)
-			{
-				if (std::strcmp(loaded_texture_[load_texture_index].first.c_str(), texture_file_name.C_Str()) == 0)
-				{
-					textures.push_back(loaded_texture_[load_texture_index].second);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
-			}
+			textures.push_back(load_texture(texture_file_name.C_Str(), the_type));
+		}
+		return textures;
+	}
 
-			if (!skip)
-			{   // if texture hasn't been loaded already, load it
-				texture temp_texture{};
-				temp_texture.id_ = model_loader::load_texture_from_file(texture_file_name.C_Str(), texture_file_dir_);
-				temp_texture.type_ = the_type;
-				textures.push_back(temp_texture);
-				loaded_texture_.emplace_back(std::basic_string<char>{texture_file_name.C_Str()}, temp_texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+	texture load_texture(const std::basic_string<char>& texture_file_name, texture_type the_type)
+	{
+		// check if texture was loaded before and if so, skip loading a new texture
+		for (std::size_t load_texture_index = 0; load_texture_index < loaded_texture_.size(); ++load_texture_index)
+		{
+			if (std::strcmp(loaded_texture_[load_texture_index].first.c_str(), texture_file_name.c_str()) == 0)
+			{
+				return loaded_texture_[load_texture_index].second; // a texture with the same filepath has already been loaded. (optimization)
 			}
 		}
-		return textures;
+
+		// if texture hasn't been loaded already, load it
+		texture temp_texture{};
+		temp_texture.id_ = model_loader::load_texture_from_file(texture_file_name, texture_file_dir_);
+		temp_texture.type_ = the_type;
+		temp_texture.path_ = texture_file_name;
+		loaded_texture_.emplace_back(texture_file_name, temp_texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+		return temp_texture;
 	}
 
 	// gamma unused temporarily.
@@ -82,6 +82,11 @@ int main() {
   Shader lampShader(
       "/home/shihua/projects/learn_opengl/illumination/1.lamp.vs",
       "/home/shihua/projects/learn_opengl/illumination/1.lamp.fs");
+  // compiled on the first run, loaded from the program binaries afterwards
+  std::cout << "shaders: " << Shader::cacheStats().loaded << " cached, "
+            << Shader::cacheStats().compiled << " compiled ("
+            << Shader::cacheStats().rejected << " rejected) in "
+            << Shader::cacheStats().milliseconds << " ms" << std::endl;
 
   // set up vertex data (and buffer(s)) and configure vertex attributes
   // ------------------------------------------------------------------
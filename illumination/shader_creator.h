@@ -4,10 +4,25 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <string>
+#include <vector>
+
+// counters of every Shader built so far, print them to compare cold (compiled)
+// and warm (binary cache) startups.
+struct ProgramCacheStats {
+  unsigned int loaded = 0;
+  unsigned int compiled = 0;
+  unsigned int rejected = 0;
+  double milliseconds = 0.0;
+};
 
 class Shader {
 public:
@@ -52,43 +67,30 @@ public:
     } catch (std::ifstream::failure e) {
       std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-    // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
-    // if geometry shader is given, compile geometry shader
-    unsigned int geometry;
-    if (geometryPath != nullptr) {
-      const char *gShaderCode = geometryCode.c_str();
-      geometry = glCreateShader(GL_GEOMETRY_SHADER);
-      glShaderSource(geometry, 1, &gShaderCode, NULL);
-      glCompileShader(geometry);
-      checkCompileErrors(geometry, "GEOMETRY");
+    // 2. load the linked program from the binary cache, or compile and cache it.
+    // the key covers the sources and the driver, any change of them is a miss.
+    auto buildBegin = std::chrono::steady_clock::now();
+    std::uint64_t key = cacheKey(vertexCode, fragmentCode, geometryCode);
+    std::string cacheFile = cachePath(vertexPath, key);
+    ID = loadBinary(cacheFile, key);
+    if (ID != 0) {
+      ++cacheStats().loaded;
+    } else {
+      ID = compile(vertexCode, fragmentCode,
+                   geometryPath != nullptr ? &geometryCode : nullptr);
+      ++cacheStats().compiled;
+      storeBinary(cacheFile, key);
     }
-    // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    if (geometryPath != nullptr)
-      glAttachShader(ID, geometry);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
-    // delete the shaders as they're linked into our program now and no longer
-    // necessery
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (geometryPath != nullptr)
-      glDeleteShader(geometry);
+    cacheStats().milliseconds +=
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - buildBegin)
+            .count();
+  }
+  // shared by every Shader
+  // ------------------------------------------------------------------------
+  static ProgramCacheStats &cacheStats() {
+    static ProgramCacheStats stats;
+    return stats;
   }
   // activate the shader
   // ------------------------------------------------------------------------
@@ -144,6 +146,178 @@ public:
   }
 
 private:
+  // on disk: this header, then binaryLength bytes of the driver's binary.
+  struct BinaryHeader {
+    char magic[8];
+    std::uint32_t binaryFormat;
+    std::uint32_t reserved;
+    std::uint64_t key;
+    std::uint64_t binaryLength;
+  };
+
+  unsigned int compile(const std::string &vertexCode,
+                       const std::string &fragmentCode,
+                       const std::string *geometryCode) {
+    const char *vShaderCode = vertexCode.c_str();
+    const char *fShaderCode = fragmentCode.c_str();
+    // compile shaders
+    unsigned int vertex, fragment;
+    // vertex shader
+    vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &vShaderCode, NULL);
+    glCompileShader(vertex);
+    checkCompileErrors(vertex, "VERTEX");
+    // fragment Shader
+    fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, &fShaderCode, NULL);
+    glCompileShader(fragment);
+    checkCompileErrors(fragment, "FRAGMENT");
+    // if geometry shader is given, compile geometry shader
+    unsigned int geometry;
+    if (geometryCode != nullptr) {
+      const char *gShaderCode = geometryCode->c_str();
+      geometry = glCreateShader(GL_GEOMETRY_SHADER);
+      glShaderSource(geometry, 1, &gShaderCode, NULL);
+      glCompileShader(geometry);
+      checkCompileErrors(geometry, "GEOMETRY");
+    }
+    // shader Program
+    unsigned int program = glCreateProgram();
+    if (binariesSupported())
+      glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                          GL_TRUE);
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    if (geometryCode != nullptr)
+      glAttachShader(program, geometry);
+    glLinkProgram(program);
+    checkCompileErrors(program, "PROGRAM");
+    // delete the shaders as they're linked into our program now and no longer
+    // necessery
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    if (geometryCode != nullptr)
+      glDeleteShader(geometry);
+    return program;
+  }
+
+  static bool binariesSupported() {
+    // glad leaves these null below GL 4.1.
+    if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+      return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+  }
+
+  // 64-bit FNV-1a over the driver strings and the sources, each terminated
+  // so that "ab" + "c" and "a" + "bc" differ.
+  static void hashString(std::uint64_t &hash, const char *text) {
+    if (text == nullptr)
+      text = "";
+    std::size_t length = std::strlen(text) + 1;
+    for (std::size_t i = 0; i < length; ++i) {
+      hash ^= static_cast<unsigned char>(text[i]);
+      hash *= 1099511628211ull;
+    }
+  }
+
+  static std::uint64_t cacheKey(const std::string &vertexCode,
+                                const std::string &fragmentCode,
+                                const std::string &geometryCode) {
+    std::uint64_t hash = 14695981039346656037ull;
+    hashString(hash, (const char *)glGetString(GL_VENDOR));
+    hashString(hash, (const char *)glGetString(GL_RENDERER));
+    hashString(hash, (const char *)glGetString(GL_VERSION));
+    hashString(hash, vertexCode.c_str());
+    hashString(hash, fragmentCode.c_str());
+    hashString(hash, geometryCode.c_str());
+    return hash;
+  }
+
+  // next to the vertex shader, named after the key.
+  static std::string cachePath(const char *vertexPath, std::uint64_t key) {
+    std::string path(vertexPath);
+    std::size_t slash = path.find_last_of("/\\");
+    path = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    char name[40];
+    std::snprintf(name, sizeof(name), "%016llx.program_binary",
+                  static_cast<unsigned long long>(key));
+    return path + name;
+  }
+
+  // returns 0 on a miss or when the driver rejects the binary.
+  static unsigned int loadBinary(const std::string &cacheFile,
+                                 std::uint64_t key) {
+    if (!binariesSupported())
+      return 0;
+    std::ifstream file(cacheFile, std::ios::binary);
+    if (!file.is_open())
+      return 0;
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    BinaryHeader header;
+    if (bytes.size() < sizeof(header))
+      return 0;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, "PRGMBIN", 8) != 0 || header.key != key ||
+        header.binaryLength != bytes.size() - sizeof(header))
+      return 0;
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, bytes.data() + sizeof(header),
+                    static_cast<GLsizei>(header.binaryLength));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+      // driver update or another GPU: compile again and overwrite the file.
+      ++cacheStats().rejected;
+      glDeleteProgram(program);
+      std::remove(cacheFile.c_str());
+      return 0;
+    }
+    return program;
+  }
+
+  void storeBinary(const std::string &cacheFile, std::uint64_t key) {
+    if (!binariesSupported())
+      return;
+    GLint length = 0;
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+      return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, NULL, &format, binary.data());
+    BinaryHeader header;
+    std::memcpy(header.magic, "PRGMBIN", 8);
+    header.binaryFormat = format;
+    header.reserved = 0;
+    header.key = key;
+    header.binaryLength = binary.size();
+    // a crash mid write must not leave a truncated binary under the final name.
+    std::string tempFile = cacheFile + ".tmp";
+    {
+      std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+      if (!file.is_open()) {
+        std::cout << "ERROR::SHADER::PROGRAM_CACHE_NOT_WRITTEN: " << cacheFile
+                  << std::endl;
+        return;
+      }
+      file.write((const char *)&header, sizeof(header));
+      file.write(binary.data(), binary.size());
+      file.close();
+      if (!file) {
+        std::cout << "ERROR::SHADER::PROGRAM_CACHE_NOT_WRITTEN: " << cacheFile
+                  << std::endl;
+        std::remove(tempFile.c_str());
+        return;
+      }
+    }
+    std::remove(cacheFile.c_str());
+    if (std::rename(tempFile.c_str(), cacheFile.c_str()) != 0)
+      std::remove(tempFile.c_str());
+  }
+
   // utility function for checking shader compilation/linking errors.
   // ------------------------------------------------------------------------
   void checkCompileErrors(GLuint shader, std::string type) {
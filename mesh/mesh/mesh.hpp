@@ -37,6 +37,7 @@ struct texture
 {
 	std::size_t id_;
 	texture_type type_;
+	std::basic_string<char> path_;
 };
 
 
@@ -48,6 +49,12 @@ private:
 	std::vector<GLuint> indices_;
 	std::list<texture> textures_;
 
+	// point either to vertices_/indices_ or to memory owned by someone else(e.g. a mapped mesh cache).
+	const vertex* vertices_data_{ nullptr };
+	std::size_t vertices_count_{};
+	const GLuint* indices_data_{ nullptr };
+	std::size_t indices_count_{};
+
 	GLuint VAO_;
 	GLuint VBO_;
 	GLuint EBO_;
@@ -60,6 +67,26 @@ public:
 	inline void add_vertices(const std::vector<vertex>& vertices)noexcept
 	{
 		this->vertices_ = vertices;
+		this->vertices_data_ = this->vertices_.data();
+		this->vertices_count_ = this->vertices_.size();
+	}
+
+	// the caller keeps the vertices alive until bind_VAO_VBO_EBO() has uploaded them.
+	inline void add_vertices(const vertex* vertices, std::size_t count)noexcept
+	{
+		this->vertices_.clear();
+		this->vertices_data_ = vertices;
+		this->vertices_count_ = count;
+	}
+
+	inline const vertex* get_vertices_data()const noexcept
+	{
+		return this->vertices_data_;
+	}
+
+	inline std::size_t get_vertices_count()const noexcept
+	{
+		return this->vertices_count_;
 	}
 
 	inline const std::vector<vertex>& get_vertices(const std::vector<vertex>& vertices)const noexcept
@@ -70,6 +97,26 @@ public:
 	inline void add_indices(const std::vector<GLuint>& indices)noexcept
 	{
 		this->indices_ = indices;
+		this->indices_data_ = this->indices_.data();
+		this->indices_count_ = this->indices_.size();
+	}
+
+	// the caller keeps the indices alive until bind_VAO_VBO_EBO() has uploaded them.
+	inline void add_indices(const GLuint* indices, std::size_t count)noexcept
+	{
+		this->indices_.clear();
+		this->indices_data_ = indices;
+		this->indices_count_ = count;
+	}
+
+	inline const GLuint* get_indices_data()const noexcept
+	{
+		return this->indices_data_;
+	}
+
+	inline std::size_t get_indices_count()const noexcept
+	{
+		return this->indices_count_;
 	}
 
 	inline const std::vector<GLuint>& get_indices()const noexcept
@@ -82,7 +129,7 @@ public:
 		this->textures_ = textures;
 	}
 
-	const const std::list<texture> get_textures()const noexcept
+	const std::list<texture>& get_textures()const noexcept
 	{
 		return this->textures_;
 	}
@@ -145,7 +192,7 @@ public:
 
 		// draw mesh
 		glBindVertexArray(VAO_);
-		glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT, 0);
+		glDrawElements(GL_TRIANGLES, indices_count_, GL_UNSIGNED_INT, 0);
 
 		// always good practice to set everything back to defaults once configured.
 		glBindVertexArray(0);
@@ -162,10 +209,10 @@ public:
 		glBindVertexArray(VAO_);
 
 		glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-		glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(vertex), &vertices_[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, vertices_count_ * sizeof(vertex), vertices_data_, GL_STATIC_DRAW);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(GLuint), &indices_[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_count_ * sizeof(GLuint), indices_data_, GL_STATIC_DRAW);
 
 		std::size_t offset{ 0 };
 		glEnableVertexAttribArray(0);
@@ -189,6 +236,17 @@ public:
 
 		//notice here:
 		glBindVertexArray(0);
+
+		// external memory is not guaranteed to outlive the upload.
+		if (this->vertices_.empty())
+		{
+			this->vertices_data_ = nullptr;
+		}
+
+		if (this->indices_.empty())
+		{
+			this->indices_data_ = nullptr;
+		}
 	}
 };
 
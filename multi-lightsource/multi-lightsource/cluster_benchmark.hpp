@@ -0,0 +1,83 @@
+#ifndef __CLUSTER_BENCHMARK_HPP__
+#define __CLUSTER_BENCHMARK_HPP__
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "light_clusters.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+
+
+// times light_clusters::build() on every level the CPU runs, for 256 to 16k point lights scattered around the containers,
+// in microseconds per frame. the wider levels are checked against the scalar cluster lists.
+inline void run_cluster_benchmark(std::ostream& out)
+{
+	glm::mat4 view{ glm::lookAt(glm::vec3{ 0.0f, 0.0f, 3.0f }, glm::vec3{ 0.0f, 0.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f }) };
+
+	std::vector<simd_level> levels{ simd_support::available_levels() };
+	out << "light cluster benchmark, " << CLUSTER_X << "x" << CLUSTER_Y << "x" << CLUSTER_Z << " clusters, best level: "
+		<< simd_support::level_name(levels.back()) << std::endl;
+
+	std::mt19937 generator{ 42 };
+	std::uniform_real_distribution<float> across{ -8.0f, 8.0f };
+	std::uniform_real_distribution<float> up{ -5.0f, 6.0f };
+	std::uniform_real_distribution<float> along{ -20.0f, 3.0f };
+	std::uniform_real_distribution<float> radius{ 1.0f, 3.0f };
+	for (std::size_t count : { std::size_t{ 256 }, std::size_t{ 1024 }, std::size_t{ 4096 }, std::size_t{ 16384 } })
+	{
+		std::vector<clustered_light> lights(count);
+		for (clustered_light& light : lights)
+		{
+			light.position_ = glm::vec3{ across(generator), up(generator), along(generator) };
+			light.radius_ = radius(generator);
+		}
+
+		std::size_t repeats{ std::max<std::size_t>(8, 200000 / count) };
+		double scalar_seconds{};
+		std::vector<std::uint32_t> reference_ranges{};
+		std::vector<std::uint32_t> reference_indices{};
+		for (simd_level level : levels)
+		{
+			light_clusters clusters{ level };
+			clusters.set_projection(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+			clusters.set_lights(lights);
+
+			auto begin{ std::chrono::steady_clock::now() };
+			for (std::size_t repeat = 0; repeat < repeats; ++repeat)
+			{
+				clusters.build(view);
+			}
+			double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / repeats };
+
+			bool mismatch{ false };
+			if (level == simd_level::scalar)
+			{
+				scalar_seconds = seconds;
+				reference_ranges = clusters.get_ranges();
+				reference_indices = clusters.get_indices();
+			}
+			else
+			{
+				mismatch = clusters.get_ranges() != reference_ranges || clusters.get_indices() != reference_indices;
+			}
+
+			out << "    " << std::setw(6) << count << " lights " << std::setw(6) << simd_support::level_name(level) << " " << std::fixed << std::setprecision(1)
+				<< std::setw(9) << seconds * 1e6 << " us/frame (" << std::setprecision(2) << scalar_seconds / seconds << "x), "
+				<< std::setprecision(1) << static_cast<double>(clusters.get_index_count()) / CLUSTER_COUNT << " lights per cluster"
+				<< (mismatch ? " MISMATCH" : "") << std::endl;
+		}
+	}
+
+	out.unsetf(std::ios::fixed);
+	out << std::setprecision(6);
+}
+
+
+#endif // !__CLUSTER_BENCHMARK_HPP__
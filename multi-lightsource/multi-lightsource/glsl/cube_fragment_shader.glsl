@@ -0,0 +1,45 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+
+#include "camera_block.glsl"
+#include "phong_lights.glsl"
+
+void main()
+{
+    // properties
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(camera_position.xyz - FragPos);
+
+    // == =====================================================
+    // Our lighting is set up in 3 phases: directional, point lights(or clustered lights) and an optional flashlight
+    // For each phase, a calculate function is defined that calculates the corresponding color
+    // per lamp. In the main() function we take all the calculated colors and sum them up for
+    // this fragment's final color.
+    // which phases exist is decided when the variant is compiled.
+    // == =====================================================
+    vec3 result = vec3(0.0);
+
+    // phase 1: directional lighting
+#ifdef HAS_DIR_LIGHT
+    result += CalcDirLight(dirLight, norm, viewDir, TexCoords);
+#endif
+
+    // phase 2: point lights
+    for (int i = 0; i < NR_POINT_LIGHTS; i++)
+        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, TexCoords);
+
+#ifdef CLUSTERED_LIGHTS
+    result += CalcClusteredLights(norm, FragPos, viewDir, TexCoords, -(view * vec4(FragPos, 1.0)).z);
+#endif
+
+    // phase 3: spot light
+#ifdef HAS_SPOT_LIGHT
+    result += CalcSpotLight(spotLight, norm, FragPos, viewDir, TexCoords);
+#endif
+
+    FragColor = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 model;
+#include "camera_block.glsl"
+
+void main()
+{
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords;
+
+    // must use Normal Matrix, it can keep NU Scale right.
+    Normal = mat3(transpose(inverse(model))) * aNormal; //transpose(inverse(model)) create Normal Matrix.
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+#include "camera_block.glsl"
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+// phong lighting for a directional light, point lights and a spot light, shared by every lit program.
+// permutations, defined by the program variant instead of branched on at run time:
+//   NR_POINT_LIGHTS     point lights evaluated, 0 .. MAX_POINT_LIGHTS
+//   HAS_DIR_LIGHT       evaluate dirLight
+//   HAS_SPOT_LIGHT      evaluate spotLight(the flash light)
+//   HAS_SPECULAR_MAP    sample material.specular_, otherwise use material.specular_color_
+//   CLUSTERED_LIGHTS    evaluate the light_data point lights listed for the fragment's cluster(light_clusters.hpp),
+//                       CLUSTER_X, CLUSTER_Y and CLUSTER_Z give the grid
+//   UNCULLED_LIGHTS     with CLUSTERED_LIGHTS, loop over all light_count lights instead, for comparison
+
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 4
+#endif
+
+// size of pointLights[], fixed so light_block keeps one layout for every variant.
+#define MAX_POINT_LIGHTS 4
+
+struct Material
+{
+    sampler2D diffuse_; // ambient color is the same with diffuse color, ususally.
+#ifdef HAS_SPECULAR_MAP
+    sampler2D specular_;
+#else
+    vec3 specular_color_;
+#endif
+    float shininess_;
+};
+
+// std140 puts every vec3 on a 16 byte boundary, the scalars fill the gap after each vec3.
+// the C++ mirror is light_block in main.cpp.
+struct DirLight
+{
+    vec3 direction_;
+    vec3 ambient_;
+    vec3 diffuse_;
+    vec3 specular_;
+};
+
+struct PointLight
+{
+    vec3 position_;
+    float constant_;
+    vec3 ambient_;
+    float linear_;
+    vec3 diffuse_;
+    float quadratic_;
+    vec3 specular_;
+};
+
+struct SpotLight
+{
+    vec3 position_; // bes same with camera position.
+    float cutoff_;
+    vec3 direction_; // be same with camera direction.
+    float outer_cutoff_;
+    vec3 ambient_;
+    float constant_;
+    vec3 diffuse_;
+    float linear_;
+    vec3 specular_;
+    float quadratic_;
+};
+
+layout (std140) uniform light_block
+{
+    DirLight dirLight; // cllimated light
+    PointLight pointLights[MAX_POINT_LIGHTS]; // point lights
+    SpotLight spotLight; // flash light
+};
+
+uniform Material material;
+
+vec3 SpecularColor(vec2 tex_coords)
+{
+#ifdef HAS_SPECULAR_MAP
+    return vec3(texture(material.specular_, tex_coords));
+#else
+    return material.specular_color_;
+#endif
+}
+
+vec3 CalcDirLight(DirLight dir_light, vec3 normal, vec3 viewer_dir, vec2 tex_coords)
+{
+    vec3 light_direction = normalize(-dir_light.direction_);
+
+    // diffuse
+    float diffuse_value = max(dot(light_direction, normal), 0.0f);
+
+    // specular
+    vec3 reflect_direction = reflect(-light_direction, normal);
+    float specular_value = pow(max(dot(viewer_dir, reflect_direction), 0.0f), material.shininess_);
+
+    vec3 ambient = dir_light.ambient_ * vec3(texture(material.diffuse_, tex_coords));
+    vec3 diffuse = dir_light.diffuse_ * diffuse_value * vec3(texture(material.diffuse_, tex_coords));
+    vec3 specular = dir_light.specular_ * specular_value * SpecularColor(tex_coords);
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcPointLight(PointLight point_light, vec3 normal, vec3 frag_pos, vec3 viewer_dir, vec2 tex_coords)
+{
+    vec3 light_direction = normalize(point_light.position_ - frag_pos);
+
+    // diffuse
+    float diffuse_value = max(dot(light_direction, normal), 0.0f);
+
+    // specular
+    vec3 reflect_direction = reflect(-light_direction, normal);
+    float specular_value = pow(max(dot(viewer_dir, reflect_direction), 0.0), material.shininess_);
+
+    // attenuation
+    float distance = length(point_light.position_ - frag_pos);
+    float attenuation_value = 1.0f / (point_light.constant_ + point_light.linear_ * distance + point_light.quadratic_ * (distance * distance));
+
+    vec3 ambient = point_light.ambient_ * vec3(texture(material.diffuse_, tex_coords));
+    vec3 diffuse = point_light.diffuse_ * diffuse_value * vec3(texture(material.diffuse_, tex_coords));
+    vec3 specular = point_light.specular_ * specular_value * SpecularColor(tex_coords);
+
+    ambient *= attenuation_value;
+    diffuse *= attenuation_value;
+    specular *= attenuation_value;
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a spot light.
+vec3 CalcSpotLight(SpotLight spot_light, vec3 normal, vec3 frag_pos, vec3 viewer_dir, vec2 tex_coords)
+{
+    vec3 light_direction = normalize(spot_light.position_ - frag_pos);
+
+    // diffuse shading
+    float diff = max(dot(normal, light_direction), 0.0);
+
+    // specular shading
+    vec3 reflect_direction = reflect(-light_direction, normal);
+    float spec = pow(max(dot(viewer_dir, reflect_direction), 0.0), material.shininess_);
+
+    // attenuation
+    float distance = length(spot_light.position_ - frag_pos);
+    float attenuation = 1.0f / (spot_light.constant_ + spot_light.linear_ * distance + spot_light.quadratic_ * (distance * distance));
+
+    // spotlight intensity
+    float theta = dot(light_direction, normalize(-spot_light.direction_));
+    float epsilon = spot_light.cutoff_ - spot_light.outer_cutoff_;
+    float intensity = clamp((theta - spot_light.outer_cutoff_) / epsilon, 0.0, 1.0);
+
+    // combine results
+    vec3 ambient = spot_light.ambient_ * vec3(texture(material.diffuse_, tex_coords));
+    vec3 diffuse = spot_light.diffuse_ * diff * vec3(texture(material.diffuse_, tex_coords));
+    vec3 specular = spot_light.specular_ * spec * SpecularColor(tex_coords);
+
+    ambient *= attenuation * intensity;
+    diffuse *= attenuation * intensity;
+    specular *= attenuation * intensity;
+
+    return (ambient + diffuse + specular);
+}
+
+#ifdef CLUSTERED_LIGHTS
+// three texels per light: position_ and radius_, diffuse_ and linear_, specular_ and quadratic_.
+uniform samplerBuffer light_data;
+// offset and count of every cluster's run in light_indices.
+uniform usamplerBuffer cluster_ranges;
+uniform usamplerBuffer light_indices;
+// xy turn gl_FragCoord into a tile, a view depth d is in slice log(d) * z - w.
+uniform vec4 cluster_params;
+uniform int light_count;
+
+// like CalcPointLight with a constant term of 1 and no ambient, faded out to nothing at the radius the clusters were built with.
+vec3 CalcClusteredLight(int light, vec3 normal, vec3 frag_pos, vec3 viewer_dir, vec3 diffuse_color, vec3 specular_color)
+{
+    vec4 position_radius = texelFetch(light_data, light * 3);
+    vec3 to_light = position_radius.xyz - frag_pos;
+    float distance = length(to_light);
+    if (distance >= position_radius.w)
+        return vec3(0.0);
+
+    vec4 diffuse_linear = texelFetch(light_data, light * 3 + 1);
+    vec4 specular_quadratic = texelFetch(light_data, light * 3 + 2);
+    vec3 light_direction = to_light / distance;
+
+    // diffuse
+    float diffuse_value = max(dot(light_direction, normal), 0.0f);
+
+    // specular
+    vec3 reflect_direction = reflect(-light_direction, normal);
+    float specular_value = pow(max(dot(viewer_dir, reflect_direction), 0.0), material.shininess_);
+
+    // attenuation
+    float ratio = distance / position_radius.w;
+    float fade = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    float attenuation_value = fade * fade / (1.0 + diffuse_linear.w * distance + specular_quadratic.w * (distance * distance));
+
+    vec3 diffuse = diffuse_linear.rgb * diffuse_value * diffuse_color;
+    vec3 specular = specular_quadratic.rgb * specular_value * specular_color;
+    return (diffuse + specular) * attenuation_value;
+}
+
+// view_depth is the fragment's distance in front of the camera.
+vec3 CalcClusteredLights(vec3 normal, vec3 frag_pos, vec3 viewer_dir, vec2 tex_coords, float view_depth)
+{
+    vec3 diffuse_color = vec3(texture(material.diffuse_, tex_coords));
+    vec3 specular_color = SpecularColor(tex_coords);
+    vec3 result = vec3(0.0);
+
+#ifdef UNCULLED_LIGHTS
+    for (int i = 0; i < light_count; i++)
+        result += CalcClusteredLight(i, normal, frag_pos, viewer_dir, diffuse_color, specular_color);
+#else
+    ivec3 cluster = ivec3(gl_FragCoord.xy * cluster_params.xy, log(view_depth) * cluster_params.z - cluster_params.w);
+    cluster = clamp(cluster, ivec3(0), ivec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+    uvec2 range = texelFetch(cluster_ranges, (cluster.z * CLUSTER_Y + cluster.y) * CLUSTER_X + cluster.x).xy;
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcClusteredLight(int(texelFetch(light_indices, int(range.x + i)).r), normal, frag_pos, viewer_dir, diffuse_color, specular_color);
+#endif
+
+    return result;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,470 @@
+#ifndef __LIGHT_CLUSTERS_HPP__
+#define __LIGHT_CLUSTERS_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "simd_level.hpp"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+
+// the cluster grid: screen tiles across and up, and depth slices spaced exponentially between the near and far planes.
+// the glsl side gets them as CLUSTER_X, CLUSTER_Y and CLUSTER_Z defines.
+static constexpr const std::uint32_t CLUSTER_X{ 16 };
+static constexpr const std::uint32_t CLUSTER_Y{ 9 };
+static constexpr const std::uint32_t CLUSTER_Z{ 24 };
+static constexpr const std::uint32_t CLUSTER_COUNT{ CLUSTER_X * CLUSTER_Y * CLUSTER_Z };
+
+// rows are tested in whole SIMD registers and a row's hits are one bit mask.
+static_assert(CLUSTER_X % 8 == 0 && CLUSTER_X <= 32, "a cluster row must be whole AVX2 registers and fit a 32 bit mask");
+
+// texture units of the buffer textures, after material.diffuse_ and material.specular_.
+static constexpr const GLint LIGHT_DATA_UNIT{ 2 };
+static constexpr const GLint CLUSTER_RANGE_UNIT{ 3 };
+static constexpr const GLint LIGHT_INDEX_UNIT{ 4 };
+
+
+// a point light of the clustered path, three RGBA32F texels of light_data in glsl/phong_lights.glsl.
+// attenuated like PointLight with a constant term of 1, and faded out to nothing at radius_.
+struct clustered_light
+{
+	glm::vec3 position_;
+	float radius_;
+	glm::vec3 diffuse_;
+	float linear_;
+	glm::vec3 specular_;
+	float quadratic_;
+};
+
+static_assert(sizeof(clustered_light) == 48, "clustered_light must be three vec4 texels");
+
+
+// clustered forward lighting: the view frustum is cut into CLUSTER_COUNT boxes, and every frame build() lists the lights
+// reaching each box, so a fragment only loops over the lights of its own cluster instead of all of them.
+// lights are only looked up in the clusters under their screen and depth bounds, and those are tested against the sphere
+// a row at a time, 8 clusters at once with AVX2 or 4 with SSE, in aligned blocks whose hits outside the bounds are masked off.
+// the lists are counted into one index array, every cluster getting an offset and a count, and go to the GPU as buffer
+// textures(OpenGL 3.3 has no storage buffers).
+class light_clusters final
+{
+private:
+	simd_level level_{ simd_level::scalar };
+
+	// view space bounds of every cluster, index (z * CLUSTER_Y + y) * CLUSTER_X + x.
+	std::vector<float> min_x_{};
+	std::vector<float> min_y_{};
+	std::vector<float> min_z_{};
+	std::vector<float> max_x_{};
+	std::vector<float> max_y_{};
+	std::vector<float> max_z_{};
+
+	float field_of_view_{};
+	float aspect_{};
+	float near_{};
+	float far_{};
+	float tan_half_x_{};
+	float tan_half_y_{};
+	// slice = log(depth) * depth_scale_ - depth_bias_.
+	float depth_scale_{};
+	float depth_bias_{};
+
+	// lights in world space.
+	std::vector<float> x_{};
+	std::vector<float> y_{};
+	std::vector<float> z_{};
+	std::vector<float> radius_{};
+
+	// every (cluster, light) hit of a build, in light order.
+	std::vector<std::uint32_t> hit_clusters_{};
+	std::vector<std::uint32_t> hit_lights_{};
+
+	// offset and count of every cluster's lights in indices_.
+	std::vector<std::uint32_t> ranges_{};
+	std::vector<std::uint32_t> indices_{};
+
+	GLuint light_buffer_{};
+	GLuint range_buffer_{};
+	GLuint index_buffer_{};
+	GLuint light_texture_{};
+	GLuint range_texture_{};
+	GLuint index_texture_{};
+
+public:
+	explicit light_clusters(simd_level level = simd_support::detect())
+		: level_{ level },
+		ranges_(CLUSTER_COUNT * 2)
+	{
+		for (std::vector<float>* bounds : { &this->min_x_, &this->min_y_, &this->min_z_, &this->max_x_, &this->max_y_, &this->max_z_ })
+		{
+			bounds->resize(CLUSTER_COUNT);
+		}
+	}
+
+	light_clusters(const light_clusters&) = delete;
+	light_clusters& operator=(const light_clusters&) = delete;
+
+	~light_clusters()
+	{
+		if (this->light_buffer_ == 0)
+		{
+			return;
+		}
+
+		const GLuint buffers[]{ this->light_buffer_, this->range_buffer_, this->index_buffer_ };
+		const GLuint textures[]{ this->light_texture_, this->range_texture_, this->index_texture_ };
+		glDeleteBuffers(3, buffers);
+		glDeleteTextures(3, textures);
+	}
+
+	simd_level get_level()const noexcept
+	{
+		return this->level_;
+	}
+
+	std::size_t get_light_count()const noexcept
+	{
+		return this->x_.size();
+	}
+
+	// light indices over all clusters in the last build.
+	std::size_t get_index_count()const noexcept
+	{
+		return this->indices_.size();
+	}
+
+	const std::vector<std::uint32_t>& get_ranges()const noexcept
+	{
+		return this->ranges_;
+	}
+
+	const std::vector<std::uint32_t>& get_indices()const noexcept
+	{
+		return this->indices_;
+	}
+
+	// the buffers and their buffer textures. the CPU side works without them, for benchmarks without a context.
+	void create_buffers()
+	{
+		glGenBuffers(1, &this->light_buffer_);
+		glGenBuffers(1, &this->range_buffer_);
+		glGenBuffers(1, &this->index_buffer_);
+		glGenTextures(1, &this->light_texture_);
+		glGenTextures(1, &this->range_texture_);
+		glGenTextures(1, &this->index_texture_);
+
+		light_clusters::attach(this->light_texture_, GL_RGBA32F, this->light_buffer_);
+		light_clusters::attach(this->range_texture_, GL_RG32UI, this->range_buffer_);
+		light_clusters::attach(this->index_texture_, GL_R32UI, this->index_buffer_);
+	}
+
+	// rebuilds the cluster bounds when the projection changed.
+	void set_projection(float field_of_view, float aspect, float near, float far)
+	{
+		if (field_of_view == this->field_of_view_ && aspect == this->aspect_ && near == this->near_ && far == this->far_)
+		{
+			return;
+		}
+
+		this->field_of_view_ = field_of_view;
+		this->aspect_ = aspect;
+		this->near_ = near;
+		this->far_ = far;
+		this->tan_half_y_ = std::tan(field_of_view * 0.5f);
+		this->tan_half_x_ = this->tan_half_y_ * aspect;
+		this->depth_scale_ = static_cast<float>(CLUSTER_Z) / std::log(far / near);
+		this->depth_bias_ = this->depth_scale_ * std::log(near);
+
+		for (std::uint32_t z = 0; z < CLUSTER_Z; ++z)
+		{
+			float near_depth{ near * std::pow(far / near, static_cast<float>(z) / CLUSTER_Z) };
+			float far_depth{ near * std::pow(far / near, static_cast<float>(z + 1) / CLUSTER_Z) };
+			for (std::uint32_t y = 0; y < CLUSTER_Y; ++y)
+			{
+				float bottom{ (-1.0f + 2.0f * y / CLUSTER_Y) * this->tan_half_y_ };
+				float top{ (-1.0f + 2.0f * (y + 1) / CLUSTER_Y) * this->tan_half_y_ };
+				for (std::uint32_t x = 0; x < CLUSTER_X; ++x)
+				{
+					float left{ (-1.0f + 2.0f * x / CLUSTER_X) * this->tan_half_x_ };
+					float right{ (-1.0f + 2.0f * (x + 1) / CLUSTER_X) * this->tan_half_x_ };
+
+					// the frustum slice widens with depth, its box spans both ends.
+					std::size_t cluster{ (static_cast<std::size_t>(z) * CLUSTER_Y + y) * CLUSTER_X + x };
+					this->min_x_[cluster] = std::min(left * near_depth, left * far_depth);
+					this->max_x_[cluster] = std::max(right * near_depth, right * far_depth);
+					this->min_y_[cluster] = std::min(bottom * near_depth, bottom * far_depth);
+					this->max_y_[cluster] = std::max(top * near_depth, top * far_depth);
+					this->min_z_[cluster] = -far_depth;
+					this->max_z_[cluster] = -near_depth;
+				}
+			}
+		}
+	}
+
+	// the cluster_params uniform for a framebuffer_width x framebuffer_height viewport:
+	// xy turn gl_FragCoord into a tile, zw a view depth into a slice.
+	glm::vec4 get_params(int framebuffer_width, int framebuffer_height)const noexcept
+	{
+		return glm::vec4{ static_cast<float>(CLUSTER_X) / std::max(framebuffer_width, 1), static_cast<float>(CLUSTER_Y) / std::max(framebuffer_height, 1),
+			this->depth_scale_, this->depth_bias_ };
+	}
+
+	// keeps the positions for build(), and uploads the lights when the buffers exist.
+	void set_lights(const std::vector<clustered_light>& lights)
+	{
+		this->x_.resize(lights.size());
+		this->y_.resize(lights.size());
+		this->z_.resize(lights.size());
+		this->radius_.resize(lights.size());
+		for (std::size_t index = 0; index < lights.size(); ++index)
+		{
+			this->x_[index] = lights[index].position_.x;
+			this->y_[index] = lights[index].position_.y;
+			this->z_[index] = lights[index].position_.z;
+			this->radius_[index] = lights[index].radius_;
+		}
+
+		if (this->light_buffer_ != 0)
+		{
+			glBindBuffer(GL_TEXTURE_BUFFER, this->light_buffer_);
+			glBufferData(GL_TEXTURE_BUFFER, std::max<std::size_t>(lights.size(), 1) * sizeof(clustered_light), lights.data(), GL_STATIC_DRAW);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		}
+	}
+
+	// lists the lights of every cluster for view, on the CPU. set_projection() must have been called.
+	void build(const glm::mat4& view)
+	{
+		this->hit_clusters_.clear();
+		this->hit_lights_.clear();
+
+		for (std::size_t light = 0; light < this->x_.size(); ++light)
+		{
+			float radius{ this->radius_[light] };
+			glm::vec3 center{ view[0][0] * this->x_[light] + view[1][0] * this->y_[light] + view[2][0] * this->z_[light] + view[3][0],
+				view[0][1] * this->x_[light] + view[1][1] * this->y_[light] + view[2][1] * this->z_[light] + view[3][1],
+				view[0][2] * this->x_[light] + view[1][2] * this->y_[light] + view[2][2] * this->z_[light] + view[3][2] };
+
+			// depth range of the sphere, clipped to the frustum.
+			float nearest{ std::max(-center.z - radius, this->near_) };
+			float farthest{ std::min(-center.z + radius, this->far_) };
+			if (nearest > farthest)
+			{
+				continue;
+			}
+
+			std::uint32_t first_x{}, last_x{}, first_y{}, last_y{};
+			if (!light_clusters::tile_range(center.x, radius, nearest, farthest, this->tan_half_x_, CLUSTER_X, first_x, last_x)
+				|| !light_clusters::tile_range(center.y, radius, nearest, farthest, this->tan_half_y_, CLUSTER_Y, first_y, last_y))
+			{
+				continue;
+			}
+
+			std::uint32_t first_z{ this->slice(nearest) };
+			std::uint32_t last_z{ this->slice(farthest) };
+			glm::vec4 sphere{ center, radius * radius };
+			std::uint32_t row_mask{ static_cast<std::uint32_t>((std::uint64_t{ 2 } << last_x) - (std::uint64_t{ 1 } << first_x)) };
+			for (std::uint32_t z = first_z; z <= last_z; ++z)
+			{
+				for (std::uint32_t y = first_y; y <= last_y; ++y)
+				{
+					std::uint32_t row{ (z * CLUSTER_Y + y) * CLUSTER_X };
+					std::uint32_t hits{ this->test_row(row, first_x, last_x, sphere) & row_mask };
+					for (std::uint32_t x = first_x; hits >> x != 0; ++x)
+					{
+						if (hits >> x & 1)
+						{
+							this->hit_clusters_.push_back(row + x);
+							this->hit_lights_.push_back(static_cast<std::uint32_t>(light));
+						}
+					}
+				}
+			}
+		}
+
+		// counting sort by cluster, light order is kept inside each cluster.
+		std::fill(this->ranges_.begin(), this->ranges_.end(), 0u);
+		for (std::uint32_t cluster : this->hit_clusters_)
+		{
+			++this->ranges_[cluster * 2 + 1];
+		}
+
+		std::uint32_t offset{ 0 };
+		for (std::uint32_t cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+		{
+			this->ranges_[cluster * 2] = offset;
+			offset += this->ranges_[cluster * 2 + 1];
+		}
+
+		this->indices_.resize(this->hit_lights_.size());
+		for (std::size_t hit = 0; hit < this->hit_clusters_.size(); ++hit)
+		{
+			std::uint32_t& cluster_offset{ this->ranges_[this->hit_clusters_[hit] * 2] };
+			this->indices_[cluster_offset++] = this->hit_lights_[hit];
+		}
+
+		// the scatter moved every offset to the end of its cluster.
+		for (std::uint32_t cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+		{
+			this->ranges_[cluster * 2] -= this->ranges_[cluster * 2 + 1];
+		}
+	}
+
+	// uploads the last build and binds the buffer textures to their units.
+	void upload_and_bind()const
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, this->range_buffer_);
+		glBufferData(GL_TEXTURE_BUFFER, this->ranges_.size() * sizeof(std::uint32_t), this->ranges_.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, this->index_buffer_);
+		glBufferData(GL_TEXTURE_BUFFER, std::max<std::size_t>(this->indices_.size(), 1) * sizeof(std::uint32_t), this->indices_.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, this->light_texture_);
+		glActiveTexture(GL_TEXTURE0 + CLUSTER_RANGE_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, this->range_texture_);
+		glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, this->index_texture_);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void print(std::ostream& out)const
+	{
+		std::uint32_t busiest{ 0 };
+		std::size_t lit_clusters{ 0 };
+		for (std::uint32_t cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+		{
+			busiest = std::max(busiest, this->ranges_[cluster * 2 + 1]);
+			lit_clusters += this->ranges_[cluster * 2 + 1] != 0 ? 1 : 0;
+		}
+
+		out << "light clusters(" << simd_support::level_name(this->level_) << "): " << this->x_.size() << " lights, "
+			<< lit_clusters << "/" << CLUSTER_COUNT << " clusters lit, " << this->indices_.size() << " light indices, at most " << busiest << " lights in a cluster";
+	}
+
+private:
+	static void attach(GLuint texture, GLenum format, GLuint buffer)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+
+	std::uint32_t slice(float depth)const noexcept
+	{
+		float slice{ std::log(depth) * this->depth_scale_ - this->depth_bias_ };
+		return static_cast<std::uint32_t>(std::min(std::max(slice, 0.0f), static_cast<float>(CLUSTER_Z - 1)));
+	}
+
+	// tiles a sphere may cover along one axis, over its depth range [nearest, farthest]: the smallest x / depth divides a
+	// negative coordinate by the nearest depth and a positive one by the farthest, the largest the other way round.
+	// false when it is off screen on this axis.
+	static bool tile_range(float center, float radius, float nearest, float farthest, float tan_half, std::uint32_t tiles,
+		std::uint32_t& first, std::uint32_t& last)noexcept
+	{
+		float low{ center - radius };
+		float high{ center + radius };
+		float low_ndc{ low / ((low < 0.0f ? nearest : farthest) * tan_half) };
+		float high_ndc{ high / ((high > 0.0f ? nearest : farthest) * tan_half) };
+		if (low_ndc > 1.0f || high_ndc < -1.0f)
+		{
+			return false;
+		}
+
+		float scale{ static_cast<float>(tiles) * 0.5f };
+		first = static_cast<std::uint32_t>(std::min(std::max((low_ndc + 1.0f) * scale, 0.0f), static_cast<float>(tiles - 1)));
+		last = static_cast<std::uint32_t>(std::min(std::max((high_ndc + 1.0f) * scale, 0.0f), static_cast<float>(tiles - 1)));
+		return true;
+	}
+
+	// bit x set when cluster row + x overlaps sphere(view space center, squared radius), for x in [first_x, last_x] and
+	// whatever else shares their SIMD blocks.
+	std::uint32_t test_row(std::uint32_t row, std::uint32_t first_x, std::uint32_t last_x, const glm::vec4& sphere)const noexcept
+	{
+		switch (this->level_)
+		{
+#if defined(SIMD_X86)
+		case simd_level::avx2: return this->test_row_avx2(row, first_x, last_x, sphere);
+		case simd_level::sse: return this->test_row_sse(row, first_x, last_x, sphere);
+#endif
+		default: return this->test_row_scalar(row, first_x, last_x, sphere);
+		}
+	}
+
+	std::uint32_t test_row_scalar(std::uint32_t row, std::uint32_t first_x, std::uint32_t last_x, const glm::vec4& sphere)const noexcept
+	{
+		std::uint32_t hits{ 0 };
+		for (std::uint32_t x = first_x; x <= last_x; ++x)
+		{
+			std::size_t cluster{ row + x };
+			float dx{ std::max(std::max(this->min_x_[cluster] - sphere.x, 0.0f), sphere.x - this->max_x_[cluster]) };
+			float dy{ std::max(std::max(this->min_y_[cluster] - sphere.y, 0.0f), sphere.y - this->max_y_[cluster]) };
+			float dz{ std::max(std::max(this->min_z_[cluster] - sphere.z, 0.0f), sphere.z - this->max_z_[cluster]) };
+			if (dx * dx + dy * dy + dz * dz <= sphere.w)
+			{
+				hits |= 1u << x;
+			}
+		}
+
+		return hits;
+	}
+
+#if defined(SIMD_X86)
+	std::uint32_t test_row_sse(std::uint32_t row, std::uint32_t first_x, std::uint32_t last_x, const glm::vec4& sphere)const noexcept
+	{
+		__m128 center_x{ _mm_set1_ps(sphere.x) };
+		__m128 center_y{ _mm_set1_ps(sphere.y) };
+		__m128 center_z{ _mm_set1_ps(sphere.z) };
+		__m128 radius_squared{ _mm_set1_ps(sphere.w) };
+		__m128 zero{ _mm_setzero_ps() };
+
+		std::uint32_t hits{ 0 };
+		for (std::uint32_t x = first_x & ~3u; x <= last_x; x += 4)
+		{
+			std::size_t cluster{ row + x };
+			__m128 dx{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(this->min_x_.data() + cluster), center_x), zero), _mm_sub_ps(center_x, _mm_loadu_ps(this->max_x_.data() + cluster))) };
+			__m128 dy{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(this->min_y_.data() + cluster), center_y), zero), _mm_sub_ps(center_y, _mm_loadu_ps(this->max_y_.data() + cluster))) };
+			__m128 dz{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(this->min_z_.data() + cluster), center_z), zero), _mm_sub_ps(center_z, _mm_loadu_ps(this->max_z_.data() + cluster))) };
+			__m128 distance_squared{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)) };
+			hits |= static_cast<std::uint32_t>(_mm_movemask_ps(_mm_cmple_ps(distance_squared, radius_squared))) << x;
+		}
+
+		return hits;
+	}
+
+	SIMD_TARGET_AVX2
+	std::uint32_t test_row_avx2(std::uint32_t row, std::uint32_t first_x, std::uint32_t last_x, const glm::vec4& sphere)const noexcept
+	{
+		__m256 center_x{ _mm256_set1_ps(sphere.x) };
+		__m256 center_y{ _mm256_set1_ps(sphere.y) };
+		__m256 center_z{ _mm256_set1_ps(sphere.z) };
+		__m256 radius_squared{ _mm256_set1_ps(sphere.w) };
+		__m256 zero{ _mm256_setzero_ps() };
+
+		std::uint32_t hits{ 0 };
+		for (std::uint32_t x = first_x & ~7u; x <= last_x; x += 8)
+		{
+			std::size_t cluster{ row + x };
+			__m256 dx{ _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(this->min_x_.data() + cluster), center_x), zero), _mm256_sub_ps(center_x, _mm256_loadu_ps(this->max_x_.data() + cluster))) };
+			__m256 dy{ _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(this->min_y_.data() + cluster), center_y), zero), _mm256_sub_ps(center_y, _mm256_loadu_ps(this->max_y_.data() + cluster))) };
+			__m256 dz{ _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(this->min_z_.data() + cluster), center_z), zero), _mm256_sub_ps(center_z, _mm256_loadu_ps(this->max_z_.data() + cluster))) };
+			__m256 distance_squared{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)) };
+			hits |= static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(distance_squared, radius_squared, _CMP_LE_OQ))) << x;
+		}
+
+		return hits;
+	}
+#endif
+};
+
+
+#endif // !__LIGHT_CLUSTERS_HPP__
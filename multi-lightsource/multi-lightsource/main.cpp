@@ -7,9 +7,20 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <iomanip>
 #include <iostream>
 
 #include "stb_image/stb_image.h"
+#include "shader_program.hpp"
+#include "uniform_blocks.hpp"
+#include "shader_variants.hpp"
+#include "light_clusters.hpp"
+#include "cluster_benchmark.hpp"
 
 static constexpr const int WIDTH{ 800 };
 static constexpr const int HEIGHT{ 600 };
@@ -36,6 +47,11 @@ static float yaw{ -90.f };
 static float speed{ 2.5f };
 static float sensitivity{ 0.05f };
 
+// F toggles the flash light, 0-4 pick how many point lights are lit. each combination is its own program variant.
+// with --lights the point lights come from light_clusters instead, and 0-4 do nothing.
+static bool flashLightOn{ true };
+static std::size_t activePointLights{ 4 };
+
 static void updateCameraVectors()
 {
 	// Calculate the new Front vector
@@ -50,225 +66,111 @@ static void updateCameraVectors()
 	cameraUp = glm::normalize(glm::cross(cameraRight, cameraFront));
 }
 
-static constexpr const char *cubeVertexShaderSource{
-	"#version 330 core\n"
-	"layout (location = 0) in vec3 aPos;\n"
-	"layout (location = 1) in vec3 aNormal;\n"
-	"layout (location = 2) in vec2 aTexCoords;\n"
-
-	"out vec3 FragPos;\n"
-	"out vec3 Normal;\n"
-	"out vec2 TexCoords;\n"
-
-	"uniform mat4 model;\n"
-	"uniform mat4 view;\n"
-	"uniform mat4 projection;\n"
-
-	"void main()\n"
-	"{\n"
-	"    FragPos = vec3(model * vec4(aPos, 1.0));\n"
-	"    TexCoords = aTexCoords;\n"
-
-	// must use Normal Matrix, it can keep NU Scale right.
-	"    Normal = mat3(transpose(inverse(model))) * aNormal;\n" //transpose(inverse(model)) create Normal Matrix.
-
-	"    gl_Position = projection * view * vec4(FragPos, 1.0);\n"
-	"}" };
-static constexpr const char *cubeFragmentShaderSource{
-	"#version 330 core\n"
-	"out vec4 FragColor;\n"
-
-	"struct Material\n"
-	"{\n"
-	"	sampler2D diffuse_;\n"
-	"	sampler2D specular_;\n"
-	"	float shininess_;\n"
-	"};\n"
-
-"struct DirLight {\n"
-"	vec3 direction_;\n"
-"	vec3 ambient_;\n"
-"	vec3 diffuse_;\n"
-"	vec3 specular_;\n"
-"};\n"
-
-"struct PointLight\n"
-"{\n"
-"	vec3 position_;\n"
-
-"	float constant_;\n"
-"	float linear_;\n"
-"	float quadratic_;\n"
-
-"	vec3 ambient_;\n"
-"	vec3 diffuse_;\n"
-"	vec3 specular_;\n"
-"};\n"
-
-
-"struct Material\n"
-"{\n"
-"    sampler2D diffuse_;\n" //ambient color is the same with diffuse color, ususally.
-"    sampler2D specular_;\n"
-"    float shininess_;\n"
-"};\n"
-
-"struct SpotLight"
-"{\n"
-"vec3 position_;\n"   // bes same with camera position.
-"vec3 direction_;\n" // be same with camera direction.
-"float cutoff_;\n"
-"float outer_cutoff_;\n"
-
-"float constant_;\n"
-"float linear_;\n"
-"float quadratic_;\n"
-
-"vec3 ambient_;\n"
-"vec3 diffuse_;\n"
-"vec3 specular_;\n"
-"};\n"
-
-"#define NR_POINT_LIGHTS 4\n"
-
-"in vec3 Normal;\n"
-"in vec3 FragPos;\n"
-"in vec2 TexCoords;\n"
-
-"uniform Material material;\n"
-"uniform DirLight dirLight;\n" // cllimated light
-"uniform PointLight pointLights[NR_POINT_LIGHTS];\n" // point lights
-"uniform SpotLight spotLight;\n" // flash light
-
-"uniform vec3 cameraPos;\n" //camera pos.
-
-"vec3 CalcDirLight(DirLight dir_light, vec3 normal, vec3 viewer_dir);\n"
-"vec3 CalcPointLight(PointLight point_light, vec3 normal, vec3 frag_pos, vec3 viewer_dir);\n"
-"vec3 CalcSpotLight(SpotLight spot_light, vec3 normal, vec3 frag_pos, vec3 viewer_dir);\n"
-
-"void main()\n"
-"{\n"
-
-// properties
-"vec3 norm = normalize(Normal);\n"
-"vec3 viewDir = normalize(cameraPos - FragPos);\n"
-
-// == =====================================================
-// Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-// For each phase, a calculate function is defined that calculates the corresponding color
-// per lamp. In the main() function we take all the calculated colors and sum them up for
-// this fragment's final color.
-// == =====================================================
-// phase 1: directional lighting
-"vec3 result = CalcDirLight(dirLight, norm, viewDir);\n"
-
-// phase 2: point lights
-"for (int i = 0; i < NR_POINT_LIGHTS; i++)\n"
-"	result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);\n"
-
-// phase 3: spot light
-"result += CalcSpotLight(spotLight, norm, FragPos, viewDir);\n"
-
-"FragColor = vec4(result, 1.0);\n"
-
-"}\n"
-
-"vec3 CalcDirLight(DirLight dir_light, vec3 normal, vec3 viewer_dir)"
-"{\n"
-
-	"vec3 light_direction = normalize(-dir_light.direction_);\n"
-
-	// diffuse
-	"float diffuse_value = max(dot(light_direction, normal), 0.0f);\n"
-
-	// specular
-	"vec3 reflect_direction = reflect(-light_direction, normal);\n"
-	"float specular_value = pow(max(dot(viewer_dir, reflect_direction), 0.0f), material.shininess_);\n"
-
-	"vec3 ambient = dir_light.ambient_ * vec3(texture(material.diffuse_, TexCoords));\n"
-	"vec3 diffuse = dir_light.diffuse_ * diffuse_value * vec3(texture(material.diffuse_, TexCoords));\n"
-	"vec3 specular = dir_light.specular_ * specular_value * vec3(texture(material.specular_, TexCoords));\n"
-
-	"return (ambient + diffuse + specular);\n"
-"}\n"
-
-"vec3 CalcPointLight(PointLight point_light, vec3 normal, vec3 frag_pos, vec3 viewer_dir)\n"
-"{\n"
-	"vec3 light_direction = normalize(point_light.position_ - frag_pos);\n"
-
-	// diffuse
-	"float diffuse_value = max(dot(light_direction, normal), 0.0f);\n"
-
-	// specular
-	"vec3 reflect_direction = reflect(-light_direction, normal);\n"
-	"float specular_value = pow(max(dot(viewer_dir, reflect_direction), 0.0), material.shininess_);\n"
+// where the glsl files live, glsl/phong_lights.glsl is included by the lit programs.
+#define GLSL_DIRECTORY "C:\\Users\\shihua\\source\\repos\\opengl_demo\\multi-lightsource\\multi-lightsource\\glsl\\"
 
-	// attenuation
-	"float distance = length(point_light.position_ - frag_pos);\n"
-	"float attenuation_value = 1.0f / (point_light.constant_ + point_light.linear_ * distance + point_light.quadratic_ * (distance * distance));\n"
+// mirror of light_block in glsl/phong_lights.glsl, vec3s are followed by the scalar std140 packs into their padding.
+static constexpr const std::size_t MAX_POINT_LIGHTS{ 4 };
 
-	"vec3 ambient = point_light.ambient_ * vec3(texture(material.diffuse_, TexCoords));\n"
-	"vec3 diffuse = point_light.diffuse_ * diffuse_value * vec3(texture(material.diffuse_, TexCoords));\n"
-	"vec3 specular = point_light.specular_ * specular_value * vec3(texture(material.specular_, TexCoords));\n"
-
-	"ambient *= attenuation_value;\n"
-	"diffuse *= attenuation_value;\n"
-	"specular *= attenuation_value;\n"
-	"return (ambient + diffuse + specular);\n"
-"}\n"
+struct dir_light_std140
+{
+	glm::vec3 direction_;
+	float padding0_;
+	glm::vec3 ambient_;
+	float padding1_;
+	glm::vec3 diffuse_;
+	float padding2_;
+	glm::vec3 specular_;
+	float padding3_;
+};
 
-// calculates the color when using a spot light.
-"vec3 CalcSpotLight(SpotLight spot_light, vec3 normal, vec3 frag_pos, vec3 viewer_dir)\n"
-"{\n"
-	"vec3 light_direction = normalize(spot_light.position_ - frag_pos);\n"
+struct point_light_std140
+{
+	glm::vec3 position_;
+	float constant_;
+	glm::vec3 ambient_;
+	float linear_;
+	glm::vec3 diffuse_;
+	float quadratic_;
+	glm::vec3 specular_;
+	float padding_;
+};
 
-	// diffuse shading
-	"float diff = max(dot(normal, light_direction), 0.0);\n"
+struct spot_light_std140
+{
+	glm::vec3 position_;
+	float cutoff_;
+	glm::vec3 direction_;
+	float outer_cutoff_;
+	glm::vec3 ambient_;
+	float constant_;
+	glm::vec3 diffuse_;
+	float linear_;
+	glm::vec3 specular_;
+	float quadratic_;
+};
 
-	// specular shading
-	"vec3 reflect_direction = reflect(-light_direction, normal);\n"
-	"float spec = pow(max(dot(viewer_dir, reflect_direction), 0.0), material.shininess_);\n"
+struct light_block
+{
+	dir_light_std140 dir_light_;
+	point_light_std140 point_lights_[MAX_POINT_LIGHTS];
+	spot_light_std140 spot_light_;
+};
 
-	// attenuation
-	"float distance = length(spot_light.position_ - frag_pos);\n"
-	"float attenuation = 1.0f / (spot_light.constant_ + spot_light.linear_ * distance + spot_light.quadratic_ * (distance * distance));\n"
+static_assert(offsetof(dir_light_std140, ambient_) == 16, "DirLight.ambient_ must match std140");
+static_assert(offsetof(dir_light_std140, specular_) == 48, "DirLight.specular_ must match std140");
+static_assert(sizeof(dir_light_std140) == 64, "DirLight size must match std140");
 
-	// spotlight intensity
-	"float theta = dot(light_direction, normalize(-spot_light.direction_));\n"
-	"float epsilon = spot_light.cutoff_ - spot_light.outer_cutoff_;\n"
-	"float intensity = clamp((theta - spot_light.outer_cutoff_) / epsilon, 0.0, 1.0);\n"
+static_assert(offsetof(point_light_std140, constant_) == 12, "PointLight.constant_ must match std140");
+static_assert(offsetof(point_light_std140, ambient_) == 16, "PointLight.ambient_ must match std140");
+static_assert(offsetof(point_light_std140, linear_) == 28, "PointLight.linear_ must match std140");
+static_assert(offsetof(point_light_std140, quadratic_) == 44, "PointLight.quadratic_ must match std140");
+static_assert(offsetof(point_light_std140, specular_) == 48, "PointLight.specular_ must match std140");
+static_assert(sizeof(point_light_std140) == 64, "PointLight array stride must match std140");
 
-	// combine results
-	"vec3 ambient = spot_light.ambient_ * vec3(texture(material.diffuse_, TexCoords));\n"
-	"vec3 diffuse = spot_light.diffuse_ * diff * vec3(texture(material.diffuse_, TexCoords));\n"
-	"vec3 specular = spot_light.specular_ * spec * vec3(texture(material.specular_, TexCoords));\n"
+static_assert(offsetof(spot_light_std140, cutoff_) == 12, "SpotLight.cutoff_ must match std140");
+static_assert(offsetof(spot_light_std140, outer_cutoff_) == 28, "SpotLight.outer_cutoff_ must match std140");
+static_assert(offsetof(spot_light_std140, quadratic_) == 76, "SpotLight.quadratic_ must match std140");
+static_assert(sizeof(spot_light_std140) == 80, "SpotLight size must match std140");
 
-	"ambient *= attenuation * intensity;\n"
-	"diffuse *= attenuation * intensity;\n"
-	"specular *= attenuation * intensity;\n"
+static_assert(offsetof(light_block, point_lights_) == 64, "light_block.pointLights must match std140");
+static_assert(offsetof(light_block, spot_light_) == 64 + 64 * MAX_POINT_LIGHTS, "light_block.spotLight must match std140");
 
-	"return (ambient + diffuse + specular);\n"
-"}\n"
+// the lit program of one light combination, with its handles.
+struct cube_variant
+{
+	std::size_t request_{};
+	std::unique_ptr<shader_program> program_{};
+	uniform_handle<float> shininess_{};
+	uniform_handle<glm::mat4> model_{};
+	// clustered variants only.
+	uniform_handle<glm::vec4> cluster_params_{};
+	uniform_handle<int> light_count_{};
 };
 
-static constexpr const char *lampVertexShaderSource{
-	"#version 330 core\n"
-	"layout (location = 0) in vec3 aPos;\n"
-	"uniform mat4 model;\n"
-	"uniform mat4 view;\n"
-	"uniform mat4 projection;\n"
-	"void main()\n"
-	"{\n"
-	"	gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
-	"}" };
-
-static constexpr const char *lampFragmentShaderSource{
-	"#version 330 core\n"
-	"out vec4 FragColor;\n"
-	"void main()\n"
-	"{\n"
-	"    FragColor = vec4(1.0);\n" // set alle 4 vector values to 1.0
-	"}" };
+// count point lights of the clustered path scattered through and around the containers, colored at random.
+static std::vector<clustered_light> scatterPointLights(std::size_t count)
+{
+	std::mt19937 generator{ 7 };
+	std::uniform_real_distribution<float> across{ -6.0f, 6.0f };
+	std::uniform_real_distribution<float> up{ -4.0f, 6.0f };
+	std::uniform_real_distribution<float> along{ -16.0f, 3.0f };
+	std::uniform_real_distribution<float> color{ 0.2f, 1.0f };
+	std::uniform_real_distribution<float> radius{ 1.0f, 2.5f };
+
+	std::vector<clustered_light> lights(count);
+	for (clustered_light& light : lights)
+	{
+		light.position_ = glm::vec3{ across(generator), up(generator), along(generator) };
+		light.radius_ = radius(generator);
+		light.diffuse_ = glm::vec3{ color(generator), color(generator), color(generator) };
+		light.specular_ = light.diffuse_;
+		light.linear_ = 0.7f;
+		light.quadratic_ = 1.8f;
+	}
+
+	return lights;
+}
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
@@ -307,6 +209,24 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 	glViewport(0, 0, width, height);
 }
 
+// glfw: whenever a key is pressed, this callback is called
+// ---------------------------------------------------------
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS)
+		return;
+
+	if (key == GLFW_KEY_F)
+	{
+		flashLightOn = !flashLightOn;
+	}
+
+	if (key >= GLFW_KEY_0 && key <= GLFW_KEY_0 + static_cast<int>(MAX_POINT_LIGHTS))
+	{
+		activePointLights = static_cast<std::size_t>(key - GLFW_KEY_0);
+	}
+}
+
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 static void mouse_callback(GLFWwindow *window, double xpos, double ypos)
@@ -358,14 +278,56 @@ static void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 	}
 }
 
-int main()
+// command line:
+//   --frames N              render N frames in a hidden window, then print the CPU time spent updating camera and lights and exit.
+//   --lights N              clustered forward lighting with N point lights scattered around the containers.
+//   --unculled              with --lights, every fragment loops over all the lights instead of its cluster's.
+//   --cluster-benchmark     time building the cluster lists on every SIMD level the CPU runs and exit, without a window.
+//   --light-benchmark N     render N frames in a hidden window for 16 to 4096 clustered lights, culled and unculled,
+//                           then print the GPU time per frame and the CPU time building the clusters and exit.
+int main(int argc, char* argv[])
 {
+	std::size_t benchmark_frames{ 0 };
+	std::size_t clusteredLightCount{ 0 };
+	bool clustered{ false };
+	bool unculled{ false };
+	std::size_t lightBenchmarkFrames{ 0 };
+	for (int index = 1; index < argc; ++index)
+	{
+		std::basic_string<char> argument{ argv[index] };
+		if (argument == "--frames" && index + 1 < argc)
+		{
+			benchmark_frames = std::stoul(argv[++index]);
+		}
+		else if (argument == "--lights" && index + 1 < argc)
+		{
+			clustered = true;
+			clusteredLightCount = std::stoul(argv[++index]);
+		}
+		else if (argument == "--unculled")
+		{
+			unculled = true;
+		}
+		else if (argument == "--cluster-benchmark")
+		{
+			run_cluster_benchmark(std::cout);
+			return 0;
+		}
+		else if (argument == "--light-benchmark" && index + 1 < argc)
+		{
+			lightBenchmarkFrames = std::stoul(argv[++index]);
+		}
+	}
+
+	bool hidden{ benchmark_frames != 0 || lightBenchmarkFrames != 0 };
+
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, hidden ? GLFW_FALSE : GLFW_TRUE);
 
 	// glfw window creation
 	// --------------------
@@ -382,9 +344,13 @@ int main()
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetKeyCallback(window, key_callback);
 
 	// tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (!hidden)
+	{
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	// glad: load all OpenGL function pointers
 	// ---------------------------------------
@@ -401,99 +367,58 @@ int main()
 	// notice that: count camera front/up/right vectors.
 	updateCameraVectors();
 
-	// cube shaders.
-	GLuint cubeVertexShader{};
-	GLuint cubeFragmentShader{};
+	// every light combination is compiled up front, in one batch the driver may spread over its threads.
+	// a variant only evaluates the lights it was built for, instead of branching on them per fragment.
+	program_cache::shared().set_directory(GLSL_DIRECTORY);
+	std::unique_ptr<shader_variants> programs{ std::make_unique<shader_variants>() };
+	programs->enable_parallel_compile(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
-	cubeVertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(cubeVertexShader, 1, &cubeVertexShaderSource, nullptr);
-	glCompileShader(cubeVertexShader);
-
-	GLint success{};
-	glGetShaderiv(cubeVertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
+	cube_variant cubeVariants[MAX_POINT_LIGHTS + 1][2]{};
+	for (std::size_t pointLights = 0; pointLights <= MAX_POINT_LIGHTS; ++pointLights)
 	{
-		GLchar infoLog[1024]{};
-		glGetShaderInfoLog(cubeVertexShader, 1024, nullptr, infoLog);
-		std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: "
-			<< infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-	}
-
-	cubeFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(cubeFragmentShader, 1, &cubeFragmentShaderSource, nullptr);
-	glCompileShader(cubeFragmentShader);
-
-	success = 0;
-	glGetShaderiv(cubeFragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		GLchar infoLog[1024]{};
-		glGetShaderInfoLog(cubeFragmentShader, 1024, nullptr, infoLog);
-		std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: "
-			<< infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-	}
-
-	GLuint cubeProgramId{ glCreateProgram() };
-	glAttachShader(cubeProgramId, cubeVertexShader);
-	glAttachShader(cubeProgramId, cubeFragmentShader);
-	glLinkProgram(cubeProgramId);
-
-	success = 0;
-	glGetProgramiv(cubeProgramId, GL_LINK_STATUS, &success);
-	if (!success)
-	{
-		GLchar infoLog[1024]{};
-		glGetProgramInfoLog(cubeProgramId, 1024, nullptr, infoLog);
-		std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: "
-			<< infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+		for (std::size_t spotLight = 0; spotLight < 2; ++spotLight)
+		{
+			shader_defines defines{};
+			defines.define("NR_POINT_LIGHTS", static_cast<int>(pointLights)).define("HAS_DIR_LIGHT").define("HAS_SPECULAR_MAP");
+			if (spotLight != 0)
+			{
+				defines.define("HAS_SPOT_LIGHT");
+			}
+
+			cubeVariants[pointLights][spotLight].request_ = programs->add(GLSL_DIRECTORY "cube_vertex_shader.glsl", GLSL_DIRECTORY "cube_fragment_shader.glsl", defines);
+		}
 	}
 
-	// lamp shaders.
-	GLuint lampVertexShader{};
-	GLuint lampFragmentShader{};
-
-	lampVertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(lampVertexShader, 1, &lampVertexShaderSource, nullptr);
-	glCompileShader(lampVertexShader);
-
-	success = 0;
-	glGetShaderiv(lampVertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
+	// the clustered path replaces the pointLights[] loop, [unculled][spot light].
+	cube_variant clusteredVariants[2][2]{};
+	for (std::size_t allLights = 0; allLights < 2; ++allLights)
 	{
-		GLchar infoLog[1024]{};
-		glGetShaderInfoLog(lampVertexShader, 1024, nullptr, infoLog);
-		std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: "
-			<< infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+		for (std::size_t spotLight = 0; spotLight < 2; ++spotLight)
+		{
+			shader_defines defines{};
+			defines.define("NR_POINT_LIGHTS", 0).define("HAS_DIR_LIGHT").define("HAS_SPECULAR_MAP").define("CLUSTERED_LIGHTS")
+				.define("CLUSTER_X", static_cast<int>(CLUSTER_X)).define("CLUSTER_Y", static_cast<int>(CLUSTER_Y)).define("CLUSTER_Z", static_cast<int>(CLUSTER_Z));
+			if (allLights != 0)
+			{
+				defines.define("UNCULLED_LIGHTS");
+			}
+
+			if (spotLight != 0)
+			{
+				defines.define("HAS_SPOT_LIGHT");
+			}
+
+			clusteredVariants[allLights][spotLight].request_ = programs->add(GLSL_DIRECTORY "cube_vertex_shader.glsl", GLSL_DIRECTORY "cube_fragment_shader.glsl", defines);
+		}
 	}
 
-	lampFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(lampFragmentShader, 1, &lampFragmentShaderSource, nullptr);
-	glCompileShader(lampFragmentShader);
-
-	success = 0;
-	glGetShaderiv(lampFragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		GLchar infoLog[1024]{};
-		glGetShaderInfoLog(lampFragmentShader, 1024, nullptr, infoLog);
-		std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: "
-			<< infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-	}
+	std::size_t lampRequest{ programs->add(GLSL_DIRECTORY "lamp_vertex_shader.glsl", GLSL_DIRECTORY "lamp_fragment_shader.glsl") };
 
-	GLuint lampProgramId{ glCreateProgram() };
-	glAttachShader(lampProgramId, lampVertexShader);
-	glAttachShader(lampProgramId, lampFragmentShader);
-	glLinkProgram(lampProgramId);
+	programs->compile_all();
+	programs->print(std::cout);
+	std::cout << std::endl;
 
-	success = 0;
-	glGetProgramiv(lampProgramId, GL_LINK_STATUS, &success);
-	if (!success)
-	{
-		GLchar infoLog[1024]{};
-		glGetProgramInfoLog(lampProgramId, 1024, nullptr, infoLog);
-		std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: "
-			<< infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-	}
+	GLuint lampProgramId{ programs->get_program(lampRequest) };
 
 	// set up vertex data (and buffer(s)) and configure vertex attributes
 	// ------------------------------------------------------------------
@@ -674,27 +599,102 @@ int main()
 
 	data = nullptr;
 
-	glUseProgram(cubeProgramId);
-	GLint texture1Id{ glGetUniformLocation(cubeProgramId, "material.diffuse_") };
-	glUniform1i(texture1Id, 0);
-	GLint texture2Id{ glGetUniformLocation(cubeProgramId, "material.specular_") };
-	glUniform1i(texture2Id, 1);
+	// camera and lights reach every program through two uniform buffers, each written once per frame.
+	std::unique_ptr<uniform_buffer<camera_block>> cameraBuffer{ std::make_unique<uniform_buffer<camera_block>>(CAMERA_BLOCK_BINDING) };
+	std::unique_ptr<uniform_buffer<light_block>> lightBuffer{ std::make_unique<uniform_buffer<light_block>>(LIGHT_BLOCK_BINDING) };
+	cameraBuffer->bind_to(lampProgramId, "camera_block");
 
-	while (!glfwWindowShouldClose(window))
+	// the remaining plain uniforms are resolved once, the frame loop only goes through handles.
+	std::vector<cube_variant*> allVariants{};
+	for (auto& pointLightVariants : cubeVariants)
 	{
-		// per-frame time logic
-		float currentFrame = glfwGetTime();
-		delta_time = currentFrame - last_frame;
-		last_frame = currentFrame;
+		for (cube_variant& variant : pointLightVariants)
+		{
+			allVariants.push_back(&variant);
+		}
+	}
+
+	for (auto& clusteredLightVariants : clusteredVariants)
+	{
+		for (cube_variant& variant : clusteredLightVariants)
+		{
+			allVariants.push_back(&variant);
+		}
+	}
+
+	for (cube_variant* variant : allVariants)
+	{
+		GLuint programId{ programs->get_program(variant->request_) };
+		cameraBuffer->bind_to(programId, "camera_block");
+		lightBuffer->bind_to(programId, "light_block");
+
+		variant->program_ = std::make_unique<shader_program>(programId);
+		variant->shininess_ = variant->program_->get_uniform<float>("material.shininess_");
+		variant->model_ = variant->program_->get_uniform<glm::mat4>("model");
+		variant->cluster_params_ = variant->program_->get_uniform<glm::vec4>("cluster_params");
+		variant->light_count_ = variant->program_->get_uniform<int>("light_count");
+
+		variant->program_->use();
+		variant->program_->set(variant->program_->get_uniform<int>("material.diffuse_"), 0);
+		variant->program_->set(variant->program_->get_uniform<int>("material.specular_"), 1);
+		variant->program_->set(variant->program_->get_uniform<int>("light_data"), LIGHT_DATA_UNIT);
+		variant->program_->set(variant->program_->get_uniform<int>("cluster_ranges"), CLUSTER_RANGE_UNIT);
+		variant->program_->set(variant->program_->get_uniform<int>("light_indices"), LIGHT_INDEX_UNIT);
+	}
+
+	// the clustered lights are uploaded once, their cluster lists every frame.
+	light_clusters clusters{};
+	clusters.create_buffers();
+	if (clustered)
+	{
+		clusters.set_lights(scatterPointLights(clusteredLightCount));
+	}
+
+	shader_program lampProgram{ lampProgramId };
+	uniform_handle<glm::mat4> lampModelHandle{ lampProgram.get_uniform<glm::mat4>("model") };
+
+	// everything but the flash light stays put.
+	light_block lights{};
+	lights.dir_light_.direction_ = glm::vec3{ -0.2f, -1.0f, -0.3f };
+	lights.dir_light_.ambient_ = glm::vec3{ 0.05f, 0.05f, 0.05f };
+	lights.dir_light_.diffuse_ = glm::vec3{ 0.4f, 0.4f, 0.4f };
+	lights.dir_light_.specular_ = glm::vec3{ 0.5f, 0.5f, 0.5f };
+
+	// only the fourth point light is attenuated harder.
+	static constexpr const float pointLightQuadratic[MAX_POINT_LIGHTS]{ 0.032f, 0.032f, 0.032f, 0.32f };
+	for (std::size_t i = 0; i < MAX_POINT_LIGHTS; ++i)
+	{
+		point_light_std140& pointLight{ lights.point_lights_[i] };
+		pointLight.position_ = pointLightPositions[i];
+		pointLight.ambient_ = glm::vec3{ 0.05f, 0.05f, 0.05f };
+		pointLight.diffuse_ = glm::vec3{ 0.8f, 0.8f, 0.8f };
+		pointLight.specular_ = glm::vec3{ 1.0f, 1.0f, 1.0f };
+		pointLight.constant_ = 1.0f;
+		pointLight.linear_ = 0.09f;
+		pointLight.quadratic_ = pointLightQuadratic[i];
+	}
 
+	lights.spot_light_.ambient_ = glm::vec3{ 0.0f, 0.0f, 0.0f };
+	lights.spot_light_.diffuse_ = glm::vec3{ 1.0f, 1.0f, 1.0f };
+	lights.spot_light_.specular_ = glm::vec3{ 1.0f, 1.0f, 1.0f };
+	lights.spot_light_.constant_ = 1.0f;
+	lights.spot_light_.linear_ = 0.09f;
+	lights.spot_light_.quadratic_ = 0.032f;
+	lights.spot_light_.cutoff_ = std::cos(glm::radians(12.5f));
+	lights.spot_light_.outer_cutoff_ = std::cos(glm::radians(15.0f));
+
+	std::size_t renderedFrames{ 0 };
+	double uniformMilliseconds{ 0.0 };
+	double clusterMilliseconds{ 0.0 };
+
+	// one frame with the given program variant, clustered ones build and bind the cluster lists first.
+	auto renderScene = [&](cube_variant& cube, bool clusteredLights)
+	{
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// input
-		// -----
-		processInput(window);
-
-		glUseProgram(cubeProgramId);
+		shader_program& cubeProgram{ *cube.program_ };
+		cubeProgram.use();
 
 		// bind textures to specify uniform.
 		glActiveTexture(GL_TEXTURE0);
@@ -703,81 +703,41 @@ int main()
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, textureID2);
 
-		GLint viewPosLoc{ glGetUniformLocation(cubeProgramId, "cameraPos") };
-		glUniform3fv(viewPosLoc, 1, &cameraPos[0]);
-
-		// directional light
-		GLint dirLightDirectionLoc{ glGetUniformLocation(cubeProgramId, "dirLight.direction_") };
-		glUniform3f(dirLightDirectionLoc, -0.2f, -1.0f, -0.3f);
-
-		GLint dirLightAmbientLoc{ glGetUniformLocation(cubeProgramId, "dirLight.ambient_") };
-		glUniform3f(dirLightAmbientLoc, 0.05f, 0.05f, 0.05f);
-
-		GLint dirLightDiffuseLoc{ glGetUniformLocation(cubeProgramId, "dirLight.diffuse_") };
-		glUniform3f(dirLightDiffuseLoc, 0.4f, 0.4f, 0.4f);
-
-		GLint dirLightSpecularLoc{ glGetUniformLocation(cubeProgramId, "dirLight.specular_") };
-		glUniform3f(dirLightSpecularLoc, 0.5f, 0.5f, 0.5f);
-
-		// point light 1
-		glUniform3fv(glGetUniformLocation(cubeProgramId, "pointLights[0].position_"), 1, &pointLightPositions[0][0]);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[0].ambient_"), 0.05f, 0.05f, 0.05f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[0].diffuse_"), 0.8f, 0.8f, 0.8f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[0].specular_"), 1.0f, 1.0f, 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[0].constant_"), 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[0].linear_"), 0.09f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[0].quadratic_"), 0.032f);
-		// point light 2
-		glUniform3fv(glGetUniformLocation(cubeProgramId, "pointLights[1].position_"), 1, &pointLightPositions[1][0]);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[1].ambient_"), 0.05f, 0.05f, 0.05f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[1].diffuse_"), 0.8f, 0.8f, 0.8f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[1].specular_"), 1.0f, 1.0f, 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[1].constant_"), 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[1].linear_"), 0.09f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[1].quadratic_"), 0.032);
-		// point light 3
-		glUniform3fv(glGetUniformLocation(cubeProgramId, "pointLights[2].position_"), 1, &pointLightPositions[2][0]);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[2].ambient_"), 0.05f, 0.05f, 0.05f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[2].diffuse_"), 0.8f, 0.8f, 0.8f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[2].specular_"), 1.0f, 1.0f, 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[2].constant_"), 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[2].linear_"), 0.09f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[2].quadratic_"), 0.032f);
-		// point light 4
-		glUniform3fv(glGetUniformLocation(cubeProgramId, "pointLights[3].position_"), 1, &pointLightPositions[1][0]);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[3].ambient_"), 0.05f, 0.05f, 0.05f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[3].diffuse_"), 0.8f, 0.8f, 0.8f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "pointLights[3].specular_"), 1.0f, 1.0f, 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[3].constant_"), 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[3].linear_"), 0.09f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "pointLights[3].quadratic_"), 0.32f);
+		auto uniformBegin{ std::chrono::steady_clock::now() };
+
 		// spotLight
-		glUniform3fv(glGetUniformLocation(cubeProgramId, "spotLight.position_"), 1, &cameraPos[0]);
-		glUniform3fv(glGetUniformLocation(cubeProgramId, "spotLight.direction_"), 1, &cameraFront[0]);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "spotLight.ambient_"), 0.0f, 0.0f, 0.0f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "spotLight.diffuse_"), 1.0f, 1.0f, 1.0f);
-		glUniform3f(glGetUniformLocation(cubeProgramId, "spotLight.specular_"), 1.0f, 1.0f, 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "spotLight.constant_"), 1.0f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "spotLight.linear_"), 0.09f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "spotLight.quadratic_"), 0.032f);
-		glUniform1f(glGetUniformLocation(cubeProgramId, "spotLight.cutoff_"), std::cos(glm::radians(12.5f)));
-		glUniform1f(glGetUniformLocation(cubeProgramId, "spotLight.outer_cutoff_"), std::cos(glm::radians(15.0f)));
-
-		GLint materialShininessLoc{ glGetUniformLocation(cubeProgramId, "material.shininess_") };
-		glUniform1f(materialShininessLoc, 32.0f);
+		lights.spot_light_.position_ = cameraPos;
+		lights.spot_light_.direction_ = cameraFront;
+		lightBuffer->update(lights);
 
 		// view/projection transformations
-		glm::mat4 projection{ glm::perspective(glm::radians(field_of_view), static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), 0.1f, 100.0f) };
-		glUniformMatrix4fv(glGetUniformLocation(cubeProgramId, "projection"), 1, GL_FALSE, &projection[0][0]);
+		camera_block camera{};
+		camera.projection_ = glm::perspective(glm::radians(field_of_view), static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), 0.1f, 100.0f);
+		camera.view_ = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+		camera.camera_position_ = glm::vec4{ cameraPos, 1.0f };
+		cameraBuffer->update(camera);
 
-		// camera/view transformation
-		glm::mat4 view{ 1.0f }; // make sure to initialize matrix to identity matrix first
-		view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-		glUniformMatrix4fv(glGetUniformLocation(cubeProgramId, "view"), 1, GL_FALSE, &view[0][0]);
+		cubeProgram.set(cube.shininess_, 32.0f);
+
+		uniformMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uniformBegin).count();
+
+		if (clusteredLights)
+		{
+			auto clusterBegin{ std::chrono::steady_clock::now() };
+			clusters.set_projection(glm::radians(field_of_view), static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), 0.1f, 100.0f);
+			clusters.build(camera.view_);
+			clusters.upload_and_bind();
+			clusterMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - clusterBegin).count();
+
+			int framebufferWidth{}, framebufferHeight{};
+			glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+			cubeProgram.set(cube.cluster_params_, clusters.get_params(framebufferWidth, framebufferHeight));
+			cubeProgram.set(cube.light_count_, static_cast<int>(clusters.get_light_count()));
+		}
 
 		// model
 		glm::mat4 model{ 1.0f };
-		glUniformMatrix4fv(glGetUniformLocation(cubeProgramId, "model"), 1, GL_FALSE, &model[0][0]);
+		cubeProgram.set(cube.model_, model);
 
 		// render containers
 		glBindVertexArray(cubeVAO);
@@ -788,31 +748,121 @@ int main()
 			model = glm::translate(model, cubePositions[i]);
 			float angle{ 20.0f * i };
 			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			glUniformMatrix4fv(glGetUniformLocation(cubeProgramId, "model"), 1, GL_FALSE, &model[0][0]);
+			cubeProgram.set(cube.model_, model);
 
 			glDrawArrays(GL_TRIANGLES, 0, 36);
 		}
 
+		// the clustered lights have no bulbs, a thousand lamp draws would swamp what is measured.
+		if (clusteredLights)
+		{
+			return;
+		}
+
 		// lamp
-		glUseProgram(lampProgramId);
-		glUniformMatrix4fv(glGetUniformLocation(lampProgramId, "projection"), 1, GL_FALSE, &projection[0][0]);
-		glUniformMatrix4fv(glGetUniformLocation(lampProgramId, "view"), 1, GL_FALSE, &view[0][0]);
+		lampProgram.use();
 
 		// we now draw as many light bulbs as we have point lights.
 		glBindVertexArray(lampVAO);
-		for (std::size_t i = 0; i < 4; ++i)
+		for (std::size_t i = 0; i < activePointLights; ++i)
 		{
 			model = glm::mat4{ 1.0f };
 			model = glm::translate(model, pointLightPositions[i]);
 			model = glm::scale(model, glm::vec3(0.2f)); // Make it a smaller cube
-			glUniformMatrix4fv(glGetUniformLocation(lampProgramId, "model"), 1, GL_FALSE, &model[0][0]);
+			lampProgram.set(lampModelHandle, model);
 			glDrawArrays(GL_TRIANGLES, 0, 36);
 		}
+	};
+
+	if (lightBenchmarkFrames != 0)
+	{
+		GLuint queryId{};
+		glGenQueries(1, &queryId);
+
+		std::cout << "clustered lighting benchmark, " << WIDTH << "x" << HEIGHT << ", " << lightBenchmarkFrames << " frames per run, "
+			<< simd_support::level_name(clusters.get_level()) << " cluster build" << std::endl;
+		for (std::size_t count : { std::size_t{ 16 }, std::size_t{ 256 }, std::size_t{ 1024 }, std::size_t{ 2048 }, std::size_t{ 4096 } })
+		{
+			clusters.set_lights(scatterPointLights(count));
+			for (std::size_t allLights = 0; allLights < 2; ++allLights)
+			{
+				cube_variant& cube{ clusteredVariants[allLights][flashLightOn ? 1 : 0] };
+
+				// the first frame pays for first touches of the buffers.
+				renderScene(cube, true);
+				glFinish();
+
+				clusterMilliseconds = 0.0;
+				GLuint64 gpuNanoseconds{};
+				for (std::size_t frame = 0; frame < lightBenchmarkFrames; ++frame)
+				{
+					glBeginQuery(GL_TIME_ELAPSED, queryId);
+					renderScene(cube, true);
+					glEndQuery(GL_TIME_ELAPSED);
+
+					GLuint64 elapsed{};
+					glGetQueryObjectui64v(queryId, GL_QUERY_RESULT, &elapsed);
+					gpuNanoseconds += elapsed;
+				}
+
+				std::cout << "    " << std::setw(5) << count << " lights " << (allLights != 0 ? "unculled " : "clustered") << " " << std::fixed << std::setprecision(3)
+					<< static_cast<double>(gpuNanoseconds) / lightBenchmarkFrames / 1e6 << " ms/frame GPU, "
+					<< clusterMilliseconds / lightBenchmarkFrames << " ms/frame building clusters, " << std::setprecision(1)
+					<< static_cast<double>(clusters.get_index_count()) / CLUSTER_COUNT << " lights per cluster" << std::endl;
+			}
+		}
+
+		std::cout.unsetf(std::ios::fixed);
+		std::cout << std::setprecision(6);
+		glDeleteQueries(1, &queryId);
+		glfwSetWindowShouldClose(window, true);
+	}
+
+	while (!glfwWindowShouldClose(window))
+	{
+		// per-frame time logic
+		float currentFrame = glfwGetTime();
+		delta_time = currentFrame - last_frame;
+		last_frame = currentFrame;
+
+		// input
+		// -----
+		processInput(window);
+
+		if (clustered)
+		{
+			renderScene(clusteredVariants[unculled ? 1 : 0][flashLightOn ? 1 : 0], true);
+		}
+		else
+		{
+			renderScene(cubeVariants[activePointLights][flashLightOn ? 1 : 0], false);
+		}
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		if (benchmark_frames != 0 && ++renderedFrames == benchmark_frames)
+		{
+			std::size_t uploads{ lampProgram.get_upload_count() };
+			std::size_t skipped{ lampProgram.get_skipped_count() };
+			for (const cube_variant* variant : allVariants)
+			{
+				uploads += variant->program_->get_upload_count();
+				skipped += variant->program_->get_skipped_count();
+			}
+
+			std::cout << renderedFrames << " frames, " << uniformMilliseconds * 1000.0 / renderedFrames << " us/frame updating camera and lights, "
+				<< static_cast<double>(uploads) / renderedFrames << " uploads/frame, "
+				<< static_cast<double>(skipped) / renderedFrames << " redundant skipped/frame" << std::endl;
+			if (clustered)
+			{
+				clusters.print(std::cout);
+				std::cout << ", " << clusterMilliseconds * 1000.0 / renderedFrames << " us/frame building and uploading them" << std::endl;
+			}
+			break;
+		}
 	}
 
 	// optional: de-allocate all resources once they've outlived their purpose:
@@ -820,6 +870,9 @@ int main()
 	glDeleteVertexArrays(1, &cubeVAO);
 	glDeleteVertexArrays(1, &lampVAO);
 	glDeleteBuffers(1, &VBO);
+	lightBuffer.reset();
+	cameraBuffer.reset();
+	programs.reset();
 
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
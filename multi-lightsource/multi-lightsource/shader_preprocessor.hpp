@@ -0,0 +1,173 @@
+#ifndef __SHADER_PREPROCESSOR_HPP__
+#define __SHADER_PREPROCESSOR_HPP__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+
+
+// "#define NAME VALUE" lines, in the order they were added, for the permutations of one shader.
+class shader_defines final
+{
+private:
+	std::basic_string<char> text_{};
+
+public:
+	shader_defines& define(const std::basic_string<char>& name, const std::basic_string<char>& value = "1")
+	{
+		this->text_ += "#define " + name + " " + value + "\n";
+		return *this;
+	}
+
+	shader_defines& define(const std::basic_string<char>& name, int value)
+	{
+		return this->define(name, std::to_string(value));
+	}
+
+	const std::basic_string<char>& str()const noexcept
+	{
+		return this->text_;
+	}
+};
+
+
+// expands #include "file" directives of glsl files, paths are relative to the including file.
+// every file is pasted once per expansion, so include files need no guards and a cycle just stops.
+// #line directives keep compile errors pointing at the right line, the second number indexes get_files().
+class shader_preprocessor final
+{
+private:
+	std::vector<std::basic_string<char>> files_{};
+	bool succeeded_{ true };
+
+public:
+	// the expanded source of glsl_file, with defines right after its #version line.
+	static std::basic_string<char> expand(const std::basic_string<char>& glsl_file, const std::basic_string<char>& defines = {})
+	{
+		shader_preprocessor preprocessor{};
+		return shader_preprocessor::insert_defines(preprocessor.expand_file(glsl_file), defines);
+	}
+
+	const std::vector<std::basic_string<char>>& get_files()const noexcept
+	{
+		return this->files_;
+	}
+
+	bool succeeded()const noexcept
+	{
+		return this->succeeded_;
+	}
+
+	std::basic_string<char> expand_file(const std::basic_string<char>& glsl_file)
+	{
+		std::size_t file_index{ this->files_.size() };
+		this->files_.push_back(glsl_file);
+
+		std::basic_ifstream<char> file_reader{ glsl_file };
+		if (!file_reader.is_open())
+		{
+			std::cout << "SHADER_PREPROCESSOR:: can not open: " << glsl_file << std::endl;
+			this->succeeded_ = false;
+			return {};
+		}
+
+		std::basic_string<char> expanded{};
+		std::basic_string<char> line{};
+		std::size_t line_number{ 0 };
+
+		while (std::getline(file_reader, line))
+		{
+			++line_number;
+
+			std::basic_string<char> include_file{};
+			if (!shader_preprocessor::parse_include(line, include_file))
+			{
+				expanded += line;
+				expanded.push_back('\n');
+				continue;
+			}
+
+			std::basic_string<char> include_path{ shader_preprocessor::directory_of(glsl_file) + include_file };
+			if (std::find(this->files_.begin(), this->files_.end(), include_path) == this->files_.end())
+			{
+				expanded += "#line 1 " + std::to_string(this->files_.size()) + "\n";
+				expanded += this->expand_file(include_path);
+			}
+
+			expanded += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+		}
+
+		return expanded;
+	}
+
+	// #version has to stay the first statement, so defines go right after it.
+	static std::basic_string<char> insert_defines(const std::basic_string<char>& source, const std::basic_string<char>& defines)
+	{
+		if (defines.empty())
+		{
+			return source;
+		}
+
+		std::size_t insert_at{ 0 };
+		if (source.compare(0, 8, "#version") == 0)
+		{
+			std::size_t line_end{ source.find('\n') };
+			insert_at = line_end == std::basic_string<char>::npos ? source.size() : line_end + 1;
+		}
+
+		std::basic_string<char> result{ source.substr(0, insert_at) };
+		if (insert_at == source.size() && !result.empty())
+		{
+			result.push_back('\n');
+		}
+
+		result += defines;
+		if (insert_at != 0)
+		{
+			// the line after #version is line 2 again.
+			result += "#line 2\n";
+		}
+
+		result += source.substr(insert_at);
+		return result;
+	}
+
+private:
+	static std::basic_string<char> directory_of(const std::basic_string<char>& file)
+	{
+		std::size_t separator{ file.find_last_of("/\\") };
+		return separator == std::basic_string<char>::npos ? std::basic_string<char>{} : file.substr(0, separator + 1);
+	}
+
+	// matches `#include "name"` with optional blanks.
+	static bool parse_include(const std::basic_string<char>& line, std::basic_string<char>& include_file)
+	{
+		std::size_t position{ line.find_first_not_of(" \t") };
+		if (position == std::basic_string<char>::npos || line[position] != '#')
+		{
+			return false;
+		}
+
+		position = line.find_first_not_of(" \t", position + 1);
+		if (position == std::basic_string<char>::npos || line.compare(position, 7, "include") != 0)
+		{
+			return false;
+		}
+
+		std::size_t open_quote{ line.find('"', position + 7) };
+		std::size_t close_quote{ open_quote == std::basic_string<char>::npos ? open_quote : line.find('"', open_quote + 1) };
+		if (close_quote == std::basic_string<char>::npos)
+		{
+			return false;
+		}
+
+		include_file = line.substr(open_quote + 1, close_quote - open_quote - 1);
+		return true;
+	}
+};
+
+
+#endif // !__SHADER_PREPROCESSOR_HPP__
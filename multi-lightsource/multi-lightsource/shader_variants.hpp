@@ -0,0 +1,277 @@
+#ifndef __SHADER_VARIANTS_HPP__
+#define __SHADER_VARIANTS_HPP__
+
+#include <glad/glad.h>
+
+#include "shader.hpp"
+#include "shader_preprocessor.hpp"
+#include "program_cache.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+
+// GL_KHR_parallel_shader_compile, not part of the generated glad.
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+
+// compiles every permutation a demo asks for up front, one program per distinct expanded source.
+// each variant carries its own #defines(light counts, light types, texture presence...), so the fragment shaders
+// need no dynamic branches on them. all shaders are compiled and all programs linked before the first status query,
+// which lets the driver pipeline the work, on its own threads with GL_KHR_parallel_shader_compile.
+// programs already linked by an earlier run come from program_cache::shared().
+class shader_variants final
+{
+private:
+	struct variant
+	{
+		std::vector<program_stage> stages_{};
+		GLuint program_id_{};
+	};
+
+	// distinct variants, requests_ maps every add() to one of them.
+	std::vector<variant> variants_{};
+	std::vector<std::size_t> requests_{};
+	std::unordered_map<std::uint64_t, std::size_t> variant_by_hash_{};
+
+	bool parallel_compile_{ false };
+	double compile_milliseconds_{};
+	std::size_t cached_count_{};
+
+public:
+	shader_variants() = default;
+	shader_variants(const shader_variants&) = delete;
+	shader_variants& operator=(const shader_variants&) = delete;
+
+	~shader_variants()
+	{
+		for (const variant& the_variant : this->variants_)
+		{
+			glDeleteProgram(the_variant.program_id_);
+		}
+	}
+
+	// asks the driver to compile on as many threads as it likes. get_proc_address is glfwGetProcAddress or alike.
+	bool enable_parallel_compile(GLADloadproc get_proc_address)
+	{
+		using max_threads_proc = void(APIENTRYP)(GLuint);
+
+		const char* function_name{ nullptr };
+		if (shader_variants::has_extension("GL_KHR_parallel_shader_compile"))
+		{
+			function_name = "glMaxShaderCompilerThreadsKHR";
+		}
+		else if (shader_variants::has_extension("GL_ARB_parallel_shader_compile"))
+		{
+			function_name = "glMaxShaderCompilerThreadsARB";
+		}
+
+		max_threads_proc max_threads{ function_name ? reinterpret_cast<max_threads_proc>(get_proc_address(function_name)) : nullptr };
+		if (!max_threads)
+		{
+			return false;
+		}
+
+		// 0xFFFFFFFF: implementation defined maximum.
+		max_threads(0xFFFFFFFFu);
+		this->parallel_compile_ = true;
+		return true;
+	}
+
+	// returns the request index to pass to get_program() after compile_all().
+	std::size_t add(const std::basic_string<char>& vertex_file, const std::basic_string<char>& fragment_file,
+		const shader_defines& defines = {}, const std::basic_string<char>& geometry_file = {})
+	{
+		variant new_variant{};
+		new_variant.stages_.push_back(program_stage{ shader_type::vertex_shader, shader_preprocessor::expand(vertex_file, defines.str()) });
+		new_variant.stages_.push_back(program_stage{ shader_type::fragment_shader, shader_preprocessor::expand(fragment_file, defines.str()) });
+		if (!geometry_file.empty())
+		{
+			new_variant.stages_.push_back(program_stage{ shader_type::geometry_shader, shader_preprocessor::expand(geometry_file, defines.str()) });
+		}
+
+		std::uint64_t hash{ shader_variants::hash_stages(new_variant.stages_) };
+		auto variant_itr{ this->variant_by_hash_.find(hash) };
+		if (variant_itr == this->variant_by_hash_.end())
+		{
+			variant_itr = this->variant_by_hash_.emplace(hash, this->variants_.size()).first;
+			this->variants_.push_back(std::move(new_variant));
+		}
+
+		this->requests_.push_back(variant_itr->second);
+		return this->requests_.size() - 1;
+	}
+
+	void compile_all()
+	{
+		auto compile_begin{ std::chrono::steady_clock::now() };
+
+		// 1. whatever an earlier run already linked.
+		std::vector<std::size_t> pending{};
+		for (std::size_t index = 0; index < this->variants_.size(); ++index)
+		{
+			variant& the_variant{ this->variants_[index] };
+			if (the_variant.program_id_ != 0)
+			{
+				continue;
+			}
+
+			the_variant.program_id_ = program_cache::shared().load(the_variant.stages_);
+			if (the_variant.program_id_ != 0)
+			{
+				++this->cached_count_;
+			}
+			else
+			{
+				pending.push_back(index);
+			}
+		}
+
+		// 2. submit every compile and link without asking for a result.
+		std::vector<std::vector<GLuint>> shader_ids(pending.size());
+		for (std::size_t pending_index = 0; pending_index < pending.size(); ++pending_index)
+		{
+			variant& the_variant{ this->variants_[pending[pending_index]] };
+			for (const program_stage& stage : the_variant.stages_)
+			{
+				GLuint shader_id{ glCreateShader(shader_variants::to_gl_stage(stage.type_)) };
+				const char* source{ stage.source_.c_str() };
+				glShaderSource(shader_id, 1, &source, nullptr);
+				glCompileShader(shader_id);
+				shader_ids[pending_index].push_back(shader_id);
+			}
+		}
+
+		for (std::size_t pending_index = 0; pending_index < pending.size(); ++pending_index)
+		{
+			variant& the_variant{ this->variants_[pending[pending_index]] };
+			the_variant.program_id_ = glCreateProgram();
+			program_cache::prepare_program(the_variant.program_id_);
+
+			for (GLuint shader_id : shader_ids[pending_index])
+			{
+				glAttachShader(the_variant.program_id_, shader_id);
+			}
+
+			glLinkProgram(the_variant.program_id_);
+		}
+
+		// 3. now wait, in submission order.
+		for (std::size_t pending_index = 0; pending_index < pending.size(); ++pending_index)
+		{
+			variant& the_variant{ this->variants_[pending[pending_index]] };
+
+			GLint linked{};
+			glGetProgramiv(the_variant.program_id_, GL_LINK_STATUS, &linked);
+			if (!linked)
+			{
+				// report which stage failed, or the link error itself.
+				for (std::size_t stage_index = 0; stage_index < shader_ids[pending_index].size(); ++stage_index)
+				{
+					shader::checkout_shader_state(shader_ids[pending_index][stage_index], the_variant.stages_[stage_index].type_);
+				}
+
+				shader::checkout_shader_state(the_variant.program_id_, shader_type::program);
+				glDeleteProgram(the_variant.program_id_);
+				the_variant.program_id_ = 0;
+			}
+			else
+			{
+				program_cache::shared().store(the_variant.stages_, {}, the_variant.program_id_);
+			}
+
+			for (GLuint shader_id : shader_ids[pending_index])
+			{
+				glDeleteShader(shader_id);
+			}
+		}
+
+		double milliseconds{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compile_begin).count() };
+		this->compile_milliseconds_ += milliseconds;
+		program_cache::shared().add_milliseconds(milliseconds);
+	}
+
+	// 0 when the variant failed to compile or compile_all() was not called yet.
+	GLuint get_program(std::size_t request)const
+	{
+		return this->variants_[this->requests_[request]].program_id_;
+	}
+
+	std::size_t get_request_count()const noexcept
+	{
+		return this->requests_.size();
+	}
+
+	std::size_t get_variant_count()const noexcept
+	{
+		return this->variants_.size();
+	}
+
+	void print(std::ostream& out)const
+	{
+		out << "shader variants: " << this->requests_.size() << " requested, " << this->variants_.size() << " distinct, "
+			<< this->cached_count_ << " from the program cache, " << this->compile_milliseconds_ << " ms"
+			<< (this->parallel_compile_ ? " (parallel compile)" : "");
+	}
+
+private:
+	static bool has_extension(const char* name)
+	{
+		GLint extension_count{};
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+		for (GLint index = 0; index < extension_count; ++index)
+		{
+			const char* extension{ reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(index))) };
+			if (extension && std::strcmp(extension, name) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	static GLenum to_gl_stage(shader_type type)noexcept
+	{
+		switch (type)
+		{
+		case shader_type::geometry_shader: return GL_GEOMETRY_SHADER;
+		case shader_type::fragment_shader: return GL_FRAGMENT_SHADER;
+		default: return GL_VERTEX_SHADER;
+		}
+	}
+
+	static std::uint64_t hash_stages(const std::vector<program_stage>& stages)noexcept
+	{
+		// 64-bit FNV-1a over every stage, each one terminated by its type.
+		std::uint64_t hash{ 14695981039346656037ull };
+		for (const program_stage& stage : stages)
+		{
+			for (char character : stage.source_)
+			{
+				hash ^= static_cast<unsigned char>(character);
+				hash *= 1099511628211ull;
+			}
+
+			hash ^= static_cast<std::uint64_t>(stage.type_) + 0x100;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+};
+
+
+#endif // !__SHADER_VARIANTS_HPP__
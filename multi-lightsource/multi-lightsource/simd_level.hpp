@@ -0,0 +1,123 @@
+#ifndef __SIMD_LEVEL_HPP__
+#define __SIMD_LEVEL_HPP__
+
+#include <vector>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// msvc compiles any intrinsic as it is, gcc and clang only inside functions built for the instruction set.
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+
+enum class simd_level
+{
+	scalar,
+	sse,
+	avx2
+};
+
+
+// the instruction sets the SIMD code paths pick from at run time.
+class simd_support final
+{
+public:
+	static const char* level_name(simd_level level)noexcept
+	{
+		switch (level)
+		{
+		case simd_level::avx2: return "avx2";
+		case simd_level::sse: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	// the widest level both the CPU and the OS(saved ymm registers) support.
+	static simd_level detect()
+	{
+#if defined(SIMD_X86)
+		unsigned int leaf0[4]{};
+		unsigned int leaf1[4]{};
+		unsigned int leaf7[4]{};
+		simd_support::cpuid(0, 0, leaf0);
+		simd_support::cpuid(1, 0, leaf1);
+		if (leaf0[0] >= 7)
+		{
+			simd_support::cpuid(7, 0, leaf7);
+		}
+
+		bool has_osxsave{ (leaf1[2] & (1u << 27)) != 0 };
+		bool has_avx{ (leaf1[2] & (1u << 28)) != 0 };
+		bool has_avx2{ (leaf7[1] & (1u << 5)) != 0 };
+		if (has_osxsave && has_avx && has_avx2 && (simd_support::xgetbv0() & 0x6) == 0x6)
+		{
+			return simd_level::avx2;
+		}
+
+		return simd_level::sse;
+#else
+		return simd_level::scalar;
+#endif
+	}
+
+	// the levels from scalar up to the detected one, what benchmarks compare.
+	static std::vector<simd_level> available_levels()
+	{
+		std::vector<simd_level> levels{ simd_level::scalar };
+		simd_level best_level{ simd_support::detect() };
+		if (best_level != simd_level::scalar)
+		{
+			levels.push_back(simd_level::sse);
+		}
+		if (best_level == simd_level::avx2)
+		{
+			levels.push_back(simd_level::avx2);
+		}
+
+		return levels;
+	}
+
+private:
+#if defined(SIMD_X86)
+	static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+	{
+#if defined(_MSC_VER)
+		int values[4]{};
+		__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+		for (std::size_t index = 0; index < 4; ++index)
+		{
+			registers[index] = static_cast<unsigned int>(values[index]);
+		}
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	// which register files the OS saves on a context switch, bits 1 and 2 are xmm and ymm.
+	static unsigned long long xgetbv0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax{}, edx{};
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+#endif
+};
+
+
+#endif // !__SIMD_LEVEL_HPP__
@@ -0,0 +1,106 @@
+#ifndef __UNIFORM_BLOCKS_HPP__
+#define __UNIFORM_BLOCKS_HPP__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <cstddef>
+
+
+// fixed binding points, every program declaring one of these blocks is bound to the same point.
+static constexpr const GLuint CAMERA_BLOCK_BINDING{ 0 };
+static constexpr const GLuint LIGHT_BLOCK_BINDING{ 1 };
+
+
+// mirror of:
+//   layout (std140) uniform camera_block
+//   {
+//       mat4 projection;
+//       mat4 view;
+//       vec4 camera_position;
+//   };
+struct camera_block
+{
+	glm::mat4 projection_;
+	glm::mat4 view_;
+	glm::vec4 camera_position_;
+};
+
+static_assert(offsetof(camera_block, projection_) == 0, "camera_block.projection must match std140");
+static_assert(offsetof(camera_block, view_) == 64, "camera_block.view must match std140");
+static_assert(offsetof(camera_block, camera_position_) == 128, "camera_block.camera_position must match std140");
+static_assert(sizeof(camera_block) == 144, "camera_block size must match std140");
+
+
+// binds the program's block_name to binding, needed because glsl 330 has no layout(binding = N).
+inline bool bind_uniform_block(GLuint program_id, const char* block_name, GLuint binding)
+{
+	GLuint block_index{ glGetUniformBlockIndex(program_id, block_name) };
+	if (block_index == GL_INVALID_INDEX)
+	{
+		return false;
+	}
+
+	glUniformBlockBinding(program_id, block_index, binding);
+	return true;
+}
+
+
+// a std140 uniform buffer holding one Block, attached to a fixed binding point and rewritten with one call per update.
+template<typename Block>
+class uniform_buffer final
+{
+private:
+	GLuint UBO_{};
+	GLuint binding_{};
+
+public:
+	explicit uniform_buffer(GLuint binding)
+		: binding_{ binding }
+	{
+		glGenBuffers(1, &this->UBO_);
+		glBindBuffer(GL_UNIFORM_BUFFER, this->UBO_);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		glBindBufferBase(GL_UNIFORM_BUFFER, this->binding_, this->UBO_);
+	}
+
+	uniform_buffer(const uniform_buffer&) = delete;
+	uniform_buffer& operator=(const uniform_buffer&) = delete;
+
+	~uniform_buffer()
+	{
+		glDeleteBuffers(1, &this->UBO_);
+	}
+
+	GLuint get_UBO()const noexcept
+	{
+		return this->UBO_;
+	}
+
+	GLuint get_binding()const noexcept
+	{
+		return this->binding_;
+	}
+
+	// attaches the program's block_name to this buffer's binding point.
+	void bind_to(GLuint program_id, const char* block_name)const
+	{
+		if (!bind_uniform_block(program_id, block_name, this->binding_))
+		{
+			std::cout << "UNIFORM_BUFFER:: program " << program_id << " has no block named: " << block_name << std::endl;
+		}
+	}
+
+	void update(const Block& block)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, this->UBO_);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+};
+
+
+#endif // !__UNIFORM_BLOCKS_HPP__
@@ -0,0 +1,25 @@
+#version 330 core
+// blended over the opaque scene with glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA).
+out vec4 frag_color;
+
+uniform sampler2D accumulation_texture;
+uniform sampler2D weight_texture;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 accumulation = texelFetch(accumulation_texture, texel, 0);
+
+    // nothing transparent covers this pixel.
+    float revealage = accumulation.a;
+    if (revealage >= 0.9999)
+        discard;
+
+    // half floats overflow under many near layers, white is then the least wrong color.
+    float weight = texelFetch(weight_texture, texel, 0).r;
+    vec3 color = accumulation.rgb;
+    if (isinf(max(max(abs(color.r), abs(color.g)), abs(color.b))))
+        color = vec3(weight);
+
+    frag_color = vec4(color / max(weight, 1e-5), 1.0 - revealage);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texcoords;
+
+out vec2 TexCoords;
+out float ViewDepth;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec4 view_position = view * model * vec4(position, 1.0);
+    TexCoords = texcoords;
+    ViewDepth = -view_position.z;
+    gl_Position = projection * view_position;
+}
\ No newline at end of file
@@ -7,12 +7,18 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#include <map>
 #include <vector>
+#include <functional>
+#include <random>
+#include <string>
 #include <atomic>
 #include <iostream>
 
 #include "shader.hpp"
+#include "transparency_sorter.hpp"
+#include "sort_benchmark.hpp"
+#include "oit_framebuffer.hpp"
+#include "oit_benchmark.hpp"
 #include "stb_image/stb_image.h"
 
 static  const int WIDTH{ 1280 };
@@ -187,14 +193,45 @@ static GLuint load_texture(const char * path)
 }
 
 
-int main()
+// command line:
+//   --windows N  scatter N more windows over the floor, next to the 5 placed ones.
+//   --sort-benchmark  time the radix transparency sorter against a per frame std::map at 10/1k/100k windows, no window is opened.
+//   --transparency M  sorted(default): blend the windows back to front. oit: weighted blended order independent transparency, unsorted.
+//   --compare-transparency N  render N frames in each mode in a hidden window, print their GPU time and how far the images differ, then exit.
+int main(int argc, char* argv[])
 {
+	std::size_t extra_windows{ 0 };
+	transparency_mode window_mode{ transparency_mode::sorted };
+	std::size_t compare_frames{ 0 };
+	for (int index = 1; index < argc; ++index)
+	{
+		std::basic_string<char> argument{ argv[index] };
+		if (argument == "--windows" && index + 1 < argc)
+		{
+			extra_windows = std::stoul(argv[++index]);
+		}
+		else if (argument == "--sort-benchmark")
+		{
+			run_sort_benchmark(std::cout);
+			return 0;
+		}
+		else if (argument == "--transparency" && index + 1 < argc)
+		{
+			window_mode = std::basic_string<char>{ argv[++index] } == "oit" ? transparency_mode::oit : transparency_mode::sorted;
+		}
+		else if (argument == "--compare-transparency" && index + 1 < argc)
+		{
+			compare_frames = std::stoul(argv[++index]);
+		}
+	}
+
 	// glfw: initialize and configure
 // ------------------------------
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, compare_frames == 0 ? GLFW_TRUE : GLFW_FALSE);
 
 	// glfw window creation
 	// --------------------
@@ -213,7 +250,10 @@ int main()
 	glfwSetScrollCallback(window, scroll_callback);
 
 	// tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (compare_frames == 0)
+	{
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	// glad: load all OpenGL function pointers
 	// ---------------------------------------
@@ -226,10 +266,8 @@ int main()
 	// update camera parameters.
 	update_camera_vectors();
 
-	// configure global opengl state
+	// configure global opengl state, blending is turned on only for the windows.
 	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 
 	GLuint vertex_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\depth_test\\depth_test\\glsl\\stencil_testing_vertex_shader.glsl", shader_type::vertex_shader) };
@@ -244,6 +282,30 @@ int main()
 	shader::checkout_shader_state(program_id, shader_type::program);
 
 
+	// the unsorted windows write weighted color and revealage, the composite pass blends them over the scene.
+	GLuint oit_vertex_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\window_blending\\window_blending\\glsl\\oit_vertex_shader.glsl", shader_type::vertex_shader) };
+	GLuint oit_fragment_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\window_blending\\window_blending\\glsl\\oit_accumulation_fragment_shader.glsl", shader_type::fragment_shader) };
+
+	GLuint oit_program_id{ glCreateProgram() };
+	glAttachShader(oit_program_id, oit_vertex_shader_id);
+	glAttachShader(oit_program_id, oit_fragment_shader_id);
+	glLinkProgram(oit_program_id);
+	glDeleteShader(oit_vertex_shader_id);
+	glDeleteShader(oit_fragment_shader_id);
+	shader::checkout_shader_state(oit_program_id, shader_type::program);
+
+	GLuint composite_vertex_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\window_blending\\window_blending\\glsl\\oit_composite_vertex_shader.glsl", shader_type::vertex_shader) };
+	GLuint composite_fragment_shader_id{ shader::create("C:\\Users\\shihua\\source\\repos\\opengl_demo\\window_blending\\window_blending\\glsl\\oit_composite_fragment_shader.glsl", shader_type::fragment_shader) };
+
+	GLuint composite_program_id{ glCreateProgram() };
+	glAttachShader(composite_program_id, composite_vertex_shader_id);
+	glAttachShader(composite_program_id, composite_fragment_shader_id);
+	glLinkProgram(composite_program_id);
+	glDeleteShader(composite_vertex_shader_id);
+	glDeleteShader(composite_fragment_shader_id);
+	shader::checkout_shader_state(composite_program_id, shader_type::program);
+
+
 
 	// set up vertex data (and buffer(s)) and configure vertex attributes
 	// ------------------------------------------------------------------
@@ -395,29 +457,36 @@ int main()
 		glm::vec3(0.5f, 0.0f, -0.6f)
 	};
 
+	std::mt19937 generator{ 42 };
+	std::uniform_real_distribution<float> floor_position{ -4.5f, 4.5f };
+	for (std::size_t index = 0; index < extra_windows; ++index)
+	{
+		windows_locations.push_back(glm::vec3{ floor_position(generator), 0.0f, floor_position(generator) });
+	}
 
-	glUseProgram(program_id);
-	shader::set_int(program_id, "texture_1", 0);
-
-
-	while (!glfwWindowShouldClose(window))
+	// the windows do not move, only the camera: their positions go in once.
+	transparency_sorter window_sorter{};
+	window_sorter.reserve(windows_locations.size());
+	for (const glm::vec3& location : windows_locations)
 	{
-		double current_time{ glfwGetTime() };
-		delta_time = current_time - last_frame;
-		last_frame = current_time;
+		window_sorter.add(location);
+	}
+	std::cout << "WINDOW_BLENDING:: sorting " << windows_locations.size() << " windows, " << simd_support::level_name(window_sorter.get_level()) << std::endl;
 
-		process_input(window);
 
-		// sort the transparent windows before rendering
-// ---------------------------------------------
-		std::map<float, glm::vec3> sorted;
-		for (std::size_t index = 0; index < windows_locations.size(); ++index)
-		{
-			float distance = glm::length(camera_pos - windows_locations[index]);
-			sorted[distance] = windows_locations[index];
-		}
+	glUseProgram(program_id);
+	shader::set_int(program_id, "texture_1", 0);
+	glUseProgram(oit_program_id);
+	shader::set_int(oit_program_id, "texture_1", 0);
 
+	// both modes draw into the same offscreen scene, which is then copied to the window.
+	oit_framebuffer targets{};
+	targets.create(WIDTH, HEIGHT, composite_program_id);
 
+
+	std::function<void(transparency_mode)> render_frame{ [&](transparency_mode mode)
+	{
+		targets.begin_scene();
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -449,16 +518,62 @@ int main()
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 
 
-		// windows (from furthest to nearest)
 		glBindVertexArray(window_VAO);
 		glBindTexture(GL_TEXTURE_2D, window_texture_id);
-		for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it)
+		if (mode == transparency_mode::sorted)
+		{
+			// windows (from furthest to nearest), windows at the same depth keep their order
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			for (std::uint32_t index : window_sorter.sort(view))
+			{
+				model = glm::mat4(1.0f);
+				model = glm::translate(model, windows_locations[index]);
+				shader::set_mat4(program_id, "model", model);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+			glDisable(GL_BLEND);
+		}
+		else
 		{
-			model = glm::mat4(1.0f);
-			model = glm::translate(model, it->second);
-			shader::set_mat4(program_id, "model", model);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+			// windows in any order, intersecting ones included.
+			targets.begin_accumulation();
+			glUseProgram(oit_program_id);
+			shader::set_mat4(oit_program_id, "projection", projection);
+			shader::set_mat4(oit_program_id, "view", view);
+			for (const glm::vec3& location : windows_locations)
+			{
+				model = glm::mat4(1.0f);
+				model = glm::translate(model, location);
+				shader::set_mat4(oit_program_id, "model", model);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+			targets.composite();
 		}
+	} };
+
+	if (compare_frames != 0)
+	{
+		run_transparency_comparison(std::cout, targets, compare_frames, render_frame);
+		targets.destroy();
+		glfwTerminate();
+		return 0;
+	}
+
+
+	while (!glfwWindowShouldClose(window))
+	{
+		double current_time{ glfwGetTime() };
+		delta_time = current_time - last_frame;
+		last_frame = current_time;
+
+		process_input(window);
+
+		render_frame(window_mode);
+
+		int window_width{}, window_height{};
+		glfwGetFramebufferSize(window, &window_width, &window_height);
+		targets.present(window_width, window_height);
 
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -475,6 +590,7 @@ int main()
 	glDeleteBuffers(1, &cube_VBO);
 	glDeleteBuffers(1, &floor_VBO);
 	glDeleteBuffers(1, &window_VBO);
+	targets.destroy();
 
 	glfwTerminate();
 	return 0;
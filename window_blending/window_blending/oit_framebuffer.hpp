@@ -0,0 +1,222 @@
+#ifndef __OIT_FRAMEBUFFER_HPP__
+#define __OIT_FRAMEBUFFER_HPP__
+
+#include <glad/glad.h>
+
+#include "shader.hpp"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+
+enum class transparency_mode
+{
+	sorted,
+	oit
+};
+
+
+// render targets for weighted blended order independent transparency(McGuire and Bavoil 2013), built like framebuffer_primary's:
+// the scene renders into a color texture and depth/stencil renderbuffer, transparent surfaces then go unsorted into an RGBA16F
+// accumulation texture and an R16F weight texture that share the scene's depth, and composite() blends their weighted average over the scene.
+// OpenGL 3.3 has one blend state for all draw buffers, so revealage rides in the accumulation alpha:
+// glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA) sums the colors and weights and multiplies up the revealage.
+// sorted mode uses the scene targets alone, so both modes end up in the same texture and can be compared.
+class oit_framebuffer final
+{
+private:
+	int width_{};
+	int height_{};
+
+	GLuint scene_framebuffer_{};
+	GLuint scene_color_{};
+	GLuint depth_stencil_{};
+
+	GLuint accumulation_framebuffer_{};
+	GLuint accumulation_{};
+	GLuint weight_{};
+
+	GLuint composite_program_{};
+	GLuint empty_VAO_{};
+
+public:
+	oit_framebuffer() = default;
+	oit_framebuffer(const oit_framebuffer&) = delete;
+	oit_framebuffer& operator=(const oit_framebuffer&) = delete;
+
+	~oit_framebuffer()
+	{
+		this->destroy();
+	}
+
+	static const char* mode_name(transparency_mode mode)noexcept
+	{
+		return mode == transparency_mode::oit ? "oit" : "sorted";
+	}
+
+	int get_width()const noexcept
+	{
+		return this->width_;
+	}
+
+	int get_height()const noexcept
+	{
+		return this->height_;
+	}
+
+	GLuint get_scene_framebuffer()const noexcept
+	{
+		return this->scene_framebuffer_;
+	}
+
+	// composite_program is linked from oit_composite_vertex_shader.glsl and oit_composite_fragment_shader.glsl.
+	bool create(int width, int height, GLuint composite_program)
+	{
+		this->destroy();
+		this->width_ = width;
+		this->height_ = height;
+		this->composite_program_ = composite_program;
+
+		glGenFramebuffers(1, &this->scene_framebuffer_);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->scene_framebuffer_);
+		this->scene_color_ = oit_framebuffer::create_target(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->scene_color_, 0);
+
+		glGenRenderbuffers(1, &this->depth_stencil_);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->depth_stencil_);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depth_stencil_);
+		bool complete{ oit_framebuffer::check_complete("scene") };
+
+		glGenFramebuffers(1, &this->accumulation_framebuffer_);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->accumulation_framebuffer_);
+		this->accumulation_ = oit_framebuffer::create_target(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, width, height);
+		this->weight_ = oit_framebuffer::create_target(GL_R16F, GL_RED, GL_HALF_FLOAT, width, height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->accumulation_, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, this->weight_, 0);
+		// transparent surfaces are depth tested against the opaque scene, never write it.
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depth_stencil_);
+
+		const GLenum draw_buffers[]{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, draw_buffers);
+		complete = oit_framebuffer::check_complete("accumulation") && complete;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		// the composite triangle comes from gl_VertexID, a core profile draw still needs some VAO bound.
+		glGenVertexArrays(1, &this->empty_VAO_);
+
+		glUseProgram(this->composite_program_);
+		shader::set_int(this->composite_program_, "accumulation_texture", 0);
+		shader::set_int(this->composite_program_, "weight_texture", 1);
+		return complete;
+	}
+
+	void destroy()noexcept
+	{
+		if (this->scene_framebuffer_ == 0)
+		{
+			return;
+		}
+
+		const GLuint framebuffers[]{ this->scene_framebuffer_, this->accumulation_framebuffer_ };
+		const GLuint textures[]{ this->scene_color_, this->accumulation_, this->weight_ };
+		glDeleteFramebuffers(2, framebuffers);
+		glDeleteTextures(3, textures);
+		glDeleteRenderbuffers(1, &this->depth_stencil_);
+		glDeleteVertexArrays(1, &this->empty_VAO_);
+		this->scene_framebuffer_ = 0;
+	}
+
+	// opaque geometry, and in sorted mode the blended surfaces back to front.
+	void begin_scene()const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, this->scene_framebuffer_);
+		glViewport(0, 0, this->width_, this->height_);
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
+	}
+
+	// after the opaque geometry: transparent surfaces in any order, with a program writing accumulation and weight.
+	void begin_accumulation()const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, this->accumulation_framebuffer_);
+		const GLfloat clear_accumulation[]{ 0.0f, 0.0f, 0.0f, 1.0f };
+		const GLfloat clear_weight[]{ 0.0f, 0.0f, 0.0f, 0.0f };
+		glClearBufferfv(GL_COLOR, 0, clear_accumulation);
+		glClearBufferfv(GL_COLOR, 1, clear_weight);
+
+		glDepthMask(GL_FALSE);
+		glEnable(GL_BLEND);
+		glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	// blends the accumulated surfaces over the scene, then leaves blending off and depth writes on.
+	void composite()const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, this->scene_framebuffer_);
+		glDisable(GL_DEPTH_TEST);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		glUseProgram(this->composite_program_);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, this->accumulation_);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, this->weight_);
+		glBindVertexArray(this->empty_VAO_);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+		glDisable(GL_BLEND);
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
+	}
+
+	// copies the scene to the window, scaled to its framebuffer size.
+	void present(int window_width, int window_height)const
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, this->scene_framebuffer_);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, this->width_, this->height_, 0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// rgba rows of the scene, bottom up.
+	std::vector<std::uint8_t> read_scene()const
+	{
+		std::vector<std::uint8_t> pixels(static_cast<std::size_t>(this->width_) * this->height_ * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, this->scene_framebuffer_);
+		glReadPixels(0, 0, this->width_, this->height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		return pixels;
+	}
+
+private:
+	static GLuint create_target(GLint internal_format, GLenum format, GLenum type, int width, int height)
+	{
+		GLuint texture_id{};
+		glGenTextures(1, &texture_id);
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+		glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture_id;
+	}
+
+	static bool check_complete(const char* name)
+	{
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR::FRAMEBUFFER:: " << name << " framebuffer is not complete!" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+};
+
+
+#endif // !__OIT_FRAMEBUFFER_HPP__
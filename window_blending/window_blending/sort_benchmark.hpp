@@ -0,0 +1,131 @@
+#ifndef __SORT_BENCHMARK_HPP__
+#define __SORT_BENCHMARK_HPP__
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "transparency_sorter.hpp"
+
+#include <map>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+// times the per frame std::map<float, glm::vec3> distance sort the demo used against transparency_sorter on every level the CPU runs,
+// for 10, 1k and 100k windows scattered in front of the camera, in microseconds per frame: building the order and walking it once.
+// each order is checked against std::stable_sort of the same depths, then mirrored pairs of windows show what the map drops.
+inline void run_sort_benchmark(std::ostream& out)
+{
+	glm::vec3 camera{ 0.0f, 1.0f, 3.0f };
+	glm::mat4 view{ glm::lookAt(camera, glm::vec3{ 0.0f, 0.0f, -20.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f }) };
+
+	std::vector<simd_level> levels{ simd_support::available_levels() };
+	out << "transparency sort benchmark, best level: " << simd_support::level_name(levels.back()) << std::endl;
+
+	std::mt19937 generator{ 42 };
+	std::uniform_real_distribution<float> spread{ -40.0f, 40.0f };
+	std::uniform_real_distribution<float> distance{ 0.5f, 80.0f };
+	for (std::size_t count : { std::size_t{ 10 }, std::size_t{ 1000 }, std::size_t{ 100000 } })
+	{
+		std::vector<glm::vec3> windows(count);
+		for (glm::vec3& window : windows)
+		{
+			window = glm::vec3{ spread(generator), spread(generator) * 0.25f, -distance(generator) };
+		}
+
+		// about the same total work for every count.
+		std::size_t repeats{ std::max<std::size_t>(4, 2000000 / count) };
+
+		// summed positions keep the walk from being optimized away.
+		float checksum{};
+		auto begin{ std::chrono::steady_clock::now() };
+		std::size_t map_kept{};
+		for (std::size_t repeat = 0; repeat < repeats; ++repeat)
+		{
+			std::map<float, glm::vec3> sorted;
+			for (const glm::vec3& window : windows)
+			{
+				sorted[glm::length(camera - window)] = window;
+			}
+
+			for (auto it = sorted.rbegin(); it != sorted.rend(); ++it)
+			{
+				checksum += it->second.x;
+			}
+			map_kept = sorted.size();
+		}
+		double map_seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / repeats };
+
+		out << "    " << std::setw(6) << count << " windows  std::map " << std::fixed << std::setprecision(2) << std::setw(10) << map_seconds * 1e6 << " us"
+			<< (map_kept != count ? " (dropped " + std::to_string(count - map_kept) + ")" : std::string{}) << std::endl;
+
+		for (simd_level level : levels)
+		{
+			transparency_sorter sorter{ level };
+			sorter.reserve(count);
+			for (const glm::vec3& window : windows)
+			{
+				sorter.add(window);
+			}
+
+			begin = std::chrono::steady_clock::now();
+			for (std::size_t repeat = 0; repeat < repeats; ++repeat)
+			{
+				for (std::uint32_t index : sorter.sort(view))
+				{
+					checksum += windows[index].x;
+				}
+			}
+			double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / repeats };
+
+			// farthest first, equal depths in the order they were added.
+			const std::vector<float>& depths{ sorter.get_depths() };
+			std::vector<std::uint32_t> reference(count);
+			for (std::size_t index = 0; index < count; ++index)
+			{
+				reference[index] = static_cast<std::uint32_t>(index);
+			}
+			std::stable_sort(reference.begin(), reference.end(), [&depths](std::uint32_t left, std::uint32_t right)
+			{
+				return depths[left] > depths[right];
+			});
+
+			out << "           " << std::setw(6) << simd_support::level_name(level) << " sorter " << std::setw(10) << seconds * 1e6 << " us ("
+				<< map_seconds / seconds << "x)" << (sorter.sort(view) != reference ? " MISMATCH" : "") << std::endl;
+		}
+
+		volatile float sink{ checksum };
+		static_cast<void>(sink);
+	}
+
+	// every window has a twin mirrored across the camera's axis: same distance, same depth.
+	std::vector<glm::vec3> pairs{};
+	for (std::size_t pair = 0; pair < 500; ++pair)
+	{
+		float x{ 0.5f + static_cast<float>(pair % 50) }, z{ -1.0f - static_cast<float>(pair / 50) };
+		pairs.push_back(glm::vec3{ -x, 1.0f, z });
+		pairs.push_back(glm::vec3{ x, 1.0f, z });
+	}
+
+	std::map<float, glm::vec3> sorted;
+	transparency_sorter sorter{};
+	for (const glm::vec3& window : pairs)
+	{
+		sorted[glm::length(camera - window)] = window;
+		sorter.add(window);
+	}
+	out << "    " << pairs.size() << " windows in mirrored pairs: std::map draws " << sorted.size() << ", sorter draws " << sorter.sort(view).size() << std::endl;
+
+	out.unsetf(std::ios::fixed);
+	out << std::setprecision(6);
+}
+
+
+#endif // !__SORT_BENCHMARK_HPP__